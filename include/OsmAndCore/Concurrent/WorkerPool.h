@@ -32,6 +32,7 @@ namespace OsmAnd
             };
 
             typedef std::function<bool (QRunnable* const l, QRunnable* const r)> SortPredicate;
+            typedef std::function<void ()> Job;
 
         private:
             PrivateImplementation<WorkerPool_P> _p;
@@ -56,6 +57,13 @@ namespace OsmAnd
 
             void sortQueue(const SortPredicate predicate);
 
+            // Executes given jobs and returns once all of them are complete. Jobs that were not yet
+            // picked by any worker are executed by calling thread, so it's safe to call this from a job
+            // that is itself executed by this pool. Jobs dropped from queue by reset() or dequeueAll()
+            // are executed by calling thread as well. Calling thread job (if any) is executed only by
+            // calling thread, before it joins workers
+            void executeAndWait(const QVector<Job>& jobs, const Job& callingThreadJob = nullptr);
+
             void reset();
         };
     }
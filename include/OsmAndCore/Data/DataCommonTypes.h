@@ -110,7 +110,9 @@ namespace OsmAnd
         uint64_t id;
         struct
         {
-            int sectionRuntimeGeneratedId;
+            int sectionRuntimeGeneratedId : 31;
+            // Block with simplified geometry is a different block than unsimplified one at same offset
+            unsigned int simplifiedGeometry : 1;
             uint32_t offset;
         };
 
@@ -31,6 +31,7 @@ namespace OsmAnd
 
         const QString filePath;
         const uint64_t fileSize;
+        const int64_t lastModifiedTime;
         const std::shared_ptr<const ObfInfo>& obfInfo;
 
         const QString getRegionName() const;
@@ -7,6 +7,7 @@
 #include <OsmAndCore/QtExtensions.h>
 #include <QList>
 #include <QSet>
+#include <QVector>
 
 #include <OsmAndCore.h>
 #include <OsmAndCore/CommonTypes.h>
@@ -36,6 +37,11 @@ namespace OsmAnd
             const ZoomLevel firstZoomLevel,
             const ZoomLevel lastZoomLevel,
             const ZoomLevel requestedZoomLevel) > FilterByIdFunction;
+        // Decides using only types of map object, before its points are read, whether it's needed
+        typedef std::function < bool(
+            const std::shared_ptr<const ObfMapSectionInfo>& section,
+            const QVector<uint32_t>& attributeIds,
+            const ZoomLevel requestedZoomLevel) > FilterByAttributesFunction;
         typedef std::function<bool(const std::shared_ptr<const OsmAnd::BinaryMapObject>&)> VisitorFunction;
         typedef ObfMapSectionDataBlockId DataBlockId;
 
@@ -80,6 +86,10 @@ namespace OsmAnd
         ~ObfMapSectionReader();
     protected:
     public:
+        // If simplifyGeometry is set, geometry of non-basemap objects is simplified while being read,
+        // dropping vertices that deviate less than half a pixel at the most detailed zoom of their level.
+        // Such geometry fits every zoom its level is read for, so cached blocks hold it as well,
+        // under block ids that differ from ids of unsimplified blocks
         static void loadMapObjects(
             const std::shared_ptr<const ObfReader>& reader,
             const std::shared_ptr<const ObfMapSectionInfo>& section,
@@ -92,7 +102,27 @@ namespace OsmAnd
             DataBlocksCache* cache = nullptr,
             QList< std::shared_ptr<const DataBlock> >* outReferencedCacheEntries = nullptr,
             const std::shared_ptr<const IQueryController>& queryController = nullptr,
-            ObfMapSectionReader_Metrics::Metric_loadMapObjects* const metric = nullptr);
+            ObfMapSectionReader_Metrics::Metric_loadMapObjects* const metric = nullptr,
+            const FilterByAttributesFunction filterByAttributes = nullptr,
+            const bool simplifyGeometry = false);
+
+        // Loads map objects of several tiles (or any other areas) of the same zoom in one pass:
+        // tree is traversed once, each intersecting block is read once and its objects are placed
+        // into results of all tiles they touch. Filter is invoked once per object
+        static void loadTiledMapObjects(
+            const std::shared_ptr<const ObfReader>& reader,
+            const std::shared_ptr<const ObfMapSectionInfo>& section,
+            const ZoomLevel zoom,
+            const QVector<AreaI>& tilesBBoxes31,
+            QVector< QList< std::shared_ptr<const OsmAnd::BinaryMapObject> > >* tilesResultsOut = nullptr,
+            QVector<MapSurfaceType>* outTilesSurfaceTypes = nullptr,
+            const FilterByIdFunction filterById = nullptr,
+            DataBlocksCache* cache = nullptr,
+            QList< std::shared_ptr<const DataBlock> >* outReferencedCacheEntries = nullptr,
+            const std::shared_ptr<const IQueryController>& queryController = nullptr,
+            ObfMapSectionReader_Metrics::Metric_loadMapObjects* const metric = nullptr,
+            const FilterByAttributesFunction filterByAttributes = nullptr,
+            const bool simplifyGeometry = false);
     };
 }
 
@@ -73,7 +73,13 @@ namespace OsmAnd
         FIELD_ACTION(float, elapsedTimeForNotSkippedMapObjectsPoints, "s");                     \
                                                                                                 \
         /* Number of points read from MapObjects that were not skipped */                       \
-        FIELD_ACTION(unsigned int, notSkippedMapObjectsPoints, "");
+        FIELD_ACTION(unsigned int, notSkippedMapObjectsPoints, "");                             \
+                                                                                                \
+        /* Number of MapObjects rejected by attributes */                                       \
+        FIELD_ACTION(unsigned int, skippedByAttributesMapObjects, "");                          \
+                                                                                                \
+        /* Number of points of MapObjects dropped by geometry simplification */                 \
+        FIELD_ACTION(unsigned int, simplifiedOutMapObjectsPoints, "");
 
         struct OSMAND_CORE_API Metric_loadMapObjects : public Metric
         {
@@ -28,6 +28,7 @@ namespace OsmAnd
     class ObfRoutingSectionReader;
     class ObfPoiSectionReader;
     class ObfTransportSectionReader;
+    class CachedOsmandIndexes_P;
 
     class ObfReader_P;
     class OSMAND_CORE_API ObfReader
@@ -37,12 +38,16 @@ namespace OsmAnd
         PrivateImplementation<ObfReader_P> _p;
     protected:
     public:
-        ObfReader(const std::shared_ptr<const ObfFile>& obfFile);
+        ObfReader(const std::shared_ptr<const ObfFile>& obfFile, const bool memoryMapped = false);
         ObfReader(const std::shared_ptr<QIODevice>& input);
         virtual ~ObfReader();
 
         const std::shared_ptr<const ObfFile> obfFile;
 
+        // Memory-mapped reader maps entire file once and gives each thread own stream over it,
+        // so it can be used concurrently from any number of threads
+        const bool memoryMapped;
+
         bool isOpened() const;
         bool open();
         bool close();
@@ -56,6 +61,7 @@ namespace OsmAnd
     friend class OsmAnd::ObfRoutingSectionReader;
     friend class OsmAnd::ObfPoiSectionReader;
     friend class OsmAnd::ObfTransportSectionReader;
+    friend class OsmAnd::CachedOsmandIndexes_P;
     };
 }
 
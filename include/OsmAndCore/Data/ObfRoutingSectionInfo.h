@@ -146,6 +146,7 @@ namespace OsmAnd
         AreaI area31;
 
     friend class OsmAnd::ObfRoutingSectionReader_P;
+    friend class OsmAnd::Road;
     };
 }
 
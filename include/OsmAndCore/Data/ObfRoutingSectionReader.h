@@ -7,6 +7,8 @@
 #include <OsmAndCore/QtExtensions.h>
 #include <QList>
 #include <QSet>
+#include <QMutex>
+#include <QAtomicInt>
 
 #include <OsmAndCore.h>
 #include <OsmAndCore/CommonTypes.h>
@@ -19,6 +21,7 @@ namespace OsmAnd
     class ObfRoutingSectionInfo;
     class ObfRoutingSectionLevelTreeNode;
     class Road;
+    class ObfRoutingSegmentsIndex;
     class IQueryController;
     namespace ObfRoutingSectionReader_Metrics
     {
@@ -36,6 +39,9 @@ namespace OsmAnd
         {
             Q_DISABLE_COPY_AND_MOVE(DataBlock);
         private:
+            mutable std::shared_ptr<const ObfRoutingSegmentsIndex> _segmentsIndex;
+            mutable QAtomicInt _segmentsIndexBuilt;
+            mutable QMutex _segmentsIndexBuildMutex;
         protected:
             DataBlock(
                 const DataBlockId id,
@@ -50,6 +56,11 @@ namespace OsmAnd
             const AreaI area31;
             const QList< std::shared_ptr<const OsmAnd::Road> > roads;
 
+#if !defined(SWIG)
+            // Grid of road segments, built on first request and kept while block lives
+            std::shared_ptr<const ObfRoutingSegmentsIndex> getSegmentsIndex() const;
+#endif // !defined(SWIG)
+
         friend class OsmAnd::ObfRoutingSectionReader;
         friend class OsmAnd::ObfRoutingSectionReader_P;
         };
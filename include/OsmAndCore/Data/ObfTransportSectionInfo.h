@@ -8,6 +8,7 @@
 
 #include <OsmAndCore.h>
 #include <OsmAndCore/CommonTypes.h>
+#include <OsmAndCore/PrivateImplementation.h>
 #include <OsmAndCore/Data/ObfSectionInfo.h>
 #include <OsmAndCore/CachedOsmandIndexes.h>
 
@@ -15,7 +16,9 @@ namespace OsmAnd {
 
     class ObfTransportSectionReader_P;
     class ObfReader_P;
+    class TransportNetwork;
 
+    class ObfTransportSectionInfo_P;
     class OSMAND_CORE_API ObfTransportSectionInfo : public ObfSectionInfo
     {
         Q_DISABLE_COPY_AND_MOVE(ObfTransportSectionInfo)
@@ -27,6 +30,7 @@ namespace OsmAnd {
         };
         
     private:
+        PrivateImplementation<ObfTransportSectionInfo_P> _p;
     protected:
         ObfTransportSectionInfo(const std::shared_ptr<const ObfInfo>& container);
 
@@ -47,6 +51,7 @@ namespace OsmAnd {
         friend class OsmAnd::ObfTransportSectionReader_P;
         friend class OsmAnd::ObfReader_P;
         friend class OsmAnd::CachedOsmandIndexes_P;
+        friend class OsmAnd::TransportNetwork;
     };
 
 } // namespace OsmAnd
@@ -40,10 +40,35 @@ namespace OsmAnd
         OnlyStraightOn = 7,
     };
 
+    // Points types and restrictions of all roads read from the same data block, packed into flat
+    // arrays shared by these roads instead of hash tables owned by each road
+    struct OSMAND_CORE_API RoadsPackedAttributes Q_DECL_FINAL
+    {
+        RoadsPackedAttributes();
+        ~RoadsPackedAttributes();
+
+        // Types of point pointsIndices[i] are types[typesOffsets[i]] ... types[typesOffsets[i + 1] - 1],
+        // typesSetsIds[i] identifies that set of types within section
+        QVector<uint32_t> pointsIndices;
+        QVector<int> typesOffsets;
+        QVector<uint32_t> types;
+        QVector<uint32_t> typesSetsIds;
+
+        // Restriction to road restrictionsDestinations[i] is restrictionsTypes[i]
+        QVector<ObfObjectId> restrictionsDestinations;
+        QVector<RoadRestriction> restrictionsTypes;
+    };
+
     class OSMAND_CORE_API Road Q_DECL_FINAL : public ObfMapObject
     {
         Q_DISABLE_COPY_AND_MOVE(Road);
     private:
+        std::shared_ptr<const RoadsPackedAttributes> _packedAttributes;
+        int _pointsTypesBegin;
+        int _pointsTypesEnd;
+        int _restrictionsBegin;
+        int _restrictionsEnd;
+        uint32_t _typesSetId;
     protected:
         Road(const std::shared_ptr<const ObfRoutingSectionInfo>& section);
     public:
@@ -53,8 +78,30 @@ namespace OsmAnd
         const std::shared_ptr<const ObfRoutingSectionInfo> section;
 
         // Road information
-        QHash< uint32_t, QVector<uint32_t> > pointsTypes;
-        QHash< ObfObjectId, RoadRestriction > restrictions;
+        // Roads and points of the same section that have equal types share identifier of types set
+        uint32_t getTypesSetId() const;
+        bool hasPointsTypes() const;
+#if !defined(SWIG)
+        // Returns types of point and their count, or nullptr if point has no types
+        const uint32_t* getPointTypes(
+            const uint32_t pointIndex,
+            int* const outTypesCount,
+            uint32_t* const outTypesSetId = nullptr) const;
+#endif // !defined(SWIG)
+        int getRestrictionsCount() const;
+        ObfObjectId getRestrictionDestination(const int restrictionIndex) const;
+        RoadRestriction getRestrictionType(const int restrictionIndex) const;
+        bool getRestriction(const ObfObjectId destinationRoadId, RoadRestriction* const outRestriction = nullptr) const;
+
+        // Copies of packed points types and restrictions in the form of former public fields, for bindings
+        QHash< uint32_t, QVector<uint32_t> > getPointsTypes() const;
+        QHash< ObfObjectId, RoadRestriction > getRestrictions() const;
+
+        RoadDirection getDirection() const;
+        bool isRoundabout() const;
+        int getLanes() const;
+        QString getHighway() const;
+        bool isLoop() const;
 
         QString getRefInNativeLanguage() const;
         QString getRefInLanguage(const QString& lang) const;
@@ -70,6 +117,17 @@ namespace OsmAnd
 
         const bool hasGeocodingAccess() const;
 
+        // Copy of road with extra point inserted at given index, e.g. projection of route start onto the road
+        static std::shared_ptr<Road> createWithInsertedPoint(
+            const std::shared_ptr<const Road>& road,
+            const int insertIdx,
+            const PointI& point31);
+        // Road without any types, that doesn't come from OBF file
+        static std::shared_ptr<Road> create(
+            const std::shared_ptr<const ObfRoutingSectionInfo>& section,
+            const ObfObjectId id,
+            const QVector<PointI>& points31);
+
     friend class OsmAnd::ObfRoutingSectionReader_P;
     };
 }
@@ -0,0 +1,77 @@
+#ifndef _OSMAND_CORE_TRANSPORT_JOURNEY_PLANNER_H_
+#define _OSMAND_CORE_TRANSPORT_JOURNEY_PLANNER_H_
+
+#include <OsmAndCore/stdlib_common.h>
+
+#include <OsmAndCore/QtExtensions.h>
+#include <QList>
+
+#include <OsmAndCore.h>
+#include <OsmAndCore/CommonTypes.h>
+
+namespace OsmAnd
+{
+    class TransportNetwork;
+    class TransportStop;
+    class TransportRoute;
+    class IQueryController;
+
+    // Earliest arrival search over transport network in rounds, as RAPTOR does: round K finds
+    // stops reached with K rides, scanning each route once from the first stop improved in
+    // previous round. Routes have no timetables, so boarding costs half of headway on average
+    class OSMAND_CORE_API TransportJourneyPlanner
+    {
+    public:
+        struct OSMAND_CORE_API Settings
+        {
+            Settings();
+
+            // Rides beyond first one
+            int maxTransfers;
+            // Farthest walk to first stop and from last stop, in meters
+            double maxWalkDistance;
+            // Average interval between vehicles of route, in seconds
+            int averageHeadway;
+        };
+
+        struct OSMAND_CORE_API Leg
+        {
+            Leg();
+
+            // Not set for walking legs
+            std::shared_ptr<const TransportRoute> route;
+            // Not set for walk from origin and walk to destination respectively
+            std::shared_ptr<const TransportStop> fromStop;
+            std::shared_ptr<const TransportStop> toStop;
+            // Seconds, same scale as departure time of query
+            int departureTime;
+            int arrivalTime;
+        };
+
+        struct OSMAND_CORE_API Journey
+        {
+            Journey();
+
+            QList<Leg> legs;
+            int arrivalTime;
+            int ridesCount;
+        };
+
+    private:
+        TransportJourneyPlanner();
+        ~TransportJourneyPlanner();
+    protected:
+    public:
+        // Returns false if destination can not be reached or query was aborted
+        static bool findEarliestArrival(
+            const std::shared_ptr<const TransportNetwork>& network,
+            const PointI& origin31,
+            const PointI& destination31,
+            const int departureTime,
+            Journey& outJourney,
+            const Settings& settings = Settings(),
+            const std::shared_ptr<const IQueryController>& queryController = nullptr);
+    };
+}
+
+#endif // !defined(_OSMAND_CORE_TRANSPORT_JOURNEY_PLANNER_H_)
@@ -0,0 +1,109 @@
+#ifndef _OSMAND_CORE_TRANSPORT_NETWORK_H_
+#define _OSMAND_CORE_TRANSPORT_NETWORK_H_
+
+#include <OsmAndCore/stdlib_common.h>
+
+#include <OsmAndCore/QtExtensions.h>
+#include <QList>
+#include <QVector>
+
+#include <OsmAndCore.h>
+#include <OsmAndCore/CommonTypes.h>
+
+namespace OsmAnd
+{
+    class ObfReader;
+    class ObfTransportSectionInfo;
+    class TransportStop;
+    class TransportRoute;
+    class IQueryController;
+    class TransportJourneyPlanner;
+
+    // Stops, routes and travel times of a transport section laid out in flat arrays, the way
+    // round-based journey search walks them: stops of each route in order, routes through each
+    // stop, and walking transfers between nearby stops. Network is not changed once built, so
+    // it can be queried from any number of threads at once
+    class OSMAND_CORE_API TransportNetwork Q_DECL_FINAL
+    {
+        Q_DISABLE_COPY_AND_MOVE(TransportNetwork);
+    public:
+        enum : int {
+            // Stops closer than this, in meters, are connected by walking transfers
+            TransfersRadius = 300,
+            // Time vehicle stands at each intermediate stop, in seconds
+            DwellTime = 20,
+        };
+
+        // Average walking speed, in meters per second
+        static const double WalkingSpeed;
+
+        struct RouteStop
+        {
+            int routeIndex;
+            // Position of stop among stops of route
+            int position;
+        };
+
+        struct Transfer
+        {
+            int stopIndex;
+            // Walking time, in seconds
+            int time;
+        };
+
+    private:
+        // Stops of route N are _routeStops[_routeStopsOffsets[N]] .. _routeStops[_routeStopsOffsets[N + 1] - 1],
+        // and _routeStopsTimes holds time of travel from first stop of route to each of them
+        QVector<int> _routeStopsOffsets;
+        QVector<int> _routeStops;
+        QVector<int> _routeStopsTimes;
+
+        // Same layout for routes that go through each stop and for transfers from each stop
+        QVector<int> _stopRoutesOffsets;
+        QVector<RouteStop> _stopRoutes;
+        QVector<int> _transfersOffsets;
+        QVector<Transfer> _transfers;
+
+        // Stops ordered by x31, to find stops around a point without scanning all of them
+        QVector<int> _stopsByX31;
+
+        void buildStopRoutes();
+        void buildTransfers();
+
+        static double getAverageSpeed(const TransportRoute& route);
+    protected:
+        TransportNetwork();
+    public:
+        ~TransportNetwork();
+
+        QVector< std::shared_ptr<const TransportStop> > stops;
+        QVector<PointI> stopsPositions31;
+        QVector< std::shared_ptr<const TransportRoute> > routes;
+
+        // Stops within radius from point, with walking time to each of them
+        void findStopsAround(
+            const PointI& point31,
+            const double radiusInMeters,
+            QVector<Transfer>& outStops) const;
+
+        static std::shared_ptr<const TransportNetwork> build(
+            const std::shared_ptr<const ObfReader>& reader,
+            const std::shared_ptr<const ObfTransportSectionInfo>& section,
+            const std::shared_ptr<const IQueryController>& queryController = nullptr);
+        // Network of given stops and stops of given routes, routes with less than two stops are skipped
+        static std::shared_ptr<const TransportNetwork> build(
+            const QList< std::shared_ptr<const TransportStop> >& stops,
+            const QList< std::shared_ptr<const TransportRoute> >& routes);
+
+        // Network of section is built once and kept by section for as long as section lives.
+        // Callers that ask for network being built wait for it instead of building another one
+        static std::shared_ptr<const TransportNetwork> obtain(
+            const std::shared_ptr<const ObfReader>& reader,
+            const std::shared_ptr<const ObfTransportSectionInfo>& section,
+            const std::shared_ptr<const IQueryController>& queryController = nullptr);
+
+    friend class OsmAnd::TransportJourneyPlanner;
+    };
+}
+
+#endif // !defined(_OSMAND_CORE_TRANSPORT_NETWORK_H_)
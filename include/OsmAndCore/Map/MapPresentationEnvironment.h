@@ -15,6 +15,7 @@
 #include <OsmAndCore/PrivateImplementation.h>
 #include <OsmAndCore/ICoreResourcesProvider.h>
 #include <OsmAndCore/Map/IMapStyle.h>
+#include <OsmAndCore/Data/MapObject.h>
 
 class SkBitmap;
 
@@ -111,6 +112,13 @@ namespace OsmAnd
         QHash<QString, int> getLineRenderingAttributes(const QString& renderAttrName) const;
         QHash<QString, int> getGpxColors() const;
 
+        // Tells if map object with given attributes may produce any primitive at given zoom.
+        // Answer is conservative: false means that object is surely not drawn
+        bool mayProducePrimitives(
+            const ZoomLevel zoom,
+            const std::shared_ptr<const MapObject::AttributeMapping>& attributeMapping,
+            const QVector<uint32_t>& attributeIds) const;
+
         enum {
             DefaultShadowLevelMin = 0,
             DefaultShadowLevelMax = 256,
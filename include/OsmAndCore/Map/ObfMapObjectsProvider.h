@@ -18,6 +18,7 @@
 namespace OsmAnd
 {
     class IObfsCollection;
+    class MapPresentationEnvironment;
 
     class ObfMapObjectsProvider_P;
     class OSMAND_CORE_API ObfMapObjectsProvider Q_DECL_FINAL : public IMapObjectsProvider
@@ -37,11 +38,15 @@ namespace OsmAnd
     public:
         ObfMapObjectsProvider(
             const std::shared_ptr<const IObfsCollection>& obfsCollection,
-            const Mode mode = Mode::BinaryMapObjectsAndRoads);
+            const Mode mode = Mode::BinaryMapObjectsAndRoads,
+            const std::shared_ptr<const MapPresentationEnvironment>& environment = nullptr);
         virtual ~ObfMapObjectsProvider();
 
         const std::shared_ptr<const IObfsCollection> obfsCollection;
         const Mode mode;
+        // If set, map objects are loaded only for presentation in this environment: binary map objects
+        // that can not be drawn are not loaded at all, and their geometry is simplified on read
+        const std::shared_ptr<const MapPresentationEnvironment> environment;
 
         virtual ZoomLevel getMinZoom() const;
         virtual ZoomLevel getMaxZoom() const;
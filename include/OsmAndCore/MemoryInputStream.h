@@ -0,0 +1,54 @@
+#ifndef _OSMAND_CORE_MEMORY_INPUT_STREAM_H_
+#define _OSMAND_CORE_MEMORY_INPUT_STREAM_H_
+
+#include <memory>
+
+#include <OsmAndCore/QtExtensions.h>
+
+#include "ignore_warnings_on_external_includes.h"
+#include <google/protobuf/io/zero_copy_stream.h>
+#include "restore_internal_warnings.h"
+
+#include <OsmAndCore.h>
+
+namespace OsmAnd
+{
+    namespace gpb = google::protobuf;
+
+    /**
+    Implementation of input stream for Google Protobuf over a memory block (e.g. memory-mapped file).
+    Unlike gpb::io::ArrayInputStream, it allows backing up to any position, as required by
+    CodedInputStream::Seek(). Memory block is kept alive by the owner reference.
+    */
+    class OSMAND_CORE_API MemoryInputStream : public gpb::io::ZeroCopyInputStream
+    {
+    private:
+        GOOGLE_DISALLOW_EVIL_CONSTRUCTORS(MemoryInputStream);
+
+        //! Reference to object that owns the memory
+        const std::shared_ptr<const void> _memoryOwner;
+
+        //! Pointer to memory block
+        const uint8_t* const _data;
+
+        //! Memory block size
+        const qint64 _size;
+
+        //! Current position
+        qint64 _currentPosition;
+    protected:
+    public:
+        MemoryInputStream(
+            const std::shared_ptr<const void>& memoryOwner,
+            const uint8_t* const data,
+            const qint64 size);
+        virtual ~MemoryInputStream();
+
+        virtual bool Next(const void** data, int* size);
+        virtual void BackUp(int count);
+        virtual bool Skip(int count);
+        virtual gpb::int64 ByteCount() const;
+    };
+}
+
+#endif // !defined(_OSMAND_CORE_MEMORY_INPUT_STREAM_H_)
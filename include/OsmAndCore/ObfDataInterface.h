@@ -7,6 +7,8 @@
 
 #include <OsmAndCore/QtExtensions.h>
 #include <QList>
+#include <QVector>
+#include <QMutex>
 
 #include <OsmAndCore.h>
 #include <OsmAndCore/CommonTypes.h>
@@ -18,6 +20,7 @@
 #include <OsmAndCore/Data/ObfTransportSectionReader.h>
 #include <OsmAndCore/CollatorStringMatcher.h>
 #include <OsmAndCore/Ref.h>
+#include <OsmAndCore/Concurrent/WorkerPool.h>
 
 namespace OsmAnd
 {
@@ -25,18 +28,58 @@ namespace OsmAnd
     class ObfFile;
     class ObfMapObject;
     class IQueryController;
+    class TransportNetwork;
 
     class OSMAND_CORE_API ObfDataInterface
     {
         Q_DISABLE_COPY_AND_MOVE(ObfDataInterface);
     private:
+#if !defined(SWIG)
+        template<typename SECTION_INFO>
+        using SectionEntry = std::pair< std::shared_ptr<const ObfReader>, Ref<SECTION_INFO> >;
+        typedef SectionEntry<ObfRoutingSectionInfo> RoutingSectionsEntry;
+
+        mutable QMutex _callbacksMutex;
+        template<typename RESULT, typename... ARGS>
+        std::function<RESULT (ARGS...)> serializedCallback(const std::function<RESULT (ARGS...)>& callback) const;
+        bool canReadSectionsConcurrently(const std::shared_ptr<const ObfReader>& obfReader) const;
+        static ObfMapSectionReader::FilterByAttributesFunction requestedZoomOf(
+            const ObfMapSectionReader::FilterByAttributesFunction& filterByAttributes,
+            const ZoomLevel requestedZoom);
+        template<typename SECTION_INFO, typename RESULT, typename READ_SECTION>
+        void readSections(
+            const QList< SectionEntry<SECTION_INFO> >& sections,
+            QVector<RESULT>& outResults,
+            const READ_SECTION readSection,
+            const std::shared_ptr<const IQueryController>& queryController) const;
+
+        bool loadRoadsFromSections(
+            const QList< RoutingSectionsEntry >& routingSections,
+            const RoutingDataLevel dataLevel,
+            const AreaI* const bbox31,
+            QList< std::shared_ptr<const OsmAnd::Road> >* resultOut,
+            const FilterRoadsByIdFunction filterById,
+            ObfRoutingSectionReader::DataBlocksCache* cache,
+            QList< std::shared_ptr<const ObfRoutingSectionReader::DataBlock> >* outReferencedCacheEntries,
+            const std::shared_ptr<const IQueryController>& queryController,
+            ObfRoutingSectionReader_Metrics::Metric_loadRoads* const metric);
+#endif // !defined(SWIG)
     protected:
     public:
-        ObfDataInterface(const QList< std::shared_ptr<const ObfReader> >& obfReaders);
+        ObfDataInterface(
+            const QList< std::shared_ptr<const ObfReader> >& obfReaders,
+            const std::shared_ptr<Concurrent::WorkerPool>& workerPool = nullptr);
         virtual ~ObfDataInterface();
 
         const QList< std::shared_ptr<const ObfReader> > obfReaders;
 
+        // If set, sections of memory-mapped files are read concurrently using this pool, while sections
+        // of other files are read by calling thread, since such readers can't be shared by threads.
+        // Results are merged in the same order as in sequential read. Id filters and visitors are never
+        // invoked concurrently, but they see objects of different sections interleaved, not in file order.
+        // Attribute filters are invoked concurrently, so they must be thread-safe
+        const std::shared_ptr<Concurrent::WorkerPool> workerPool;
+
         bool loadObfFiles(
             QList< std::shared_ptr<const ObfFile> >* outFiles = nullptr,
             const std::shared_ptr<const IQueryController>& queryController = nullptr);
@@ -50,7 +93,24 @@ namespace OsmAnd
             ObfMapSectionReader::DataBlocksCache* cache = nullptr,
             QList< std::shared_ptr<const ObfMapSectionReader::DataBlock> >* outReferencedCacheEntries = nullptr,
             const std::shared_ptr<const IQueryController>& queryController = nullptr,
-            ObfMapSectionReader_Metrics::Metric_loadMapObjects* const metric = nullptr);
+            ObfMapSectionReader_Metrics::Metric_loadMapObjects* const metric = nullptr,
+            const ObfMapSectionReader::FilterByAttributesFunction filterByAttributes = nullptr,
+            const bool simplifyGeometry = false);
+
+        // Same as loadBinaryMapObjects() for several tiles of the same zoom at once, with each
+        // map section traversed and each of its blocks read only once for all tiles
+        bool loadTiledBinaryMapObjects(
+            QVector< QList< std::shared_ptr<const OsmAnd::BinaryMapObject> > >* tilesResultsOut,
+            QVector<MapSurfaceType>* outTilesSurfaceTypes,
+            const ZoomLevel zoom,
+            const QVector<AreaI>& tilesBBoxes31,
+            const ObfMapSectionReader::FilterByIdFunction filterById = nullptr,
+            ObfMapSectionReader::DataBlocksCache* cache = nullptr,
+            QList< std::shared_ptr<const ObfMapSectionReader::DataBlock> >* outReferencedCacheEntries = nullptr,
+            const std::shared_ptr<const IQueryController>& queryController = nullptr,
+            ObfMapSectionReader_Metrics::Metric_loadMapObjects* const metric = nullptr,
+            const ObfMapSectionReader::FilterByAttributesFunction filterByAttributes = nullptr,
+            const bool simplifyGeometry = false);
 
         bool loadRoads(
             const RoutingDataLevel dataLevel,
@@ -83,7 +143,9 @@ namespace OsmAnd
             QList< std::shared_ptr<const ObfRoutingSectionReader::DataBlock> >* outReferencedRoadsCacheEntries = nullptr,
             const std::shared_ptr<const IQueryController>& queryController = nullptr,
             ObfMapSectionReader_Metrics::Metric_loadMapObjects* const binaryMapObjectsMetric = nullptr,
-            ObfRoutingSectionReader_Metrics::Metric_loadRoads* const roadsMetric = nullptr);
+            ObfRoutingSectionReader_Metrics::Metric_loadRoads* const roadsMetric = nullptr,
+            const ObfMapSectionReader::FilterByAttributesFunction filterMapObjectsByAttributes = nullptr,
+            const bool simplifyMapObjectsGeometry = false);
 
         bool loadAmenityCategories(
             QHash<QString, QStringList>* outCategories,
@@ -183,6 +245,12 @@ namespace OsmAnd
             ObfSectionInfo::StringTable* const stringTable = nullptr,
             const ObfTransportSectionReader::TransportRouteVisitorFunction visitor = nullptr,
             const std::shared_ptr<const IQueryController>& queryController = nullptr);
+
+        // Networks are shared with other callers that obtain them for the same sections
+        bool obtainTransportNetworks(
+            QList< std::shared_ptr<const TransportNetwork> >* outTransportNetworks,
+            const AreaI* const bbox31 = nullptr,
+            const std::shared_ptr<const IQueryController>& queryController = nullptr);
         
         const std::shared_ptr<const ObfTransportSectionInfo> getTransportSectionInfo(
             const QList<Ref<ObfTransportSectionInfo>>& sections,
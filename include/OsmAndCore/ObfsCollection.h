@@ -18,6 +18,10 @@ namespace OsmAnd
 {
     class ObfDataInterface;
     class ObfReader;
+    namespace Concurrent
+    {
+        class WorkerPool;
+    }
 
     class ObfsCollection_P;
     class OSMAND_CORE_API ObfsCollection : public IObfsCollection
@@ -26,6 +30,11 @@ namespace OsmAnd
     public:
         typedef int SourceOriginId;
 
+        enum {
+            DefaultMaxIdleObfReaders = 64,
+            DefaultMaxOpenObfReaders = 128,
+        };
+
     private:
     protected:
         PrivateImplementation<ObfsCollection_P> _p;
@@ -40,11 +49,25 @@ namespace OsmAnd
         SourceOriginId addFile(const QString& filePath);
         bool remove(const SourceOriginId entryId);
 
+        // Readers are leased from pool by file and calling thread and returned to it once released.
+        // Limit applies to idle readers (and thus their open file handles), 0 disables pooling
+        void setMaxIdleObfReaders(const unsigned int maxIdleObfReaders);
+        // Limit applies to all readers that own file handle, leased ones included. Once it's reached,
+        // threads share memory-mapped reader of the file instead of opening one more, 0 disables limit
+        void setMaxOpenObfReaders(const unsigned int maxOpenObfReaders);
+        // Memory-mapped readers are shared by all threads, so only one is pooled per file
+        void setUseMemoryMappedObfReaders(const bool useMemoryMappedObfReaders);
+        // Obtained data interfaces read files concurrently on this pool (if set)
+        void setDataInterfaceWorkerPool(const std::shared_ptr<Concurrent::WorkerPool>& workerPool);
+
         virtual QList< std::shared_ptr<const ObfFile> > getObfFiles() const;
         virtual std::shared_ptr<OsmAnd::ObfDataInterface> obtainDataInterface(
             const std::shared_ptr<const ObfFile> obfFile) const;
         virtual std::shared_ptr<OsmAnd::ObfDataInterface> obtainDataInterface(
             const QList< std::shared_ptr<const ResourcesManager::LocalResource> > localResources) const;
+        // With bbox, files are selected by bounds of their sections: readers of such files come
+        // first, grouped by data type in no particular order of files, followed by readers of
+        // basemaps and of files whose information is not known yet
         virtual std::shared_ptr<ObfDataInterface> obtainDataInterface(
             const AreaI* const pBbox31 = nullptr,
             const ZoomLevel minZoomLevel = MinZoomLevel,
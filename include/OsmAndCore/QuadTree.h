@@ -827,7 +827,7 @@ namespace OsmAnd
 
         inline unsigned int removeSlow(const Acceptor acceptor)
         {
-            return _rootNode->removeAllSlow(acceptor);
+            return _rootNode->removeSlow(acceptor);
         }
     };
 }
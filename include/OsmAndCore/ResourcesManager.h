@@ -254,6 +254,12 @@ namespace OsmAnd
         std::shared_ptr<const LocalResource> getLocalResource(const QString& id) const;
         bool isLocalResource(const QString& id) const;
 
+        // OBF readers:
+        // Memory-mapped readers share one mapping of each file and may be used from any number
+        // of threads at once, instead of each reader opening file on its own
+        void setUseMemoryMappedObfReaders(const bool useMemoryMappedObfReaders);
+        bool getUseMemoryMappedObfReaders() const;
+
         // Resources in repository:
         bool isRepositoryAvailable() const;
         bool updateRepository() const;
@@ -0,0 +1,152 @@
+#ifndef _OSMAND_CORE_ROUTE_MATCHER_H_
+#define _OSMAND_CORE_ROUTE_MATCHER_H_
+
+#include <OsmAndCore/stdlib_common.h>
+#include <functional>
+#include <memory>
+
+#include <OsmAndCore/QtExtensions.h>
+#include <OsmAndCore/ignore_warnings_on_external_includes.h>
+#include <QList>
+#include <QVector>
+#include <OsmAndCore/restore_internal_warnings.h>
+
+#include <OsmAndCore.h>
+#include <OsmAndCore/CommonTypes.h>
+#include <OsmAndCore/IQueryController.h>
+#include <OsmAndCore/Data/Road.h>
+#include <OsmAndCore/Routing/RoutePlannerContext.h>
+
+namespace OsmAnd {
+
+    class GeoInfoDocument;
+    namespace Concurrent
+    {
+        class WorkerPool;
+    }
+
+    // Matches recorded traces to roads as hidden Markov model. Candidates of each point are the
+    // nearest segments of roads around it, scored by distance to the point. Transition between
+    // candidates of consecutive points is scored by how much distance along roads differs from
+    // straight distance between the points. Most likely sequence of candidates is found with
+    // Viterbi algorithm, and where no sequence goes on, matching starts over from next point
+    class OSMAND_CORE_API RouteMatcher
+    {
+    public:
+        struct OSMAND_CORE_API Settings
+        {
+            Settings();
+
+            // Roads farther than this from point, in meters, are not its candidates
+            double searchRadius;
+            // Nearest roads kept as candidates of each point
+            int maxCandidatesCount;
+            // Standard deviation of recorded position error, in meters
+            double positionSigma;
+            // Expected difference between distance along roads and straight distance, in meters
+            double transitionBeta;
+            // Distance along roads is searched up to this many straight distances plus two search radiuses
+            double maxRouteDistanceFactor;
+            // Points closer than this to previous matched one, in meters, are put on the same road
+            double minPointsDistance;
+        };
+
+        struct OSMAND_CORE_API MatchedPoint
+        {
+            MatchedPoint();
+
+            // Not set if there was no road around the point
+            std::shared_ptr<const Road> road;
+            // Point lies on segment from previous point of road to this one
+            uint32_t pointIndex;
+            PointI point31;
+            // Distance from recorded point, in meters
+            double distance;
+        };
+
+        typedef std::function< std::shared_ptr<RoutePlannerContext> () > ContextFactory;
+
+        // Roads traces are matched to
+        class OSMAND_CORE_API IRoadsGraph
+        {
+            Q_DISABLE_COPY_AND_MOVE(IRoadsGraph);
+        private:
+        protected:
+            IRoadsGraph();
+        public:
+            virtual ~IRoadsGraph();
+
+            // Roads around point are obtained for whole area at once, so consecutive points of
+            // the same area reuse them
+            virtual uint64_t getAreaId(const PointI& point31) = 0;
+            virtual void obtainRoadsAround(const PointI& point31, QList< std::shared_ptr<const Road> >& outRoads) = 0;
+            // Roads that have a point at given location, each with index of that point
+            virtual void obtainRoadsAt(
+                const PointI& point31,
+                QList< std::pair< std::shared_ptr<const Road>, uint32_t > >& outRoads) = 0;
+            virtual RoadDirection getDirection(const std::shared_ptr<const Road>& road) = 0;
+            // Search from previous point of trace is over, so data made for it may be released
+            virtual void releaseSearchData();
+        };
+    private:
+        struct NearbyRoads;
+        class RoutePlannerRoadsGraph;
+
+        static void obtainNearbyRoads(
+            IRoadsGraph* graph,
+            const PointI& point31,
+            NearbyRoads& inOutNearbyRoads);
+        static void findCandidates(
+            const NearbyRoads& nearbyRoads,
+            const PointI& point31,
+            const Settings& settings,
+            QVector<MatchedPoint>& outCandidates);
+        static MatchedPoint matchToRoad(
+            const std::shared_ptr<const Road>& road,
+            const PointI& point31);
+        static void measureRouteDistances(
+            IRoadsGraph* graph,
+            const MatchedPoint& from,
+            const QVector<MatchedPoint>& targets,
+            const double maxDistance,
+            QVector<double>& outDistances);
+        static bool isMovementAllowed(
+            IRoadsGraph* graph,
+            const std::shared_ptr<const Road>& road,
+            const bool towardsLastPoint);
+    protected:
+        RouteMatcher();
+    public:
+        virtual ~RouteMatcher();
+
+        // Matched points go in the same order as points of trace
+        static bool matchTrace(
+            RoutePlannerContext* context,
+            const QList< std::pair<double, double> >& trace,
+            QVector<MatchedPoint>& outMatchedPoints,
+            const Settings& settings = Settings(),
+            const IQueryController* const controller = nullptr);
+        static bool matchTrace(
+            IRoadsGraph* graph,
+            const QList< std::pair<double, double> >& trace,
+            QVector<MatchedPoint>& outMatchedPoints,
+            const Settings& settings = Settings(),
+            const IQueryController* const controller = nullptr);
+
+        // Traces are matched in parallel, each in own context made by factory. Contexts that share
+        // tiles cache decode each tile once for all traces
+        static bool matchTraces(
+            const ContextFactory contextFactory,
+            const QList< QList< std::pair<double, double> > >& traces,
+            QVector< QVector<MatchedPoint> >& outMatchedTraces,
+            const Settings& settings = Settings(),
+            Concurrent::WorkerPool* const workerPool = nullptr,
+            const IQueryController* const controller = nullptr);
+
+        // Every segment of every track of document as separate trace
+        static QList< QList< std::pair<double, double> > > getTraces(const std::shared_ptr<const GeoInfoDocument>& document);
+    };
+
+} // namespace OsmAnd
+
+#endif // !defined(_OSMAND_CORE_ROUTE_MATCHER_H_)
@@ -13,6 +13,7 @@
 #include <QMap>
 #include <QSet>
 #include <QList>
+#include <QVector>
 #include <OsmAndCore/restore_internal_warnings.h>
 
 #include <OsmAndCore.h>
@@ -42,25 +43,87 @@ namespace OsmAnd {
         }
     };
 
+    enum class IsochroneCostType
+    {
+        Time,
+        Distance,
+    };
+
+    struct IsochroneSegment
+    {
+        std::shared_ptr<const Road> road;
+        // Adjacent points of road, segment is passed from first to second
+        uint32_t fromPointIndex;
+        uint32_t toPointIndex;
+        // Seconds or meters from origin. End of segment that costs more than limit is not reached
+        float fromCost;
+        float toCost;
+    };
+
+    // Point on road that lies between road points [pointIndex - 1] and [pointIndex]
+    struct RoadPoint
+    {
+        std::shared_ptr<const Road> road;
+        uint32_t pointIndex;
+        PointI point31;
+    };
+
     class OSMAND_CORE_API RoutePlanner
     {
+    public:
+        // Roads that search from road point goes over, along with costs of moving along them
+        class OSMAND_CORE_API IRoadsGraph
+        {
+            Q_DISABLE_COPY_AND_MOVE(IRoadsGraph);
+        private:
+        protected:
+            IRoadsGraph();
+        public:
+            virtual ~IRoadsGraph();
+
+            // Roads that have a point at given location and may be entered there from given road,
+            // as turn restrictions of that road allow, each with index of that point
+            virtual void obtainRoadsAt(
+                const PointI& point31,
+                const std::shared_ptr<const Road>& fromRoad,
+                QList< std::pair< std::shared_ptr<const Road>, uint32_t > >& outRoads) = 0;
+            virtual RoadDirection getDirection(const std::shared_ptr<const Road>& road) = 0;
+            // Extra time to pass point of road, negative if point can't be passed
+            virtual float getObstacleTime(const std::shared_ptr<const Road>& road, const uint32_t pointIndex) = 0;
+            virtual float getTime(const std::shared_ptr<const Road>& road, const float distance, const float obstaclesTime) = 0;
+            // Time to turn onto road at its point towards its given end, from road that was entered
+            // at one point and is left at another
+            virtual float getTurnTime(
+                const std::shared_ptr<const Road>& fromRoad,
+                const uint32_t fromEnteredPointIndex,
+                const uint32_t fromPointIndex,
+                const std::shared_ptr<const Road>& toRoad,
+                const uint32_t toPointIndex,
+                const uint32_t toEndPointIndex) = 0;
+        };
+
+        // Gets segment passed by search along with location its passing started at. Search stops
+        // once visitor returns false
+        typedef std::function<bool (const IsochroneSegment& segment, const PointI& fromPoint31)> SegmentVisitor;
 
     protected:
         RoutePlanner();
 
+        class RoutePlannerRoadsGraph;
+
         typedef std::priority_queue<
             std::shared_ptr<RoutePlannerContext::RouteCalculationSegment>,
             std::vector< std::shared_ptr<RoutePlannerContext::RouteCalculationSegment> >,
             std::function< bool(const std::shared_ptr<RoutePlannerContext::RouteCalculationSegment>&, const std::shared_ptr<RoutePlannerContext::RouteCalculationSegment>&) >
         >  RoadSegmentsPriorityQueue;
 
-        static void loadRoads(RoutePlannerContext* context, uint32_t x31, uint32_t y31, uint32_t zoomAround, QList< std::shared_ptr<const Model::Road> >& roads);
-        static void loadRoadsFromTile(RoutePlannerContext* context, uint64_t tileId, QList< std::shared_ptr<const Model::Road> >& roads);
+        static void loadRoads(RoutePlannerContext* context, uint32_t x31, uint32_t y31, uint32_t zoomAround, QList< std::shared_ptr<const Road> >& roads);
+        static void loadRoadsFromTile(RoutePlannerContext* context, uint64_t tileId, QList< std::shared_ptr<const Road> >& roads);
         static uint64_t getRoutingTileId(RoutePlannerContext* context, uint32_t x31, uint32_t y31, bool dontLoad);
         static uint32_t getCurrentEstimatedSize(RoutePlannerContext* context);
-        static void cacheRoad(RoutePlannerContext* context, const std::shared_ptr<Model::Road>& road);
-        static void loadTileHeader(RoutePlannerContext* context, uint32_t x31, uint32_t y31, QList< std::shared_ptr<RoutePlannerContext::RoutingSubsectionContext> >& subsectionsContexts);
-        static void loadSubregionContext(RoutePlannerContext::RoutingSubsectionContext* context);
+        static void cacheRoad(RoutePlannerContext* context, const std::shared_ptr<Road>& road);
+        static void loadTileHeader(RoutePlannerContext* context, uint32_t x31, uint32_t y31, QList< std::shared_ptr<RoutePlannerContext::RoutingTileContext> >& tilesContexts);
+        static void loadTileContext(RoutePlannerContext::RoutingTileContext* context);
 
         static bool findClosestRouteSegment(OsmAnd::RoutePlannerContext* context, double latitude, double longitude, std::shared_ptr<OsmAnd::RoutePlannerContext::RouteCalculationSegment>& routeSegment);
 
@@ -70,10 +133,36 @@ namespace OsmAnd {
             const std::shared_ptr<RoutePlannerContext::RouteCalculationSegment>& to,
             bool leftSideNavigation,
             const IQueryController* const controller = nullptr);
-        static void loadBorderPoints(OsmAnd::RoutePlannerContext::CalculationContext* context);
-        static void updateDistanceForBorderPoints(OsmAnd::RoutePlannerContext::CalculationContext* context, const PointI& sPoint, bool isDistanceToStart);
-        static uint64_t encodeRoutePointId(const std::shared_ptr<const Model::Road>& road, uint64_t pointIndex, bool positive);
-        static uint64_t encodeRoutePointId(const std::shared_ptr<const Model::Road>& road, uint64_t pointIndex);
+        static bool calculateRouteUsingHierarchy(
+            OsmAnd::RoutePlannerContext::CalculationContext* context,
+            const std::pair<double, double>& from,
+            const std::pair<double, double>& to,
+            bool leftSideNavigation,
+            const IQueryController* const controller,
+            OsmAnd::RouteCalculationResult& outResult);
+        static void collectHierarchyTerminals(
+            OsmAnd::RoutePlannerContext::CalculationContext* context,
+            const std::shared_ptr<const RoutingHierarchy>& hierarchy,
+            const std::shared_ptr<const Road>& road,
+            uint32_t pointIdx,
+            const PointI& point31,
+            bool isSource,
+            QVector<RoutingHierarchy::Terminal>& outTerminals,
+            QVector<uint32_t>& outEdges);
+        static std::shared_ptr<const Road> loadRoad(
+            OsmAnd::RoutePlannerContext::CalculationContext* context,
+            uint64_t roadId,
+            const PointI& point31);
+        static std::shared_ptr<RoutePlannerContext::RouteCalculationSegment> searchInParallel(
+            OsmAnd::RoutePlannerContext::CalculationContext* context,
+            RoadSegmentsPriorityQueue& graphDirectSegments,
+            RoadSegmentsPriorityQueue& graphReverseSegments,
+            RoutePlannerContext::VisitedSegments& visitedDirectSegments,
+            RoutePlannerContext::VisitedSegments& visitedOppositeSegments,
+            const IQueryController* const controller,
+            QString& outErrorMessage);
+        static uint64_t encodeRoutePointId(const std::shared_ptr<const Road>& road, uint64_t pointIndex, bool positive);
+        static uint64_t encodeRoutePointId(const std::shared_ptr<const Road>& road, uint64_t pointIndex);
         static float estimateTimeDistance(
             OsmAnd::RoutePlannerContext::CalculationContext* context,
             const PointI& from,
@@ -86,9 +175,9 @@ namespace OsmAnd {
             OsmAnd::RoutePlannerContext::CalculationContext* context,
             bool reverseWaySearch,
             RoadSegmentsPriorityQueue& graphSegments,
-            QMap<uint64_t, std::shared_ptr<RoutePlannerContext::RouteCalculationSegment> >& visitedSegments,
+            RoutePlannerContext::VisitedSegments& visitedSegments,
             const std::shared_ptr<RoutePlannerContext::RouteCalculationSegment>& segment,
-            QMap<uint64_t, std::shared_ptr<RoutePlannerContext::RouteCalculationSegment> >& oppositeSegments,
+            RoutePlannerContext::VisitedSegments& oppositeSegments,
             bool forwardDirection);
         static float calculateTurnTime(
             OsmAnd::RoutePlannerContext::CalculationContext* context,
@@ -96,20 +185,28 @@ namespace OsmAnd {
             uint32_t aEndPointIndex,
             const std::shared_ptr<RoutePlannerContext::RouteCalculationSegment>& b,
             uint32_t bEndPointIndex);
+        static float calculateTurnTime(
+            OsmAnd::RoutePlannerContext::CalculationContext* context,
+            const std::shared_ptr<const Road>& aRoad,
+            uint32_t aPointIndex,
+            uint32_t aEndPointIndex,
+            const std::shared_ptr<const Road>& bRoad,
+            uint32_t bPointIndex,
+            uint32_t bEndPointIndex);
         static bool checkIfInitialMovementAllowedOnSegment(
             OsmAnd::RoutePlannerContext::CalculationContext* context,
             bool reverseWaySearch,
-            QMap<uint64_t, std::shared_ptr<RoutePlannerContext::RouteCalculationSegment> >& visitedSegments,
+            RoutePlannerContext::VisitedSegments& visitedSegments,
             const std::shared_ptr<RoutePlannerContext::RouteCalculationSegment>& segment,
             bool forwardDirection,
-            const std::shared_ptr<const Model::Road>& road);
+            const std::shared_ptr<const Road>& road);
         static bool checkIfOppositeSegmentWasVisited(
             OsmAnd::RoutePlannerContext::CalculationContext* context,
             bool reverseWaySearch,
             RoadSegmentsPriorityQueue& graphSegments,
             const std::shared_ptr<RoutePlannerContext::RouteCalculationSegment>& segment,
-            QMap<uint64_t, std::shared_ptr<RoutePlannerContext::RouteCalculationSegment> >& oppositeSegments,
-            const std::shared_ptr<const Model::Road>& road,
+            RoutePlannerContext::VisitedSegments& oppositeSegments,
+            const std::shared_ptr<const Road>& road,
             uint32_t segmentEnd,
             bool forwardDirection,
             uint32_t intervalId,
@@ -117,19 +214,19 @@ namespace OsmAnd {
             float obstaclesTime);
         static float calculateTimeWithObstacles(
             OsmAnd::RoutePlannerContext::CalculationContext* context,
-            const std::shared_ptr<const Model::Road>& road,
+            const std::shared_ptr<const Road>& road,
             float distOnRoadToPass,
             float obstaclesTime);
         static bool processRestrictions(
             OsmAnd::RoutePlannerContext::CalculationContext* context,
             QList< std::shared_ptr<RoutePlannerContext::RouteCalculationSegment> >& prescripted,
-            const std::shared_ptr<const Model::Road>& road,
+            const std::shared_ptr<const Road>& road,
             const std::shared_ptr<RoutePlannerContext::RouteCalculationSegment>& inputNext,
             bool reverseWay);
         static void processIntersections(
             OsmAnd::RoutePlannerContext::CalculationContext* context,
             RoadSegmentsPriorityQueue& graphSegments,
-            QMap<uint64_t, std::shared_ptr<RoutePlannerContext::RouteCalculationSegment> >& visitedSegments,
+            RoutePlannerContext::VisitedSegments& visitedSegments,
             float distFromStart,
             const std::shared_ptr<RoutePlannerContext::RouteCalculationSegment>& segment,
             uint32_t segmentEnd,
@@ -138,11 +235,20 @@ namespace OsmAnd {
             bool addSameRoadFutureDirection);
         static bool checkPartialRecalculationPossible(
             OsmAnd::RoutePlannerContext::CalculationContext* context,
-            QMap<uint64_t, std::shared_ptr<RoutePlannerContext::RouteCalculationSegment> >& visitedOppositeSegments,
+            RoutePlannerContext::VisitedSegments& visitedOppositeSegments,
             std::shared_ptr<RoutePlannerContext::RouteCalculationSegment>& segment);
         static std::shared_ptr<RoutePlannerContext::RouteCalculationSegment> loadRouteCalculationSegment(
-            OsmAnd::RoutePlannerContext* context,
-            uint32_t x31, uint32_t y31);
+            OsmAnd::RoutePlannerContext::CalculationContext* context,
+            uint32_t x31, uint32_t y31,
+            bool reverseWaySearch = false);
+        static std::shared_ptr<RoutePlannerContext::RouteCalculationSegment> createSegment(
+            const std::shared_ptr<RoutePlannerContext::RouteCalculationSegmentsPool>& pool,
+            const std::shared_ptr<const Road>& road,
+            uint32_t pointIndex);
+        static std::shared_ptr<RoutePlannerContext::RouteCalculationFinalSegment> createFinalSegment(
+            const std::shared_ptr<RoutePlannerContext::RouteCalculationSegmentsPool>& pool,
+            const std::shared_ptr<const Road>& road,
+            uint32_t pointIndex);
         static void printDebugInformation(OsmAnd::RoutePlannerContext::CalculationContext* ctx,
             int directSegmentSize, int reverseSegmentSize,
             std::shared_ptr<RoutePlannerContext::RouteCalculationSegment>);
@@ -157,6 +263,9 @@ namespace OsmAnd {
         static OsmAnd::RouteCalculationResult prepareResult(OsmAnd::RoutePlannerContext::CalculationContext* context,
             std::shared_ptr<RoutePlannerContext::RouteCalculationSegment> finalSegment,
             bool leftSideNavigation);
+        static OsmAnd::RouteCalculationResult completeRoute(OsmAnd::RoutePlannerContext::CalculationContext* context,
+            QVector< std::shared_ptr<RouteSegment> >& route,
+            bool leftSideNavigation);
         static void addRouteSegmentToRoute(QVector< std::shared_ptr<RouteSegment> >& route, const std::shared_ptr<RouteSegment>& segment, bool reverse);
         static bool combineTwoSegmentResult(const std::shared_ptr<RouteSegment>& toAdd, const std::shared_ptr<RouteSegment>& previous, bool reverse);
         static bool validateAllPointsConnected(const QVector< std::shared_ptr<RouteSegment> >& route);
@@ -180,7 +289,7 @@ namespace OsmAnd {
         static bool findClosestRoadPoint(
             OsmAnd::RoutePlannerContext* context,
             double latitude, double longitude,
-            std::shared_ptr<const OsmAnd::Model::Road>* closestRoad = nullptr,
+            std::shared_ptr<const OsmAnd::Road>* closestRoad = nullptr,
             uint32_t* closestPointIndex = nullptr,
             double* sqDistanceToClosestPoint = nullptr,
             uint32_t* rx31 = nullptr, uint32_t* ry31 = nullptr);
@@ -191,8 +300,60 @@ namespace OsmAnd {
             bool leftSideNavigation,
             const OsmAnd::IQueryController* const controller = nullptr);
 
+        // Travel times in seconds from every origin to every destination, row per origin.
+        // Pairs without route get infinite time
+        static bool calculateTimesMatrix(
+            OsmAnd::RoutePlannerContext* context,
+            const QList< std::pair<double, double> >& origins,
+            const QList< std::pair<double, double> >& destinations,
+            QVector<float>& outTimes,
+            const OsmAnd::IQueryController* const controller = nullptr);
+
+        // Travel times in seconds from origin to every destination, found by single search that
+        // visits road points in order of time and stops once all destinations are reached.
+        // Destinations without road or without route get infinite time. If search is aborted,
+        // only destinations it has settled get their times
+        static bool calculateTimesFromRoadPoint(
+            IRoadsGraph* const graph,
+            const RoadPoint& origin,
+            const QVector<RoadPoint>& destinations,
+            QVector<float>& outTimes,
+            const OsmAnd::IQueryController* const controller = nullptr);
+
+        // Search from road point that passes road segments in order of cost they are passed from,
+        // up to the limit
+        static bool searchFromRoadPoint(
+            IRoadsGraph* const graph,
+            const RoadPoint& origin,
+            const IsochroneCostType costType,
+            const float limit,
+            const SegmentVisitor visitor,
+            const OsmAnd::IQueryController* const controller = nullptr);
+
+        // Everything reachable from point within the limit, found by single search that visits
+        // road points in order of cost. Turn restrictions are applied the same way as in route
+        // search, if profile is aware of them. Outline goes around farthest reached points in each
+        // direction from origin
+        static bool calculateIsochrone(
+            OsmAnd::RoutePlannerContext* context,
+            double latitude, double longitude,
+            const IsochroneCostType costType,
+            const float limit,
+            QList<IsochroneSegment>& outSegments,
+            QVector<PointI>* const outOutline31 = nullptr,
+            const OsmAnd::IQueryController* const controller = nullptr);
+        static bool calculateIsochrone(
+            IRoadsGraph* const graph,
+            const RoadPoint& origin,
+            const IsochroneCostType costType,
+            const float limit,
+            QList<IsochroneSegment>& outSegments,
+            QVector<PointI>* const outOutline31 = nullptr,
+            const OsmAnd::IQueryController* const controller = nullptr);
+
         friend class OsmAnd::RoutePlannerContext;
         friend class OsmAnd::RoutePlannerAnalyzer;
+        friend class OsmAnd::RouteMatcher;
     };
 
 } // namespace OsmAnd
@@ -3,6 +3,8 @@
 
 #include <limits>
 #include <memory>
+#include <vector>
+#include <atomic>
 
 #include <OsmAndCore/stdlib_common.h>
 #include <ctime>
@@ -13,22 +15,24 @@
 #include <QMap>
 #include <QSet>
 #include <QList>
+#include <QMutex>
 
 #include <OsmAndCore.h>
 #include <OsmAndCore/Common.h>
 #include <OsmAndCore/Routing/RoutingConfiguration.h>
-#include <OsmAndCore/Data/Model/Road.h>
+#include <OsmAndCore/Data/Road.h>
 #include <OsmAndCore/Routing/RouteSegment.h>
 #include <OsmAndCore/Routing/RoutingProfileContext.h>
+#include <OsmAndCore/Routing/RoutingHierarchy.h>
+#include <OsmAndCore/Routing/RoutingTilesCache.h>
 #include <OsmAndCore/CommonTypes.h>
 
 namespace OsmAnd {
 
     class ObfReader;
     class ObfRoutingSectionInfo;
-    class ObfRoutingSubsectionInfo;
-    class ObfRoutingBorderLinePoint;
     class RoutePlanner;
+    class RouteMatcher;
 
     struct RouteStatistics
     {
@@ -36,6 +40,7 @@ namespace OsmAnd {
         uint32_t backwardIterations;
         uint32_t sizeOfDQueue;
         uint32_t sizeOfRQueue;
+        uint32_t visitedSegments;
         uint64_t timeToLoad;
         uint64_t timeToCalculate;
 
@@ -70,13 +75,13 @@ namespace OsmAnd {
 
             int _assignedDirection;
 
-            RouteCalculationSegment(const std::shared_ptr<const Model::Road>& road, uint32_t pointIndex);
+            RouteCalculationSegment(const std::shared_ptr<const Road>& road, uint32_t pointIndex);
 
             void dump(const QString& prefix = QString::null) const;
         public:
             virtual ~RouteCalculationSegment();
 
-            const std::shared_ptr<const Model::Road> road;
+            const std::shared_ptr<const Road> road;
             const uint32_t pointIndex;
 
             const std::shared_ptr<RouteCalculationSegment>& next;
@@ -94,7 +99,7 @@ namespace OsmAnd {
         {
         private:
         protected:
-            RouteCalculationFinalSegment(const std::shared_ptr<const Model::Road>& road, uint32_t pointIndex);
+            RouteCalculationFinalSegment(const std::shared_ptr<const Road>& road, uint32_t pointIndex);
 
             bool _reverseWaySearch;
             std::shared_ptr<RouteCalculationSegment> _opposite;
@@ -108,23 +113,179 @@ namespace OsmAnd {
             friend class OsmAnd::RoutePlannerContext;
         };
 
-        class OSMAND_CORE_API RoutingSubsectionContext
+        // Memory for route calculation segments created during single calculation. Segments and
+        // their shared_ptr control blocks are placed one after another in large chunks, which are
+        // released all at once together with the pool instead of segment by segment. Pool lives
+        // while calculation context or any segment allocated from it does
+        class OSMAND_CORE_API RouteCalculationSegmentsPool
+        {
+            Q_DISABLE_COPY_AND_MOVE(RouteCalculationSegmentsPool);
+        private:
+            std::vector< std::unique_ptr<uint8_t[]> > _chunks;
+            size_t _chunkOffset;
+            size_t _chunkSize;
+
+            enum {
+                ChunkSize = 64 * 1024,
+            };
+        protected:
+        public:
+            RouteCalculationSegmentsPool();
+            ~RouteCalculationSegmentsPool();
+
+            void* allocate(size_t size, size_t alignment);
+
+            // Allocator for shared_ptr control blocks. Deallocation does nothing, since
+            // memory is reclaimed with the pool. Control block keeps a copy of allocator, so
+            // the pool can't go away before the last segment allocated from it
+            template<typename T>
+            struct Allocator
+            {
+                typedef T value_type;
+
+                Allocator(const std::shared_ptr<RouteCalculationSegmentsPool>& pool)
+                    : pool(pool)
+                {
+                }
+
+                template<typename U>
+                Allocator(const Allocator<U>& that)
+                    : pool(that.pool)
+                {
+                }
+
+                T* allocate(size_t n)
+                {
+                    return static_cast<T*>(pool->allocate(n * sizeof(T), alignof(T)));
+                }
+
+                void deallocate(T*, size_t)
+                {
+                }
+
+                template<typename U>
+                bool operator==(const Allocator<U>& that) const
+                {
+                    return pool == that.pool;
+                }
+
+                template<typename U>
+                bool operator!=(const Allocator<U>& that) const
+                {
+                    return pool != that.pool;
+                }
+
+                std::shared_ptr<RouteCalculationSegmentsPool> pool;
+            };
+
+            // Destroys segment without freeing its memory
+            struct Deleter
+            {
+                void operator()(RouteCalculationSegment* segment) const
+                {
+                    segment->~RouteCalculationSegment();
+                }
+            };
+        };
+
+        // Segments visited by one direction of parallel bidirectional search, which the other
+        // direction looks up without locking. Insert-only hash table with chains hanging from atomic
+        // bucket heads; entries are allocated from segments pool of the inserting direction and
+        // keep state of segment at the moment it was visited
+        class OSMAND_CORE_API MeetingSegments
+        {
+            Q_DISABLE_COPY_AND_MOVE(MeetingSegments);
+        public:
+            struct Entry
+            {
+                uint64_t id;
+                uint32_t pointIndex;
+                float distanceFromStart;
+                std::shared_ptr<RouteCalculationSegment> segment;
+                Entry* next;
+            };
+        private:
+            std::unique_ptr< std::atomic<Entry*>[] > _buckets;
+            const std::shared_ptr<RouteCalculationSegmentsPool> _pool;
+
+            enum {
+                BucketsCountLog2 = 18,
+            };
+        protected:
+        public:
+            MeetingSegments(const std::shared_ptr<RouteCalculationSegmentsPool>& pool);
+            ~MeetingSegments();
+
+            // Only single thread may insert
+            void insert(uint64_t id, const std::shared_ptr<RouteCalculationSegment>& segment);
+            const Entry* find(uint64_t id) const;
+        };
+
+        // Visited segments keyed by RoutePlanner::encodeRoutePointId(), stored in open-addressing
+        // table with linear probing. Segments are never removed during calculation
+        class OSMAND_CORE_API VisitedSegments
+        {
+        private:
+            struct Entry
+            {
+                uint64_t id;
+                std::shared_ptr<RouteCalculationSegment> segment;
+            };
+            std::vector<Entry> _entries;
+            size_t _size;
+            MeetingSegments* _meetingSegments;
+
+            size_t findSlot(uint64_t id) const;
+            void grow();
+
+            enum {
+                InitialCapacity = 1024,
+            };
+        protected:
+        public:
+            VisitedSegments();
+            ~VisitedSegments();
+
+            void insert(uint64_t id, const std::shared_ptr<RouteCalculationSegment>& segment);
+            bool contains(uint64_t id) const;
+            std::shared_ptr<RouteCalculationSegment> value(uint64_t id) const;
+            size_t size() const;
+
+            // Also publish inserted segments for the opposite direction of parallel search
+            void publishTo(MeetingSegments* meetingSegments);
+            MeetingSegments* getMeetingSegments() const;
+        };
+
+        class OSMAND_CORE_API RoutingTileContext
         {
         private:
             int _mixedLoadsCounter;
             int _access;
         protected:
-            RoutingSubsectionContext(RoutePlannerContext* owner, const std::shared_ptr<ObfReader>& origin, const std::shared_ptr<const ObfRoutingSubsectionInfo>& subsection);
+            RoutingTileContext(
+                RoutePlannerContext* owner,
+                const std::shared_ptr<ObfReader>& origin,
+                const std::shared_ptr<const ObfRoutingSectionInfo>& section,
+                const TileId tileId,
+                const ZoomLevel zoom);
 
             QMap< uint64_t, std::shared_ptr<RouteCalculationSegment> > _roadSegments;
+            // Shared decoded roads, borrowed while tile is loaded
+            std::shared_ptr<const RoutingTilesCache::Tile> _tile;
 
             void markLoaded();
             void unload();
-            std::shared_ptr<RouteCalculationSegment> loadRouteCalculationSegment(uint32_t x31, uint32_t y31, QMap<uint64_t, std::shared_ptr<const Model::Road> >& processed, const std::shared_ptr<RouteCalculationSegment>& original);
+            std::shared_ptr<RouteCalculationSegment> loadRouteCalculationSegment(
+                uint32_t x31, uint32_t y31,
+                QMap<uint64_t, std::shared_ptr<const Road> >& processed,
+                const std::shared_ptr<RouteCalculationSegment>& original,
+                const std::shared_ptr<RouteCalculationSegmentsPool>& segmentsPool);
         public:
-            virtual ~RoutingSubsectionContext();
+            virtual ~RoutingTileContext();
 
-            const std::shared_ptr<const ObfRoutingSubsectionInfo> subsection;
+            const std::shared_ptr<const ObfRoutingSectionInfo> section;
+            const TileId tileId;
+            const ZoomLevel zoom;
             RoutePlannerContext* const owner;
             const std::shared_ptr<ObfReader> origin;
 
@@ -132,19 +293,13 @@ namespace OsmAnd {
             uint32_t getLoadsCounter() const;
             uint32_t getAccessCounter() const {return _access;}
 
-            void registerRoad(const std::shared_ptr<const Model::Road>& road);
-            void collectRoads(QList< std::shared_ptr<const Model::Road> >& output, QMap<uint64_t, std::shared_ptr<const Model::Road> >* duplicatesRegistry = nullptr);
+            void registerRoad(const std::shared_ptr<const Road>& road);
+            void collectRoads(QList< std::shared_ptr<const Road> >& output, QMap<uint64_t, std::shared_ptr<const Road> >* duplicatesRegistry = nullptr);
 
             friend class OsmAnd::RoutePlanner;
             friend class OsmAnd::RoutePlannerContext;
         };
 
-        struct OSMAND_CORE_API BorderLine
-        {
-            uint32_t _y31;
-            QList< std::shared_ptr<const ObfRoutingBorderLinePoint> > _borderPoints;
-        };
-
         class OSMAND_CORE_API CalculationContext
         {
         private:
@@ -155,8 +310,10 @@ namespace OsmAnd {
             uint64_t _entranceRoadId;
             int _entranceRoadDirection;
             
-            QList< std::shared_ptr<BorderLine> > _borderLines;
-            QVector< uint32_t > _borderLinesY31;
+            // Each direction of search has own pool, so that directions may run in parallel
+            const std::shared_ptr<RouteCalculationSegmentsPool> _segmentsPool;
+            const std::shared_ptr<RouteCalculationSegmentsPool> _reverseSegmentsPool;
+            const std::shared_ptr<RouteCalculationSegmentsPool>& getSegmentsPool(bool reverseWaySearch);
             
             CalculationContext(RoutePlannerContext* owner);
         public:
@@ -166,17 +323,21 @@ namespace OsmAnd {
 
             friend class OsmAnd::RoutePlanner;
             friend class OsmAnd::RoutePlannerContext;
+            friend class OsmAnd::RouteMatcher;
         };
     private:
     protected:
-        QList< std::shared_ptr<RoutingSubsectionContext> > _subsectionsContexts;
-        QMap< const ObfRoutingSubsectionInfo*, std::shared_ptr<RoutingSubsectionContext> > _subsectionsContextsLUT;
-        QMap< const ObfRoutingSectionInfo*, std::shared_ptr<ObfReader> > _sourcesLUT;
+        QList< std::shared_ptr<RoutingTileContext> > _tilesContexts;
 
         QList< std::shared_ptr<RouteSegment> > _previouslyCalculatedRoute;
 
-        QMap< uint64_t, QList< std::shared_ptr<RoutingSubsectionContext> > > _indexedSubsectionsContexts;
-        QMap< uint64_t, QList< std::shared_ptr<Model::Road> > > _cachedRoadsInTiles;
+        QMap< uint64_t, QList< std::shared_ptr<RoutingTileContext> > > _indexedTilesContexts;
+        QMap< uint64_t, QList< std::shared_ptr<Road> > > _cachedRoadsInTiles;
+        // Guards tiles state above while both directions of search load tiles
+        QMutex _tilesMutex;
+
+        // Hierarchies built for the profile from sidecar files of sources, if any
+        QList< std::shared_ptr<const RoutingHierarchy> > _hierarchies;
 
         float _initialHeading;
         bool _useBasemap;
@@ -185,6 +346,7 @@ namespace OsmAnd {
         int _planRoadDirection;
         float _heuristicCoefficient;
         float _partialRecalculationDistanceLimit;
+        bool _parallelBidirectionalSearch;
         int _loadedTiles;
         std::shared_ptr<RouteStatistics> _routeStatistics;
 
@@ -199,18 +361,23 @@ namespace OsmAnd {
             bool useBasemap,
             float initialHeading = std::numeric_limits<float>::quiet_NaN(),
             QHash<QString, QString>* options = nullptr,
-            size_t memoryLimit = 1000000);
+            size_t memoryLimit = 1000000,
+            const std::shared_ptr<OsmAnd::RoutingTilesCache>& tilesCache = nullptr);
         virtual ~RoutePlannerContext();
 
         const QList< std::shared_ptr<OsmAnd::ObfReader> > sources;
         const std::shared_ptr<OsmAnd::RoutingConfiguration> configuration;
         const std::shared_ptr<OsmAnd::RoutingProfileContext> profileContext;
+        // Decoded tiles shared with other contexts, global cache unless other one was given
+        const std::shared_ptr<OsmAnd::RoutingTilesCache> tilesCache;
 
         uint32_t getCurrentlyLoadedTiles();
         uint32_t getCurrentEstimatedSize();
         void unloadUnusedTiles(size_t memoryTarget);
+        std::shared_ptr<const RouteStatistics> getRouteStatistics() const;
 
         friend class OsmAnd::RoutePlanner;
+        friend class OsmAnd::RouteMatcher;
     };
 
 } // namespace OsmAnd
@@ -0,0 +1,192 @@
+#ifndef _OSMAND_CORE_ROUTING_HIERARCHY_H_
+#define _OSMAND_CORE_ROUTING_HIERARCHY_H_
+
+#include <OsmAndCore/stdlib_common.h>
+#include <memory>
+
+#include <OsmAndCore/QtExtensions.h>
+#include <OsmAndCore/ignore_warnings_on_external_includes.h>
+#include <QString>
+#include <QHash>
+#include <QVector>
+#include <QMutex>
+#include <OsmAndCore/restore_internal_warnings.h>
+
+#include <OsmAndCore.h>
+#include <OsmAndCore/CommonTypes.h>
+#include <OsmAndCore/IQueryController.h>
+
+namespace OsmAnd {
+
+    class ObfReader;
+    class RoutingProfileContext;
+    namespace Concurrent
+    {
+        class WorkerPool;
+    }
+
+    // Contraction hierarchy over routing data of single OBF file for single routing profile.
+    // Nodes are road junctions and road ends, edges are pieces of roads between them plus shortcuts
+    // that replace paths through nodes contracted earlier. Turn costs and turn restrictions are not
+    // part of the hierarchy, so it is meant for long routes where they don't change the result much,
+    // and it's not used for profiles that respect turn restrictions or have non-default options.
+    // Hierarchy is built offline and stored in a sidecar file next to the OBF file
+    class OSMAND_CORE_API RoutingHierarchy
+    {
+    public:
+        enum : uint32_t {
+            InvalidId = 0xFFFFFFFFu,
+        };
+
+        struct Node
+        {
+            PointI location31;
+            uint32_t rank;
+        };
+
+        struct Edge
+        {
+            uint32_t from;
+            uint32_t to;
+            float time;
+
+            // Original edge goes along single road from one point to another
+            uint64_t roadId;
+            uint32_t startPointIndex;
+            uint32_t endPointIndex;
+
+            // Shortcut consists of two other edges
+            uint32_t firstChild;
+            uint32_t secondChild;
+
+            inline bool isShortcut() const
+            {
+                return firstChild != InvalidId;
+            }
+        };
+
+        // Node where search starts or ends, with time to get there from the route point (or back)
+        struct Terminal
+        {
+            uint32_t node;
+            float time;
+        };
+    private:
+        QVector<Node> _nodes;
+        QVector<Edge> _edges;
+
+        // Edges that lead to higher ranked nodes, stored per node: outgoing ones are used by
+        // forward search, incoming ones by backward search
+        QVector<uint32_t> _upwardOutgoingOffsets;
+        QVector<uint32_t> _upwardOutgoingEdges;
+        QVector<uint32_t> _upwardIncomingOffsets;
+        QVector<uint32_t> _upwardIncomingEdges;
+
+        QHash< uint64_t, QVector<uint32_t> > _roadsEdges;
+
+        // Assigns ranks to nodes and adds shortcuts to original edges
+        bool contract(const IQueryController* const controller);
+        void buildSearchGraph();
+        void unpackEdge(const uint32_t edgeId, QVector<uint32_t>& outEdges) const;
+        // Settles whole upward search space of terminals, outgoing edges are followed by forward
+        // search and incoming ones by backward search
+        bool settleUpward(
+            const QVector<Terminal>& terminals,
+            const bool backward,
+            QHash<uint32_t, float>& outTimes,
+            const IQueryController* const controller) const;
+
+        enum {
+            FileSignature = 0x4F524348,
+            FileVersion = 1,
+
+            WitnessSearchSettledNodesLimit = 500,
+            AbortCheckInterval = 1024,
+        };
+    protected:
+        RoutingHierarchy(const QString& profileName, const uint64_t obfFileSize);
+    public:
+        virtual ~RoutingHierarchy();
+
+        const QString profileName;
+        // Size of OBF file hierarchy was built from, to detect outdated sidecar files
+        const uint64_t obfFileSize;
+
+        const QVector<Node>& nodes;
+        const QVector<Edge>& edges;
+
+        // Original edges that go along given road
+        QVector<uint32_t> getRoadEdges(const uint64_t roadId) const;
+
+        // Bidirectional upward search from sources to targets. Found path is returned as original
+        // edges in route order along with indices of the source and target it connects
+        bool findPath(
+            const QVector<Terminal>& sources,
+            const QVector<Terminal>& targets,
+            QVector<uint32_t>& outEdges,
+            int* const outSourceIndex = nullptr,
+            int* const outTargetIndex = nullptr,
+            float* const outTime = nullptr,
+            const IQueryController* const controller = nullptr) const;
+
+        // Times from every group of sources to every group of targets, row per group of sources.
+        // Backward searches of targets leave buckets at nodes they reach, then forward search of
+        // each group of sources scans buckets of nodes it reaches. Unreachable pairs get infinite time
+        bool calculateTimesMatrix(
+            const QVector< QVector<Terminal> >& sources,
+            const QVector< QVector<Terminal> >& targets,
+            QVector<float>& outTimes,
+            Concurrent::WorkerPool* const workerPool = nullptr,
+            const IQueryController* const controller = nullptr) const;
+
+        bool saveTo(const QString& filePath) const;
+        static std::shared_ptr<RoutingHierarchy> loadFrom(const QString& filePath);
+        static QString getSidecarFilePath(const QString& obfFilePath, const QString& profileName);
+
+        static std::shared_ptr<RoutingHierarchy> build(
+            const std::shared_ptr<ObfReader>& source,
+            const std::shared_ptr<RoutingProfileContext>& profileContext,
+            const IQueryController* const controller = nullptr);
+        // Builds hierarchy over given original edges, ranks of nodes are ignored
+        static std::shared_ptr<RoutingHierarchy> build(
+            const QString& profileName,
+            const uint64_t obfFileSize,
+            const QVector<Node>& nodes,
+            const QVector<Edge>& edges,
+            const IQueryController* const controller = nullptr);
+    };
+
+    // Hierarchies loaded from sidecar files, shared by all route planner contexts, so that sidecar
+    // is read once rather than by each context. Sidecar that changed on disk is loaded again
+    class OSMAND_CORE_API RoutingHierarchiesCache
+    {
+        Q_DISABLE_COPY_AND_MOVE(RoutingHierarchiesCache);
+    private:
+        struct Entry
+        {
+            // Missing or outdated sidecar is remembered as well, as null hierarchy
+            std::shared_ptr<const RoutingHierarchy> hierarchy;
+            uint64_t obfFileSize;
+            int64_t sidecarLastModifiedTime;
+        };
+
+        mutable QMutex _mutex;
+        QHash<QString, Entry> _entries;
+    protected:
+    public:
+        RoutingHierarchiesCache();
+        virtual ~RoutingHierarchiesCache();
+
+        // Returns hierarchy of given profile for given OBF file, or nullptr if there's no up-to-date one
+        std::shared_ptr<const RoutingHierarchy> obtainHierarchy(
+            const QString& obfFilePath,
+            const uint64_t obfFileSize,
+            const QString& profileName);
+        void clear();
+
+        static std::shared_ptr<RoutingHierarchiesCache> globalInstance();
+    };
+
+} // namespace OsmAnd
+
+#endif // !defined(_OSMAND_CORE_ROUTING_HIERARCHY_H_)
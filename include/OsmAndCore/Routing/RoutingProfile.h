@@ -10,7 +10,7 @@
 
 #include <OsmAndCore.h>
 #include <OsmAndCore/Routing/RoutingRuleset.h>
-#include <OsmAndCore/Data/Model/Road.h>
+#include <OsmAndCore/Data/Road.h>
 
 namespace OsmAnd {
 
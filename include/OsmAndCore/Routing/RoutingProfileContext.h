@@ -6,16 +6,16 @@
 #include <OsmAndCore/QtExtensions.h>
 #include <QString>
 #include <QHash>
+#include <QReadWriteLock>
 
 #include <OsmAndCore.h>
 #include <OsmAndCore/Routing/RoutingProfile.h>
 #include <OsmAndCore/Routing/RoutingRulesetContext.h>
-#include <OsmAndCore/Data/Model/Road.h>
+#include <OsmAndCore/Data/Road.h>
 
 namespace OsmAnd {
 
     class ObfRoutingSectionInfo;
-    class ObfRoutingBorderLinePoint;
 
     class OSMAND_CORE_API RoutingProfileContext
     {
@@ -24,6 +24,34 @@ namespace OsmAnd {
         std::shared_ptr<RoutingRulesetContext> _rulesetContexts[RoutingRuleset::TypesCount];
 
         QHash< std::shared_ptr<const ObfRoutingSectionInfo>, QMap<uint32_t, uint32_t> > _tagValueAttribIdCache;
+
+        // Rules depend only on types and context values, so they are evaluated once per distinct
+        // set of types in a section and then looked up on each segment relaxation by key built
+        // from section runtime identifier and identifier of types set within that section
+        static uint64_t getTypesSetKey(const ObfRoutingSectionInfo* const section, const uint32_t typesSetId);
+        struct RoadAttributes
+        {
+            RoadDirection direction;
+            bool accepted;
+            float speedPriority;
+            float speed;
+        };
+        QHash<uint64_t, RoadAttributes> _roadAttributesCache;
+        struct PointAttributes
+        {
+            float obstaclesExtraTime;
+            float routingObstaclesExtraTime;
+        };
+        QHash<uint64_t, PointAttributes> _pointAttributesCache;
+        // Rule evaluation also updates type encoding caches, so misses are evaluated under write lock
+        mutable QReadWriteLock _attributesCacheLock;
+
+        RoadAttributes getRoadAttributes(const std::shared_ptr<const OsmAnd::Road>& road);
+        PointAttributes getPointAttributes(
+            const std::shared_ptr<const ObfRoutingSectionInfo>& section,
+            const uint32_t* const pPointTypes,
+            const int pointTypesCount,
+            const uint32_t typesSetId);
     public:
         RoutingProfileContext(const std::shared_ptr<RoutingProfile>& profile, QHash<QString, QString>* contextValues = nullptr);
         virtual ~RoutingProfileContext();
@@ -32,13 +60,12 @@ namespace OsmAnd {
 
         std::shared_ptr<RoutingRulesetContext> getRulesetContext(RoutingRuleset::Type type);
 
-        Model::RoadDirection getDirection(const std::shared_ptr<const OsmAnd::Model::Road>& road);
-        bool acceptsRoad(const std::shared_ptr<const OsmAnd::Model::Road>& road);
-        bool acceptsBorderLinePoint(const std::shared_ptr<const ObfRoutingSectionInfo>& section, const std::shared_ptr<const ObfRoutingBorderLinePoint>& point);
-        float getSpeedPriority(const std::shared_ptr<const OsmAnd::Model::Road>& road);
-        float getSpeed(const std::shared_ptr<const OsmAnd::Model::Road>& road);
-        float getObstaclesExtraTime(const std::shared_ptr<const OsmAnd::Model::Road>& road, uint32_t pointIndex);
-        float getRoutingObstaclesExtraTime(const std::shared_ptr<const OsmAnd::Model::Road>& road, uint32_t pointIndex);
+        RoadDirection getDirection(const std::shared_ptr<const OsmAnd::Road>& road);
+        bool acceptsRoad(const std::shared_ptr<const OsmAnd::Road>& road);
+        float getSpeedPriority(const std::shared_ptr<const OsmAnd::Road>& road);
+        float getSpeed(const std::shared_ptr<const OsmAnd::Road>& road);
+        float getObstaclesExtraTime(const std::shared_ptr<const OsmAnd::Road>& road, uint32_t pointIndex);
+        float getRoutingObstaclesExtraTime(const std::shared_ptr<const OsmAnd::Road>& road, uint32_t pointIndex);
 
         friend class OsmAnd::RoutingRulesetContext;
     };
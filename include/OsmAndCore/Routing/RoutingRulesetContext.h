@@ -15,9 +15,7 @@ namespace OsmAnd {
 
     class RoutingProfileContext;
     class ObfRoutingSectionInfo;
-    namespace Model {
-        class Road;
-    } // namespace Model
+    class Road;
 
     class OSMAND_CORE_API RoutingRulesetContext
     {
@@ -25,7 +23,7 @@ namespace OsmAnd {
         QHash<QString, QString> _contextValues;
         std::shared_ptr<RoutingRuleset> _ruleset;
     protected:
-        bool evaluate(const std::shared_ptr<const Model::Road>& road, const RoutingRuleExpression::ResultType type, void* const result);
+        bool evaluate(const std::shared_ptr<const Road>& road, const RoutingRuleExpression::ResultType type, void* const result);
         bool evaluate(const QBitArray& types, const RoutingRuleExpression::ResultType type, void* const result);
         QBitArray encode(const std::shared_ptr<const ObfRoutingSectionInfo>& section, const QVector<uint32_t>& roadTypes);
     public:
@@ -36,8 +34,8 @@ namespace OsmAnd {
         const std::shared_ptr<RoutingRuleset> ruleset;
         const QHash<QString, QString>& contextValues;
 
-        int evaluateAsInteger(const std::shared_ptr<const Model::Road>& road, const int defaultValue);
-        float evaluateAsFloat(const std::shared_ptr<const Model::Road>& road, const float defaultValue);
+        int evaluateAsInteger(const std::shared_ptr<const Road>& road, const int defaultValue);
+        float evaluateAsFloat(const std::shared_ptr<const Road>& road, const float defaultValue);
 
         int evaluateAsInteger(const std::shared_ptr<const ObfRoutingSectionInfo>& section, const QVector<uint32_t>& roadTypes, const int defaultValue);
         float evaluateAsFloat(const std::shared_ptr<const ObfRoutingSectionInfo>& section, const QVector<uint32_t>& roadTypes, const float defaultValue);
@@ -0,0 +1,110 @@
+#ifndef _OSMAND_CORE_ROUTING_TILES_CACHE_H_
+#define _OSMAND_CORE_ROUTING_TILES_CACHE_H_
+
+#include <OsmAndCore/stdlib_common.h>
+#include <memory>
+
+#include <OsmAndCore/QtExtensions.h>
+#include <OsmAndCore/ignore_warnings_on_external_includes.h>
+#include <QHash>
+#include <QList>
+#include <QMutex>
+#include <QWaitCondition>
+#include <OsmAndCore/restore_internal_warnings.h>
+
+#include <OsmAndCore.h>
+#include <OsmAndCore/CommonTypes.h>
+#include <OsmAndCore/Data/DataCommonTypes.h>
+#include <OsmAndCore/Data/Road.h>
+#include <OsmAndCore/Data/ObfRoutingSectionReader.h>
+
+namespace OsmAnd {
+
+    class ObfReader;
+    class ObfRoutingSectionInfo;
+
+    // Roads of routing sections within loading tiles, decoded once and shared by all route planner
+    // contexts that use same OBF readers. Roads are kept as read, before profile filtering, so that
+    // contexts of different profiles share them as well: each context keeps own index of roads
+    // accepted by its profile on top of borrowed tile. Data blocks of sections are decoded once even
+    // if they span several tiles. Tiles no context borrows are evicted in least recently used order
+    // once their estimated size goes above the limit
+    class OSMAND_CORE_API RoutingTilesCache
+    {
+        Q_DISABLE_COPY_AND_MOVE(RoutingTilesCache);
+    public:
+        struct Tile
+        {
+            QList< std::shared_ptr<const Road> > roads;
+            // References to data blocks roads come from, released when tile is evicted
+            QList< std::shared_ptr<const ObfRoutingSectionReader::DataBlock> > dataBlocks;
+            size_t estimatedSize;
+        };
+
+        enum : size_t {
+            DefaultSizeLimit = 256 * 1024 * 1024,
+        };
+    private:
+        struct TileKey
+        {
+            const ObfRoutingSectionInfo* section;
+            RoutingDataLevel dataLevel;
+            ZoomLevel zoom;
+            TileId tileId;
+
+            inline bool operator==(const TileKey& that) const
+            {
+                return section == that.section && dataLevel == that.dataLevel && zoom == that.zoom && tileId.id == that.tileId.id;
+            }
+
+            friend inline uint qHash(const TileKey& key, uint seed = 0)
+            {
+                return ::qHash(key.section, seed) ^ ::qHash(key.tileId.id, seed) ^ (static_cast<uint>(key.zoom) << 1) ^ static_cast<uint>(key.dataLevel);
+            }
+        };
+
+        struct Entry
+        {
+            // Keeps section alive, so its address used in key is not reused while entry exists
+            std::shared_ptr<const ObfRoutingSectionInfo> section;
+            std::shared_ptr<const Tile> tile;
+            bool isLoading;
+            uint64_t lastAccess;
+        };
+
+        mutable QMutex _mutex;
+        QWaitCondition _tileLoadedCondition;
+        QHash<TileKey, Entry> _entries;
+        uint64_t _accessCounter;
+        size_t _estimatedSize;
+        size_t _sizeLimit;
+        ObfRoutingSectionReader::DataBlocksCache _dataBlocksCache;
+
+        void releaseTile(const std::shared_ptr<const Tile>& tile);
+        void evictUnusedTiles();
+    protected:
+    public:
+        RoutingTilesCache(const size_t sizeLimit = DefaultSizeLimit);
+        virtual ~RoutingTilesCache();
+
+        // Returns decoded tile, decoding it if needed. Concurrent requests for the same tile wait
+        // for single decoding. Tile stays in cache at least while returned pointer is held
+        std::shared_ptr<const Tile> obtainTile(
+            const std::shared_ptr<ObfReader>& reader,
+            const std::shared_ptr<const ObfRoutingSectionInfo>& section,
+            const RoutingDataLevel dataLevel,
+            const TileId tileId,
+            const ZoomLevel zoom,
+            bool* const outWasCached = nullptr);
+
+        size_t getEstimatedSize() const;
+        size_t getSizeLimit() const;
+        void setSizeLimit(const size_t sizeLimit);
+        void clear();
+
+        static std::shared_ptr<RoutingTilesCache> globalInstance();
+    };
+
+} // namespace OsmAnd
+
+#endif // !defined(_OSMAND_CORE_ROUTING_TILES_CACHE_H_)
@@ -1,440 +1,884 @@
 #include "CachedOsmandIndexes_P.h"
 #include "CachedOsmandIndexes.h"
 
-#include <fcntl.h>
+#include <cstring>
 
 #include "QtExtensions.h"
-#include <QFile>
-#include <QDateTime>
+#include <QFileInfo>
+#include <QSaveFile>
 
-#include "ignore_warnings_on_external_includes.h"
-#include "google/protobuf/io/zero_copy_stream_impl.h"
-#include "restore_internal_warnings.h"
-
-#include "QIODeviceInputStream.h"
-#include "QFileDeviceInputStream.h"
 #include "ObfFile.h"
-#include "ObfFile_P.h"
 #include "ObfInfo.h"
 #include "ObfReader.h"
+#include "ObfReader_P.h"
 #include "ObfMapSectionInfo.h"
 #include "ObfMapSectionReader_P.h"
 #include "ObfAddressSectionInfo.h"
-#include "ObfAddressSectionReader_P.h"
 #include "ObfTransportSectionInfo.h"
-#include "ObfTransportSectionReader_P.h"
 #include "ObfRoutingSectionInfo.h"
+#include "ObfRoutingSectionReader.h"
 #include "ObfRoutingSectionReader_P.h"
 #include "ObfPoiSectionInfo.h"
 #include "ObfPoiSectionReader_P.h"
-#include "ObfReaderUtilities.h"
+#include "ObfAddressSectionReader_P.h"
 #include "Logging.h"
 #include "Stopwatch.h"
-#include "IObfsCollection.h"
-#include "ObfDataInterface.h"
+
+namespace
+{
+    const char CacheFileMagic[8] = { 'O', 's', 'm', 'A', 'n', 'd', 'C', 'I' };
+    enum : quint32
+    {
+        // Bumped on any change of records layout, independently of CachedOsmandIndexes::VERSION
+        RecordsFormatVersion = 3,
+    };
+    const int CacheFileHeaderSize = sizeof(CacheFileMagic) + 2 * sizeof(quint32);
+
+    // Cache of OsmAnd app, it has protobuf format and is never written by core
+    const QLatin1String AppCacheFileName("ind.cache");
+
+    // Appends values to record as they are in memory
+    class RecordWriter Q_DECL_FINAL
+    {
+    public:
+        RecordWriter(QByteArray& buffer_)
+            : buffer(buffer_)
+        {
+        }
+
+        QByteArray& buffer;
+
+        template<typename T>
+        void write(const T value)
+        {
+            buffer.append(reinterpret_cast<const char*>(&value), sizeof(T));
+        }
+
+        void write(const bool value)
+        {
+            write<quint8>(value ? 1 : 0);
+        }
+
+        void write(const QString& value)
+        {
+            write<quint32>(value.size());
+            buffer.append(reinterpret_cast<const char*>(value.constData()), value.size() * sizeof(QChar));
+        }
+
+        void write(const OsmAnd::AreaI& area31)
+        {
+            write<qint32>(area31.top());
+            write<qint32>(area31.left());
+            write<qint32>(area31.bottom());
+            write<qint32>(area31.right());
+        }
+
+        void writeBlob(const QByteArray& blob)
+        {
+            write<quint32>(blob.size());
+            buffer.append(blob);
+        }
+    };
+
+    // Reads values written by RecordWriter. Reading past the end only marks reader as failed,
+    // so values are checked once after whole record is read
+    class RecordReader Q_DECL_FINAL
+    {
+    private:
+        const char* _pData;
+        const char* const _pEnd;
+        bool _ok;
+
+        bool ensureAvailable(const quint64 size)
+        {
+            if (_ok && static_cast<quint64>(_pEnd - _pData) >= size)
+                return true;
+            _ok = false;
+            return false;
+        }
+    public:
+        RecordReader(const char* const pData, const int size)
+            : _pData(pData)
+            , _pEnd(pData + size)
+            , _ok(true)
+        {
+        }
+
+        bool isOk() const
+        {
+            return _ok;
+        }
+
+        template<typename T>
+        T read()
+        {
+            T value = T();
+            if (!ensureAvailable(sizeof(T)))
+                return value;
+            memcpy(&value, _pData, sizeof(T));
+            _pData += sizeof(T);
+            return value;
+        }
+
+        bool readBool()
+        {
+            return read<quint8>() != 0;
+        }
+
+        QString readString()
+        {
+            const auto length = read<quint32>();
+            if (!ensureAvailable(static_cast<quint64>(length) * sizeof(QChar)))
+                return QString();
+            QString value(length, Qt::Uninitialized);
+            memcpy(value.data(), _pData, length * sizeof(QChar));
+            _pData += length * sizeof(QChar);
+            return value;
+        }
+
+        OsmAnd::AreaI readArea()
+        {
+            const auto top = read<qint32>();
+            const auto left = read<qint32>();
+            const auto bottom = read<qint32>();
+            const auto right = read<qint32>();
+            return OsmAnd::AreaI(top, left, bottom, right);
+        }
+
+        // Blob is copied, since record may reside in memory-mapped cache file
+        QByteArray readBlob()
+        {
+            const auto size = read<quint32>();
+            if (!ensureAvailable(size))
+                return QByteArray();
+            const QByteArray blob(_pData, size);
+            _pData += size;
+            return blob;
+        }
+    };
+
+    std::shared_ptr<OsmAnd::ObfMapSectionAttributeMapping> decodeAttributeMapping(const QByteArray& data)
+    {
+        RecordReader reader(data.constData(), data.size());
+        const std::shared_ptr<OsmAnd::ObfMapSectionAttributeMapping> attributeMapping(new OsmAnd::ObfMapSectionAttributeMapping());
+        const auto entriesCount = reader.read<quint32>();
+        for (auto entryIdx = 0u; entryIdx < entriesCount && reader.isOk(); entryIdx++)
+        {
+            const auto id = reader.read<quint32>();
+            const auto tag = reader.readString();
+            const auto value = reader.readString();
+            if (reader.isOk())
+                attributeMapping->registerMapping(id, tag, value);
+        }
+        if (!reader.isOk())
+            return nullptr;
+
+        attributeMapping->verifyRequiredMappingRegistered();
+        return attributeMapping;
+    }
+
+    inline void enlargeGlobalBBox(OsmAnd::Nullable<OsmAnd::AreaI>& globalBBox31, const OsmAnd::AreaI& area31)
+    {
+        if (globalBBox31.isSet())
+            globalBBox31->enlargeToInclude(area31);
+        else
+            globalBBox31 = area31;
+    }
+}
 
 OsmAnd::CachedOsmandIndexes_P::CachedOsmandIndexes_P(
-	CachedOsmandIndexes* const owner_)
-    : _storedIndex(nullptr)
-    , _hasChanged(true)
+    CachedOsmandIndexes* const owner_)
+    : _validCacheSize(0)
+    , _supersededRecordsSize(0)
     , owner(owner_)
 {
 }
 
 OsmAnd::CachedOsmandIndexes_P::~CachedOsmandIndexes_P()
 {
+    closeCacheFile();
+}
+
+void OsmAnd::CachedOsmandIndexes_P::closeCacheFile()
+{
+    if (!_cacheFile)
+        return;
+
+    // Records that still reference mapped memory have to own their data from now on
+    for (auto& record : _records)
+        record.payload = QByteArray(record.payload.constData(), record.payload.size());
+
+    _cacheFile->close();
+    _cacheFile.reset();
+}
+
+void OsmAnd::CachedOsmandIndexes_P::addToCache(
+    const std::shared_ptr<const ObfFile>& file,
+    const std::shared_ptr<const ObfReader>& obfReader)
+{
+    const auto fileName = QFileInfo(file->filePath).fileName();
+    const auto payload = encodeRecord(fileName, file, obfReader);
+
+    const auto citExistingRecord = _records.constFind(fileName);
+    if (citExistingRecord != _records.cend())
+        _supersededRecordsSize += sizeof(quint32) + citExistingRecord->payload.size();
+
+    Record record;
+    record.fileSize = file->fileSize;
+    record.payload = payload;
+    _records.insert(fileName, record);
+    _pendingRecords.push_back(payload);
 }
 
-void OsmAnd::CachedOsmandIndexes_P::addToCache(const std::shared_ptr<const ObfFile>& file)
+QByteArray OsmAnd::CachedOsmandIndexes_P::encodeRecord(
+    const QString& fileName,
+    const std::shared_ptr<const ObfFile>& file,
+    const std::shared_ptr<const ObfReader>& obfReader)
 {
-    _hasChanged = true;
-    if (_storedIndex == nullptr)
-    {
-        _storedIndex = std::make_shared<OBF::OsmAndStoredIndex>();
-        _storedIndex->set_version(CachedOsmandIndexes::VERSION);
-        auto time_since_epoch = std::chrono::system_clock::now().time_since_epoch();
-        auto millis = std::chrono::duration_cast<std::chrono::milliseconds>(time_since_epoch).count();
-        _storedIndex->set_datecreated(millis);
+    const auto& obfInfo = file->obfInfo;
+
+    QByteArray payload;
+    RecordWriter writer(payload);
+
+    writer.write(fileName);
+    writer.write<quint64>(file->fileSize);
+    writer.write<qint32>(obfInfo->version);
+    writer.write<quint64>(obfInfo->creationTimestamp);
+
+    writer.write<quint32>(obfInfo->mapSections.size());
+    for (const auto& section : constOf(obfInfo->mapSections))
+    {
+        writer.write(section->name);
+        writer.write<quint32>(section->offset);
+        writer.write<quint32>(section->length);
+
+        writer.write<quint32>(section->levels.size());
+        for (const auto& level : constOf(section->levels))
+        {
+            writer.write<quint32>(level->offset);
+            writer.write<quint32>(level->length);
+            writer.write<quint32>(level->firstDataBoxInnerOffset);
+            writer.write(level->area31);
+            writer.write<qint32>(level->minZoom);
+            writer.write<qint32>(level->maxZoom);
+
+            const auto rootNodes = ObfMapSectionReader_P::obtainRootNodes(*obfReader->_p, section, level);
+            writer.write<quint32>(rootNodes->nodes.size());
+            for (const auto& rootNode : constOf(rootNodes->nodes))
+            {
+                writer.write<quint32>(rootNode.offset);
+                writer.write<quint32>(rootNode.length);
+                writer.write<quint32>(rootNode.dataOffset);
+                writer.write<qint32>(static_cast<int>(rootNode.surfaceType));
+                writer.write(rootNode.area31);
+                writer.write(rootNode.hasChildrenDataBoxes);
+                writer.write<quint32>(rootNode.firstDataBoxInnerOffset);
+            }
+        }
+
+        // Attribute mapping is stored including required entries, registering them again is no-op.
+        // It's a separate blob, so that it's decoded only when section is queried
+        ObfMapSectionReader_P::ensureAttributeMappingLoaded(*obfReader->_p, section);
+        const auto& decodeMap = section->getAttributeMapping()->decodeMap;
+        ListMap<MapObject::AttributeMapping::TagValue>::KeyType maxKey = 0;
+        const auto hasEntries = decodeMap.findMaxKey(maxKey);
+        quint32 entriesCount = 0;
+        for (auto id = 0u; hasEntries && id <= maxKey; id++)
+        {
+            if (decodeMap.getRef(id))
+                entriesCount++;
+        }
+        QByteArray attributeMappingData;
+        RecordWriter attributeMappingWriter(attributeMappingData);
+        attributeMappingWriter.write<quint32>(entriesCount);
+        for (auto id = 0u; hasEntries && id <= maxKey; id++)
+        {
+            if (const auto entry = decodeMap.getRef(id))
+            {
+                attributeMappingWriter.write<quint32>(id);
+                attributeMappingWriter.write(entry->tag);
+                attributeMappingWriter.write(entry->value);
+            }
+        }
+        writer.writeBlob(attributeMappingData);
     }
-    
-    const auto& fileInfo = QFileInfo(file->filePath);
-    auto obfInfo = file->obfInfo;
-    
-    auto fileIndex = _storedIndex->add_fileindex();
-    auto d = obfInfo->creationTimestamp;
-    if (d == 0)
-    {
-        auto lastModified = fileInfo.lastModified().toMSecsSinceEpoch();
-        fileIndex->set_datemodified(lastModified);
+
+    writer.write<quint32>(obfInfo->poiSections.size());
+    for (const auto& section : constOf(obfInfo->poiSections))
+    {
+        writer.write(section->name);
+        writer.write<quint32>(section->offset);
+        writer.write<quint32>(section->length);
+        writer.write(section->area31);
+        writer.write<quint32>(section->firstCategoryInnerOffset);
+        writer.write<quint32>(section->nameIndexInnerOffset);
+        writer.write<quint32>(section->subtypesInnerOffset);
+        writer.write<quint32>(section->firstBoxInnerOffset);
     }
-    else
+
+    writer.write<quint32>(obfInfo->transportSections.size());
+    for (const auto& section : constOf(obfInfo->transportSections))
+    {
+        writer.write(section->name);
+        writer.write<quint32>(section->offset);
+        writer.write<quint32>(section->length);
+        writer.write(section->area31);
+        writer.write<quint32>(section->stopsOffset);
+        writer.write<quint32>(section->stopsLength);
+        writer.write(section->stringTable.isSet());
+        if (section->stringTable.isSet())
+        {
+            writer.write<qint32>(section->stringTable->fileOffset);
+            writer.write<qint32>(section->stringTable->length);
+        }
+    }
+
+    writer.write<quint32>(obfInfo->routingSections.size());
+    for (const auto& section : constOf(obfInfo->routingSections))
     {
-        fileIndex->set_datemodified(d);
+        writer.write(section->name);
+        writer.write<quint32>(section->offset);
+        writer.write<quint32>(section->length);
+
+        for (const auto dataLevel : { RoutingDataLevel::Basemap, RoutingDataLevel::Detailed })
+        {
+            QList< std::shared_ptr<const ObfRoutingSectionLevelTreeNode> > rootNodes;
+            ObfRoutingSectionReader::loadTreeNodes(obfReader, section, dataLevel, &rootNodes);
+
+            writer.write<quint32>(rootNodes.size());
+            for (const auto& rootNode : constOf(rootNodes))
+            {
+                writer.write<quint32>(rootNode->offset);
+                writer.write<quint32>(rootNode->length);
+                writer.write<quint32>(rootNode->dataOffset);
+                writer.write(rootNode->area31);
+                writer.write(rootNode->hasChildrenDataBoxes);
+                writer.write<quint32>(rootNode->firstDataBoxInnerOffset);
+            }
+        }
     }
-    fileIndex->set_size(file->fileSize);
-    fileIndex->set_version(obfInfo->version);
-    fileIndex->set_filename(fileInfo.fileName().toStdString());
-    for(auto& index : obfInfo->mapSections)
-    {
-        auto map = fileIndex->add_mapindex();
-        map->set_size(index->length);
-        map->set_offset(index->offset);
-        map->set_name(index->name.toStdString());
-        
-        for (auto& mr : index->levels)
-        {
-            auto lev = map->add_levels();
-            lev->set_size(mr->length);
-            lev->set_offset(mr->offset);
-            lev->set_left(mr->area31.left());
-            lev->set_right(mr->area31.right());
-            lev->set_top(mr->area31.top());
-            lev->set_bottom(mr->area31.bottom());
-            lev->set_minzoom(mr->minZoom);
-            lev->set_maxzoom(mr->maxZoom);
+
+    writer.write<quint32>(obfInfo->addressSections.size());
+    for (const auto& section : constOf(obfInfo->addressSections))
+    {
+        writer.write(section->name);
+        writer.write<quint32>(section->offset);
+        writer.write<quint32>(section->length);
+        writer.write<quint32>(section->localizedNames.size());
+        for (const auto& localizedName : rangeOf(constOf(section->localizedNames)))
+        {
+            writer.write(localizedName.key());
+            writer.write(localizedName.value());
+        }
+        writer.write<quint32>(section->nameIndexInnerOffset);
+        writer.write<quint32>(section->attributeTagsTable.size());
+        for (const auto& attributeTag : constOf(section->attributeTagsTable))
+            writer.write(attributeTag);
+
+        writer.write<quint32>(section->cities.size());
+        for (const auto& citiesBlock : constOf(section->cities))
+        {
+            writer.write(citiesBlock->name);
+            writer.write<quint32>(citiesBlock->offset);
+            writer.write<quint32>(citiesBlock->length);
+            writer.write<qint32>(citiesBlock->type);
+        }
+    }
+
+    return payload;
+}
+
+std::shared_ptr<const OsmAnd::ObfInfo> OsmAnd::CachedOsmandIndexes_P::decodeRecord(const QByteArray& payload)
+{
+    RecordReader reader(payload.constData(), payload.size());
+
+    // File name and size were already checked by caller
+    reader.readString();
+    reader.read<quint64>();
+
+    const std::shared_ptr<ObfInfo> obfInfo(new ObfInfo());
+    obfInfo->version = reader.read<qint32>();
+    obfInfo->creationTimestamp = reader.read<quint64>();
+
+    Nullable<AreaI> globalBBox31;
+
+    const auto mapSectionsCount = reader.read<quint32>();
+    for (auto sectionIdx = 0u; sectionIdx < mapSectionsCount && reader.isOk(); sectionIdx++)
+    {
+        Ref<ObfMapSectionInfo> section(new ObfMapSectionInfo(obfInfo));
+        section->name = reader.readString();
+        section->offset = reader.read<quint32>();
+        section->length = reader.read<quint32>();
+
+        const auto levelsCount = reader.read<quint32>();
+        for (auto levelIdx = 0u; levelIdx < levelsCount && reader.isOk(); levelIdx++)
+        {
+            Ref<ObfMapSectionLevel> level(new ObfMapSectionLevel());
+            level->offset = reader.read<quint32>();
+            level->length = reader.read<quint32>();
+            level->firstDataBoxInnerOffset = reader.read<quint32>();
+            level->area31 = reader.readArea();
+            level->minZoom = static_cast<ZoomLevel>(reader.read<qint32>());
+            level->maxZoom = static_cast<ZoomLevel>(reader.read<qint32>());
+
+            const auto rootNodesCount = reader.read<quint32>();
+            QVector<ObfMapSectionLevelTreeNode> rootNodes;
+            for (auto nodeIdx = 0u; nodeIdx < rootNodesCount && reader.isOk(); nodeIdx++)
+            {
+                ObfMapSectionLevelTreeNode rootNode;
+                rootNode.offset = reader.read<quint32>();
+                rootNode.length = reader.read<quint32>();
+                rootNode.dataOffset = reader.read<quint32>();
+                rootNode.surfaceType = static_cast<MapSurfaceType>(reader.read<qint32>());
+                rootNode.area31 = reader.readArea();
+                rootNode.hasChildrenDataBoxes = reader.readBool();
+                rootNode.firstDataBoxInnerOffset = reader.read<quint32>();
+                rootNodes.push_back(rootNode);
+            }
+            if (reader.isOk())
+                ObfMapSectionReader_P::restoreRootNodes(level.shared_ptr(), rootNodes);
+
+            enlargeGlobalBBox(globalBBox31, level->area31);
+            section->levels.push_back(level);
+        }
+
+        const auto attributeMappingData = reader.readBlob();
+        if (reader.isOk())
+        {
+            ObfMapSectionReader_P::restoreAttributeMapping(section.shared_ptr(),
+                [attributeMappingData]
+                () -> std::shared_ptr<ObfMapSectionAttributeMapping>
+                {
+                    return decodeAttributeMapping(attributeMappingData);
+                });
         }
+
+        section->isBasemap = section->name.contains(QLatin1String("basemap"), Qt::CaseInsensitive);
+        section->isBasemapWithCoastlines = section->name == QLatin1String("basemap");
+        obfInfo->isBasemap = obfInfo->isBasemap || section->isBasemap;
+        obfInfo->isBasemapWithCoastlines = obfInfo->isBasemapWithCoastlines || section->isBasemapWithCoastlines;
+
+        obfInfo->mapSections.push_back(section);
     }
-    
-    for (auto& index : obfInfo->addressSections)
-    {
-        auto addr = fileIndex->add_addressindex();
-        addr->set_size(index->length);
-        addr->set_offset(index->offset);
-        addr->set_name(index->name.toStdString());
-        if (index->localizedNames.contains(QLatin1String("en")))
-            addr->set_nameen(index->localizedNames[QLatin1String("en")].toStdString());
-
-        addr->set_indexnameoffset(index->nameIndexInnerOffset);
-        for (auto& mr : index->cities)
-        {
-            auto cblock = addr->add_cities();
-            cblock->set_size(mr->length);
-            cblock->set_offset(mr->offset);
-            cblock->set_type(mr->type);
-        }
-        for (const auto& s : index->attributeTagsTable)
-            addr->add_additionaltags(s.toStdString());
+
+    const auto poiSectionsCount = reader.read<quint32>();
+    for (auto sectionIdx = 0u; sectionIdx < poiSectionsCount && reader.isOk(); sectionIdx++)
+    {
+        Ref<ObfPoiSectionInfo> section(new ObfPoiSectionInfo(obfInfo));
+        section->name = reader.readString();
+        section->offset = reader.read<quint32>();
+        section->length = reader.read<quint32>();
+        section->area31 = reader.readArea();
+        section->firstCategoryInnerOffset = reader.read<quint32>();
+        section->nameIndexInnerOffset = reader.read<quint32>();
+        section->subtypesInnerOffset = reader.read<quint32>();
+        section->firstBoxInnerOffset = reader.read<quint32>();
+
+        enlargeGlobalBBox(globalBBox31, section->area31);
+        obfInfo->poiSections.push_back(section);
     }
-    
-    for (auto index : obfInfo->poiSections)
-    {
-        auto poi = fileIndex->add_poiindex();
-        poi->set_size(index->length);
-        poi->set_offset(index->offset);
-        poi->set_name(index->name.toStdString());
-        poi->set_left(index->area31.left());
-        poi->set_right(index->area31.right());
-        poi->set_top(index->area31.top());
-        poi->set_bottom(index->area31.bottom());
+
+    const auto transportSectionsCount = reader.read<quint32>();
+    for (auto sectionIdx = 0u; sectionIdx < transportSectionsCount && reader.isOk(); sectionIdx++)
+    {
+        Ref<ObfTransportSectionInfo> section(new ObfTransportSectionInfo(obfInfo));
+        section->name = reader.readString();
+        section->offset = reader.read<quint32>();
+        section->length = reader.read<quint32>();
+        section->_area31 = reader.readArea();
+        section->_stopsOffset = reader.read<quint32>();
+        section->_stopsLength = reader.read<quint32>();
+        if (reader.readBool())
+        {
+            ObfTransportSectionInfo::IndexStringTable stringTable;
+            stringTable.fileOffset = reader.read<qint32>();
+            stringTable.length = reader.read<qint32>();
+            section->_stringTable = stringTable;
+        }
+
+        enlargeGlobalBBox(globalBBox31, section->_area31);
+        obfInfo->transportSections.push_back(section);
     }
-    
-    for (auto index : obfInfo->transportSections)
-    {
-        auto transport = fileIndex->add_transportindex();
-        transport->set_size(index->length);
-        transport->set_offset(index->offset);
-        transport->set_name(index->name.toStdString());
-        transport->set_left(index->area31.left());
-        transport->set_right(index->area31.right());
-        transport->set_top(index->area31.top());
-        transport->set_bottom(index->area31.bottom());
-        transport->set_stopstablelength(index->stopsLength);
-        transport->set_stopstableoffset(index->stopsOffset);
-        transport->set_stringtablelength(index->stringTable->length);
-        transport->set_stringtableoffset(index->stringTable->fileOffset);
+
+    const auto routingSectionsCount = reader.read<quint32>();
+    for (auto sectionIdx = 0u; sectionIdx < routingSectionsCount && reader.isOk(); sectionIdx++)
+    {
+        Ref<ObfRoutingSectionInfo> section(new ObfRoutingSectionInfo(obfInfo));
+        section->name = reader.readString();
+        section->offset = reader.read<quint32>();
+        section->length = reader.read<quint32>();
+
+        Nullable<AreaI> bbox31;
+        for (const auto dataLevel : { RoutingDataLevel::Basemap, RoutingDataLevel::Detailed })
+        {
+            const auto rootNodesCount = reader.read<quint32>();
+            QList< std::shared_ptr<const ObfRoutingSectionLevelTreeNode> > rootNodes;
+            for (auto nodeIdx = 0u; nodeIdx < rootNodesCount && reader.isOk(); nodeIdx++)
+            {
+                const std::shared_ptr<ObfRoutingSectionLevelTreeNode> rootNode(new ObfRoutingSectionLevelTreeNode());
+                rootNode->offset = reader.read<quint32>();
+                rootNode->length = reader.read<quint32>();
+                rootNode->dataOffset = reader.read<quint32>();
+                rootNode->area31 = reader.readArea();
+                rootNode->hasChildrenDataBoxes = reader.readBool();
+                rootNode->firstDataBoxInnerOffset = reader.read<quint32>();
+                rootNodes.push_back(rootNode);
+
+                enlargeGlobalBBox(bbox31, rootNode->area31);
+            }
+            if (reader.isOk())
+                ObfRoutingSectionReader_P::restoreTreeNodes(section.shared_ptr(), dataLevel, rootNodes);
+        }
+        if (bbox31.isSet())
+        {
+            section->area31 = *bbox31;
+            enlargeGlobalBBox(globalBBox31, section->area31);
+        }
+
+        obfInfo->routingSections.push_back(section);
     }
-    
-    auto obfReader = std::make_shared<const ObfReader>(file);
-    for (auto index : obfInfo->routingSections)
-    {
-        auto routing = fileIndex->add_routingindex();
-        routing->set_size(index->length);
-        routing->set_offset(index->offset);
-        routing->set_name(index->name.toStdString());
-
-        QList<std::shared_ptr<const ObfRoutingSectionLevelTreeNode>> baseNodes;
-        OsmAnd::ObfRoutingSectionReader::loadTreeNodes(
-            obfReader,
-            index,
-            RoutingDataLevel::Basemap,
-            &baseNodes);
-
-        QList<std::shared_ptr<const ObfRoutingSectionLevelTreeNode>> detailedNodes;
-        OsmAnd::ObfRoutingSectionReader::loadTreeNodes(
-            obfReader,
-            index,
-            RoutingDataLevel::Detailed,
-            &detailedNodes);
-
-        for (auto node : baseNodes)
-            addRouteSubregion(routing, node, true);
-        
-        for (auto node : detailedNodes)
-            addRouteSubregion(routing, node, false);
+
+    const auto addressSectionsCount = reader.read<quint32>();
+    for (auto sectionIdx = 0u; sectionIdx < addressSectionsCount && reader.isOk(); sectionIdx++)
+    {
+        Ref<ObfAddressSectionInfo> section(new ObfAddressSectionInfo(obfInfo));
+        section->name = reader.readString();
+        section->offset = reader.read<quint32>();
+        section->length = reader.read<quint32>();
+        const auto localizedNamesCount = reader.read<quint32>();
+        for (auto nameIdx = 0u; nameIdx < localizedNamesCount && reader.isOk(); nameIdx++)
+        {
+            const auto language = reader.readString();
+            section->localizedNames.insert(language, reader.readString());
+        }
+        section->nameIndexInnerOffset = reader.read<quint32>();
+        const auto attributeTagsCount = reader.read<quint32>();
+        for (auto tagIdx = 0u; tagIdx < attributeTagsCount && reader.isOk(); tagIdx++)
+            section->attributeTagsTable.push_back(reader.readString());
+        if (globalBBox31.isSet())
+            section->area31 = *globalBBox31;
+
+        const auto citiesBlocksCount = reader.read<quint32>();
+        for (auto blockIdx = 0u; blockIdx < citiesBlocksCount && reader.isOk(); blockIdx++)
+        {
+            const auto name = reader.readString();
+            const auto offset = reader.read<quint32>();
+            const auto length = reader.read<quint32>();
+            const auto type = reader.read<qint32>();
+            section->cities.push_back(std::make_shared<ObfAddressSectionInfo::CitiesBlock>(name, offset, length, type));
+        }
+
+        obfInfo->addressSections.push_back(section);
     }
-}
 
-void OsmAnd::CachedOsmandIndexes_P::addRouteSubregion(OBF::RoutingPart* routing, std::shared_ptr<const ObfRoutingSectionLevelTreeNode>& node, bool base)
-{
-    auto rpart = routing->add_subregions();
-    rpart->set_size(node->length);
-    rpart->set_offset(node->offset);
-    rpart->set_left(node->area31.left());
-    rpart->set_right(node->area31.right());
-    rpart->set_top(node->area31.top());
-    rpart->set_basemap(base);
-    rpart->set_bottom(node->area31.bottom());
-    if (node->dataOffset > node->offset)
-        rpart->set_shiftodata((unsigned int)(node->dataOffset - node->offset));
-    else
-        rpart->set_shiftodata(0);
+    if (!reader.isOk())
+        return nullptr;
+
+    obfInfo->calculateCenterPointForRegions();
+    return obfInfo;
 }
 
-std::shared_ptr<const OsmAnd::ObfInfo> OsmAnd::CachedOsmandIndexes_P::initFileIndex(const std::shared_ptr<const OBF::FileIndex>& found)
+std::shared_ptr<const OsmAnd::ObfInfo> OsmAnd::CachedOsmandIndexes_P::decodeLegacyFileIndex(const OBF::FileIndex& fileIndex)
 {
-    auto obfInfo = std::make_shared<ObfInfo>();
-    obfInfo->version = found->version();
-    obfInfo->creationTimestamp = found->datemodified();
-    
+    const std::shared_ptr<ObfInfo> obfInfo(new ObfInfo());
+    obfInfo->version = fileIndex.version();
+    obfInfo->creationTimestamp = fileIndex.datemodified();
+
+    // Legacy index has no tree nodes nor attribute mapping, these are read from file when needed
     Nullable<AreaI> globalBBox31;
-    
-    for (int i = 0; i < found->mapindex_size(); i++)
-    {
-        auto index = found->mapindex(i);
-        Ref<ObfMapSectionInfo> mi(new ObfMapSectionInfo(obfInfo));
-        mi->length = (unsigned int) index.size();
-        mi->offset = (unsigned int) index.offset();
-        mi->name = QString::fromStdString(index.name());
-        
-        for (int m = 0; m < index.levels_size(); m++) {
-            auto mr = index.levels(m);
-            Ref<ObfMapSectionLevel> root(new ObfMapSectionLevel());
-            root->length = (unsigned int) mr.size();
-            root->offset = (unsigned int) mr.offset();
-            root->area31 = AreaI(mr.top(), mr.left(), mr.bottom(), mr.right());
-            root->minZoom = (ZoomLevel) mr.minzoom();
-            root->maxZoom = (ZoomLevel) mr.maxzoom();
-            mi->levels.push_back(qMove(root));
-            
-            if (globalBBox31.isSet())
-                globalBBox31->enlargeToInclude(root->area31);
-            else
-                globalBBox31 = root->area31;
-        }
-        mi->isBasemap = mi->name.contains(QLatin1String("basemap"), Qt::CaseInsensitive);
-        mi->isBasemapWithCoastlines = mi->name == QLatin1String("basemap");
-        obfInfo->isBasemap = obfInfo->isBasemap || mi->isBasemap;
-        obfInfo->isBasemapWithCoastlines = obfInfo->isBasemapWithCoastlines || mi->isBasemapWithCoastlines;
-
-        obfInfo->mapSections.push_back(qMove(mi));
+
+    for (auto sectionIdx = 0; sectionIdx < fileIndex.mapindex_size(); sectionIdx++)
+    {
+        const auto& index = fileIndex.mapindex(sectionIdx);
+        Ref<ObfMapSectionInfo> section(new ObfMapSectionInfo(obfInfo));
+        section->length = index.size();
+        section->offset = index.offset();
+        section->name = QString::fromStdString(index.name());
+
+        for (auto levelIdx = 0; levelIdx < index.levels_size(); levelIdx++)
+        {
+            const auto& levelIndex = index.levels(levelIdx);
+            Ref<ObfMapSectionLevel> level(new ObfMapSectionLevel());
+            level->length = levelIndex.size();
+            level->offset = levelIndex.offset();
+            level->area31 = AreaI(levelIndex.top(), levelIndex.left(), levelIndex.bottom(), levelIndex.right());
+            level->minZoom = static_cast<ZoomLevel>(levelIndex.minzoom());
+            level->maxZoom = static_cast<ZoomLevel>(levelIndex.maxzoom());
+
+            enlargeGlobalBBox(globalBBox31, level->area31);
+            section->levels.push_back(level);
+        }
+
+        section->isBasemap = section->name.contains(QLatin1String("basemap"), Qt::CaseInsensitive);
+        section->isBasemapWithCoastlines = section->name == QLatin1String("basemap");
+        obfInfo->isBasemap = obfInfo->isBasemap || section->isBasemap;
+        obfInfo->isBasemapWithCoastlines = obfInfo->isBasemapWithCoastlines || section->isBasemapWithCoastlines;
+
+        obfInfo->mapSections.push_back(section);
     }
-    
-    for (int i = 0; i < found->poiindex_size(); i++)
+
+    for (auto sectionIdx = 0; sectionIdx < fileIndex.poiindex_size(); sectionIdx++)
     {
-        auto index = found->poiindex(i);
-        Ref<ObfPoiSectionInfo> mi(new ObfPoiSectionInfo(obfInfo));
-        mi->length = (unsigned int) index.size();
-        mi->offset = (unsigned int) index.offset();
-        mi->name = QString::fromStdString(index.name());
-        mi->area31 = AreaI(index.top(), index.left(), index.bottom(), index.right());
-        obfInfo->poiSections.push_back(qMove(mi));
+        const auto& index = fileIndex.poiindex(sectionIdx);
+        Ref<ObfPoiSectionInfo> section(new ObfPoiSectionInfo(obfInfo));
+        section->length = index.size();
+        section->offset = index.offset();
+        section->name = QString::fromStdString(index.name());
+        section->area31 = AreaI(index.top(), index.left(), index.bottom(), index.right());
 
-        if (globalBBox31.isSet())
-            globalBBox31->enlargeToInclude(mi->area31);
-        else
-            globalBBox31 = mi->area31;
+        enlargeGlobalBBox(globalBBox31, section->area31);
+        obfInfo->poiSections.push_back(section);
     }
-    
-    for (int i = 0; i < found->transportindex_size(); i++)
-    {
-        auto index = found->transportindex(i);
-        Ref<ObfTransportSectionInfo> mi(new ObfTransportSectionInfo(obfInfo));
-        mi->length = (unsigned int) index.size();
-        mi->offset = (unsigned int) index.offset();
-        mi->name = QString::fromStdString(index.name());
-        mi->_area31 = AreaI(index.top(), index.left(), index.bottom(), index.right());
-        mi->_stopsLength = index.stopstablelength();
-        mi->_stopsOffset = index.stopstableoffset();
+
+    for (auto sectionIdx = 0; sectionIdx < fileIndex.transportindex_size(); sectionIdx++)
+    {
+        const auto& index = fileIndex.transportindex(sectionIdx);
+        Ref<ObfTransportSectionInfo> section(new ObfTransportSectionInfo(obfInfo));
+        section->length = index.size();
+        section->offset = index.offset();
+        section->name = QString::fromStdString(index.name());
+        section->_area31 = AreaI(index.top(), index.left(), index.bottom(), index.right());
+        section->_stopsLength = index.stopstablelength();
+        section->_stopsOffset = index.stopstableoffset();
         ObfTransportSectionInfo::IndexStringTable stringTable;
         stringTable.fileOffset = index.stringtableoffset();
         stringTable.length = index.stringtablelength();
-        mi->_stringTable = stringTable;
-        obfInfo->transportSections.push_back(qMove(mi));
-        
-        if (globalBBox31.isSet())
-            globalBBox31->enlargeToInclude(mi->_area31);
-        else
-            globalBBox31 = mi->_area31;
+        section->_stringTable = stringTable;
+
+        enlargeGlobalBBox(globalBBox31, section->_area31);
+        obfInfo->transportSections.push_back(section);
     }
-    
-    for (int i = 0; i < found->routingindex_size(); i++)
-    {
-        auto index = found->routingindex(i);
-        Ref<ObfRoutingSectionInfo> mi(new ObfRoutingSectionInfo(obfInfo));
-        mi->length = (unsigned int) index.size();
-        mi->offset = (unsigned int) index.offset();
-        mi->name = QString::fromStdString(index.name());
-        
+
+    for (auto sectionIdx = 0; sectionIdx < fileIndex.routingindex_size(); sectionIdx++)
+    {
+        const auto& index = fileIndex.routingindex(sectionIdx);
+        Ref<ObfRoutingSectionInfo> section(new ObfRoutingSectionInfo(obfInfo));
+        section->length = index.size();
+        section->offset = index.offset();
+        section->name = QString::fromStdString(index.name());
+
         Nullable<AreaI> bbox31;
-        for (int k = 0; k < index.subregions_size(); k++)
+        for (auto subregionIdx = 0; subregionIdx < index.subregions_size(); subregionIdx++)
         {
-            auto subregion = index.subregions(k);
-            auto nodeBbox31 = AreaI(subregion.top(), subregion.left(), subregion.bottom(), subregion.right());
-            if (bbox31.isSet())
-                bbox31->enlargeToInclude(nodeBbox31);
-            else
-                bbox31 = nodeBbox31;
+            const auto& subregion = index.subregions(subregionIdx);
+            enlargeGlobalBBox(bbox31, AreaI(subregion.top(), subregion.left(), subregion.bottom(), subregion.right()));
         }
         if (bbox31.isSet())
         {
-            mi->area31 = *bbox31;
-
-            if (globalBBox31.isSet())
-                globalBBox31->enlargeToInclude(mi->area31);
-            else
-                globalBBox31 = mi->area31;
-        }
-        else
-        {
-            AreaI empty;
-            mi->area31 = empty;
-        }
-        
-        /*
-        for(RoutingSubregion mr : index.getSubregionsList()) {
-            RouteSubregion sub = new RouteSubregion(mi);
-            sub.length = (int) mr.getSize();
-            sub.filePointer = (int) mr.getOffset();
-            sub.left = mr.getLeft();
-            sub.right = mr.getRight();
-            sub.top = mr.getTop();
-            sub.bottom = mr.getBottom();
-            sub.shiftToData = mr.getShifToData();
-            if(mr.getBasemap()) {
-                mi.basesubregions.add(sub);
-            } else {
-                mi.subregions.add(sub);
-            }
+            section->area31 = *bbox31;
+            enlargeGlobalBBox(globalBBox31, section->area31);
         }
-        */
-        
-        obfInfo->routingSections.push_back(qMove(mi));
+
+        obfInfo->routingSections.push_back(section);
     }
-    
-    for (int i = 0; i < found->addressindex_size(); i++)
+
+    for (auto sectionIdx = 0; sectionIdx < fileIndex.addressindex_size(); sectionIdx++)
     {
-        auto index = found->addressindex(i);
-        Ref<ObfAddressSectionInfo> mi(new ObfAddressSectionInfo(obfInfo));
-        mi->length = (unsigned int) index.size();
-        mi->offset = (unsigned int) index.offset();
+        const auto& index = fileIndex.addressindex(sectionIdx);
+        Ref<ObfAddressSectionInfo> section(new ObfAddressSectionInfo(obfInfo));
+        section->length = index.size();
+        section->offset = index.offset();
         if (globalBBox31.isSet())
-            mi->area31 = *globalBBox31;
-
-        mi->name = QString::fromStdString(index.name());
-        mi->localizedNames.insert(QLatin1String("en"), QString::fromStdString(index.nameen()));
-        mi->nameIndexInnerOffset = index.indexnameoffset();
-        for (int m = 0; m < index.cities_size(); m++) {
-            auto mr = index.cities(m);
-            auto cblock = std::make_shared<ObfAddressSectionInfo::CitiesBlock>(QString::null, mr.offset(), mr.size(), mr.type());
-            mi->cities.push_back(cblock);
-        }
-        for (int m = 0; m < index.additionaltags_size(); m++) {
-            const auto& s = index.additionaltags(m);
-            mi->attributeTagsTable.push_back(QString::fromStdString(s));
+            section->area31 = *globalBBox31;
+        section->name = QString::fromStdString(index.name());
+        section->localizedNames.insert(QLatin1String("en"), QString::fromStdString(index.nameen()));
+        section->nameIndexInnerOffset = index.indexnameoffset();
+        for (auto blockIdx = 0; blockIdx < index.cities_size(); blockIdx++)
+        {
+            const auto& citiesBlock = index.cities(blockIdx);
+            section->cities.push_back(std::make_shared<ObfAddressSectionInfo::CitiesBlock>(
+                QString(), citiesBlock.offset(), citiesBlock.size(), citiesBlock.type()));
         }
-        obfInfo->addressSections.push_back(qMove(mi));
+        for (auto tagIdx = 0; tagIdx < index.additionaltags_size(); tagIdx++)
+            section->attributeTagsTable.push_back(QString::fromStdString(index.additionaltags(tagIdx)));
+
+        obfInfo->addressSections.push_back(section);
     }
-    
+
+    obfInfo->calculateCenterPointForRegions();
     return obfInfo;
 }
 
 const std::shared_ptr<OsmAnd::ObfFile> OsmAnd::CachedOsmandIndexes_P::getObfFile(const QString& filePath)
 {
-    //RandomAccessFile mf = new RandomAccessFile(f.getPath(), "r");
-    QFileInfo f(filePath);
-    std::shared_ptr<OBF::FileIndex> found = nullptr;
-    if (_storedIndex)
+    const QFileInfo fileInfo(filePath);
+    const auto fileName = fileInfo.fileName();
+    const auto fileSize = static_cast<quint64>(fileInfo.size());
+
+    // Only headers of sections are decoded here, heavier parts are decoded when section is queried
+    const auto citRecord = _records.constFind(fileName);
+    if (citRecord != _records.cend() && citRecord->fileSize == fileSize)
     {
-        for (int i = 0; i < _storedIndex->fileindex_size(); i++)
-        {
-            auto fi = _storedIndex->fileindex(i);
-            if (f.size() == fi.size() && f.fileName() == QString(fi.filename().c_str()))
-            {
-                // f.lastModified() == fi.getDateModified()
-                found = std::make_shared<OBF::FileIndex>(qMove(fi));
-                break;
-            }
-        }
+        if (const auto obfInfo = decodeRecord(citRecord->payload))
+            return std::make_shared<ObfFile>(filePath, obfInfo);
+
+        LogPrintf(LogSeverityLevel::Warning, "Cached index of OBF '%s' is corrupted", qPrintable(filePath));
     }
-    std::shared_ptr<ObfFile> obfFile = nullptr;
-    if (!found)
+
+    if (_legacyIndex)
     {
-        Stopwatch totalStopwatch(true);
-        obfFile = std::make_shared<ObfFile>(filePath);
-        if (!ObfReader(obfFile).obtainInfo())
-        {
-            LogPrintf(LogSeverityLevel::Warning, "Failed to open OBF '%s'", qPrintable(filePath));
-        }
-        else
+        const auto fileNameStd = fileName.toStdString();
+        for (auto fileIdx = 0; fileIdx < _legacyIndex->fileindex_size(); fileIdx++)
         {
-            addToCache(obfFile);
-            LogPrintf(LogSeverityLevel::Debug, "Initializing OBF '%s' %fs", qPrintable(filePath), totalStopwatch.elapsed());
+            const auto& fileIndex = _legacyIndex->fileindex(fileIdx);
+            if (static_cast<quint64>(fileIndex.size()) == fileSize && fileIndex.filename() == fileNameStd)
+                return std::make_shared<ObfFile>(filePath, decodeLegacyFileIndex(fileIndex));
         }
     }
+
+    Stopwatch totalStopwatch(true);
+    const auto obfFile = std::make_shared<ObfFile>(filePath);
+    const auto obfReader = std::make_shared<const ObfReader>(obfFile);
+    if (!obfReader->obtainInfo())
+    {
+        LogPrintf(LogSeverityLevel::Warning, "Failed to open OBF '%s'", qPrintable(filePath));
+    }
     else
     {
-        auto obfInfo = initFileIndex(found);
-        obfFile = std::make_shared<ObfFile>(filePath, obfInfo);
+        addToCache(obfFile, obfReader);
+        LogPrintf(LogSeverityLevel::Debug, "Initializing OBF '%s' %fs", qPrintable(filePath), totalStopwatch.elapsed());
     }
     return obfFile;
 }
 
+bool OsmAnd::CachedOsmandIndexes_P::readLegacyFile(const QByteArray& data, const int version)
+{
+    const std::shared_ptr<OBF::OsmAndStoredIndex> legacyIndex(new OBF::OsmAndStoredIndex());
+    if (!legacyIndex->ParseFromArray(data.constData(), data.size()) || legacyIndex->version() != version)
+        return false;
+
+    _legacyIndex = legacyIndex;
+    return true;
+}
+
 void OsmAnd::CachedOsmandIndexes_P::readFromFile(const QString& filePath, int version)
 {
-    int fileDescriptor = open(filePath.toStdString().c_str(), O_RDONLY);
-    if (fileDescriptor < 0)
+    Stopwatch totalStopwatch(true);
+
+    const std::shared_ptr<QFile> cacheFile(new QFile(filePath));
+    if (!cacheFile->open(QIODevice::ReadOnly))
     {
-        OsmAnd::LogPrintf(OsmAnd::LogSeverityLevel::Error, "Cache file could not be open to read: %s", qPrintable(filePath));
+        LogPrintf(LogSeverityLevel::Error, "Cache file could not be open to read: %s", qPrintable(filePath));
         return;
     }
-    gpb::io::FileInputStream input(fileDescriptor);
-    gpb::io::CodedInputStream cis(&input);
-    cis.SetTotalBytesLimit(std::numeric_limits<int>::max(), std::numeric_limits<int>::max());
-    
-    Stopwatch totalStopwatch(true);
-    
-    _storedIndex.reset(new OsmAnd::OBF::OsmAndStoredIndex());
-    if (_storedIndex->MergeFromCodedStream(&cis))
+    const auto fileSize = cacheFile->size();
+    if (fileSize == 0)
+        return;
+    const auto data = reinterpret_cast<const char*>(cacheFile->map(0, fileSize));
+    if (!data)
     {
-        if (_storedIndex->version() != version)
-        {
-            _storedIndex.reset();
-        }
-        else
-        {
-            _hasChanged = false;
-            OsmAnd::LogPrintf(OsmAnd::LogSeverityLevel::Info, "Osmand Cache file initialized %s in %fs", qPrintable(filePath), totalStopwatch.elapsed());
-        }
+        LogPrintf(LogSeverityLevel::Error, "Cache file could not be mapped: %s", qPrintable(filePath));
+        return;
     }
-    else
+
+    // Protobuf cache written by OsmAnd app or by older versions of core serves files that have
+    // no own record
+    if (fileSize < CacheFileHeaderSize || memcmp(data, CacheFileMagic, sizeof(CacheFileMagic)) != 0)
     {
-        _storedIndex.reset();
+        if (readLegacyFile(QByteArray::fromRawData(data, fileSize), version))
+            LogPrintf(LogSeverityLevel::Info, "Legacy cache file initialized %s in %fs", qPrintable(filePath), totalStopwatch.elapsed());
+        return;
     }
+
+    // Cache of other version is simply ignored and rewritten later
+    quint32 header[2];
+    memcpy(header, data + sizeof(CacheFileMagic), sizeof(header));
+    if (header[0] != static_cast<quint32>(version) || header[1] != RecordsFormatVersion)
+        return;
+
+    closeCacheFile();
+    _records.clear();
+    _pendingRecords.clear();
+    _cacheFile = cacheFile;
+
+    // Walk records reading only their keys, incomplete tail (if any) is dropped
+    qint64 position = CacheFileHeaderSize;
+    _supersededRecordsSize = 0;
+    while (position + static_cast<qint64>(sizeof(quint32)) <= fileSize)
+    {
+        quint32 payloadSize;
+        memcpy(&payloadSize, data + position, sizeof(quint32));
+        if (position + static_cast<qint64>(sizeof(quint32)) + payloadSize > fileSize)
+            break;
+
+        Record record;
+        record.payload = QByteArray::fromRawData(data + position + sizeof(quint32), payloadSize);
+        RecordReader keyReader(record.payload.constData(), record.payload.size());
+        const auto fileName = keyReader.readString();
+        record.fileSize = keyReader.read<quint64>();
+        if (!keyReader.isOk())
+            break;
+
+        const auto citExistingRecord = _records.constFind(fileName);
+        if (citExistingRecord != _records.cend())
+            _supersededRecordsSize += sizeof(quint32) + citExistingRecord->payload.size();
+        _records.insert(fileName, record);
+
+        position += sizeof(quint32) + payloadSize;
+    }
+    _validCacheSize = position;
+
+    LogPrintf(LogSeverityLevel::Info, "Osmand Cache file initialized %s in %fs", qPrintable(filePath), totalStopwatch.elapsed());
 }
 
 void OsmAnd::CachedOsmandIndexes_P::writeToFile(const QString& filePath)
 {
-    if (_storedIndex && _hasChanged)
+    if (_pendingRecords.isEmpty())
+        return;
+
+    if (QFileInfo(filePath).fileName() == AppCacheFileName)
     {
-        int fileDescriptor = open(filePath.toStdString().c_str(), O_RDWR);
-        if (fileDescriptor < 0) {
-            OsmAnd::LogPrintf(OsmAnd::LogSeverityLevel::Error, "Cache file could not be written: %s", qPrintable(filePath));
-            return;
+        LogPrintf(LogSeverityLevel::Warning, "Cache file of OsmAnd app is not overwritten: %s", qPrintable(filePath));
+        return;
+    }
+
+    // Append new records while superseded ones don't take more than a half of cache
+    const auto liveRecordsSize = _validCacheSize - CacheFileHeaderSize - _supersededRecordsSize;
+    if (_cacheFile && _cacheFile->fileName() == filePath && _supersededRecordsSize <= liveRecordsSize)
+    {
+        QFile file(filePath);
+        if (file.open(QIODevice::ReadWrite) &&
+            (file.size() == _validCacheSize || file.resize(_validCacheSize)) &&
+            file.seek(_validCacheSize))
+        {
+            QByteArray appendedRecords;
+            RecordWriter writer(appendedRecords);
+            for (const auto& payload : constOf(_pendingRecords))
+                writer.writeBlob(payload);
+            if (file.write(appendedRecords) == appendedRecords.size() && file.flush())
+            {
+                _validCacheSize += appendedRecords.size();
+                _pendingRecords.clear();
+                return;
+            }
         }
-        
-        gpb::io::FileOutputStream output(fileDescriptor);
-        if (!_storedIndex->SerializeToZeroCopyStream(&output))
-            OsmAnd::LogPrintf(OsmAnd::LogSeverityLevel::Error, "Cache file could not be serialized: %s", qPrintable(filePath));
+        LogPrintf(LogSeverityLevel::Warning, "Cache file could not be appended, rewriting: %s", qPrintable(filePath));
+    }
+
+    // Otherwise rewrite cache with live records only
+    closeCacheFile();
+    QSaveFile file(filePath);
+    if (!file.open(QIODevice::WriteOnly))
+    {
+        LogPrintf(LogSeverityLevel::Error, "Cache file could not be written: %s", qPrintable(filePath));
+        return;
+    }
+
+    QByteArray cacheData;
+    RecordWriter writer(cacheData);
+    cacheData.append(CacheFileMagic, sizeof(CacheFileMagic));
+    writer.write<quint32>(CachedOsmandIndexes::VERSION);
+    writer.write<quint32>(RecordsFormatVersion);
+    for (const auto& record : constOf(_records))
+        writer.writeBlob(record.payload);
+
+    if (file.write(cacheData) != cacheData.size() || !file.commit())
+    {
+        LogPrintf(LogSeverityLevel::Error, "Cache file could not be serialized: %s", qPrintable(filePath));
+        return;
     }
-}
 
+    _pendingRecords.clear();
+    _validCacheSize = cacheData.size();
+    _supersededRecordsSize = 0;
+}
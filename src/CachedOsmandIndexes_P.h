@@ -7,13 +7,14 @@
 #include "QtExtensions.h"
 #include "ignore_warnings_on_external_includes.h"
 #include <QString>
+#include <QByteArray>
+#include <QHash>
+#include <QList>
+#include <QFile>
 #include "restore_internal_warnings.h"
 
 #include "ignore_warnings_on_external_includes.h"
 #include "osmand_index.pb.h"
-#include <google/protobuf/io/coded_stream.h>
-#include <google/protobuf/io/zero_copy_stream.h>
-#include <google/protobuf/wire_format_lite.h>
 #include "restore_internal_warnings.h"
 
 #include "OsmAndCore.h"
@@ -21,11 +22,9 @@
 
 namespace OsmAnd
 {
-    namespace gpb = google::protobuf;
-
     class ObfFile;
     class ObfInfo;
-    class ObfRoutingSectionLevelTreeNode;
+    class ObfReader;
 
     class CachedOsmandIndexes;
     class CachedOsmandIndexes_P Q_DECL_FINAL
@@ -33,12 +32,37 @@ namespace OsmAnd
         Q_DISABLE_COPY_AND_MOVE(CachedOsmandIndexes_P);
 
     private:
-        std::shared_ptr<OBF::OsmAndStoredIndex> _storedIndex;
-        bool _hasChanged;
+        // Cache file is a fixed header followed by records appended one after another:
+        // [quint32 payload size][payload], where payload starts with file name and file size.
+        // Later record of the same file supersedes earlier one. Values are stored raw in native
+        // byte order, since cache never leaves the device
+        struct Record
+        {
+            quint64 fileSize;
+            QByteArray payload;
+        };
+
+        // Cache file is kept opened and mapped, so records of not-yet-requested files
+        // are never decoded or even copied
+        std::shared_ptr<QFile> _cacheFile;
+        qint64 _validCacheSize;
+        qint64 _supersededRecordsSize;
+        QHash<QString, Record> _records;
+        QList<QByteArray> _pendingRecords;
+
+        // Protobuf cache of OsmAnd app ("ind.cache", shared with it and never written) or of older
+        // core. Its entries are used for files that have no record of their own
+        std::shared_ptr<const OBF::OsmAndStoredIndex> _legacyIndex;
+        bool readLegacyFile(const QByteArray& data, const int version);
+        static std::shared_ptr<const ObfInfo> decodeLegacyFileIndex(const OBF::FileIndex& fileIndex);
 
-        void addToCache(const std::shared_ptr<const ObfFile>& file);
-        void addRouteSubregion(OBF::RoutingPart* routing, std::shared_ptr<const ObfRoutingSectionLevelTreeNode>& sub, bool base);
-        std::shared_ptr<const ObfInfo> initFileIndex(const std::shared_ptr<const OBF::FileIndex>& found);
+        void closeCacheFile();
+        void addToCache(const std::shared_ptr<const ObfFile>& file, const std::shared_ptr<const ObfReader>& obfReader);
+        static QByteArray encodeRecord(
+            const QString& fileName,
+            const std::shared_ptr<const ObfFile>& file,
+            const std::shared_ptr<const ObfReader>& obfReader);
+        static std::shared_ptr<const ObfInfo> decodeRecord(const QByteArray& payload);
 
     protected:
         CachedOsmandIndexes_P(CachedOsmandIndexes* const owner);
@@ -46,11 +70,11 @@ namespace OsmAnd
         virtual ~CachedOsmandIndexes_P();
 
         ImplementationInterface<CachedOsmandIndexes> owner;
-        
+
         const std::shared_ptr<ObfFile> getObfFile(const QString& filePath);
         void readFromFile(const QString& filePath, int version);
         void writeToFile(const QString& filePath);
-        
+
     friend class OsmAnd::CachedOsmandIndexes;
     };
 }
@@ -4,6 +4,7 @@
 #include "QtCommon.h"
 
 #include "RoadLocator.h"
+#include "RoadLocator_P.h"
 #include "Road.h"
 #include "IObfsCollection.h"
 #include "ObfDataInterface.h"
@@ -18,16 +19,12 @@ OsmAnd::CachingRoadLocator_P::~CachingRoadLocator_P()
 {
 }
 
-std::shared_ptr<const OsmAnd::Road> OsmAnd::CachingRoadLocator_P::findNearestRoad(
+QList< std::shared_ptr<const OsmAnd::ObfRoutingSectionReader::DataBlock> > OsmAnd::CachingRoadLocator_P::referenceDataBlocks(
     const PointI position31,
     const double radiusInMeters,
     const RoutingDataLevel dataLevel,
-    const ObfRoutingSectionReader::VisitorFunction filter,
-    int* const outNearestRoadPointIndex,
-    double* const outDistanceToNearestRoadPoint) const
+    QList< std::shared_ptr<const Road> >* const outRoads /*= nullptr*/) const
 {
-    QList< std::shared_ptr<const Road> > roadsInBBox;
-
     const auto bbox31 = (AreaI)Utilities::boundingBox31FromAreaInMeters(radiusInMeters, position31);
     const auto obfDataInterface = owner->obfsCollection->obtainDataInterface(
         &bbox31,
@@ -38,7 +35,7 @@ std::shared_ptr<const OsmAnd::Road> OsmAnd::CachingRoadLocator_P::findNearestRoa
     obfDataInterface->loadRoads(
         dataLevel,
         &bbox31,
-        &roadsInBBox,
+        outRoads,
         nullptr,
         nullptr,
         &_cache,
@@ -49,17 +46,30 @@ std::shared_ptr<const OsmAnd::Road> OsmAnd::CachingRoadLocator_P::findNearestRoa
     {
         QMutexLocker scopedLocker(&_referencedDataBlocksMapMutex);
 
-        for (auto& referencedBlock : referencedCacheEntries)
-            _referencedDataBlocksMap[referencedBlock.get()].push_back(qMove(referencedBlock));
+        for (const auto& referencedBlock : constOf(referencedCacheEntries))
+            _referencedDataBlocksMap[referencedBlock.get()].push_back(referencedBlock);
     }
-    
-    return RoadLocator::findNearestRoad(
-        roadsInBBox,
+
+    return referencedCacheEntries;
+}
+
+std::shared_ptr<const OsmAnd::Road> OsmAnd::CachingRoadLocator_P::findNearestRoad(
+    const PointI position31,
+    const double radiusInMeters,
+    const RoutingDataLevel dataLevel,
+    const ObfRoutingSectionReader::VisitorFunction filter,
+    int* const outNearestRoadPointIndex,
+    double* const outDistanceToNearestRoadPoint) const
+{
+    const auto dataBlocks = referenceDataBlocks(position31, radiusInMeters, dataLevel);
+
+    return RoadLocator_P::findNearestRoadInDataBlocks(
+        dataBlocks,
         position31,
         radiusInMeters,
         filter,
         outNearestRoadPointIndex,
-                outDistanceToNearestRoadPoint);
+        outDistanceToNearestRoadPoint);
 }
 
 QVector<std::pair<std::shared_ptr<const OsmAnd::Road>, std::shared_ptr<const OsmAnd::RoadInfo>>> OsmAnd::CachingRoadLocator_P::findNearestRoads(
@@ -69,7 +79,15 @@ QVector<std::pair<std::shared_ptr<const OsmAnd::Road>, std::shared_ptr<const Osm
         const OsmAnd::ObfRoutingSectionReader::VisitorFunction filter,
         QList<std::shared_ptr<const OsmAnd::ObfRoutingSectionReader::DataBlock>> * const outReferencedCacheEntries) const
 {
+    const auto dataBlocks = referenceDataBlocks(position31, radiusInMeters, dataLevel);
+    if (outReferencedCacheEntries)
+        outReferencedCacheEntries->append(dataBlocks);
 
+    return RoadLocator_P::sortedRoadsInDataBlocksByDistance(
+        dataBlocks,
+        position31,
+        radiusInMeters,
+        filter);
 }
 
 QList< std::shared_ptr<const OsmAnd::Road> > OsmAnd::CachingRoadLocator_P::findRoadsInArea(
@@ -79,31 +97,7 @@ QList< std::shared_ptr<const OsmAnd::Road> > OsmAnd::CachingRoadLocator_P::findR
     const ObfRoutingSectionReader::VisitorFunction filter) const
 {
     QList< std::shared_ptr<const Road> > roadsInBBox;
-
-    const auto bbox31 = (AreaI)Utilities::boundingBox31FromAreaInMeters(radiusInMeters, position31);
-    const auto obfDataInterface = owner->obfsCollection->obtainDataInterface(
-        &bbox31,
-        MinZoomLevel,
-        MaxZoomLevel,
-        ObfDataTypesMask().set(ObfDataType::Routing));
-    QList< std::shared_ptr<const ObfRoutingSectionReader::DataBlock> > referencedCacheEntries;
-    obfDataInterface->loadRoads(
-        dataLevel,
-        &bbox31,
-        &roadsInBBox,
-        nullptr,
-        nullptr,
-        &_cache,
-        &referencedCacheEntries,
-        nullptr,
-        nullptr);
-
-    {
-        QMutexLocker scopedLocker(&_referencedDataBlocksMapMutex);
-
-        for (auto& referencedBlock : referencedCacheEntries)
-            _referencedDataBlocksMap[referencedBlock.get()].push_back(qMove(referencedBlock));
-    }
+    referenceDataBlocks(position31, radiusInMeters, dataLevel, &roadsInBBox);
 
     return RoadLocator::findRoadsInArea(
         roadsInBBox,
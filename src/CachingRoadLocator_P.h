@@ -24,6 +24,12 @@ namespace OsmAnd
     {
         Q_DISABLE_COPY_AND_MOVE(CachingRoadLocator_P);
     private:
+        // Every block gets cached, so referenced blocks hold all roads around position
+        QList< std::shared_ptr<const ObfRoutingSectionReader::DataBlock> > referenceDataBlocks(
+            const PointI position31,
+            const double radiusInMeters,
+            const RoutingDataLevel dataLevel,
+            QList< std::shared_ptr<const Road> >* const outRoads = nullptr) const;
     protected:
         CachingRoadLocator_P(CachingRoadLocator* const owner);
 
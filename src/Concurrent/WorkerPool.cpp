@@ -68,6 +68,11 @@ void OsmAnd::Concurrent::WorkerPool::sortQueue(const SortPredicate predicate)
     _p->sortQueue(predicate);
 }
 
+void OsmAnd::Concurrent::WorkerPool::executeAndWait(const QVector<Job>& jobs, const Job& callingThreadJob /*= nullptr*/)
+{
+    _p->executeAndWait(jobs, callingThreadJob);
+}
+
 void OsmAnd::Concurrent::WorkerPool::reset()
 {
     _p->reset();
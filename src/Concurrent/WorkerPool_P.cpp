@@ -3,7 +3,9 @@
 
 #include "QtExtensions.h"
 #include <QElapsedTimer>
+#include <QSemaphore>
 
+#include "QRunnableFunctor.h"
 #include "Logging.h"
 
 OsmAnd::Concurrent::WorkerPool_P::WorkerPool_P(WorkerPool* const owner_, const Order order_, const int maxThreadCount_)
@@ -78,7 +80,7 @@ void OsmAnd::Concurrent::WorkerPool_P::enqueue(const QVector<QRunnable*>& runnab
     if (predicate)
         sortQueueNoLock(predicate);
 
-    tryLaunchNextRunnable();
+    tryLaunchNextRunnables();
 }
 
 bool OsmAnd::Concurrent::WorkerPool_P::dequeue(QRunnable* const runnable, const SortPredicate predicate)
@@ -106,6 +108,69 @@ void OsmAnd::Concurrent::WorkerPool_P::sortQueue(const SortPredicate predicate)
     sortQueueNoLock(predicate);
 }
 
+void OsmAnd::Concurrent::WorkerPool_P::executeAndWait(const QVector<Job>& jobs, const Job& callingThreadJob)
+{
+    if (jobs.size() <= (callingThreadJob ? 0 : 1))
+    {
+        if (callingThreadJob)
+            callingThreadJob();
+        for (const auto& job : constOf(jobs))
+            job();
+        return;
+    }
+
+    // Each job is claimed exactly once, by worker or by calling thread, and runnables only
+    // claim next job. So runnables dropped from queue by reset() or dequeueAll() leave their jobs
+    // to calling thread, and runnables that are left in queue once all jobs are claimed do nothing
+    struct Execution
+    {
+        Execution(const QVector<Job>& jobs_)
+            : jobs(jobs_)
+            , nextJobIndex(0)
+        {
+        }
+
+        const QVector<Job> jobs;
+        QAtomicInt nextJobIndex;
+        QSemaphore completedJobs;
+
+        bool executeNextJob()
+        {
+            const auto jobIndex = nextJobIndex.fetchAndAddOrdered(1);
+            if (jobIndex >= jobs.size())
+                return false;
+
+            jobs[jobIndex]();
+            completedJobs.release();
+            return true;
+        }
+    };
+    const std::shared_ptr<Execution> execution(new Execution(jobs));
+
+    // Unless calling thread has a job of its own, it executes at least one of given jobs
+    const auto runnablesCount = callingThreadJob ? jobs.size() : jobs.size() - 1;
+    QVector<QRunnable*> runnables;
+    runnables.reserve(runnablesCount);
+    for (auto runnableIndex = 0; runnableIndex < runnablesCount; runnableIndex++)
+    {
+        runnables.push_back(new QRunnableFunctor(
+            [execution]
+            (const QRunnableFunctor* const runnable)
+            {
+                execution->executeNextJob();
+            }));
+    }
+    enqueue(runnables, nullptr);
+
+    if (callingThreadJob)
+        callingThreadJob();
+
+    // Help workers: execute in this thread everything they have not picked up yet
+    while (execution->executeNextJob());
+
+    execution->completedJobs.acquire(jobs.size());
+}
+
 void OsmAnd::Concurrent::WorkerPool_P::reset()
 {
     QMutexLocker scopedLocker(&_mutex);
@@ -177,7 +242,35 @@ bool OsmAnd::Concurrent::WorkerPool_P::tryLaunchNextRunnable()
 
 void OsmAnd::Concurrent::WorkerPool_P::tryLaunchNextRunnables()
 {
-    while (!_queue.isEmpty() && tryLaunchNextRunnable());
+    // Every thread takes one runnable at a time, so launch as many distinct threads as there are
+    // queued runnables (within limit). Calling tryLaunchNextRunnable() in a loop would wake same
+    // head of free threads over and over, since woken thread leaves free threads only once it
+    // acquires the mutex
+    auto threadsToLaunch = _queue.size();
+    const auto maxThreadCount = this->maxThreadCount();
+    if (maxThreadCount > 0)
+        threadsToLaunch = qMin(threadsToLaunch, maxThreadCount - static_cast<int>(activeThreadCountNoLock()));
+
+    for (const auto thread : constOf(_freeThreads))
+    {
+        if (threadsToLaunch <= 0)
+            return;
+
+        thread->wakeup.wakeOne();
+        threadsToLaunch--;
+    }
+
+    for (const auto thread : constOf(_inactiveThreads))
+    {
+        if (threadsToLaunch <= 0)
+            return;
+
+        thread->wakeup.wakeOne();
+        threadsToLaunch--;
+    }
+
+    while (threadsToLaunch-- > 0)
+        createNewThread();
 }
 
 QRunnable* OsmAnd::Concurrent::WorkerPool_P::takeNextRunnable()
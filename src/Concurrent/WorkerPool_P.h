@@ -30,6 +30,7 @@ namespace OsmAnd
         public:
             typedef WorkerPool::Order Order;
             typedef WorkerPool::SortPredicate SortPredicate;
+            typedef WorkerPool::Job Job;
 
         private:
             class WorkerThread Q_DECL_FINAL : public QThread
@@ -94,6 +95,8 @@ namespace OsmAnd
 
             void sortQueue(const SortPredicate predicate);
 
+            void executeAndWait(const QVector<Job>& jobs, const Job& callingThreadJob);
+
             void reset();
 
         friend class OsmAnd::Concurrent::WorkerPool;
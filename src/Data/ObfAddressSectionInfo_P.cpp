@@ -0,0 +1,11 @@
+#include "ObfAddressSectionInfo_P.h"
+#include "ObfAddressSectionInfo.h"
+
+OsmAnd::ObfAddressSectionInfo_P::ObfAddressSectionInfo_P(ObfAddressSectionInfo* owner_)
+    : owner(owner_)
+{
+}
+
+OsmAnd::ObfAddressSectionInfo_P::~ObfAddressSectionInfo_P()
+{
+}
@@ -13,11 +13,13 @@
 #include "ObfReader.h"
 #include "ObfReader_P.h"
 #include "ObfAddressSectionInfo.h"
+#include "ObfAddressSectionInfo_P.h"
 #include "StreetGroup.h"
 #include "Street.h"
 #include "Building.h"
 #include "StreetIntersection.h"
 #include "ObfReaderUtilities.h"
+#include "ObfNameIndex.h"
 #include "IQueryController.h"
 #include "Utilities.h"
 #include "DataCommonTypes.h"
@@ -896,6 +898,7 @@ void OsmAnd::ObfAddressSectionReader_P::readAddressesByName(
 
                 scanNameIndex(
                     reader,
+                    section,
                     query,
                     indexReferences,
                     bbox31,
@@ -1053,8 +1056,67 @@ void OsmAnd::ObfAddressSectionReader_P::readAddressesByName(
     }
 }
 
+void OsmAnd::ObfAddressSectionReader_P::ensureNameIndexLoaded(
+    const ObfReader_P& reader,
+    const std::shared_ptr<const ObfAddressSectionInfo>& section)
+{
+    if (section->_p->_nameIndexLoaded.loadAcquire() != 0)
+        return;
+
+    QMutexLocker scopedLocker(&section->_p->_nameIndexLoadMutex);
+    if (section->_p->_nameIndex)
+        return;
+
+    const auto cis = reader.getCodedInputStream().get();
+
+    cis->Seek(section->offset);
+    const auto oldLimit = cis->PushLimit(section->length);
+    cis->Skip(section->nameIndexInnerOffset);
+
+    // Only the table of name index is read, atoms are left as is
+    std::shared_ptr<const ObfNameIndex> nameIndex;
+    const auto tag = cis->ReadTag();
+    if (gpb::internal::WireFormatLite::GetTagFieldNumber(tag) == OBF::OsmAndAddressIndex::kNameIndexFieldNumber)
+    {
+        const auto length = ObfReaderUtilities::readBigEndianInt(cis);
+        const auto oldNameIndexLimit = cis->PushLimit(length);
+
+        while (!nameIndex)
+        {
+            const auto nameIndexTag = cis->ReadTag();
+            const auto fieldNumber = gpb::internal::WireFormatLite::GetTagFieldNumber(nameIndexTag);
+            if (fieldNumber == 0)
+                break;
+
+            if (fieldNumber != OBF::OsmAndAddressNameIndexData::kTableFieldNumber)
+            {
+                ObfReaderUtilities::skipUnknownField(cis, nameIndexTag);
+                continue;
+            }
+
+            const auto tableLength = ObfReaderUtilities::readBigEndianInt(cis);
+            const auto oldTableLimit = cis->PushLimit(tableLength);
+
+            nameIndex = ObfNameIndex::read(cis);
+
+            ObfReaderUtilities::ensureAllDataWasRead(cis);
+            cis->PopLimit(oldTableLimit);
+        }
+
+        cis->PopLimit(oldNameIndexLimit);
+    }
+    if (!nameIndex)
+        nameIndex.reset(new ObfNameIndex(QVector<ObfNameIndex::Table>()));
+    section->_p->_nameIndex = nameIndex;
+
+    cis->PopLimit(oldLimit);
+
+    section->_p->_nameIndexLoaded.storeRelease(1);
+}
+
 void OsmAnd::ObfAddressSectionReader_P::scanNameIndex(
     const ObfReader_P& reader,
+    const std::shared_ptr<const ObfAddressSectionInfo>& section,
     const QString& query,
     QVector<AddressReference>& outAddressReferences,
     const AreaI* const bbox31,
@@ -1082,12 +1144,10 @@ void OsmAnd::ObfAddressSectionReader_P::scanNameIndex(
             {
                 const auto length = ObfReaderUtilities::readBigEndianInt(cis);
                 baseOffset = cis->CurrentPosition();
-                const auto oldLimit = cis->PushLimit(length);
+                cis->Skip(length);
 
-                ObfReaderUtilities::scanIndexedStringTable(cis, query, intermediateOffsets, strictMatch);
-                ObfReaderUtilities::ensureAllDataWasRead(cis);
-
-                cis->PopLimit(oldLimit);
+                // Table itself is skipped, query is matched against name index of section kept in memory
+                section->_p->_nameIndex->match(query, intermediateOffsets, strictMatch);
 
                 if (intermediateOffsets.isEmpty())
                 {
@@ -1371,6 +1431,8 @@ void OsmAnd::ObfAddressSectionReader_P::scanAddressesByName(
     const ObfAddressSectionReader::VisitorFunction visitor,
     const std::shared_ptr<const IQueryController>& queryController)
 {
+    ensureNameIndexLoaded(reader, section);
+
     const auto cis = reader.getCodedInputStream().get();
     cis->Seek(section->offset);
     auto oldLimit = cis->PushLimit(section->length);
@@ -138,8 +138,12 @@ namespace OsmAnd
             const bool strictMatch,
             const ObfAddressSectionReader::VisitorFunction visitor,
             const std::shared_ptr<const IQueryController>& queryController);
+        static void ensureNameIndexLoaded(
+            const ObfReader_P& reader,
+            const std::shared_ptr<const ObfAddressSectionInfo>& section);
         static void scanNameIndex(
             const ObfReader_P& reader,
+            const std::shared_ptr<const ObfAddressSectionInfo>& section,
             const QString& query,
             QVector<AddressReference>& outAddressReferences,
             const AreaI* const bbox31,
@@ -2,6 +2,7 @@
 #include "ObfFile_P.h"
 
 #include <QFile>
+#include <QDateTime>
 #include <QStringList>
 #include <OsmAndCore/Data/ObfInfo.h>
 #include <OsmAndCore/Utilities.h>
@@ -10,6 +11,7 @@ OsmAnd::ObfFile::ObfFile(const QString& filePath_, const std::shared_ptr<const O
     : _p(new ObfFile_P(this, obfInfo_))
     , filePath(filePath_)
     , fileSize(QFile(filePath).size())
+    , lastModifiedTime(QFileInfo(filePath).lastModified().toMSecsSinceEpoch())
     , obfInfo(_p->_obfInfo)
 {
 }
@@ -18,6 +20,7 @@ OsmAnd::ObfFile::ObfFile(const QString& filePath_)
     : _p(new ObfFile_P(this))
     , filePath(filePath_)
     , fileSize(QFile(filePath).size())
+    , lastModifiedTime(QFileInfo(filePath).lastModified().toMSecsSinceEpoch())
     , obfInfo(_p->_obfInfo)
 {
 }
@@ -26,6 +29,7 @@ OsmAnd::ObfFile::ObfFile(const QString& filePath_, const uint64_t fileSize_)
     : _p(new ObfFile_P(this))
     , filePath(filePath_)
     , fileSize(fileSize_)
+    , lastModifiedTime(QFileInfo(filePath).lastModified().toMSecsSinceEpoch())
     , obfInfo(_p->_obfInfo)
 {
 }
@@ -1,4 +1,7 @@
 #include "ObfFile_P.h"
+#include "ObfFile.h"
+
+#include "Logging.h"
 
 OsmAnd::ObfFile_P::ObfFile_P(ObfFile* owner_, const std::shared_ptr<const ObfInfo>& obfInfo_)
     : owner(owner_)
@@ -14,3 +17,60 @@ OsmAnd::ObfFile_P::ObfFile_P(ObfFile* owner_)
 OsmAnd::ObfFile_P::~ObfFile_P()
 {
 }
+
+std::shared_ptr<const OsmAnd::ObfFile_P::MemoryMapping> OsmAnd::ObfFile_P::obtainMemoryMapping() const
+{
+    QMutexLocker scopedLocker(&_memoryMappingMutex);
+
+    // Mapping is shared by all readers of this file while at least one of them is alive
+    if (const auto memoryMapping = _memoryMapping.lock())
+        return memoryMapping;
+
+    const std::shared_ptr<const MemoryMapping> memoryMapping(new MemoryMapping(owner->filePath));
+    if (!memoryMapping->isValid())
+        return nullptr;
+    _memoryMapping = memoryMapping;
+
+    return memoryMapping;
+}
+
+OsmAnd::ObfFile_P::MemoryMapping::MemoryMapping(const QString& filePath)
+    : file(filePath)
+    , data(nullptr)
+    , size(0)
+{
+    if (!file.open(QIODevice::ReadOnly))
+    {
+        LogPrintf(LogSeverityLevel::Warning,
+            "Failed to open '%s' for memory mapping: %s",
+            qPrintable(filePath),
+            qPrintable(file.errorString()));
+        return;
+    }
+
+    size = file.size();
+    data = file.map(0, size);
+    if (!data)
+    {
+        LogPrintf(LogSeverityLevel::Warning,
+            "Failed to map %" PRIi64 " bytes of '%s' into memory: %s",
+            size,
+            qPrintable(filePath),
+            qPrintable(file.errorString()));
+        size = 0;
+        file.close();
+    }
+}
+
+OsmAnd::ObfFile_P::MemoryMapping::~MemoryMapping()
+{
+    if (data)
+        file.unmap(const_cast<uchar*>(data));
+    if (file.isOpen())
+        file.close();
+}
+
+bool OsmAnd::ObfFile_P::MemoryMapping::isValid() const
+{
+    return data != nullptr;
+}
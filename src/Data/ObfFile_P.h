@@ -6,6 +6,7 @@
 #include "QtExtensions.h"
 #include <QMutex>
 #include <QWaitCondition>
+#include <QFile>
 
 #include "OsmAndCore.h"
 #include "PrivateImplementation.h"
@@ -19,6 +20,22 @@ namespace OsmAnd
     class ObfFile_P Q_DECL_FINAL
     {
         Q_DISABLE_COPY_AND_MOVE(ObfFile_P)
+    public:
+        struct MemoryMapping Q_DECL_FINAL
+        {
+            MemoryMapping(const QString& filePath);
+            ~MemoryMapping();
+
+            QFile file;
+            const uint8_t* data;
+            qint64 size;
+
+            bool isValid() const;
+
+        private:
+            Q_DISABLE_COPY_AND_MOVE(MemoryMapping);
+        };
+
     private:
     protected:
         ObfFile_P(ObfFile* owner);
@@ -28,9 +45,14 @@ namespace OsmAnd
 
         mutable QMutex _obfInfoMutex;
         mutable std::shared_ptr<const ObfInfo> _obfInfo;
+
+        mutable QMutex _memoryMappingMutex;
+        mutable std::weak_ptr<const MemoryMapping> _memoryMapping;
     public:
         virtual ~ObfFile_P();
 
+        std::shared_ptr<const MemoryMapping> obtainMemoryMapping() const;
+
     friend class OsmAnd::ObfFile;
     friend class OsmAnd::ObfReader_P;
     };
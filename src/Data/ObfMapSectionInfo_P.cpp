@@ -22,12 +22,31 @@ std::shared_ptr<const OsmAnd::ObfMapSectionAttributeMapping> OsmAnd::ObfMapSecti
         }
         return _attributeMapping;
     }
-    return nullptr;
+
+    QMutexLocker scopedLocker(&_attributeMappingLoadMutex);
+    loadCachedAttributeMapping();
+    return _attributeMapping;
+}
+
+bool OsmAnd::ObfMapSectionInfo_P::loadCachedAttributeMapping() const
+{
+    if (_attributeMapping)
+        return true;
+    if (!_cachedAttributeMappingLoader)
+        return false;
+
+    const auto attributeMapping = _cachedAttributeMappingLoader();
+    _cachedAttributeMappingLoader = nullptr;
+    if (!attributeMapping)
+        return false;
+
+    _attributeMapping = attributeMapping;
+    _attributeMappingLoaded.storeRelease(1);
+    return true;
 }
 
 OsmAnd::ObfMapSectionLevel_P::ObfMapSectionLevel_P(ObfMapSectionLevel* owner_)
-    : _rootNodes()
-    , _rootNodesLoaded(0)
+    : _rootNodesLoaded(0)
     , owner(owner_)
 {
 }
@@ -36,8 +55,9 @@ OsmAnd::ObfMapSectionLevel_P::~ObfMapSectionLevel_P()
 {
 }
 
-OsmAnd::ObfMapSectionLevelTreeNode::ObfMapSectionLevelTreeNode(const std::shared_ptr<const ObfMapSectionLevel>& level_)
-    : level(level_)
+OsmAnd::ObfMapSectionLevelTreeNode::ObfMapSectionLevelTreeNode()
+    : offset(0)
+    , length(0)
     , dataOffset(0)
     , surfaceType(MapSurfaceType::Undefined)
     , hasChildrenDataBoxes(false)
@@ -48,3 +68,15 @@ OsmAnd::ObfMapSectionLevelTreeNode::ObfMapSectionLevelTreeNode(const std::shared
 OsmAnd::ObfMapSectionLevelTreeNode::~ObfMapSectionLevelTreeNode()
 {
 }
+
+OsmAnd::ObfMapSectionLevelTreeNodes::ObfMapSectionLevelTreeNodes(const QVector<ObfMapSectionLevelTreeNode>& nodes_)
+    : nodes(nodes_)
+    , children(new QAtomicPointer<const ObfMapSectionLevelTreeNodes>[nodes_.size()])
+{
+}
+
+OsmAnd::ObfMapSectionLevelTreeNodes::~ObfMapSectionLevelTreeNodes()
+{
+    for (auto nodeIdx = 0, nodesCount = nodes.size(); nodeIdx < nodesCount; nodeIdx++)
+        delete children[nodeIdx].loadAcquire();
+}
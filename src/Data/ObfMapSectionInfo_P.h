@@ -3,6 +3,7 @@
 
 #include "stdlib_common.h"
 #include <atomic>
+#include <functional>
 
 #include "QtExtensions.h"
 #include "ignore_warnings_on_external_includes.h"
@@ -12,12 +13,15 @@
 #include <QMap>
 #include <QString>
 #include <QAtomicInt>
+#include <QAtomicPointer>
+#include <QVector>
 #include "restore_internal_warnings.h"
 
 #include "OsmAndCore.h"
 #include "CommonTypes.h"
 #include "PrivateImplementation.h"
 #include "MapCommonTypes.h"
+#include "ObfStringsPool.h"
 
 namespace OsmAnd
 {
@@ -25,17 +29,12 @@ namespace OsmAnd
     class ObfMapSectionAttributeMapping;
     class ObfMapSectionReader_P;
 
-    class ObfMapSectionLevelTreeNode
+    class ObfMapSectionLevelTreeNode Q_DECL_FINAL
     {
-        Q_DISABLE_COPY_AND_MOVE(ObfMapSectionLevelTreeNode);
-    private:
-    protected:
-        ObfMapSectionLevelTreeNode(const std::shared_ptr<const ObfMapSectionLevel>& level);
     public:
+        ObfMapSectionLevelTreeNode();
         ~ObfMapSectionLevelTreeNode();
 
-        const std::shared_ptr<const ObfMapSectionLevel> level;
-
         uint32_t offset;
         uint32_t length;
         uint32_t dataOffset;
@@ -44,8 +43,23 @@ namespace OsmAnd
 
         bool hasChildrenDataBoxes;
         uint32_t firstDataBoxInnerOffset;
+    };
 
-    friend class OsmAnd::ObfMapSectionReader_P;
+    // Sibling nodes of map level tree, stored by value in a flat array. Children of each node are
+    // decoded on first use and published once, so decoded subtrees are walked without locking
+    class ObfMapSectionLevelTreeNodes Q_DECL_FINAL
+    {
+        Q_DISABLE_COPY_AND_MOVE(ObfMapSectionLevelTreeNodes);
+    private:
+    protected:
+    public:
+        ObfMapSectionLevelTreeNodes(const QVector<ObfMapSectionLevelTreeNode>& nodes);
+        ~ObfMapSectionLevelTreeNodes();
+
+        const QVector<ObfMapSectionLevelTreeNode> nodes;
+
+        // Children of nodes[i], null until decoded
+        const std::unique_ptr< QAtomicPointer<const ObfMapSectionLevelTreeNodes>[] > children;
     };
 
     class ObfMapSectionLevel_P Q_DECL_FINAL
@@ -54,9 +68,11 @@ namespace OsmAnd
     protected:
         ObfMapSectionLevel_P(ObfMapSectionLevel* owner);
 
-        mutable std::shared_ptr< const QList< std::shared_ptr<const ObfMapSectionLevelTreeNode> > > _rootNodes;
+        // Root nodes are read from file or restored from cached indexes, deeper nodes are decoded
+        // subtree by subtree when queries reach them
+        mutable std::shared_ptr<const ObfMapSectionLevelTreeNodes> _rootNodes;
         mutable QAtomicInt _rootNodesLoaded;
-        mutable QMutex _rootNodesLoadMutex;
+        mutable QMutex _treeLoadMutex;
     public:
         virtual ~ObfMapSectionLevel_P();
 
@@ -76,6 +92,14 @@ namespace OsmAnd
         mutable std::shared_ptr<ObfMapSectionAttributeMapping> _attributeMapping;
         mutable QAtomicInt _attributeMappingLoaded;
         mutable QMutex _attributeMappingLoadMutex;
+
+        // Set when section was restored from cached indexes: mapping is decoded on first use,
+        // since most sections of collected files are never queried
+        mutable std::function< std::shared_ptr<ObfMapSectionAttributeMapping> () > _cachedAttributeMappingLoader;
+        bool loadCachedAttributeMapping() const;
+
+        // Captions of map objects, shared by all blocks of the section
+        mutable ObfStringsPool _captionsPool;
     public:
         virtual ~ObfMapSectionInfo_P();
 
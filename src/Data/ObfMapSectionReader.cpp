@@ -23,7 +23,9 @@ void OsmAnd::ObfMapSectionReader::loadMapObjects(
     DataBlocksCache* cache /*= nullptr*/,
     QList< std::shared_ptr<const DataBlock> >* outReferencedCacheEntries /*= nullptr*/,
     const std::shared_ptr<const IQueryController>& queryController /*= nullptr*/,
-    ObfMapSectionReader_Metrics::Metric_loadMapObjects* const metric /*= nullptr*/)
+    ObfMapSectionReader_Metrics::Metric_loadMapObjects* const metric /*= nullptr*/,
+    const FilterByAttributesFunction filterByAttributes /*= nullptr*/,
+    const bool simplifyGeometry /*= false*/)
 {
     ObfMapSectionReader_P::loadMapObjects(
         *reader->_p,
@@ -37,7 +39,40 @@ void OsmAnd::ObfMapSectionReader::loadMapObjects(
         cache,
         outReferencedCacheEntries,
         queryController,
-        metric);
+        metric,
+        filterByAttributes,
+        simplifyGeometry);
+}
+
+void OsmAnd::ObfMapSectionReader::loadTiledMapObjects(
+    const std::shared_ptr<const ObfReader>& reader,
+    const std::shared_ptr<const ObfMapSectionInfo>& section,
+    const ZoomLevel zoom,
+    const QVector<AreaI>& tilesBBoxes31,
+    QVector< QList< std::shared_ptr<const OsmAnd::BinaryMapObject> > >* tilesResultsOut /*= nullptr*/,
+    QVector<MapSurfaceType>* outTilesSurfaceTypes /*= nullptr*/,
+    const FilterByIdFunction filterById /*= nullptr*/,
+    DataBlocksCache* cache /*= nullptr*/,
+    QList< std::shared_ptr<const DataBlock> >* outReferencedCacheEntries /*= nullptr*/,
+    const std::shared_ptr<const IQueryController>& queryController /*= nullptr*/,
+    ObfMapSectionReader_Metrics::Metric_loadMapObjects* const metric /*= nullptr*/,
+    const FilterByAttributesFunction filterByAttributes /*= nullptr*/,
+    const bool simplifyGeometry /*= false*/)
+{
+    ObfMapSectionReader_P::loadTiledMapObjects(
+        *reader->_p,
+        section,
+        zoom,
+        tilesBBoxes31,
+        tilesResultsOut,
+        outTilesSurfaceTypes,
+        filterById,
+        cache,
+        outReferencedCacheEntries,
+        queryController,
+        metric,
+        filterByAttributes,
+        simplifyGeometry);
 }
 
 OsmAnd::ObfMapSectionReader::DataBlock::DataBlock(
@@ -239,7 +239,7 @@ void OsmAnd::ObfMapSectionReader_P::readMapLevelTreeNodes(
     const ObfReader_P& reader,
     const std::shared_ptr<const ObfMapSectionInfo>& section,
     const std::shared_ptr<const ObfMapSectionLevel>& level,
-    QList< std::shared_ptr<const ObfMapSectionLevelTreeNode> >& trees)
+    QVector<ObfMapSectionLevelTreeNode>& nodes)
 {
     const auto cis = reader.getCodedInputStream().get();
 
@@ -260,15 +260,15 @@ void OsmAnd::ObfMapSectionReader_P::readMapLevelTreeNodes(
                 const auto offset = cis->CurrentPosition();
                 const auto oldLimit = cis->PushLimit(length);
 
-                const std::shared_ptr<ObfMapSectionLevelTreeNode> levelTree(new ObfMapSectionLevelTreeNode(level));
-                levelTree->offset = offset;
-                levelTree->length = length;
-                readTreeNode(reader, section, level->area31, levelTree);
+                ObfMapSectionLevelTreeNode rootNode;
+                rootNode.offset = offset;
+                rootNode.length = length;
+                readTreeNode(reader, section, level->area31, rootNode);
 
                 ObfReaderUtilities::ensureAllDataWasRead(cis);
                 cis->PopLimit(oldLimit);
 
-                trees.push_back(qMove(levelTree));
+                nodes.push_back(rootNode);
 
                 atLeastOneMapRootLevelRead = true;
                 break;
@@ -286,7 +286,7 @@ void OsmAnd::ObfMapSectionReader_P::readTreeNode(
     const ObfReader_P& reader,
     const std::shared_ptr<const ObfMapSectionInfo>& section,
     const AreaI& parentArea,
-    const std::shared_ptr<ObfMapSectionLevelTreeNode>& treeNode)
+    ObfMapSectionLevelTreeNode& treeNode)
 {
     const auto cis = reader.getCodedInputStream().get();
 
@@ -313,7 +313,7 @@ void OsmAnd::ObfMapSectionReader_P::readTreeNode(
             case OBF::OsmAndMapIndex_MapDataBox::kLeftFieldNumber:
             {
                 const auto d = ObfReaderUtilities::readSInt32(cis);
-                treeNode->area31.left() = d + parentArea.left();
+                treeNode.area31.left() = d + parentArea.left();
 
                 fieldsMask |= (1ull << tfn);
                 break;
@@ -321,7 +321,7 @@ void OsmAnd::ObfMapSectionReader_P::readTreeNode(
             case OBF::OsmAndMapIndex_MapDataBox::kRightFieldNumber:
             {
                 const auto d = ObfReaderUtilities::readSInt32(cis);
-                treeNode->area31.right() = d + parentArea.right();
+                treeNode.area31.right() = d + parentArea.right();
 
                 fieldsMask |= (1ull << tfn);
                 break;
@@ -329,7 +329,7 @@ void OsmAnd::ObfMapSectionReader_P::readTreeNode(
             case OBF::OsmAndMapIndex_MapDataBox::kTopFieldNumber:
             {
                 const auto d = ObfReaderUtilities::readSInt32(cis);
-                treeNode->area31.top() = d + parentArea.top();
+                treeNode.area31.top() = d + parentArea.top();
 
                 fieldsMask |= (1ull << tfn);
                 break;
@@ -337,7 +337,7 @@ void OsmAnd::ObfMapSectionReader_P::readTreeNode(
             case OBF::OsmAndMapIndex_MapDataBox::kBottomFieldNumber:
             {
                 const auto d = ObfReaderUtilities::readSInt32(cis);
-                treeNode->area31.bottom() = d + parentArea.bottom();
+                treeNode.area31.bottom() = d + parentArea.bottom();
 
                 fieldsMask |= (1ull << tfn);
                 break;
@@ -345,7 +345,7 @@ void OsmAnd::ObfMapSectionReader_P::readTreeNode(
             case OBF::OsmAndMapIndex_MapDataBox::kShiftToMapDataFieldNumber:
             {
                 const auto offset = ObfReaderUtilities::readBigEndianInt(cis);
-                treeNode->dataOffset = offset + treeNode->offset;
+                treeNode.dataOffset = offset + treeNode.offset;
 
                 fieldsMask |= (1ull << tfn);
                 break;
@@ -355,10 +355,10 @@ void OsmAnd::ObfMapSectionReader_P::readTreeNode(
                 gpb::uint32 value;
                 cis->ReadVarint32(&value);
 
-                treeNode->surfaceType = (value != 0) ? MapSurfaceType::FullWater : MapSurfaceType::FullLand;
+                treeNode.surfaceType = (value != 0) ? MapSurfaceType::FullWater : MapSurfaceType::FullLand;
                 assert(
-                    (treeNode->surfaceType != MapSurfaceType::FullWater) ||
-                    (treeNode->surfaceType == MapSurfaceType::FullWater && section->isBasemapWithCoastlines));
+                    (treeNode.surfaceType != MapSurfaceType::FullWater) ||
+                    (treeNode.surfaceType == MapSurfaceType::FullWater && section->isBasemapWithCoastlines));
 
                 fieldsMask |= (1ull << tfn);
                 break;
@@ -367,8 +367,8 @@ void OsmAnd::ObfMapSectionReader_P::readTreeNode(
             {
                 if (!kBoxesFieldNumberProcessed)
                 {
-                    treeNode->hasChildrenDataBoxes = true;
-                    treeNode->firstDataBoxInnerOffset = tagPos - treeNode->offset;
+                    treeNode.hasChildrenDataBoxes = true;
+                    treeNode.firstDataBoxInnerOffset = tagPos - treeNode.offset;
                     kBoxesFieldNumberProcessed = true;
 
                     if (fieldsMask == safeToSkipFieldsMask)
@@ -391,16 +391,11 @@ void OsmAnd::ObfMapSectionReader_P::readTreeNode(
 void OsmAnd::ObfMapSectionReader_P::readTreeNodeChildren(
     const ObfReader_P& reader,
     const std::shared_ptr<const ObfMapSectionInfo>& section,
-    const std::shared_ptr<const ObfMapSectionLevelTreeNode>& treeNode,
-    MapSurfaceType& outChildrenSurfaceType,
-    QList< std::shared_ptr<const ObfMapSectionLevelTreeNode> >* nodesWithData,
-    const AreaI* bbox31,
-    const std::shared_ptr<const IQueryController>& queryController,
-    ObfMapSectionReader_Metrics::Metric_loadMapObjects* const metric)
+    const ObfMapSectionLevelTreeNode& treeNode,
+    QVector<ObfMapSectionLevelTreeNode>& outChildNodes)
 {
     const auto cis = reader.getCodedInputStream().get();
 
-    outChildrenSurfaceType = MapSurfaceType::Undefined;
     for (;;)
     {
         const auto tag = cis->ReadTag();
@@ -417,63 +412,93 @@ void OsmAnd::ObfMapSectionReader_P::readTreeNodeChildren(
                 const auto offset = cis->CurrentPosition();
                 const auto oldLimit = cis->PushLimit(length);
 
-                const std::shared_ptr<ObfMapSectionLevelTreeNode> childNode(new ObfMapSectionLevelTreeNode(treeNode->level));
-                childNode->surfaceType = treeNode->surfaceType;
-                childNode->offset = offset;
-                childNode->length = length;
-                readTreeNode(reader, section, treeNode->area31, childNode);
+                ObfMapSectionLevelTreeNode childNode;
+                childNode.surfaceType = treeNode.surfaceType;
+                childNode.offset = offset;
+                childNode.length = length;
+                readTreeNode(reader, section, treeNode.area31, childNode);
 
                 ObfReaderUtilities::ensureAllDataWasRead(cis);
                 cis->PopLimit(oldLimit);
 
-                // Update metric
-                if (metric)
-                    metric->visitedNodes++;
+                outChildNodes.push_back(childNode);
 
-                if (bbox31)
-                {
-                    const auto shouldSkip =
-                        !bbox31->contains(childNode->area31) &&
-                        !childNode->area31.contains(*bbox31) &&
-                        !bbox31->intersects(childNode->area31);
-                    if (shouldSkip)
-                        break;
-                }
+                break;
+            }
+            default:
+                ObfReaderUtilities::skipUnknownField(cis, tag);
+                break;
+        }
+    }
+}
 
-                // Update metric
-                if (metric)
-                    metric->acceptedNodes++;
+void OsmAnd::ObfMapSectionReader_P::queryTreeNodes(
+    const ObfReader_P& reader,
+    const std::shared_ptr<const ObfMapSectionInfo>& section,
+    const std::shared_ptr<const ObfMapSectionLevel>& mapLevel,
+    const ObfMapSectionLevelTreeNodes& nodes,
+    MapSurfaceType& outSurfaceType,
+    QList<const ObfMapSectionLevelTreeNode*>& nodesWithData,
+    const AreaI* bbox31,
+    ObfMapSectionReader_Metrics::Metric_loadMapObjects* const metric)
+{
+    outSurfaceType = MapSurfaceType::Undefined;
+    for (auto nodeIdx = 0, nodesCount = nodes.nodes.size(); nodeIdx < nodesCount; nodeIdx++)
+    {
+        const auto& node = nodes.nodes[nodeIdx];
 
-                if (nodesWithData && childNode->dataOffset > 0)
-                    nodesWithData->push_back(childNode);
+        // Update metric
+        if (metric)
+            metric->visitedNodes++;
 
-                auto subchildrenSurfaceType = MapSurfaceType::Undefined;
-                if (childNode->hasChildrenDataBoxes)
-                {
-                    cis->Seek(childNode->offset);
-                    const auto oldLimit = cis->PushLimit(childNode->length);
+        if (bbox31)
+        {
+            const Stopwatch bboxNodeCheckStopwatch(metric != nullptr);
 
-                    cis->Skip(childNode->firstDataBoxInnerOffset);
-                    readTreeNodeChildren(reader, section, childNode, subchildrenSurfaceType, nodesWithData, bbox31, queryController, metric);
+            const auto shouldSkip =
+                !bbox31->contains(node.area31) &&
+                !node.area31.contains(*bbox31) &&
+                !bbox31->intersects(node.area31);
 
-                    ObfReaderUtilities::ensureAllDataWasRead(cis);
-                    cis->PopLimit(oldLimit);
-                }
+            // Update metric
+            if (metric)
+                metric->elapsedTimeForNodesBbox += bboxNodeCheckStopwatch.elapsed();
 
-                const auto surfaceTypeToMerge = (subchildrenSurfaceType != MapSurfaceType::Undefined) ? subchildrenSurfaceType : childNode->surfaceType;
-                if (surfaceTypeToMerge != MapSurfaceType::Undefined)
-                {
-                    if (outChildrenSurfaceType == MapSurfaceType::Undefined)
-                        outChildrenSurfaceType = surfaceTypeToMerge;
-                    else if (outChildrenSurfaceType != surfaceTypeToMerge)
-                        outChildrenSurfaceType = MapSurfaceType::Mixed;
-                }
+            // Skip entire subtree
+            if (shouldSkip)
+                continue;
+        }
 
-                break;
-            }
-            default:
-                ObfReaderUtilities::skipUnknownField(cis, tag);
-                break;
+        // Update metric
+        if (metric)
+            metric->acceptedNodes++;
+
+        if (node.dataOffset > 0)
+            nodesWithData.push_back(&node);
+
+        auto childrenSurfaceType = MapSurfaceType::Undefined;
+        if (const auto childNodes = obtainChildNodes(reader, section, mapLevel, nodes, nodeIdx))
+        {
+            queryTreeNodes(
+                reader,
+                section,
+                mapLevel,
+                *childNodes,
+                childrenSurfaceType,
+                nodesWithData,
+                bbox31,
+                metric);
+        }
+
+        const auto surfaceTypeToMerge = (childrenSurfaceType != MapSurfaceType::Undefined)
+            ? childrenSurfaceType
+            : node.surfaceType;
+        if (surfaceTypeToMerge != MapSurfaceType::Undefined)
+        {
+            if (outSurfaceType == MapSurfaceType::Undefined)
+                outSurfaceType = surfaceTypeToMerge;
+            else if (outSurfaceType != surfaceTypeToMerge)
+                outSurfaceType = MapSurfaceType::Mixed;
         }
     }
 }
@@ -481,10 +506,13 @@ void OsmAnd::ObfMapSectionReader_P::readTreeNodeChildren(
 void OsmAnd::ObfMapSectionReader_P::readMapObjectsBlock(
     const ObfReader_P& reader,
     const std::shared_ptr<const ObfMapSectionInfo>& section,
-    const std::shared_ptr<const ObfMapSectionLevelTreeNode>& tree,
+    const std::shared_ptr<const ObfMapSectionLevel>& level,
+    const ObfMapSectionLevelTreeNode& treeNode,
     QList< std::shared_ptr<const OsmAnd::BinaryMapObject> >* resultOut,
     const AreaI* bbox31,
     const FilterReadingByIdFunction filterById,
+    const FilterReadingByAttributesFunction filterByAttributes,
+    const bool simplifyGeometry,
     const VisitorFunction visitor,
     const std::shared_ptr<const IQueryController>& queryController,
     ObfMapSectionReader_Metrics::Metric_loadMapObjects* const metric)
@@ -492,7 +520,7 @@ void OsmAnd::ObfMapSectionReader_P::readMapObjectsBlock(
     const auto cis = reader.getCodedInputStream().get();
 
     QList< std::shared_ptr<BinaryMapObject> > intermediateResult;
-    QStringList mapObjectsCaptionsTable;
+    QVector<std::string> mapObjectsCaptionsTable;
     gpb::uint64 baseId = 0;
     for (;;)
     {
@@ -521,7 +549,7 @@ void OsmAnd::ObfMapSectionReader_P::readMapObjectsBlock(
                             caption = QString::fromLatin1("#%1 NOT FOUND").arg(stringId);
                             continue;
                         }
-                        caption = mapObjectsCaptionsTable[stringId];
+                        caption = section->_p->_captionsPool.obtain(mapObjectsCaptionsTable[stringId]);
                     }
 
                     //////////////////////////////////////////////////////////////////////////
@@ -560,7 +588,17 @@ void OsmAnd::ObfMapSectionReader_P::readMapObjectsBlock(
                 std::shared_ptr<OsmAnd::BinaryMapObject> mapObject;
                 auto oldLimit = cis->PushLimit(length);
                 
-                readMapObject(reader, section, baseId, tree, mapObject, bbox31, metric);
+                readMapObject(
+                    reader,
+                    section,
+                    baseId,
+                    level,
+                    treeNode,
+                    mapObject,
+                    bbox31,
+                    filterByAttributes,
+                    simplifyGeometry,
+                    metric);
 
                 ObfReaderUtilities::ensureAllDataWasRead(cis);
                 cis->PopLimit(oldLimit);
@@ -639,14 +677,65 @@ void OsmAnd::ObfMapSectionReader_P::readMapObject(
     const ObfReader_P& reader,
     const std::shared_ptr<const ObfMapSectionInfo>& section,
     uint64_t baseId,
-    const std::shared_ptr<const ObfMapSectionLevelTreeNode>& treeNode,
+    const std::shared_ptr<const ObfMapSectionLevel>& level,
+    const ObfMapSectionLevelTreeNode& treeNode,
     std::shared_ptr<OsmAnd::BinaryMapObject>& mapObject,
     const AreaI* bbox31,
+    const FilterReadingByAttributesFunction filterByAttributes,
+    const bool simplifyGeometry,
     ObfMapSectionReader_Metrics::Metric_loadMapObjects* const metric)
 {
     const auto cis = reader.getCodedInputStream().get();
     const auto baseOffset = cis->CurrentPosition();
 
+    // Basemap is read for zooms beyond its levels, so only detailed geometry is simplified
+    double simplificationTolerance31 = 0.0;
+    const int levelMaxZoom = level->maxZoom;
+    if (simplifyGeometry && !section->isBasemap && levelMaxZoom < static_cast<int>(SimplificationToleranceShift))
+        simplificationTolerance31 = static_cast<double>(1u << (SimplificationToleranceShift - levelMaxZoom));
+
+    // Types are stored after points, so to check types first points are skipped without decoding.
+    // If object is accepted, it's read from its beginning as usual
+    if (filterByAttributes)
+    {
+        QVector<uint32_t> attributeIds;
+        bool typesRead = false;
+        while (!typesRead && cis->BytesUntilLimit() > 0)
+        {
+            const auto tag = cis->ReadTag();
+            if (gpb::internal::WireFormatLite::GetTagFieldNumber(tag) != OBF::MapData::kTypesFieldNumber)
+            {
+                ObfReaderUtilities::skipUnknownField(cis, tag);
+                continue;
+            }
+
+            gpb::uint32 length;
+            cis->ReadVarint32(&length);
+            auto oldLimit = cis->PushLimit(length);
+            attributeIds.reserve(cis->BytesUntilLimit());
+            while (cis->BytesUntilLimit() > 0)
+            {
+                gpb::uint32 attributeId;
+                cis->ReadVarint32(&attributeId);
+                attributeIds.push_back(attributeId);
+            }
+            cis->PopLimit(oldLimit);
+
+            typesRead = true;
+        }
+
+        if (typesRead && !filterByAttributes(section, attributeIds))
+        {
+            if (metric)
+                metric->skippedByAttributesMapObjects++;
+
+            cis->Skip(cis->BytesUntilLimit());
+            return;
+        }
+
+        cis->Seek(baseOffset);
+    }
+
     for (;;)
     {
         const auto tag = cis->ReadTag();
@@ -674,81 +763,49 @@ void OsmAnd::ObfMapSectionReader_P::readMapObject(
             {
                 const Stopwatch mapObjectPointsStopwatch(metric != nullptr);
 
-                gpb::uint32 length;
-                cis->ReadVarint32(&length);
-                const auto oldLimit = cis->PushLimit(length);
-
-                PointI p;
-                p.x = treeNode->area31.left() & MaskToRead;
-                p.y = treeNode->area31.top() & MaskToRead;
+                PointI origin;
+                origin.x = treeNode.area31.left() & MaskToRead;
+                origin.y = treeNode.area31.top() & MaskToRead;
 
                 AreaI objectBBox;
                 objectBBox.top() = objectBBox.left() = std::numeric_limits<int32_t>::max();
                 objectBBox.bottom() = objectBBox.right() = 0;
-                auto lastUnprocessedVertexForBBox = 0;
 
-                // In protobuf, a sint32 can be encoded using [1..4] bytes,
-                // so try to guess size of array, and preallocate it.
-                // (BytesUntilLimit/2) is ~= number of vertices, and is always larger than needed.
-                // So it's impossible that a buffer overflow will ever happen. But assert on that.
-                const auto probableVerticesCount = (cis->BytesUntilLimit() / 2);
-                QVector< PointI > points31(probableVerticesCount);
-
-                auto pPoint = points31.data();
-                auto verticesCount = 0;
-                bool shouldNotSkip = (bbox31 == nullptr);
-                while (cis->BytesUntilLimit() > 0)
+                // Entire block is decoded at once, along with bbox of the object
+                QVector< PointI > points31;
+                if (!ObfReaderUtilities::readDeltaEncodedPoints(cis, origin, ShiftCoordinates, points31, &objectBBox))
                 {
-                    PointI d;
-                    d.x = (ObfReaderUtilities::readSInt32(cis) << ShiftCoordinates);
-                    d.y = (ObfReaderUtilities::readSInt32(cis) << ShiftCoordinates);
-
-                    p += d;
-
-                    // Save point into storage
-                    assert(points31.size() > verticesCount);
-                    *(pPoint++) = p;
-                    verticesCount++;
-
-                    // Check if map object should be maintained
-                    if (!shouldNotSkip && bbox31)
-                    {
-                        const Stopwatch mapObjectBboxStopwatch(metric != nullptr);
-
-                        shouldNotSkip = bbox31->contains(p);
-                        objectBBox.enlargeToInclude(p);
-
-                        if (metric)
-                            metric->elapsedTimeForMapObjectsBbox += mapObjectBboxStopwatch.elapsed();
-
-                        lastUnprocessedVertexForBBox = verticesCount;
-                    }
+                    LogPrintf(LogSeverityLevel::Warning,
+                        "Malformed coordinates of BinaryMapObject at %d in section '%s'",
+                        baseOffset,
+                        qPrintable(section->name));
+                    mapObject.reset();
+                    cis->Skip(cis->BytesUntilLimit());
+                    return;
                 }
 
-                cis->PopLimit(oldLimit);
-
-                // Since reserved space may be larger than actual amount of data,
-                // shrink the vertices array
-                points31.resize(verticesCount);
-
                 // If map object has no vertices, retain it in a special way to report later, when
                 // it's identifier will be known
+                bool shouldNotSkip = (bbox31 == nullptr);
                 if (points31.isEmpty())
                 {
                     // Fake that this object is inside bbox
                     shouldNotSkip = true;
-                    objectBBox = treeNode->area31;
+                    objectBBox = treeNode.area31;
                 }
 
-                // Even if no vertex lays inside bbox, an edge
-                // may intersect the bbox
+                // Object is maintained if any of vertices lays inside bbox, or an edge may intersect
+                // the bbox. Both cases are covered by intersection of bboxes
                 if (!shouldNotSkip && bbox31)
                 {
-                    assert(lastUnprocessedVertexForBBox == points31.size());
+                    const Stopwatch mapObjectBboxStopwatch(metric != nullptr);
 
                     shouldNotSkip =
                         objectBBox.contains(*bbox31) ||
                         bbox31->intersects(objectBBox);
+
+                    if (metric)
+                        metric->elapsedTimeForMapObjectsBbox += mapObjectBboxStopwatch.elapsed();
                 }
 
                 // If map object didn't fit, skip it's entire content
@@ -771,31 +828,25 @@ void OsmAnd::ObfMapSectionReader_P::readMapObject(
                     metric->notSkippedMapObjectsPoints += points31.size();
                 }
 
-                // In case bbox is not fully calculated, complete this task
-                auto pPointForBBox = points31.data() + lastUnprocessedVertexForBBox;
-                while (lastUnprocessedVertexForBBox < points31.size())
+                if (simplificationTolerance31 > 0.0)
                 {
-                    const Stopwatch mapObjectBboxStopwatch(metric != nullptr);
-
-                    objectBBox.enlargeToInclude(*pPointForBBox);
+                    const auto pointsCount = points31.size();
+                    simplifyPoints(points31, simplificationTolerance31);
 
                     if (metric)
-                        metric->elapsedTimeForMapObjectsBbox += mapObjectBboxStopwatch.elapsed();
-
-                    lastUnprocessedVertexForBBox++;
-                    pPointForBBox++;
+                        metric->simplifiedOutMapObjectsPoints += pointsCount - points31.size();
                 }
 
                 // Finally, create the object
                 if (!mapObject)
-                    mapObject.reset(new OsmAnd::BinaryMapObject(section, treeNode->level));
+                    mapObject.reset(new OsmAnd::BinaryMapObject(section, level));
                 mapObject->isArea = (tgn == OBF::MapData::kAreaCoordinatesFieldNumber);
                 mapObject->points31 = qMove(points31);
                 mapObject->bbox31 = objectBBox;
-                assert(treeNode->area31.top() - mapObject->bbox31.top() <= 32);
-                assert(treeNode->area31.left() - mapObject->bbox31.left() <= 32);
-                assert(mapObject->bbox31.bottom() - treeNode->area31.bottom() <= 1);
-                assert(mapObject->bbox31.right() - treeNode->area31.right() <= 1);
+                assert(treeNode.area31.top() - mapObject->bbox31.top() <= 32);
+                assert(treeNode.area31.left() - mapObject->bbox31.left() <= 32);
+                assert(mapObject->bbox31.bottom() - treeNode.area31.bottom() <= 1);
+                assert(mapObject->bbox31.right() - treeNode.area31.right() <= 1);
                 assert(mapObject->bbox31.right() >= mapObject->bbox31.left());
                 assert(mapObject->bbox31.bottom() >= mapObject->bbox31.top());
 
@@ -804,41 +855,32 @@ void OsmAnd::ObfMapSectionReader_P::readMapObject(
             case OBF::MapData::kPolygonInnerCoordinatesFieldNumber:
             {
                 if (!mapObject)
-                    mapObject.reset(new OsmAnd::BinaryMapObject(section, treeNode->level));
-
-                gpb::uint32 length;
-                cis->ReadVarint32(&length);
-                auto oldLimit = cis->PushLimit(length);
-
-                PointI p;
-                p.x = treeNode->area31.left() & MaskToRead;
-                p.y = treeNode->area31.top() & MaskToRead;
+                    mapObject.reset(new OsmAnd::BinaryMapObject(section, level));
 
-                // Preallocate memory
-                const auto probableVerticesCount = (cis->BytesUntilLimit() / 2);
-                mapObject->innerPolygonsPoints31.push_back(qMove(QVector< PointI >(probableVerticesCount)));
-                auto& polygon = mapObject->innerPolygonsPoints31.last();
+                PointI origin;
+                origin.x = treeNode.area31.left() & MaskToRead;
+                origin.y = treeNode.area31.top() & MaskToRead;
 
-                auto pPoint = polygon.data();
-                auto verticesCount = 0;
-                while (cis->BytesUntilLimit() > 0)
+                QVector< PointI > polygon;
+                if (!ObfReaderUtilities::readDeltaEncodedPoints(cis, origin, ShiftCoordinates, polygon))
                 {
-                    PointI d;
-                    d.x = (ObfReaderUtilities::readSInt32(cis) << ShiftCoordinates);
-                    d.y = (ObfReaderUtilities::readSInt32(cis) << ShiftCoordinates);
-
-                    p += d;
-
-                    // Save point into storage
-                    assert(polygon.size() > verticesCount);
-                    *(pPoint++) = p;
-                    verticesCount++;
+                    LogPrintf(LogSeverityLevel::Warning,
+                        "Malformed inner polygon of BinaryMapObject at %d in section '%s'",
+                        baseOffset,
+                        qPrintable(section->name));
+                    mapObject.reset();
+                    cis->Skip(cis->BytesUntilLimit());
+                    return;
                 }
+                if (simplificationTolerance31 > 0.0)
+                {
+                    const auto pointsCount = polygon.size();
+                    simplifyPoints(polygon, simplificationTolerance31);
 
-                // Shrink memory
-                polygon.resize(verticesCount);
-
-                cis->PopLimit(oldLimit);
+                    if (metric)
+                        metric->simplifiedOutMapObjectsPoints += pointsCount - polygon.size();
+                }
+                mapObject->innerPolygonsPoints31.push_back(qMove(polygon));
 
                 break;
             }
@@ -846,7 +888,7 @@ void OsmAnd::ObfMapSectionReader_P::readMapObject(
             case OBF::MapData::kTypesFieldNumber:
             {
                 if (!mapObject)
-                    mapObject.reset(new OsmAnd::BinaryMapObject(section, treeNode->level));
+                    mapObject.reset(new OsmAnd::BinaryMapObject(section, level));
 
                 auto& attributeIds = (tgn == OBF::MapData::kAdditionalTypesFieldNumber)
                     ? mapObject->additionalAttributeIds
@@ -921,6 +963,220 @@ void OsmAnd::ObfMapSectionReader_P::readMapObject(
     }
 }
 
+void OsmAnd::ObfMapSectionReader_P::simplifyPoints(QVector<PointI>& points31, const double tolerance31)
+{
+    const auto pointsCount = points31.size();
+    if (pointsCount <= 3)
+        return;
+
+    const auto pPoints = points31.constData();
+    const auto squaredTolerance = tolerance31 * tolerance31;
+    QVector<bool> keepPoint(pointsCount, false);
+    keepPoint[0] = keepPoint[pointsCount - 1] = true;
+
+    // Ranges [first, last] of points that are yet to be checked against their chord
+    QVector< std::pair<int, int> > ranges;
+    if (pPoints[0] == pPoints[pointsCount - 1])
+    {
+        // Chord of a closed ring is a point, so ring is split at vertex farthest from its start
+        auto farthestIndex = 1;
+        double maxSquaredDistance = 0.0;
+        for (auto idx = 1; idx < pointsCount - 1; idx++)
+        {
+            const double dx = pPoints[idx].x - pPoints[0].x;
+            const double dy = pPoints[idx].y - pPoints[0].y;
+            const auto squaredDistance = dx * dx + dy * dy;
+            if (squaredDistance > maxSquaredDistance)
+            {
+                maxSquaredDistance = squaredDistance;
+                farthestIndex = idx;
+            }
+        }
+        keepPoint[farthestIndex] = true;
+        ranges.push_back(std::make_pair(0, farthestIndex));
+        ranges.push_back(std::make_pair(farthestIndex, pointsCount - 1));
+    }
+    else
+        ranges.push_back(std::make_pair(0, pointsCount - 1));
+
+    while (!ranges.isEmpty())
+    {
+        const auto range = ranges.takeLast();
+        if (range.second - range.first < 2)
+            continue;
+
+        const auto& start = pPoints[range.first];
+        const auto& end = pPoints[range.second];
+        const double chordX = end.x - start.x;
+        const double chordY = end.y - start.y;
+        const auto squaredChordLength = chordX * chordX + chordY * chordY;
+
+        auto farthestIndex = -1;
+        double maxSquaredDistance = squaredTolerance;
+        for (auto idx = range.first + 1; idx < range.second; idx++)
+        {
+            const double dx = pPoints[idx].x - start.x;
+            const double dy = pPoints[idx].y - start.y;
+
+            // Squared distance to the chord segment
+            double squaredDistance;
+            const auto projection = dx * chordX + dy * chordY;
+            if (squaredChordLength <= 0.0 || projection <= 0.0)
+                squaredDistance = dx * dx + dy * dy;
+            else if (projection >= squaredChordLength)
+            {
+                const double ex = pPoints[idx].x - end.x;
+                const double ey = pPoints[idx].y - end.y;
+                squaredDistance = ex * ex + ey * ey;
+            }
+            else
+            {
+                const auto cross = dx * chordY - dy * chordX;
+                squaredDistance = cross * cross / squaredChordLength;
+            }
+
+            if (squaredDistance > maxSquaredDistance)
+            {
+                maxSquaredDistance = squaredDistance;
+                farthestIndex = idx;
+            }
+        }
+        if (farthestIndex < 0)
+            continue;
+
+        keepPoint[farthestIndex] = true;
+        ranges.push_back(std::make_pair(range.first, farthestIndex));
+        ranges.push_back(std::make_pair(farthestIndex, range.second));
+    }
+
+    auto keptPointsCount = 0;
+    const auto pPointsToWrite = points31.data();
+    for (auto idx = 0; idx < pointsCount; idx++)
+    {
+        if (keepPoint[idx])
+            pPointsToWrite[keptPointsCount++] = pPointsToWrite[idx];
+    }
+    points31.resize(keptPointsCount);
+    points31.squeeze();
+}
+
+void OsmAnd::ObfMapSectionReader_P::ensureAttributeMappingLoaded(
+    const ObfReader_P& reader,
+    const std::shared_ptr<const ObfMapSectionInfo>& section)
+{
+    if (section->_p->_attributeMappingLoaded.loadAcquire() != 0)
+        return;
+
+    QMutexLocker scopedLocker(&section->_p->_attributeMappingLoadMutex);
+    if (section->_p->loadCachedAttributeMapping())
+        return;
+
+    const auto cis = reader.getCodedInputStream().get();
+
+    // Read encoding/decoding rules
+    cis->Seek(section->offset);
+    auto oldLimit = cis->PushLimit(section->length);
+
+    const std::shared_ptr<ObfMapSectionAttributeMapping> attributeMapping(new ObfMapSectionAttributeMapping());
+    readAttributeMapping(reader, section, attributeMapping);
+    section->_p->_attributeMapping = attributeMapping;
+
+    cis->PopLimit(oldLimit);
+
+    section->_p->_attributeMappingLoaded.storeRelease(1);
+}
+
+std::shared_ptr<const OsmAnd::ObfMapSectionLevelTreeNodes> OsmAnd::ObfMapSectionReader_P::obtainRootNodes(
+    const ObfReader_P& reader,
+    const std::shared_ptr<const ObfMapSectionInfo>& section,
+    const std::shared_ptr<const ObfMapSectionLevel>& mapLevel)
+{
+    // Root nodes may have been already read or restored from cached indexes
+    if (mapLevel->_p->_rootNodesLoaded.loadAcquire() != 0)
+        return mapLevel->_p->_rootNodes;
+
+    QMutexLocker scopedLocker(&mapLevel->_p->_treeLoadMutex);
+    if (mapLevel->_p->_rootNodes)
+        return mapLevel->_p->_rootNodes;
+
+    const auto cis = reader.getCodedInputStream().get();
+
+    cis->Seek(mapLevel->offset);
+    auto oldLimit = cis->PushLimit(mapLevel->length);
+
+    cis->Skip(mapLevel->firstDataBoxInnerOffset);
+    QVector<ObfMapSectionLevelTreeNode> rootNodes;
+    readMapLevelTreeNodes(reader, section, mapLevel, rootNodes);
+
+    cis->PopLimit(oldLimit);
+
+    mapLevel->_p->_rootNodes.reset(new ObfMapSectionLevelTreeNodes(rootNodes));
+    mapLevel->_p->_rootNodesLoaded.storeRelease(1);
+
+    return mapLevel->_p->_rootNodes;
+}
+
+const OsmAnd::ObfMapSectionLevelTreeNodes* OsmAnd::ObfMapSectionReader_P::obtainChildNodes(
+    const ObfReader_P& reader,
+    const std::shared_ptr<const ObfMapSectionInfo>& section,
+    const std::shared_ptr<const ObfMapSectionLevel>& mapLevel,
+    const ObfMapSectionLevelTreeNodes& nodes,
+    const int nodeIndex)
+{
+    const auto& node = nodes.nodes[nodeIndex];
+    if (!node.hasChildrenDataBoxes)
+        return nullptr;
+
+    auto& children = nodes.children[nodeIndex];
+    if (const auto childNodes = children.loadAcquire())
+        return childNodes;
+
+    // Only this subtree level is decoded, and only once: other threads wait for it
+    QMutexLocker scopedLocker(&mapLevel->_p->_treeLoadMutex);
+    if (const auto childNodes = children.loadAcquire())
+        return childNodes;
+
+    const auto cis = reader.getCodedInputStream().get();
+
+    cis->Seek(node.offset);
+    const auto oldLimit = cis->PushLimit(node.length);
+
+    cis->Skip(node.firstDataBoxInnerOffset);
+    QVector<ObfMapSectionLevelTreeNode> childNodes;
+    readTreeNodeChildren(reader, section, node, childNodes);
+
+    ObfReaderUtilities::ensureAllDataWasRead(cis);
+    cis->PopLimit(oldLimit);
+
+    const auto decodedChildNodes = new ObfMapSectionLevelTreeNodes(childNodes);
+    children.storeRelease(decodedChildNodes);
+
+    return decodedChildNodes;
+}
+
+void OsmAnd::ObfMapSectionReader_P::restoreRootNodes(
+    const std::shared_ptr<const ObfMapSectionLevel>& mapLevel,
+    const QVector<ObfMapSectionLevelTreeNode>& rootNodes)
+{
+    QMutexLocker scopedLocker(&mapLevel->_p->_treeLoadMutex);
+    if (mapLevel->_p->_rootNodes)
+        return;
+
+    mapLevel->_p->_rootNodes.reset(new ObfMapSectionLevelTreeNodes(rootNodes));
+    mapLevel->_p->_rootNodesLoaded.storeRelease(1);
+}
+
+void OsmAnd::ObfMapSectionReader_P::restoreAttributeMapping(
+    const std::shared_ptr<const ObfMapSectionInfo>& section,
+    const std::function< std::shared_ptr<ObfMapSectionAttributeMapping> () >& attributeMappingLoader)
+{
+    QMutexLocker scopedLocker(&section->_p->_attributeMappingLoadMutex);
+    if (section->_p->_attributeMapping)
+        return;
+
+    section->_p->_cachedAttributeMappingLoader = attributeMappingLoader;
+}
+
 void OsmAnd::ObfMapSectionReader_P::loadMapObjects(
     const ObfReader_P& reader,
     const std::shared_ptr<const ObfMapSectionInfo>& section,
@@ -933,7 +1189,9 @@ void OsmAnd::ObfMapSectionReader_P::loadMapObjects(
     DataBlocksCache* cache,
     QList< std::shared_ptr<const DataBlock> >* outReferencedCacheEntries,
     const std::shared_ptr<const IQueryController>& queryController,
-    ObfMapSectionReader_Metrics::Metric_loadMapObjects* const metric)
+    ObfMapSectionReader_Metrics::Metric_loadMapObjects* const metric,
+    const FilterByAttributesFunction filterByAttributes,
+    const bool simplifyGeometry)
 {
     const auto cis = reader.getCodedInputStream().get();
 
@@ -947,28 +1205,16 @@ void OsmAnd::ObfMapSectionReader_P::loadMapObjects(
         {
             return filterById(section, mapObjectId, bbox, firstZoomLevel, lastZoomLevel, zoom);
         };
-
-    // Ensure encoding/decoding rules are read
-    if (section->_p->_attributeMappingLoaded.loadAcquire() == 0)
-    {
-        QMutexLocker scopedLocker(&section->_p->_attributeMappingLoadMutex);
-        if (!section->_p->_attributeMapping)
+    const auto filterReadByAttributes =
+        [filterByAttributes, zoom]
+        (const std::shared_ptr<const ObfMapSectionInfo>& section,
+        const QVector<uint32_t>& attributeIds) -> bool
         {
-            // Read encoding/decoding rules
-            cis->Seek(section->offset);
-            auto oldLimit = cis->PushLimit(section->length);
-
-            const std::shared_ptr<ObfMapSectionAttributeMapping> attributeMapping(new ObfMapSectionAttributeMapping());
-            readAttributeMapping(reader, section, attributeMapping);
-            section->_p->_attributeMapping = attributeMapping;
-
-            cis->PopLimit(oldLimit);
-
-            section->_p->_attributeMappingLoaded.storeRelease(1);
-        }
-    }
+            return filterByAttributes(section, attributeIds, zoom);
+        };
 
-    ObfMapSectionReader_Metrics::Metric_loadMapObjects localMetric;
+    // Ensure encoding/decoding rules are read
+    ensureAttributeMappingLoaded(reader, section);
 
     auto bboxOrSectionSurfaceType = MapSurfaceType::Undefined;
     if (outBBoxOrSectionSurfaceType)
@@ -1003,88 +1249,23 @@ void OsmAnd::ObfMapSectionReader_P::loadMapObjects(
         if (metric)
             metric->acceptedLevels++;
 
-        // If there are no tree nodes in map level, it means they are not loaded.
-        // Since loading may be called from multiple threads, loading of root nodes needs synchronization
-        // Ensure encoding/decoding rules are read
-        if (mapLevel->_p->_rootNodesLoaded.loadAcquire() == 0)
-        {
-            QMutexLocker scopedLocker(&mapLevel->_p->_rootNodesLoadMutex);
-            if (!mapLevel->_p->_rootNodes)
-            {
-                cis->Seek(mapLevel->offset);
-                auto oldLimit = cis->PushLimit(mapLevel->length);
-
-                cis->Skip(mapLevel->firstDataBoxInnerOffset);
-                const std::shared_ptr< QList< std::shared_ptr<const ObfMapSectionLevelTreeNode> > > rootNodes(
-                    new QList< std::shared_ptr<const ObfMapSectionLevelTreeNode> >());
-                readMapLevelTreeNodes(reader, section, mapLevel, *rootNodes);
-                mapLevel->_p->_rootNodes = rootNodes;
-
-                cis->PopLimit(oldLimit);
-
-                mapLevel->_p->_rootNodesLoaded.storeRelease(1);
-            }
-        }
-
         // Collect tree nodes with data
-        QList< std::shared_ptr<const ObfMapSectionLevelTreeNode> > treeNodesWithData;
-        for (const auto& rootNode : constOf(*mapLevel->_p->_rootNodes))
+        QList<const ObfMapSectionLevelTreeNode*> treeNodesWithData;
+        const auto rootNodes = obtainRootNodes(reader, section, mapLevel);
+        auto levelSurfaceType = MapSurfaceType::Undefined;
+        queryTreeNodes(reader, section, mapLevel, *rootNodes, levelSurfaceType, treeNodesWithData, bbox31, metric);
+        if (levelSurfaceType != MapSurfaceType::Undefined)
         {
-            // Update metric
-            if (metric)
-                metric->visitedNodes++;
-
-            if (bbox31)
-            {
-                const Stopwatch bboxNodeCheckStopwatch(metric != nullptr);
-
-                const auto shouldSkip =
-                    !bbox31->contains(rootNode->area31) &&
-                    !rootNode->area31.contains(*bbox31) &&
-                    !bbox31->intersects(rootNode->area31);
-
-                // Update metric
-                if (metric)
-                    metric->elapsedTimeForNodesBbox += bboxNodeCheckStopwatch.elapsed();
-
-                if (shouldSkip)
-                    continue;
-            }
-
-            // Update metric
-            if (metric)
-                metric->acceptedNodes++;
-
-            if (rootNode->dataOffset > 0)
-                treeNodesWithData.push_back(rootNode);
-
-            auto rootSubnodesSurfaceType = MapSurfaceType::Undefined;
-            if (rootNode->hasChildrenDataBoxes)
-            {
-                cis->Seek(rootNode->offset);
-                auto oldLimit = cis->PushLimit(rootNode->length);
-
-                cis->Skip(rootNode->firstDataBoxInnerOffset);
-                readTreeNodeChildren(reader, section, rootNode, rootSubnodesSurfaceType, &treeNodesWithData, bbox31, queryController, metric);
-                
-                ObfReaderUtilities::ensureAllDataWasRead(cis);
-                cis->PopLimit(oldLimit);
-            }
-
-            const auto surfaceTypeToMerge = (rootSubnodesSurfaceType != MapSurfaceType::Undefined) ? rootSubnodesSurfaceType : rootNode->surfaceType;
-            if (surfaceTypeToMerge != MapSurfaceType::Undefined)
-            {
-                if (bboxOrSectionSurfaceType == MapSurfaceType::Undefined)
-                    bboxOrSectionSurfaceType = surfaceTypeToMerge;
-                else if (bboxOrSectionSurfaceType != surfaceTypeToMerge)
-                    bboxOrSectionSurfaceType = MapSurfaceType::Mixed;
-            }
+            if (bboxOrSectionSurfaceType == MapSurfaceType::Undefined)
+                bboxOrSectionSurfaceType = levelSurfaceType;
+            else if (bboxOrSectionSurfaceType != levelSurfaceType)
+                bboxOrSectionSurfaceType = MapSurfaceType::Mixed;
         }
 
         // Sort blocks by data offset to force forward-only seeking
         std::sort(treeNodesWithData,
             []
-            (const std::shared_ptr<const ObfMapSectionLevelTreeNode>& l, const std::shared_ptr<const ObfMapSectionLevelTreeNode>& r) -> bool
+            (const ObfMapSectionLevelTreeNode* const l, const ObfMapSectionLevelTreeNode* const r) -> bool
             {
                 return l->dataOffset < r->dataOffset;
             });
@@ -1095,75 +1276,20 @@ void OsmAnd::ObfMapSectionReader_P::loadMapObjects(
             metric->elapsedTimeForNodes += treeNodesStopwatch.elapsed();
 
         // Read map objects from their blocks
-        for (const auto& treeNode : constOf(treeNodesWithData))
+        for (const auto pTreeNode : constOf(treeNodesWithData))
         {
             if (queryController && queryController->isAborted())
                 break;
+            const auto& treeNode = *pTreeNode;
 
-            DataBlockId blockId;
-            blockId.sectionRuntimeGeneratedId = section->runtimeGeneratedId;
-            blockId.offset = treeNode->dataOffset;
+            const auto blockId = getDataBlockId(section, treeNode, simplifyGeometry);
 
-            if (cache && cache->shouldCacheBlock(blockId, treeNode->area31, bbox31))
+            // Cached blocks are shared by all zooms of the level, so they are read unfiltered and
+            // attributes filter is applied to cached map objects instead
+            if (cache && cache->shouldCacheBlock(blockId, treeNode.area31, bbox31))
             {
                 // In case cache is provided, read and cache
-                const auto levelZooms = Utilities::enumerateZoomLevels(treeNode->level->minZoom, treeNode->level->maxZoom);
-
-                std::shared_ptr<const DataBlock> dataBlock;
-                std::shared_ptr<const DataBlock> sharedBlockReference;
-                proper::shared_future< std::shared_ptr<const DataBlock> > futureSharedBlockReference;
-                if (cache->obtainReferenceOrFutureReferenceOrMakePromise(blockId, zoom, levelZooms, sharedBlockReference, futureSharedBlockReference))
-                {
-                    // Got reference or future reference
-
-                    // Update metric
-                    if (metric)
-                        metric->mapObjectsBlocksReferenced++;
-
-                    if (sharedBlockReference)
-                    {
-                        // Ok, this block was already loaded, just use it
-                        dataBlock = sharedBlockReference;
-                    }
-                    else
-                    {
-                        // Wait until it will be loaded
-                        dataBlock = futureSharedBlockReference.get();
-                    }
-                }
-                else
-                {
-                    // Made a promise, so load entire block into temporary storage
-                    QList< std::shared_ptr<const BinaryMapObject> > mapObjects;
-
-                    cis->Seek(treeNode->dataOffset);
-
-                    gpb::uint32 length;
-                    cis->ReadVarint32(&length);
-                    const auto oldLimit = cis->PushLimit(length);
-
-                    readMapObjectsBlock(
-                        reader,
-                        section,
-                        treeNode,
-                        &mapObjects,
-                        nullptr,
-                        nullptr,
-                        nullptr,
-                        nullptr,
-                        metric ? &localMetric : nullptr);
-
-                    ObfReaderUtilities::ensureAllDataWasRead(cis);
-                    cis->PopLimit(oldLimit);
-
-                    // Update metric
-                    if (metric)
-                        metric->mapObjectsBlocksRead++;
-
-                    // Create a data block and share it
-                    dataBlock.reset(new DataBlock(blockId, treeNode->area31, treeNode->surfaceType, mapObjects));
-                    cache->fulfilPromiseAndReference(blockId, levelZooms, dataBlock);
-                }
+                const auto dataBlock = obtainDataBlock(reader, section, mapLevel, treeNode, zoom, cache, simplifyGeometry, metric);
 
                 if (outReferencedCacheEntries)
                     outReferencedCacheEntries->push_back(dataBlock);
@@ -1197,6 +1323,13 @@ void OsmAnd::ObfMapSectionReader_P::loadMapObjects(
                             continue;
                     }
 
+                    if (filterByAttributes && !filterByAttributes(section, mapObject->attributeIds, zoom))
+                    {
+                        if (metric)
+                            metric->skippedByAttributesMapObjects++;
+                        continue;
+                    }
+
                     // Check if map object is desired
                     const auto shouldReject = filterById && !filterById(
                         section,
@@ -1222,7 +1355,7 @@ void OsmAnd::ObfMapSectionReader_P::loadMapObjects(
             {
                 // In case there's no cache, simply read
 
-                cis->Seek(treeNode->dataOffset);
+                cis->Seek(treeNode.dataOffset);
 
                 gpb::uint32 length;
                 cis->ReadVarint32(&length);
@@ -1231,10 +1364,13 @@ void OsmAnd::ObfMapSectionReader_P::loadMapObjects(
                 readMapObjectsBlock(
                     reader,
                     section,
+                    mapLevel,
                     treeNode,
                     resultOut,
                     bbox31,
                     filterById != nullptr ? filterReadById : FilterReadingByIdFunction(),
+                    filterByAttributes != nullptr ? filterReadByAttributes : FilterReadingByAttributesFunction(),
+                    simplifyGeometry,
                     visitor,
                     queryController,
                     metric);
@@ -1268,10 +1404,344 @@ void OsmAnd::ObfMapSectionReader_P::loadMapObjects(
 
     if (outBBoxOrSectionSurfaceType)
         *outBBoxOrSectionSurfaceType = bboxOrSectionSurfaceType;
+}
+
+OsmAnd::ObfMapSectionReader_P::DataBlockId OsmAnd::ObfMapSectionReader_P::getDataBlockId(
+    const std::shared_ptr<const ObfMapSectionInfo>& section,
+    const ObfMapSectionLevelTreeNode& treeNode,
+    const bool simplifyGeometry)
+{
+    DataBlockId blockId;
+    blockId.sectionRuntimeGeneratedId = section->runtimeGeneratedId;
+    // Basemap is never simplified, so its blocks are same either way
+    blockId.simplifiedGeometry = (simplifyGeometry && !section->isBasemap) ? 1 : 0;
+    blockId.offset = treeNode.dataOffset;
+    return blockId;
+}
+
+std::shared_ptr<const OsmAnd::ObfMapSectionReader_P::DataBlock> OsmAnd::ObfMapSectionReader_P::obtainDataBlock(
+    const ObfReader_P& reader,
+    const std::shared_ptr<const ObfMapSectionInfo>& section,
+    const std::shared_ptr<const ObfMapSectionLevel>& level,
+    const ObfMapSectionLevelTreeNode& treeNode,
+    const ZoomLevel zoom,
+    DataBlocksCache* const cache,
+    const bool simplifyGeometry,
+    ObfMapSectionReader_Metrics::Metric_loadMapObjects* const metric)
+{
+    const auto cis = reader.getCodedInputStream().get();
+
+    const auto blockId = getDataBlockId(section, treeNode, simplifyGeometry);
+
+    const auto levelZooms = Utilities::enumerateZoomLevels(level->minZoom, level->maxZoom);
+
+    std::shared_ptr<const DataBlock> dataBlock;
+    std::shared_ptr<const DataBlock> sharedBlockReference;
+    proper::shared_future< std::shared_ptr<const DataBlock> > futureSharedBlockReference;
+    if (cache->obtainReferenceOrFutureReferenceOrMakePromise(blockId, zoom, levelZooms, sharedBlockReference, futureSharedBlockReference))
+    {
+        // Got reference or future reference
+
+        // Update metric
+        if (metric)
+            metric->mapObjectsBlocksReferenced++;
 
-    // In case cache was used, and metric was requested, some values must be taken from different parts
-    if (cache && metric)
+        if (sharedBlockReference)
+        {
+            // Ok, this block was already loaded, just use it
+            dataBlock = sharedBlockReference;
+        }
+        else
+        {
+            // Wait until it will be loaded
+            dataBlock = futureSharedBlockReference.get();
+        }
+    }
+    else
     {
-        metric->elapsedTimeForOnlyAcceptedMapObjects += localMetric.elapsedTimeForOnlyAcceptedMapObjects;
+        // Made a promise, so load entire block into temporary storage
+        QList< std::shared_ptr<const BinaryMapObject> > mapObjects;
+        ObfMapSectionReader_Metrics::Metric_loadMapObjects localMetric;
+
+        cis->Seek(treeNode.dataOffset);
+
+        gpb::uint32 length;
+        cis->ReadVarint32(&length);
+        const auto oldLimit = cis->PushLimit(length);
+
+        readMapObjectsBlock(
+            reader,
+            section,
+            level,
+            treeNode,
+            &mapObjects,
+            nullptr,
+            nullptr,
+            nullptr,
+            simplifyGeometry,
+            nullptr,
+            nullptr,
+            metric ? &localMetric : nullptr);
+
+        ObfReaderUtilities::ensureAllDataWasRead(cis);
+        cis->PopLimit(oldLimit);
+
+        // Update metric. Objects of entire block are read regardless of query, so only time is taken
+        if (metric)
+        {
+            metric->mapObjectsBlocksRead++;
+            metric->elapsedTimeForOnlyAcceptedMapObjects += localMetric.elapsedTimeForOnlyAcceptedMapObjects;
+        }
+
+        // Create a data block and share it
+        dataBlock.reset(new DataBlock(blockId, treeNode.area31, treeNode.surfaceType, mapObjects));
+        cache->fulfilPromiseAndReference(blockId, levelZooms, dataBlock);
+    }
+
+    return dataBlock;
+}
+
+void OsmAnd::ObfMapSectionReader_P::loadTiledMapObjects(
+    const ObfReader_P& reader,
+    const std::shared_ptr<const ObfMapSectionInfo>& section,
+    const ZoomLevel zoom,
+    const QVector<AreaI>& tilesBBoxes31,
+    QVector< QList< std::shared_ptr<const OsmAnd::BinaryMapObject> > >* tilesResultsOut,
+    QVector<MapSurfaceType>* outTilesSurfaceTypes,
+    const FilterByIdFunction filterById,
+    DataBlocksCache* cache,
+    QList< std::shared_ptr<const DataBlock> >* outReferencedCacheEntries,
+    const std::shared_ptr<const IQueryController>& queryController,
+    ObfMapSectionReader_Metrics::Metric_loadMapObjects* const metric,
+    const FilterByAttributesFunction filterByAttributes,
+    const bool simplifyGeometry)
+{
+    const auto cis = reader.getCodedInputStream().get();
+    const auto tilesCount = tilesBBoxes31.size();
+
+    if (tilesResultsOut)
+    {
+        tilesResultsOut->clear();
+        tilesResultsOut->resize(tilesCount);
+    }
+    if (outTilesSurfaceTypes)
+        outTilesSurfaceTypes->fill(MapSurfaceType::Undefined, tilesCount);
+    if (tilesCount == 0)
+        return;
+
+    const auto filterReadById =
+        [filterById, zoom]
+        (const std::shared_ptr<const ObfMapSectionInfo>& section,
+        const ObfObjectId mapObjectId,
+        const AreaI& bbox,
+        const ZoomLevel firstZoomLevel,
+        const ZoomLevel lastZoomLevel) -> bool
+        {
+            return filterById(section, mapObjectId, bbox, firstZoomLevel, lastZoomLevel, zoom);
+        };
+    const auto filterReadByAttributes =
+        [filterByAttributes, zoom]
+        (const std::shared_ptr<const ObfMapSectionInfo>& section,
+        const QVector<uint32_t>& attributeIds) -> bool
+        {
+            return filterByAttributes(section, attributeIds, zoom);
+        };
+
+    // Ensure encoding/decoding rules are read
+    ensureAttributeMappingLoaded(reader, section);
+
+    auto tilesUnionBBox31 = tilesBBoxes31.first();
+    for (const auto& tileBBox31 : constOf(tilesBBoxes31))
+        tilesUnionBBox31.enlargeToInclude(tileBBox31);
+
+    // Collect blocks of all levels for all tiles at once, keyed (and thus sorted) by data offset,
+    // each with list of tiles it was found for. Tree index is in memory, so querying it per tile is cheap
+    struct BlockTiles
+    {
+        std::shared_ptr<const ObfMapSectionLevel> level;
+        const ObfMapSectionLevelTreeNode* treeNode;
+        QVector<int> tilesIndices;
+        AreaI tilesUnionBBox31;
+    };
+    QMap<uint32_t, BlockTiles> blocksTiles;
+    const Stopwatch treeNodesStopwatch(metric != nullptr);
+    for (const auto& mapLevel : constOf(section->levels))
+    {
+        // Update metric
+        if (metric)
+            metric->visitedLevels++;
+
+        if (mapLevel->minZoom > zoom || mapLevel->maxZoom < zoom)
+            continue;
+
+        const auto shouldSkip =
+            !tilesUnionBBox31.contains(mapLevel->area31) &&
+            !mapLevel->area31.contains(tilesUnionBBox31) &&
+            !tilesUnionBBox31.intersects(mapLevel->area31);
+        if (shouldSkip)
+            continue;
+
+        if (metric)
+            metric->acceptedLevels++;
+
+        const auto rootNodes = obtainRootNodes(reader, section, mapLevel);
+        for (auto tileIndex = 0; tileIndex < tilesCount; tileIndex++)
+        {
+            const auto& tileBBox31 = tilesBBoxes31[tileIndex];
+
+            QList<const ObfMapSectionLevelTreeNode*> treeNodesWithData;
+            auto levelSurfaceType = MapSurfaceType::Undefined;
+            queryTreeNodes(reader, section, mapLevel, *rootNodes, levelSurfaceType, treeNodesWithData, &tileBBox31, metric);
+
+            if (outTilesSurfaceTypes && levelSurfaceType != MapSurfaceType::Undefined)
+            {
+                auto& tileSurfaceType = (*outTilesSurfaceTypes)[tileIndex];
+                if (tileSurfaceType == MapSurfaceType::Undefined)
+                    tileSurfaceType = levelSurfaceType;
+                else if (tileSurfaceType != levelSurfaceType)
+                    tileSurfaceType = MapSurfaceType::Mixed;
+            }
+
+            for (const auto treeNode : constOf(treeNodesWithData))
+            {
+                auto& blockTiles = blocksTiles[treeNode->dataOffset];
+                if (blockTiles.tilesIndices.isEmpty())
+                {
+                    blockTiles.level = mapLevel;
+                    blockTiles.treeNode = treeNode;
+                    blockTiles.tilesUnionBBox31 = tileBBox31;
+                }
+                else
+                {
+                    blockTiles.tilesUnionBBox31.enlargeToInclude(tileBBox31);
+                }
+                blockTiles.tilesIndices.push_back(tileIndex);
+            }
+        }
+    }
+
+    // Update metric
+    const Stopwatch mapObjectsStopwatch(metric != nullptr);
+    if (metric)
+        metric->elapsedTimeForNodes += treeNodesStopwatch.elapsed();
+
+    // Read each block once, and assign its objects to all tiles they touch
+    QList< std::shared_ptr<const DataBlock> > danglingReferencedCacheEntries;
+    for (const auto& blockTiles : constOf(blocksTiles))
+    {
+        if (queryController && queryController->isAborted())
+            break;
+
+        const auto& treeNode = *blockTiles.treeNode;
+
+        const auto blockId = getDataBlockId(section, treeNode, simplifyGeometry);
+
+        QList< std::shared_ptr<const BinaryMapObject> > mapObjects;
+        // Cached blocks are shared by all zooms of the level, so they are read unfiltered and
+        // attributes filter is applied to cached map objects instead
+        if (cache && cache->shouldCacheBlock(blockId, treeNode.area31, &blockTiles.tilesUnionBBox31))
+        {
+            const auto dataBlock = obtainDataBlock(reader, section, blockTiles.level, treeNode, zoom, cache, simplifyGeometry, metric);
+            if (outReferencedCacheEntries)
+                outReferencedCacheEntries->push_back(dataBlock);
+            else
+                danglingReferencedCacheEntries.push_back(dataBlock);
+
+            for (const auto& mapObject : constOf(dataBlock->mapObjects))
+            {
+                if (metric)
+                    metric->visitedMapObjects++;
+
+                const auto shouldNotSkip =
+                    mapObject->bbox31.contains(blockTiles.tilesUnionBBox31) ||
+                    blockTiles.tilesUnionBBox31.intersects(mapObject->bbox31);
+                if (!shouldNotSkip)
+                    continue;
+
+                if (filterByAttributes && !filterByAttributes(section, mapObject->attributeIds, zoom))
+                {
+                    if (metric)
+                        metric->skippedByAttributesMapObjects++;
+                    continue;
+                }
+
+                // Check if map object is desired
+                const auto shouldReject = filterById && !filterById(
+                    section,
+                    mapObject->id,
+                    mapObject->bbox31,
+                    mapObject->level->minZoom,
+                    mapObject->level->maxZoom,
+                    zoom);
+                if (shouldReject)
+                    continue;
+
+                if (metric)
+                    metric->acceptedMapObjects++;
+
+                mapObjects.push_back(mapObject);
+            }
+        }
+        else
+        {
+            cis->Seek(treeNode.dataOffset);
+
+            gpb::uint32 length;
+            cis->ReadVarint32(&length);
+            const auto oldLimit = cis->PushLimit(length);
+
+            readMapObjectsBlock(
+                reader,
+                section,
+                blockTiles.level,
+                treeNode,
+                &mapObjects,
+                &blockTiles.tilesUnionBBox31,
+                filterById != nullptr ? filterReadById : FilterReadingByIdFunction(),
+                filterByAttributes != nullptr ? filterReadByAttributes : FilterReadingByAttributesFunction(),
+                simplifyGeometry,
+                nullptr,
+                queryController,
+                metric);
+
+            ObfReaderUtilities::ensureAllDataWasRead(cis);
+            cis->PopLimit(oldLimit);
+
+            // Update metric
+            if (metric)
+                metric->mapObjectsBlocksRead++;
+        }
+
+        // Update metric
+        if (metric)
+            metric->mapObjectsBlocksProcessed++;
+
+        if (!tilesResultsOut)
+            continue;
+        for (const auto& mapObject : constOf(mapObjects))
+        {
+            for (const auto tileIndex : constOf(blockTiles.tilesIndices))
+            {
+                const auto& tileBBox31 = tilesBBoxes31[tileIndex];
+                const auto touchesTile =
+                    mapObject->bbox31.contains(tileBBox31) ||
+                    tileBBox31.intersects(mapObject->bbox31);
+                if (touchesTile)
+                    (*tilesResultsOut)[tileIndex].push_back(mapObject);
+            }
+        }
+    }
+
+    // Update metric
+    if (metric)
+        metric->elapsedTimeForMapObjectsBlocks += mapObjectsStopwatch.elapsed();
+
+    // In case cache was supplied, but referenced cache entries output collection was not specified,
+    // release all dangling references
+    if (cache && !outReferencedCacheEntries)
+    {
+        for (auto& referencedCacheEntry : danglingReferencedCacheEntries)
+            cache->releaseReference(referencedCacheEntry->id, zoom, referencedCacheEntry);
+        danglingReferencedCacheEntries.clear();
     }
 }
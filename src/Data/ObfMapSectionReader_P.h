@@ -9,12 +9,14 @@
 #include <QHash>
 #include <QMap>
 #include <QSet>
+#include <QVector>
 #include "restore_internal_warnings.h"
 
 #include "OsmAndCore.h"
 #include "CommonTypes.h"
 #include "MapCommonTypes.h"
 #include "ObfMapSectionReader.h"
+#include "ObfMapSectionInfo_P.h"
 
 namespace OsmAnd
 {
@@ -30,11 +32,14 @@ namespace OsmAnd
         struct Metric_loadMapObjects;
     }
 
+    class CachedOsmandIndexes_P;
+
     class ObfMapSectionReader;
     class ObfMapSectionReader_P Q_DECL_FINAL
     {
     public:
         typedef ObfMapSectionReader::FilterByIdFunction FilterByIdFunction;
+        typedef ObfMapSectionReader::FilterByAttributesFunction FilterByAttributesFunction;
         typedef ObfMapSectionReader::VisitorFunction VisitorFunction;
         typedef ObfMapSectionReader::DataBlockId DataBlockId;
         typedef ObfMapSectionReader::DataBlock DataBlock;
@@ -63,26 +68,59 @@ namespace OsmAnd
             const uint32_t naturalId,
             const std::shared_ptr<ObfMapSectionAttributeMapping>& attributeMapping);
 
+        static void ensureAttributeMappingLoaded(
+            const ObfReader_P& reader,
+            const std::shared_ptr<const ObfMapSectionInfo>& section);
+
+        static std::shared_ptr<const ObfMapSectionLevelTreeNodes> obtainRootNodes(
+            const ObfReader_P& reader,
+            const std::shared_ptr<const ObfMapSectionInfo>& section,
+            const std::shared_ptr<const ObfMapSectionLevel>& mapLevel);
+
+        // Decodes children of nodes.nodes[nodeIndex] on first call, returns nullptr if there are none
+        static const ObfMapSectionLevelTreeNodes* obtainChildNodes(
+            const ObfReader_P& reader,
+            const std::shared_ptr<const ObfMapSectionInfo>& section,
+            const std::shared_ptr<const ObfMapSectionLevel>& mapLevel,
+            const ObfMapSectionLevelTreeNodes& nodes,
+            const int nodeIndex);
+
+        // Used to restore section metadata from cached indexes instead of reading it from file
+        static void restoreRootNodes(
+            const std::shared_ptr<const ObfMapSectionLevel>& mapLevel,
+            const QVector<ObfMapSectionLevelTreeNode>& rootNodes);
+        // Attribute mapping is decoded by loader on first use, if loader fails it's read from file
+        static void restoreAttributeMapping(
+            const std::shared_ptr<const ObfMapSectionInfo>& section,
+            const std::function< std::shared_ptr<ObfMapSectionAttributeMapping> () >& attributeMappingLoader);
+
         static void readMapLevelTreeNodes(
             const ObfReader_P& reader,
             const std::shared_ptr<const ObfMapSectionInfo>& section,
             const std::shared_ptr<const ObfMapSectionLevel>& level,
-            QList< std::shared_ptr<const ObfMapSectionLevelTreeNode> >& nodes);
+            QVector<ObfMapSectionLevelTreeNode>& nodes);
 
         static void readTreeNode(
             const ObfReader_P& reader,
             const std::shared_ptr<const ObfMapSectionInfo>& section,
             const AreaI& parentArea,
-            const std::shared_ptr<ObfMapSectionLevelTreeNode>& treeNode);
+            ObfMapSectionLevelTreeNode& treeNode);
 
         static void readTreeNodeChildren(
             const ObfReader_P& reader,
             const std::shared_ptr<const ObfMapSectionInfo>& section,
-            const std::shared_ptr<const ObfMapSectionLevelTreeNode>& treeNode,
-            MapSurfaceType& outChildrenSurfaceType,
-            QList< std::shared_ptr<const ObfMapSectionLevelTreeNode> >* nodesWithData,
+            const ObfMapSectionLevelTreeNode& treeNode,
+            QVector<ObfMapSectionLevelTreeNode>& outChildNodes);
+
+        // Collects nodes with data that intersect bbox, decoding subtrees on the way if needed
+        static void queryTreeNodes(
+            const ObfReader_P& reader,
+            const std::shared_ptr<const ObfMapSectionInfo>& section,
+            const std::shared_ptr<const ObfMapSectionLevel>& mapLevel,
+            const ObfMapSectionLevelTreeNodes& nodes,
+            MapSurfaceType& outSurfaceType,
+            QList<const ObfMapSectionLevelTreeNode*>& nodesWithData,
             const AreaI* bbox31,
-            const std::shared_ptr<const IQueryController>& queryController,
             ObfMapSectionReader_Metrics::Metric_loadMapObjects* const metric);
 
         typedef std::function < bool(
@@ -91,13 +129,19 @@ namespace OsmAnd
             const AreaI& bbox,
             const ZoomLevel firstZoomLevel,
             const ZoomLevel lastZoomLevel) > FilterReadingByIdFunction;
+        typedef std::function < bool(
+            const std::shared_ptr<const ObfMapSectionInfo>& section,
+            const QVector<uint32_t>& attributeIds) > FilterReadingByAttributesFunction;
         static void readMapObjectsBlock(
             const ObfReader_P& reader,
             const std::shared_ptr<const ObfMapSectionInfo>& section,
-            const std::shared_ptr<const ObfMapSectionLevelTreeNode>& treeNode,
+            const std::shared_ptr<const ObfMapSectionLevel>& level,
+            const ObfMapSectionLevelTreeNode& treeNode,
             QList< std::shared_ptr<const OsmAnd::BinaryMapObject> >* resultOut,
             const AreaI* bbox31,
             const FilterReadingByIdFunction filterById,
+            const FilterReadingByAttributesFunction filterByAttributes,
+            const bool simplifyGeometry,
             const VisitorFunction visitor,
             const std::shared_ptr<const IQueryController>& queryController,
             ObfMapSectionReader_Metrics::Metric_loadMapObjects* const metric);
@@ -112,14 +156,39 @@ namespace OsmAnd
             const ObfReader_P& reader,
             const std::shared_ptr<const ObfMapSectionInfo>& section,
             uint64_t baseId,
-            const std::shared_ptr<const ObfMapSectionLevelTreeNode>& treeNode,
+            const std::shared_ptr<const ObfMapSectionLevel>& level,
+            const ObfMapSectionLevelTreeNode& treeNode,
             std::shared_ptr<OsmAnd::BinaryMapObject>& mapObjectOut,
             const AreaI* bbox31,
+            const FilterReadingByAttributesFunction filterByAttributes,
+            const bool simplifyGeometry,
+            ObfMapSectionReader_Metrics::Metric_loadMapObjects* const metric);
+
+        // Douglas-Peucker simplification in place. Endpoints are always kept, closed rings stay closed
+        static void simplifyPoints(QVector<PointI>& points31, const double tolerance31);
+
+        static DataBlockId getDataBlockId(
+            const std::shared_ptr<const ObfMapSectionInfo>& section,
+            const ObfMapSectionLevelTreeNode& treeNode,
+            const bool simplifyGeometry);
+
+        // Obtains entire block from cache, or reads and shares it. Returned block is referenced
+        static std::shared_ptr<const DataBlock> obtainDataBlock(
+            const ObfReader_P& reader,
+            const std::shared_ptr<const ObfMapSectionInfo>& section,
+            const std::shared_ptr<const ObfMapSectionLevel>& level,
+            const ObfMapSectionLevelTreeNode& treeNode,
+            const ZoomLevel zoom,
+            DataBlocksCache* const cache,
+            const bool simplifyGeometry,
             ObfMapSectionReader_Metrics::Metric_loadMapObjects* const metric);
 
         enum : uint32_t {
             ShiftCoordinates = 5,
             MaskToRead = ~((1u << ShiftCoordinates) - 1),
+
+            // Half a pixel of 256px tile at zoom Z is 2^(SimplificationToleranceShift - Z) in 31-coordinates
+            SimplificationToleranceShift = 31 - 8 - 1,
         };
 
     public:
@@ -135,10 +204,29 @@ namespace OsmAnd
             DataBlocksCache* cache,
             QList< std::shared_ptr<const DataBlock> >* outReferencedCacheEntries,
             const std::shared_ptr<const IQueryController>& queryController,
-            ObfMapSectionReader_Metrics::Metric_loadMapObjects* const metric);
+            ObfMapSectionReader_Metrics::Metric_loadMapObjects* const metric,
+            const FilterByAttributesFunction filterByAttributes,
+            const bool simplifyGeometry);
+
+
+        static void loadTiledMapObjects(
+            const ObfReader_P& reader,
+            const std::shared_ptr<const ObfMapSectionInfo>& section,
+            const ZoomLevel zoom,
+            const QVector<AreaI>& tilesBBoxes31,
+            QVector< QList< std::shared_ptr<const OsmAnd::BinaryMapObject> > >* tilesResultsOut,
+            QVector<MapSurfaceType>* outTilesSurfaceTypes,
+            const FilterByIdFunction filterById,
+            DataBlocksCache* cache,
+            QList< std::shared_ptr<const DataBlock> >* outReferencedCacheEntries,
+            const std::shared_ptr<const IQueryController>& queryController,
+            ObfMapSectionReader_Metrics::Metric_loadMapObjects* const metric,
+            const FilterByAttributesFunction filterByAttributes,
+            const bool simplifyGeometry);
 
     friend class OsmAnd::ObfMapSectionReader;
     friend class OsmAnd::ObfReader_P;
+    friend class OsmAnd::CachedOsmandIndexes_P;
     };
 }
 
@@ -0,0 +1,163 @@
+#include "ObfNameIndex.h"
+
+#include "QtCommon.h"
+#include "ignore_warnings_on_external_includes.h"
+#include "OBF.pb.h"
+#include <google/protobuf/wire_format_lite.h>
+#include "restore_internal_warnings.h"
+
+#include "ObfReaderUtilities.h"
+#include "CollatorStringMatcher.h"
+
+OsmAnd::ObfNameIndex::ObfNameIndex(const QVector<Table>& tables_)
+    : tables(tables_)
+{
+}
+
+OsmAnd::ObfNameIndex::~ObfNameIndex()
+{
+}
+
+void OsmAnd::ObfNameIndex::match(
+    const QString& query,
+    QVector<uint32_t>& outOffsets,
+    const bool strictMatch /*= false*/) const
+{
+    if (tables.isEmpty())
+        return;
+
+    QVector<uint32_t> offsets;
+    match(tables.first(), query, offsets, strictMatch, 0);
+    outOffsets += offsets;
+}
+
+int OsmAnd::ObfNameIndex::match(
+    const Table& table,
+    const QString& query,
+    QVector<uint32_t>& outOffsets,
+    const bool strictMatch,
+    int matchedCharactersCount) const
+{
+    for (const auto& entry : constOf(table))
+    {
+        const auto& key = entry.key;
+
+        bool matchesForward = false;
+        bool matchesBackward = false;
+        if (strictMatch)
+            matchesForward = key.startsWith(query, Qt::CaseInsensitive);
+        else
+            matchesForward = CollatorStringMatcher::cmatches(key, query, StringMatcherMode::CHECK_ONLY_STARTS_WITH);
+
+        if (!matchesForward)
+        {
+            if (strictMatch)
+                matchesBackward = query.startsWith(key, Qt::CaseInsensitive);
+            else
+                matchesBackward = CollatorStringMatcher::cmatches(query, key, StringMatcherMode::CHECK_ONLY_STARTS_WITH);
+        }
+
+        // Longer match drops everything matched so far, shorter one is ignored
+        int entryMatchedCharactersCount;
+        if (matchesForward)
+            entryMatchedCharactersCount = query.length();
+        else if (matchesBackward)
+            entryMatchedCharactersCount = key.length();
+        else
+            continue;
+        if (entryMatchedCharactersCount < matchedCharactersCount)
+            continue;
+        if (entryMatchedCharactersCount > matchedCharactersCount)
+        {
+            matchedCharactersCount = entryMatchedCharactersCount;
+            outOffsets.clear();
+        }
+
+        for (const auto& item : constOf(entry.items))
+        {
+            if (item.subtableIndex < 0)
+                outOffsets.push_back(item.value);
+            else
+                matchedCharactersCount = match(tables[item.subtableIndex], query, outOffsets, strictMatch, matchedCharactersCount);
+        }
+    }
+
+    return matchedCharactersCount;
+}
+
+std::shared_ptr<const OsmAnd::ObfNameIndex> OsmAnd::ObfNameIndex::read(gpb::io::CodedInputStream* cis)
+{
+    QVector<Table> tables;
+    tables.push_back(Table());
+    readTable(cis, QString::null, 0, tables);
+    tables.squeeze();
+
+    return std::make_shared<ObfNameIndex>(tables);
+}
+
+void OsmAnd::ObfNameIndex::readTable(
+    gpb::io::CodedInputStream* cis,
+    const QString& keysPrefix,
+    const int tableIndex,
+    QVector<Table>& tables)
+{
+    // Values and subtables before first key are never matched, so they are not kept
+    Table table;
+
+    for (;;)
+    {
+        const auto tag = cis->ReadTag();
+        switch (gpb::internal::WireFormatLite::GetTagFieldNumber(tag))
+        {
+            case 0:
+                table.squeeze();
+                tables[tableIndex] = table;
+                if (!ObfReaderUtilities::reachedDataEnd(cis))
+                    return;
+
+                return;
+            case OBF::IndexedStringTable::kKeyFieldNumber:
+            {
+                Entry entry;
+                ObfReaderUtilities::readQString(cis, entry.key);
+                if (!keysPrefix.isEmpty())
+                    entry.key.prepend(keysPrefix);
+                table.push_back(entry);
+                break;
+            }
+            case OBF::IndexedStringTable::kValFieldNumber:
+            {
+                Item item;
+                item.value = ObfReaderUtilities::readBigEndianInt(cis);
+                item.subtableIndex = -1;
+                if (!table.isEmpty())
+                    table.last().items.push_back(item);
+                break;
+            }
+            case OBF::IndexedStringTable::kSubtablesFieldNumber:
+            {
+                const auto length = ObfReaderUtilities::readLength(cis);
+                const auto oldLimit = cis->PushLimit(length);
+
+                if (!table.isEmpty())
+                {
+                    Item item;
+                    item.value = 0;
+                    item.subtableIndex = tables.size();
+                    tables.push_back(Table());
+                    readTable(cis, table.last().key, item.subtableIndex, tables);
+                    table.last().items.push_back(item);
+                }
+                else
+                    cis->Skip(cis->BytesUntilLimit());
+
+                ObfReaderUtilities::ensureAllDataWasRead(cis);
+                cis->PopLimit(oldLimit);
+                break;
+            }
+            default:
+                ObfReaderUtilities::skipUnknownField(cis, tag);
+                break;
+        }
+    }
+}
@@ -0,0 +1,74 @@
+#ifndef _OSMAND_CORE_OBF_NAME_INDEX_H_
+#define _OSMAND_CORE_OBF_NAME_INDEX_H_
+
+#include "stdlib_common.h"
+
+#include "QtExtensions.h"
+#include "ignore_warnings_on_external_includes.h"
+#include <QString>
+#include <QVector>
+#include "restore_internal_warnings.h"
+
+#include "ignore_warnings_on_external_includes.h"
+#include <google/protobuf/io/coded_stream.h>
+#include "restore_internal_warnings.h"
+
+#include "OsmAndCore.h"
+
+namespace OsmAnd
+{
+    namespace gpb = google::protobuf;
+
+    // Name index (IndexedStringTable) of POI or address section, kept in memory as is. Matching
+    // a query walks it exactly as ObfReaderUtilities::scanIndexedStringTable() walks the table
+    // in file, but without seeking and decoding it again on every query
+    class ObfNameIndex Q_DECL_FINAL
+    {
+        Q_DISABLE_COPY_AND_MOVE(ObfNameIndex);
+    public:
+        // Value or subtable that follows a key, in file order
+        struct Item
+        {
+            uint32_t value;
+            // Index in tables, -1 if item is a value
+            int subtableIndex;
+        };
+
+        struct Entry
+        {
+            // Full key, including keys of parent tables
+            QString key;
+            QVector<Item> items;
+        };
+
+        typedef QVector<Entry> Table;
+
+    private:
+        int match(
+            const Table& table,
+            const QString& query,
+            QVector<uint32_t>& outOffsets,
+            const bool strictMatch,
+            int matchedCharactersCount) const;
+        static void readTable(
+            gpb::io::CodedInputStream* cis,
+            const QString& keysPrefix,
+            const int tableIndex,
+            QVector<Table>& tables);
+    protected:
+    public:
+        ObfNameIndex(const QVector<Table>& tables);
+        ~ObfNameIndex();
+
+        // First table is the root one, none if section has no name index
+        const QVector<Table> tables;
+
+        // Same semantics as ObfReaderUtilities::scanIndexedStringTable(): offsets of keys that
+        // start with query, or if none, offsets of longest keys query starts with
+        void match(const QString& query, QVector<uint32_t>& outOffsets, const bool strictMatch = false) const;
+
+        static std::shared_ptr<const ObfNameIndex> read(gpb::io::CodedInputStream* cis);
+    };
+}
+
+#endif // !defined(_OSMAND_CORE_OBF_NAME_INDEX_H_)
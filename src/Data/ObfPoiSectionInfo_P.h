@@ -22,6 +22,7 @@ namespace OsmAnd
 {
     class ObfPoiSectionCategories;
     class ObfPoiSectionSubtypes;
+    class ObfNameIndex;
     class ObfPoiSectionReader_P;
 
     class ObfPoiSectionInfo;
@@ -38,6 +39,10 @@ namespace OsmAnd
         mutable std::shared_ptr<ObfPoiSectionSubtypes> _subtypes;
         mutable QAtomicInt _subtypesLoaded;
         mutable QMutex _subtypesLoadMutex;
+
+        mutable std::shared_ptr<const ObfNameIndex> _nameIndex;
+        mutable QAtomicInt _nameIndexLoaded;
+        mutable QMutex _nameIndexLoadMutex;
     public:
         virtual ~ObfPoiSectionInfo_P();
 
@@ -16,6 +16,7 @@
 #include "ObfPoiSectionInfo_P.h"
 #include "Amenity.h"
 #include "ObfReaderUtilities.h"
+#include "ObfNameIndex.h"
 #include "IQueryController.h"
 #include "Utilities.h"
 #include "CollatorStringMatcher.h"
@@ -1142,6 +1143,7 @@ void OsmAnd::ObfPoiSectionReader_P::readAmenitiesByName(
 
                 scanNameIndex(
                     reader,
+                    section,
                     query,
                     dataBoxesOffsetsSet,
                     xy31,
@@ -1223,8 +1225,67 @@ void OsmAnd::ObfPoiSectionReader_P::readAmenitiesByName(
     }
 }
 
+void OsmAnd::ObfPoiSectionReader_P::ensureNameIndexLoaded(
+    const ObfReader_P& reader,
+    const std::shared_ptr<const ObfPoiSectionInfo>& section)
+{
+    if (section->_p->_nameIndexLoaded.loadAcquire() != 0)
+        return;
+
+    QMutexLocker scopedLocker(&section->_p->_nameIndexLoadMutex);
+    if (section->_p->_nameIndex)
+        return;
+
+    const auto cis = reader.getCodedInputStream().get();
+
+    cis->Seek(section->offset);
+    const auto oldLimit = cis->PushLimit(section->length);
+    cis->Skip(section->nameIndexInnerOffset);
+
+    // Only the table of name index is read, atoms are left as is
+    std::shared_ptr<const ObfNameIndex> nameIndex;
+    const auto tag = cis->ReadTag();
+    if (gpb::internal::WireFormatLite::GetTagFieldNumber(tag) == OBF::OsmAndPoiIndex::kNameIndexFieldNumber)
+    {
+        const auto length = ObfReaderUtilities::readBigEndianInt(cis);
+        const auto oldNameIndexLimit = cis->PushLimit(length);
+
+        while (!nameIndex)
+        {
+            const auto nameIndexTag = cis->ReadTag();
+            const auto fieldNumber = gpb::internal::WireFormatLite::GetTagFieldNumber(nameIndexTag);
+            if (fieldNumber == 0)
+                break;
+
+            if (fieldNumber != OBF::OsmAndPoiNameIndex::kTableFieldNumber)
+            {
+                ObfReaderUtilities::skipUnknownField(cis, nameIndexTag);
+                continue;
+            }
+
+            const auto tableLength = ObfReaderUtilities::readBigEndianInt(cis);
+            const auto oldTableLimit = cis->PushLimit(tableLength);
+
+            nameIndex = ObfNameIndex::read(cis);
+
+            ObfReaderUtilities::ensureAllDataWasRead(cis);
+            cis->PopLimit(oldTableLimit);
+        }
+
+        cis->PopLimit(oldNameIndexLimit);
+    }
+    if (!nameIndex)
+        nameIndex.reset(new ObfNameIndex(QVector<ObfNameIndex::Table>()));
+    section->_p->_nameIndex = nameIndex;
+
+    cis->PopLimit(oldLimit);
+
+    section->_p->_nameIndexLoaded.storeRelease(1);
+}
+
 void OsmAnd::ObfPoiSectionReader_P::scanNameIndex(
     const ObfReader_P& reader,
+    const std::shared_ptr<const ObfPoiSectionInfo>& section,
     const QString& query,
     QMap<uint32_t, uint32_t>& outDataOffsets,
     const PointI* const xy31,
@@ -1250,12 +1311,10 @@ void OsmAnd::ObfPoiSectionReader_P::scanNameIndex(
             {
                 const auto length = ObfReaderUtilities::readBigEndianInt(cis);
                 baseOffset = cis->CurrentPosition();
-                const auto oldLimit = cis->PushLimit(length);
-
-                ObfReaderUtilities::scanIndexedStringTable(cis, query, intermediateOffsets);
-                ObfReaderUtilities::ensureAllDataWasRead(cis);
+                cis->Skip(length);
 
-                cis->PopLimit(oldLimit);
+                // Table itself is skipped, query is matched against name index of section kept in memory
+                section->_p->_nameIndex->match(query, intermediateOffsets);
 
                 if (intermediateOffsets.isEmpty())
                 {
@@ -1469,6 +1528,7 @@ void OsmAnd::ObfPoiSectionReader_P::scanAmenitiesByName(
 {
     ensureCategoriesLoaded(reader, section);
     ensureSubtypesLoaded(reader, section);
+    ensureNameIndexLoaded(reader, section);
 
     const auto cis = reader.getCodedInputStream().get();
     cis->Seek(section->offset);
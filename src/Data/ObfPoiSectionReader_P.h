@@ -100,8 +100,12 @@ namespace OsmAnd
             const QSet<ObfPoiCategoryId>* const categoriesFilter,
             const ObfPoiSectionReader::VisitorFunction visitor,
             const std::shared_ptr<const IQueryController>& queryController);
+        static void ensureNameIndexLoaded(
+            const ObfReader_P& reader,
+            const std::shared_ptr<const ObfPoiSectionInfo>& section);
         static void scanNameIndex(
             const ObfReader_P& reader,
+            const std::shared_ptr<const ObfPoiSectionInfo>& section,
             const QString& query,
             QMap<uint32_t, uint32_t>& outDataOffsets,
             const PointI* const xy31,
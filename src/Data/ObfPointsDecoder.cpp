@@ -0,0 +1,239 @@
+#include "ObfPointsDecoder.h"
+
+#include <limits>
+
+// SSE4.1 decoder is built on any x86 target and used only if CPU supports it, so binaries
+// built for baseline x86 still benefit from it
+#if defined(__SSE4_1__)
+#   define OSMAND_SSE41_POINTS_DECODER 1
+#   define OSMAND_SSE41_TARGET
+#elif (defined(__GNUC__) || defined(__clang__)) && (defined(__x86_64__) || defined(__i386__))
+#   define OSMAND_SSE41_POINTS_DECODER 1
+#   define OSMAND_SSE41_TARGET __attribute__((target("sse4.1")))
+#elif defined(_MSC_VER) && (defined(_M_X64) || defined(_M_IX86))
+#   define OSMAND_SSE41_POINTS_DECODER 1
+#   define OSMAND_SSE41_TARGET
+#   include <intrin.h>
+#endif
+#if defined(OSMAND_SSE41_POINTS_DECODER)
+#   include <smmintrin.h>
+#endif // defined(OSMAND_SSE41_POINTS_DECODER)
+
+static inline int32_t zigZagDecode32(const uint32_t value)
+{
+    return static_cast<int32_t>(value >> 1) ^ -static_cast<int32_t>(value & 1);
+}
+
+// Same as CodedInputStream::ReadVarint32(), but on plain memory: up to 10 bytes are consumed,
+// only lower 32 bits are kept
+static inline bool decodeVarint32(const uint8_t*& pData, const uint8_t* const pEnd, uint32_t& outValue)
+{
+    uint32_t value = 0;
+    for (auto bitsShift = 0; bitsShift < 70; bitsShift += 7)
+    {
+        if (pData == pEnd)
+            return false;
+
+        const auto byte = *(pData++);
+        if (bitsShift < 32)
+            value |= static_cast<uint32_t>(byte & 0x7f) << bitsShift;
+        if ((byte & 0x80) == 0)
+        {
+            outValue = value;
+            return true;
+        }
+    }
+
+    return false;
+}
+
+static inline bool decodeDeltaEncodedPoint(
+    const uint8_t*& pData,
+    const uint8_t* const pEnd,
+    const int shift,
+    OsmAnd::PointI& inOutPoint)
+{
+    uint32_t dx;
+    uint32_t dy;
+    if (!decodeVarint32(pData, pEnd, dx) || !decodeVarint32(pData, pEnd, dy))
+        return false;
+
+    inOutPoint.x += (zigZagDecode32(dx) << shift);
+    inOutPoint.y += (zigZagDecode32(dy) << shift);
+    return true;
+}
+
+#if defined(OSMAND_SSE41_POINTS_DECODER)
+static bool isSSE41Available()
+{
+#if defined(__SSE4_1__)
+    return true;
+#elif defined(_MSC_VER)
+    int cpuInfo[4];
+    __cpuid(cpuInfo, 1);
+    return (cpuInfo[2] & (1 << 19)) != 0;
+#else
+    return __builtin_cpu_supports("sse4.1");
+#endif
+}
+
+// Decodes 4 single-byte varints into two points: zigzag, shift, prefix sum and bbox are all done
+// in vector registers that hold [x, y, x, y]
+OSMAND_SSE41_TARGET static inline void decodeTwoPointsSSE41(
+    const __m128i encoded,
+    const __m128i shiftCount,
+    __m128i& current,
+    __m128i& bboxMin,
+    __m128i& bboxMax,
+    OsmAnd::PointI*& pOutPoint)
+{
+    // ZigZag: (n >> 1) ^ -(n & 1)
+    auto deltas = _mm_xor_si128(
+        _mm_srli_epi32(encoded, 1),
+        _mm_sub_epi32(_mm_setzero_si128(), _mm_and_si128(encoded, _mm_set1_epi32(1))));
+    deltas = _mm_sll_epi32(deltas, shiftCount);
+
+    // Prefix sum over (x, y) pairs: [dx0, dy0, dx0+dx1, dy0+dy1]
+    deltas = _mm_add_epi32(deltas, _mm_slli_si128(deltas, 8));
+    const auto points = _mm_add_epi32(deltas, current);
+    _mm_storeu_si128(reinterpret_cast<__m128i*>(pOutPoint), points);
+    pOutPoint += 2;
+
+    current = _mm_shuffle_epi32(points, _MM_SHUFFLE(3, 2, 3, 2));
+    bboxMin = _mm_min_epi32(bboxMin, points);
+    bboxMax = _mm_max_epi32(bboxMax, points);
+}
+
+// Small deltas (single-byte varints) are by far the most common in OBF geometry, so runs of
+// 8 single-byte varints (4 points) are decoded at once. Any multi-byte varint is handled one
+// point at a time. Stops when less than 8 bytes remain or data is malformed, leaving the rest
+// to scalar decoder
+OSMAND_SSE41_TARGET static void decodeDeltaEncodedPointsSSE41(
+    const uint8_t*& pData,
+    const uint8_t* const pEnd,
+    const int shift,
+    OsmAnd::PointI& inOutCurrent,
+    OsmAnd::PointI*& pOutPoint,
+    OsmAnd::AreaI& inOutBBox)
+{
+    static_assert(sizeof(OsmAnd::PointI) == 2 * sizeof(int32_t), "PointI is expected to be two packed int32");
+
+    const auto shiftCount = _mm_cvtsi32_si128(shift);
+    auto current = _mm_set_epi32(inOutCurrent.y, inOutCurrent.x, inOutCurrent.y, inOutCurrent.x);
+    auto bboxMin = _mm_set_epi32(inOutBBox.top(), inOutBBox.left(), inOutBBox.top(), inOutBBox.left());
+    auto bboxMax = _mm_set_epi32(inOutBBox.bottom(), inOutBBox.right(), inOutBBox.bottom(), inOutBBox.right());
+
+    while (pEnd - pData >= 8)
+    {
+        const auto bytes = _mm_loadl_epi64(reinterpret_cast<const __m128i*>(pData));
+        if ((_mm_movemask_epi8(bytes) & 0xff) == 0)
+        {
+            decodeTwoPointsSSE41(_mm_cvtepu8_epi32(bytes), shiftCount, current, bboxMin, bboxMax, pOutPoint);
+            decodeTwoPointsSSE41(_mm_cvtepu8_epi32(_mm_srli_si128(bytes, 4)), shiftCount, current, bboxMin, bboxMax, pOutPoint);
+            pData += 8;
+            continue;
+        }
+
+        const auto pPointData = pData;
+        OsmAnd::PointI point(_mm_cvtsi128_si32(current), _mm_extract_epi32(current, 1));
+        if (!decodeDeltaEncodedPoint(pData, pEnd, shift, point))
+        {
+            pData = pPointData;
+            break;
+        }
+        *(pOutPoint++) = point;
+
+        current = _mm_set_epi32(point.y, point.x, point.y, point.x);
+        bboxMin = _mm_min_epi32(bboxMin, current);
+        bboxMax = _mm_max_epi32(bboxMax, current);
+    }
+
+    bboxMin = _mm_min_epi32(bboxMin, _mm_shuffle_epi32(bboxMin, _MM_SHUFFLE(1, 0, 3, 2)));
+    bboxMax = _mm_max_epi32(bboxMax, _mm_shuffle_epi32(bboxMax, _MM_SHUFFLE(1, 0, 3, 2)));
+    inOutBBox.left() = _mm_cvtsi128_si32(bboxMin);
+    inOutBBox.top() = _mm_extract_epi32(bboxMin, 1);
+    inOutBBox.right() = _mm_cvtsi128_si32(bboxMax);
+    inOutBBox.bottom() = _mm_extract_epi32(bboxMax, 1);
+
+    inOutCurrent.x = _mm_cvtsi128_si32(current);
+    inOutCurrent.y = _mm_extract_epi32(current, 1);
+}
+#endif // defined(OSMAND_SSE41_POINTS_DECODER)
+
+bool OsmAnd::ObfPointsDecoder::isSupported(const Implementation implementation)
+{
+    switch (implementation)
+    {
+        case Implementation::Scalar:
+            return true;
+        case Implementation::SSE41:
+#if defined(OSMAND_SSE41_POINTS_DECODER)
+        {
+            static const bool sse41Available = isSSE41Available();
+            return sse41Available;
+        }
+#else
+            return false;
+#endif // defined(OSMAND_SSE41_POINTS_DECODER)
+    }
+
+    return false;
+}
+
+OsmAnd::ObfPointsDecoder::Implementation OsmAnd::ObfPointsDecoder::getBestImplementation()
+{
+    static const auto bestImplementation = isSupported(Implementation::SSE41)
+        ? Implementation::SSE41
+        : Implementation::Scalar;
+    return bestImplementation;
+}
+
+bool OsmAnd::ObfPointsDecoder::decode(
+    const uint8_t* const pData_,
+    const size_t length,
+    const PointI& origin,
+    const int shift,
+    QVector<PointI>& outPoints,
+    AreaI* const outBBox /*= nullptr*/,
+    const Implementation implementation /*= getBestImplementation()*/)
+{
+    auto pData = pData_;
+    const auto pEnd = pData + length;
+
+    // Each point takes at least 2 bytes, so this is always enough
+    outPoints.resize(static_cast<int>(length / 2));
+    auto pPoint = outPoints.data();
+    auto current = origin;
+    AreaI bbox;
+    if (outBBox)
+        bbox = *outBBox;
+    else
+    {
+        bbox.top() = bbox.left() = std::numeric_limits<int32_t>::max();
+        bbox.bottom() = bbox.right() = std::numeric_limits<int32_t>::min();
+    }
+
+#if defined(OSMAND_SSE41_POINTS_DECODER)
+    if (implementation == Implementation::SSE41 && isSupported(Implementation::SSE41))
+        decodeDeltaEncodedPointsSSE41(pData, pEnd, shift, current, pPoint, bbox);
+#else
+    Q_UNUSED(implementation);
+#endif // defined(OSMAND_SSE41_POINTS_DECODER)
+    bool ok = true;
+    while (pData < pEnd)
+    {
+        if (!decodeDeltaEncodedPoint(pData, pEnd, shift, current))
+        {
+            ok = false;
+            break;
+        }
+        *(pPoint++) = current;
+        bbox.enlargeToInclude(current);
+    }
+
+    outPoints.resize(pPoint - outPoints.data());
+    if (outBBox)
+        *outBBox = bbox;
+
+    return ok;
+}
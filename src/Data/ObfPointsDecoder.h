@@ -0,0 +1,43 @@
+#ifndef _OSMAND_CORE_OBF_POINTS_DECODER_H_
+#define _OSMAND_CORE_OBF_POINTS_DECODER_H_
+
+#include "stdlib_common.h"
+
+#include "QtExtensions.h"
+#include "ignore_warnings_on_external_includes.h"
+#include <QVector>
+#include "restore_internal_warnings.h"
+
+#include "OsmAndCore.h"
+#include "PointsAndAreas.h"
+
+namespace OsmAnd
+{
+    // Decodes OBF geometry: zigzag-encoded varint (dx, dy) pairs. Vectorized implementation is
+    // picked at runtime, when CPU supports it. Exported only for unit tests
+    struct OSMAND_CORE_API ObfPointsDecoder Q_DECL_FINAL
+    {
+        enum class Implementation
+        {
+            Scalar,
+            SSE41,
+        };
+
+        static bool isSupported(const Implementation implementation);
+        static Implementation getBestImplementation();
+
+        // Each delta is shifted left by 'shift' and accumulated starting from 'origin'. If provided,
+        // outBBox is enlarged to include all decoded points. Returns false if data is malformed,
+        // points decoded before that are kept
+        static bool decode(
+            const uint8_t* const pData,
+            const size_t length,
+            const PointI& origin,
+            const int shift,
+            QVector<PointI>& outPoints,
+            AreaI* const outBBox = nullptr,
+            const Implementation implementation = getBestImplementation());
+    };
+}
+
+#endif // !defined(_OSMAND_CORE_OBF_POINTS_DECODER_H_)
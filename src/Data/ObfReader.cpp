@@ -5,15 +5,17 @@
 
 #include "ObfFile.h"
 
-OsmAnd::ObfReader::ObfReader(const std::shared_ptr<const ObfFile>& obfFile_)
-    : _p(new ObfReader_P(this, std::shared_ptr<QIODevice>(new QFile(obfFile_->filePath))))
+OsmAnd::ObfReader::ObfReader(const std::shared_ptr<const ObfFile>& obfFile_, const bool memoryMapped_ /*= false*/)
+    : _p(new ObfReader_P(this, memoryMapped_ ? nullptr : std::shared_ptr<QIODevice>(new QFile(obfFile_->filePath))))
     , obfFile(obfFile_)
+    , memoryMapped(memoryMapped_)
 {
     open();
 }
 
 OsmAnd::ObfReader::ObfReader(const std::shared_ptr<QIODevice>& input)
     : _p(new ObfReader_P(this, input))
+    , memoryMapped(false)
 {
     open();
 }
@@ -12,6 +12,7 @@
 #include "restore_internal_warnings.h"
 
 #include "ObfSectionInfo.h"
+#include "ObfPointsDecoder.h"
 #include "Logging.h"
 #include "CollatorStringMatcher.h"
 
@@ -84,6 +85,32 @@ void OsmAnd::ObfReaderUtilities::readStringTable(gpb::io::CodedInputStream* cis,
     }
 }
 
+void OsmAnd::ObfReaderUtilities::readStringTable(gpb::io::CodedInputStream* cis, QVector<std::string>& stringTableOut)
+{
+    for (;;)
+    {
+        const auto tag = cis->ReadTag();
+        switch (gpb::internal::WireFormatLite::GetTagFieldNumber(tag))
+        {
+            case 0:
+                if (!ObfReaderUtilities::reachedDataEnd(cis))
+                    return;
+
+                return;
+            case OBF::StringTable::kSFieldNumber:
+            {
+                std::string value;
+                if (gpb::internal::WireFormatLite::ReadString(cis, &value))
+                    stringTableOut.push_back(qMove(value));
+                break;
+            }
+            default:
+                skipUnknownField(cis, tag);
+                break;
+        }
+    }
+}
+
 int OsmAnd::ObfReaderUtilities::scanIndexedStringTable(
     gpb::io::CodedInputStream* cis,
     const QString& query,
@@ -217,6 +244,46 @@ void OsmAnd::ObfReaderUtilities::readTileBox(gpb::io::CodedInputStream* cis, Are
     }
 }
 
+bool OsmAnd::ObfReaderUtilities::readDeltaEncodedPoints(
+    gpb::io::CodedInputStream* cis,
+    const PointI& origin,
+    const int shift,
+    QVector<PointI>& outPoints,
+    AreaI* const outBBox /*= nullptr*/)
+{
+    gpb::uint32 length;
+    if (!cis->ReadVarint32(&length))
+        return false;
+
+    // Decode right from the stream buffer if entire block is there, otherwise copy it out
+    QByteArray blockCopy;
+    const void* pBuffer = nullptr;
+    int bufferSize = 0;
+    const bool isBlockBuffered =
+        length > 0 &&
+        cis->GetDirectBufferPointer(&pBuffer, &bufferSize) &&
+        static_cast<gpb::uint32>(bufferSize) >= length;
+    if (!isBlockBuffered)
+    {
+        blockCopy.resize(length);
+        if (!cis->ReadRaw(blockCopy.data(), length))
+            return false;
+        pBuffer = blockCopy.constData();
+    }
+    const auto ok = ObfPointsDecoder::decode(
+        reinterpret_cast<const uint8_t*>(pBuffer),
+        length,
+        origin,
+        shift,
+        outPoints,
+        outBBox);
+
+    if (isBlockBuffered)
+        cis->Skip(length);
+
+    return ok;
+}
+
 void OsmAnd::ObfReaderUtilities::skipUnknownField(gpb::io::CodedInputStream* cis, int tag)
 {
     const auto wireType = gpb::internal::WireFormatLite::GetTagWireType(tag);
@@ -2,6 +2,7 @@
 #define _OSMAND_CORE_OBF_READER_UTILITIES_H_
 
 #include "stdlib_common.h"
+#include <string>
 
 #include "QtExtensions.h"
 #include "ignore_warnings_on_external_includes.h"
@@ -32,6 +33,8 @@ namespace OsmAnd
         static uint32_t readBigEndianInt(gpb::io::CodedInputStream* cis);
         static uint32_t readLength(gpb::io::CodedInputStream* cis);
         static void readStringTable(gpb::io::CodedInputStream* cis, QStringList& stringTableOut);
+        // Same as above, but strings are left undecoded
+        static void readStringTable(gpb::io::CodedInputStream* cis, QVector<std::string>& stringTableOut);
         static int scanIndexedStringTable(
             gpb::io::CodedInputStream* cis,
             const QString& query,
@@ -41,6 +44,16 @@ namespace OsmAnd
             const int matchedCharactersCount = 0);
         static void readTileBox(gpb::io::CodedInputStream* cis, AreaI& outArea);
 
+        // Reads length-delimited block of zigzag-encoded (dx, dy) pairs in one pass. Each delta is
+        // shifted left by 'shift' and accumulated starting from 'origin'. If provided, outBBox
+        // is enlarged to include all decoded points
+        static bool readDeltaEncodedPoints(
+            gpb::io::CodedInputStream* cis,
+            const PointI& origin,
+            const int shift,
+            QVector<PointI>& outPoints,
+            AreaI* const outBBox = nullptr);
+
         static void skipUnknownField(gpb::io::CodedInputStream* cis, int tag);
         static void skipBlockWithLength(gpb::io::CodedInputStream* cis);
 
@@ -3,14 +3,17 @@
 
 #include "QtExtensions.h"
 #include <QFile>
+#include <QThreadStorage>
 
 #include "ignore_warnings_on_external_includes.h"
 #include "OBF.pb.h"
 #include <google/protobuf/wire_format_lite.h>
 #include "restore_internal_warnings.h"
 
+#include "Common.h"
 #include "QIODeviceInputStream.h"
 #include "QFileDeviceInputStream.h"
+#include "MemoryInputStream.h"
 #include "ObfFile.h"
 #include "ObfFile_P.h"
 #include "ObfInfo.h"
@@ -32,10 +35,41 @@
 #   define OSMAND_TRACE_OBF_READERS 0
 #endif // !defined(OSMAND_TRACE_OBF_READERS)
 
+namespace
+{
+    // Streams that memory-mapped readers created for a thread, dropped from readers that are
+    // still alive when that thread finishes
+    struct ThreadCodedInputStreamsReleaser Q_DECL_FINAL
+    {
+        ThreadCodedInputStreamsReleaser()
+            : threadId(QThread::currentThreadId())
+        {
+        }
+
+        ~ThreadCodedInputStreamsReleaser()
+        {
+            for (const auto& weakThreadsCodedInputStreams : OsmAnd::constOf(threadsCodedInputStreams))
+            {
+                const auto threadsCodedInputStreams = weakThreadsCodedInputStreams.lock();
+                if (!threadsCodedInputStreams)
+                    continue;
+
+                QMutexLocker scopedLocker(&threadsCodedInputStreams->mutex);
+                threadsCodedInputStreams->streams.remove(threadId);
+            }
+        }
+
+        const Qt::HANDLE threadId;
+        QList< std::weak_ptr<OsmAnd::ObfReader_P::ThreadsCodedInputStreams> > threadsCodedInputStreams;
+    };
+    Q_GLOBAL_STATIC(QThreadStorage<ThreadCodedInputStreamsReleaser*>, threadCodedInputStreamsReleasers);
+}
+
 OsmAnd::ObfReader_P::ObfReader_P(
     ObfReader* const owner_,
     const std::shared_ptr<QIODevice>& input_)
     : _input(input_)
+    , _threadsCodedInputStreams(new ThreadsCodedInputStreams())
 #if OSMAND_VERIFY_OBF_READER_THREAD
     , _threadId(QThread::currentThreadId())
 #endif // OSMAND_VERIFY_OBF_READER_THREAD
@@ -49,13 +83,15 @@ OsmAnd::ObfReader_P::~ObfReader_P()
 
 bool OsmAnd::ObfReader_P::isOpened() const
 {
+    if (owner->memoryMapped)
+        return static_cast<bool>(_memoryMapping);
     return static_cast<bool>(_codedInputStream);
 }
 
 bool OsmAnd::ObfReader_P::open()
 {
 #if OSMAND_VERIFY_OBF_READER_THREAD
-    if (_threadId != QThread::currentThreadId())
+    if (!owner->memoryMapped && _threadId != QThread::currentThreadId())
     {
         LogPrintf(LogSeverityLevel::Warning,
             "ObfReader(%p) was accessed from thread %p, but created in thread %p",
@@ -71,6 +107,24 @@ bool OsmAnd::ObfReader_P::open()
     if (isOpened())
         return false;
 
+    if (owner->memoryMapped)
+    {
+        _memoryMapping = owner->obfFile->_p->obtainMemoryMapping();
+        if (!_memoryMapping)
+            return false;
+
+#if OSMAND_TRACE_OBF_READERS
+        LogPrintf(LogSeverityLevel::Debug,
+            "Opened memory-mapped ObfReader(%p) for '%s', %" PRIi64 " bytes at %p",
+            owner.get(),
+            qPrintable(owner->obfFile->filePath),
+            _memoryMapping->size,
+            _memoryMapping->data);
+#endif // OSMAND_TRACE_OBF_READERS
+
+        return true;
+    }
+
     // Create zero-copy input stream
     gpb::io::ZeroCopyInputStream* zcis = nullptr;
     if (const auto inputFileDevice = std::dynamic_pointer_cast<QFileDevice>(_input))
@@ -102,7 +156,7 @@ bool OsmAnd::ObfReader_P::open()
 bool OsmAnd::ObfReader_P::close()
 {
 #if OSMAND_VERIFY_OBF_READER_THREAD
-    if (_threadId != QThread::currentThreadId())
+    if (!owner->memoryMapped && _threadId != QThread::currentThreadId())
     {
         LogPrintf(LogSeverityLevel::Warning,
             "ObfReader(%p) was accessed from thread %p, but created in thread %p",
@@ -118,6 +172,17 @@ bool OsmAnd::ObfReader_P::close()
     if (!isOpened())
         return false;
 
+    if (owner->memoryMapped)
+    {
+        {
+            QMutexLocker scopedLocker(&_threadsCodedInputStreams->mutex);
+            _threadsCodedInputStreams->streams.clear();
+        }
+        _memoryMapping.reset();
+
+        return true;
+    }
+
 #if OSMAND_TRACE_OBF_READERS
     if (const auto fileDeviceInputStream = std::dynamic_pointer_cast<QFileDeviceInputStream>(_zeroCopyInputStream))
     {
@@ -141,7 +206,7 @@ bool OsmAnd::ObfReader_P::close()
 std::shared_ptr<const OsmAnd::ObfInfo> OsmAnd::ObfReader_P::obtainInfo() const
 {
 #if OSMAND_VERIFY_OBF_READER_THREAD
-    if (_threadId != QThread::currentThreadId())
+    if (!owner->memoryMapped && _threadId != QThread::currentThreadId())
     {
         LogPrintf(LogSeverityLevel::Warning,
             "ObfReader(%p) was accessed from thread %p, but created in thread %p",
@@ -154,6 +219,9 @@ std::shared_ptr<const OsmAnd::ObfInfo> OsmAnd::ObfReader_P::obtainInfo() const
     }
 #endif // OSMAND_VERIFY_OBF_READER_THREAD
 
+    // Memory-mapped reader may be asked for information from several threads at once
+    QMutexLocker obfInfoScopedLocker(&_obfInfoMutex);
+
     // Check if information is already available
     if (_obfInfo)
         return _obfInfo;
@@ -190,7 +258,7 @@ std::shared_ptr<const OsmAnd::ObfInfo> OsmAnd::ObfReader_P::obtainInfo() const
 std::shared_ptr<OsmAnd::gpb::io::CodedInputStream> OsmAnd::ObfReader_P::getCodedInputStream() const
 {
 #if OSMAND_VERIFY_OBF_READER_THREAD
-    if (_threadId != QThread::currentThreadId())
+    if (!owner->memoryMapped && _threadId != QThread::currentThreadId())
     {
         LogPrintf(LogSeverityLevel::Warning,
             "ObfReader(%p) was accessed from thread %p, but created in thread %p",
@@ -203,9 +271,59 @@ std::shared_ptr<OsmAnd::gpb::io::CodedInputStream> OsmAnd::ObfReader_P::getCoded
     }
 #endif // OSMAND_VERIFY_OBF_READER_THREAD
 
+    if (owner->memoryMapped)
+        return getThreadCodedInputStream();
+
     return _codedInputStream;
 }
 
+std::shared_ptr<OsmAnd::gpb::io::CodedInputStream> OsmAnd::ObfReader_P::getThreadCodedInputStream() const
+{
+    if (!_memoryMapping)
+        return nullptr;
+
+    const auto threadId = QThread::currentThreadId();
+
+    QMutexLocker scopedLocker(&_threadsCodedInputStreams->mutex);
+
+    // Nested section readers of the same query share the stream of their thread
+    auto& codedInputStream = _threadsCodedInputStreams->streams[threadId];
+    if (!codedInputStream)
+    {
+        const auto zcis = new MemoryInputStream(
+            _memoryMapping,
+            _memoryMapping->data,
+            _memoryMapping->size);
+        const auto cis = new gpb::io::CodedInputStream(zcis);
+        cis->SetTotalBytesLimit(std::numeric_limits<int>::max(), std::numeric_limits<int>::max());
+
+        // Coded input stream doesn't own the zero-copy stream, so tie their lifetimes together
+        const std::shared_ptr<gpb::io::ZeroCopyInputStream> zeroCopyInputStream(zcis);
+        codedInputStream.reset(cis,
+            [zeroCopyInputStream]
+            (gpb::io::CodedInputStream* const cis)
+            {
+                delete cis;
+            });
+
+        // Ask thread to release this stream when it finishes
+        auto& releasers = *threadCodedInputStreamsReleasers();
+        if (!releasers.hasLocalData())
+            releasers.setLocalData(new ThreadCodedInputStreamsReleaser());
+        auto& threadsCodedInputStreams = releasers.localData()->threadsCodedInputStreams;
+        for (auto itEntry = threadsCodedInputStreams.begin(); itEntry != threadsCodedInputStreams.end();)
+        {
+            if (itEntry->expired())
+                itEntry = threadsCodedInputStreams.erase(itEntry);
+            else
+                ++itEntry;
+        }
+        threadsCodedInputStreams.push_back(_threadsCodedInputStreams);
+    }
+
+    return codedInputStream;
+}
+
 bool OsmAnd::ObfReader_P::readInfo(const ObfReader_P& reader, std::shared_ptr<ObfInfo>& outInfo)
 {
     const auto cis = reader.getCodedInputStream().get();
@@ -9,6 +9,8 @@
 #include <QString>
 #include <QIODevice>
 #include <QThread>
+#include <QMutex>
+#include <QHash>
 #include "restore_internal_warnings.h"
 
 #include "ignore_warnings_on_external_includes.h"
@@ -18,6 +20,7 @@
 
 #include "OsmAndCore.h"
 #include "PrivateImplementation.h"
+#include "ObfFile_P.h"
 
 //#define OSMAND_VERIFY_OBF_READER_THREAD 1
 #if !defined(OSMAND_VERIFY_OBF_READER_THREAD)
@@ -37,11 +40,26 @@ namespace OsmAnd
     {
         Q_DISABLE_COPY_AND_MOVE(ObfReader_P);
 
+    public:
+        // Stream of a thread is released once that thread finishes, so threads that come and go
+        // don't leave their streams behind
+        struct ThreadsCodedInputStreams Q_DECL_FINAL
+        {
+            QMutex mutex;
+            QHash< Qt::HANDLE, std::shared_ptr<gpb::io::CodedInputStream> > streams;
+        };
+
     private:
         const std::shared_ptr<QIODevice> _input;
         std::shared_ptr<gpb::io::ZeroCopyInputStream> _zeroCopyInputStream;
         std::shared_ptr<gpb::io::CodedInputStream> _codedInputStream;
 
+        // Memory-mapped mode: one mapping, one stream per calling thread
+        std::shared_ptr<const ObfFile_P::MemoryMapping> _memoryMapping;
+        const std::shared_ptr<ThreadsCodedInputStreams> _threadsCodedInputStreams;
+        std::shared_ptr<gpb::io::CodedInputStream> getThreadCodedInputStream() const;
+
+        mutable QMutex _obfInfoMutex;
         mutable std::shared_ptr<const ObfInfo> _obfInfo;
         static bool readInfo(const ObfReader_P& reader, std::shared_ptr<ObfInfo>& info);
 
@@ -25,6 +25,16 @@ std::shared_ptr<const OsmAnd::ObfRoutingSectionAttributeMapping> OsmAnd::ObfRout
     return nullptr;
 }
 
+uint32_t OsmAnd::ObfRoutingSectionInfo_P::obtainTypesSetId(const QVector<uint32_t>& types) const
+{
+    QMutexLocker scopedLocker(&_typesSetsIdsMutex);
+
+    auto itTypesSetId = _typesSetsIds.constFind(types);
+    if (itTypesSetId == _typesSetsIds.cend())
+        itTypesSetId = _typesSetsIds.insert(types, static_cast<uint32_t>(_typesSetsIds.size()));
+    return *itTypesSetId;
+}
+
 OsmAnd::ObfRoutingSectionLevel_P::ObfRoutingSectionLevel_P(ObfRoutingSectionLevel* const owner_)
     : owner(owner_)
 {
@@ -8,6 +8,8 @@
 #include "QtExtensions.h"
 #include "ignore_warnings_on_external_includes.h"
 #include <QString>
+#include <QVector>
+#include <QHash>
 #include <QMutex>
 #include <QAtomicInt>
 #include "restore_internal_warnings.h"
@@ -16,6 +18,7 @@
 #include "CommonTypes.h"
 #include "PrivateImplementation.h"
 #include "ObfRoutingSectionInfo.h"
+#include "ObfStringsPool.h"
 
 namespace OsmAnd
 {
@@ -40,12 +43,19 @@ namespace OsmAnd
             std::shared_ptr<const ObfRoutingSectionLevel> level;
         };
         mutable std::array<LevelContainer, RoutingDataLevelsCount> _levelContainers;
+
+        mutable ObfStringsPool _captionsPool;
+
+        // Distinct sets of road or point types met in section, numbered in order of appearance
+        mutable QHash< QVector<uint32_t>, uint32_t > _typesSetsIds;
+        mutable QMutex _typesSetsIdsMutex;
     public:
         ~ObfRoutingSectionInfo_P();
 
         ImplementationInterface<ObfRoutingSectionInfo> owner;
 
         std::shared_ptr<const ObfRoutingSectionAttributeMapping> getAttributeMapping() const;
+        uint32_t obtainTypesSetId(const QVector<uint32_t>& types) const;
 
     friend class OsmAnd::ObfRoutingSectionInfo;
     friend class OsmAnd::ObfRoutingSectionReader_P;
@@ -2,6 +2,7 @@
 #include "ObfRoutingSectionReader_P.h"
 
 #include "ObfReader.h"
+#include "ObfRoutingSegmentsIndex.h"
 
 OsmAnd::ObfRoutingSectionReader::ObfRoutingSectionReader()
 {
@@ -68,6 +69,21 @@ OsmAnd::ObfRoutingSectionReader::DataBlock::~DataBlock()
 {
 }
 
+std::shared_ptr<const OsmAnd::ObfRoutingSegmentsIndex> OsmAnd::ObfRoutingSectionReader::DataBlock::getSegmentsIndex() const
+{
+    if (_segmentsIndexBuilt.loadAcquire() != 0)
+        return _segmentsIndex;
+
+    QMutexLocker scopedLocker(&_segmentsIndexBuildMutex);
+    if (!_segmentsIndex)
+    {
+        _segmentsIndex.reset(new ObfRoutingSegmentsIndex(roads));
+        _segmentsIndexBuilt.storeRelease(1);
+    }
+
+    return _segmentsIndex;
+}
+
 OsmAnd::ObfRoutingSectionReader::DataBlocksCache::DataBlocksCache()
 {
 }
@@ -16,6 +16,7 @@
 #include "Stopwatch.h"
 #include "IQueryController.h"
 #include "Utilities.h"
+#include "Logging.h"
 
 OsmAnd::ObfRoutingSectionReader_P::ObfRoutingSectionReader_P()
 {
@@ -456,9 +457,11 @@ void OsmAnd::ObfRoutingSectionReader_P::readRoadsBlock(
     const std::shared_ptr<const IQueryController>& queryController,
     ObfRoutingSectionReader_Metrics::Metric_loadRoads* const metric)
 {
-    QStringList roadsCaptionsTable;
+    QVector<std::string> roadsCaptionsTable;
     QList<uint64_t> roadsIdsTable;
     QHash< uint32_t, std::shared_ptr<Road> > resultsByInternalId;
+    QVector<RoadRestrictionEntry> restrictions;
+    const std::shared_ptr<RoadsPackedAttributes> packedAttributes(new RoadsPackedAttributes());
 
     const auto cis = reader.getCodedInputStream().get();
     for (;;)
@@ -471,6 +474,35 @@ void OsmAnd::ObfRoutingSectionReader_P::readRoadsBlock(
                 if (!ObfReaderUtilities::reachedDataEnd(cis))
                     return;
 
+                // Pack restrictions of each road next to each other
+                std::stable_sort(restrictions.begin(), restrictions.end(),
+                    []
+                    (const RoadRestrictionEntry& l, const RoadRestrictionEntry& r) -> bool
+                    {
+                        return l.originInternalId < r.originInternalId;
+                    });
+                packedAttributes->restrictionsDestinations.reserve(restrictions.size());
+                packedAttributes->restrictionsTypes.reserve(restrictions.size());
+                for (const auto& restriction : constOf(restrictions))
+                {
+                    const auto originRoad = resultsByInternalId.value(restriction.originInternalId);
+                    if (!originRoad)
+                        continue;
+
+                    const auto restrictionIndex = packedAttributes->restrictionsTypes.size();
+                    if (originRoad->_restrictionsEnd != restrictionIndex)
+                        originRoad->_restrictionsBegin = restrictionIndex;
+                    originRoad->_restrictionsEnd = restrictionIndex + 1;
+                    originRoad->_packedAttributes = packedAttributes;
+
+                    packedAttributes->restrictionsDestinations.push_back(restriction.destinationId);
+                    packedAttributes->restrictionsTypes.push_back(restriction.type);
+                }
+                packedAttributes->pointsIndices.squeeze();
+                packedAttributes->typesOffsets.squeeze();
+                packedAttributes->types.squeeze();
+                packedAttributes->typesSetsIds.squeeze();
+
                 for (const auto& road : constOf(resultsByInternalId))
                 {
                     // Fill captions of roads from stringtable
@@ -488,7 +520,7 @@ void OsmAnd::ObfRoutingSectionReader_P::readRoadsBlock(
                             caption = QString::fromLatin1("#%1 NOT FOUND").arg(stringId);
                             continue;
                         }
-                        caption = roadsCaptionsTable[stringId];
+                        caption = section->_p->_captionsPool.obtain(roadsCaptionsTable[stringId]);
                     }
 
                     if (!visitor || visitor(road))
@@ -523,7 +555,17 @@ void OsmAnd::ObfRoutingSectionReader_P::readRoadsBlock(
                 const auto offset = cis->CurrentPosition();
                 auto oldLimit = cis->PushLimit(length);
 
-                readRoad(reader, section, treeNode, bbox31, filterById, roadsIdsTable, internalId, road, metric);
+                readRoad(
+                    reader,
+                    section,
+                    treeNode,
+                    bbox31,
+                    filterById,
+                    roadsIdsTable,
+                    internalId,
+                    packedAttributes,
+                    road,
+                    metric);
 
                 ObfReaderUtilities::ensureAllDataWasRead(cis);
                 cis->PopLimit(oldLimit);
@@ -560,7 +602,7 @@ void OsmAnd::ObfRoutingSectionReader_P::readRoadsBlock(
                 const auto offset = cis->CurrentPosition();
                 auto oldLimit = cis->PushLimit(length);
 
-                readRoadsBlockRestrictions(reader, resultsByInternalId, roadsIdsTable);
+                readRoadsBlockRestrictions(reader, roadsIdsTable, restrictions);
 
                 ObfReaderUtilities::ensureAllDataWasRead(cis);
                 cis->PopLimit(oldLimit);
@@ -619,8 +661,8 @@ void OsmAnd::ObfRoutingSectionReader_P::readRoadsBlockIdsTable(
 
 void OsmAnd::ObfRoutingSectionReader_P::readRoadsBlockRestrictions(
     const ObfReader_P& reader,
-    const QHash< uint32_t, std::shared_ptr<Road> >& roadsByInternalIds,
-    const QList<uint64_t>& roadsInternalIdToGlobalIdMap)
+    const QList<uint64_t>& roadsInternalIdToGlobalIdMap,
+    QVector<RoadRestrictionEntry>& outRestrictions)
 {
     uint32_t originInternalId;
     uint32_t destinationInternalId;
@@ -637,11 +679,12 @@ void OsmAnd::ObfRoutingSectionReader_P::readRoadsBlockRestrictions(
                 if (!ObfReaderUtilities::reachedDataEnd(cis))
                     return;
 
-                const auto originRoad = roadsByInternalIds[originInternalId];
-                if (!originRoad)
-                    return;
-                const auto destinationRoadId = roadsInternalIdToGlobalIdMap[destinationInternalId];
-                originRoad->restrictions.insert(ObfObjectId::fromRawId(destinationRoadId), static_cast<RoadRestriction>(restrictionType));
+                // Roads of the block may be not read yet, so restriction is bound to origin road later
+                RoadRestrictionEntry restriction;
+                restriction.originInternalId = originInternalId;
+                restriction.destinationId = ObfObjectId::fromRawId(roadsInternalIdToGlobalIdMap[destinationInternalId]);
+                restriction.type = static_cast<RoadRestriction>(restrictionType);
+                outRestrictions.push_back(restriction);
                 return;
             }
             case OBF::RestrictionData::kFromFieldNumber:
@@ -674,6 +717,7 @@ void OsmAnd::ObfRoutingSectionReader_P::readRoad(
     const FilterRoadsByIdFunction filterById,
     const QList<uint64_t>& idsTable,
     uint32_t& internalId,
+    const std::shared_ptr<RoadsPackedAttributes>& packedAttributes,
     std::shared_ptr<Road>& road,
     ObfRoutingSectionReader_Metrics::Metric_loadRoads* const metric)
 {
@@ -689,77 +733,49 @@ void OsmAnd::ObfRoutingSectionReader_P::readRoad(
                 if (!ObfReaderUtilities::reachedDataEnd(cis))
                     return;
 
+                // Rules are evaluated once per distinct set of types, so road refers to its set
+                if (road)
+                    road->_typesSetId = section->_p->obtainTypesSetId(road->attributeIds);
                 return;
             case OBF::RouteData::kPointsFieldNumber:
             {
                 const Stopwatch roadPointsStopwatch(metric != nullptr);
 
-                gpb::uint32 length;
-                cis->ReadVarint32(&length);
-                auto oldLimit = cis->PushLimit(length);
+                // Accumulating deltas and then shifting is equivalent to accumulating shifted deltas
+                PointI origin;
+                origin.x = (treeNode->area31.left() >> ShiftCoordinates) << ShiftCoordinates;
+                origin.y = (treeNode->area31.top() >> ShiftCoordinates) << ShiftCoordinates;
 
                 AreaI roadBBox;
                 roadBBox.top() = roadBBox.left() = std::numeric_limits<int32_t>::max();
                 roadBBox.bottom() = roadBBox.right() = 0;
-                auto lastUnprocessedPointForBBox = 0;
-
-                // In protobuf, a sint32 can be encoded using [1..4] bytes,
-                // so try to guess size of array, and preallocate it.
-                // (BytesUntilLimit/2) is ~= number of vertices, and is always larger than needed.
-                // So it's impossible that a buffer overflow will ever happen. But assert on that.
-                const auto probableVerticesCount = (cis->BytesUntilLimit() / 2);
-                QVector< PointI > points31(probableVerticesCount);
 
-                bool shouldNotSkip = (bbox31 == nullptr);
-                auto pointsCount = 0;
-                auto dx = treeNode->area31.left() >> ShiftCoordinates;
-                auto dy = treeNode->area31.top() >> ShiftCoordinates;
-                auto pPoint = points31.data();
-                while (cis->BytesUntilLimit() > 0)
+                // Entire block is decoded at once, along with bbox of the road
+                QVector< PointI > points31;
+                if (!ObfReaderUtilities::readDeltaEncodedPoints(cis, origin, ShiftCoordinates, points31, &roadBBox))
                 {
-                    const uint32_t x = ObfReaderUtilities::readSInt32(cis) + dx;
-                    const uint32_t y = ObfReaderUtilities::readSInt32(cis) + dy;
-
-                    PointI point31(
-                        x << ShiftCoordinates,
-                        y << ShiftCoordinates);
-                    // Save point into storage
-                    assert(points31.size() > pointsCount);
-                    *(pPoint++) = point31;
-                    pointsCount++;
-
-                    dx = x;
-                    dy = y;
-
-                    // Check if road should be maintained
-                    if (!shouldNotSkip && bbox31)
-                    {
-                        const Stopwatch roadBboxStopwatch(metric != nullptr);
-
-                        shouldNotSkip = bbox31->contains(point31);
-                        roadBBox.enlargeToInclude(point31);
-
-                        if (metric)
-                            metric->elapsedTimeForRoadsBbox += roadBboxStopwatch.elapsed();
-
-                        lastUnprocessedPointForBBox = pointsCount;
-                    }
+                    LogPrintf(LogSeverityLevel::Warning,
+                        "Malformed points of road at %d in section '%s'",
+                        baseOffset,
+                        qPrintable(section->name));
+                    road.reset();
+                    cis->Skip(cis->BytesUntilLimit());
+                    return;
                 }
-                cis->PopLimit(oldLimit);
-
-                // Since reserved space may be larger than actual amount of data,
-                // shrink the vertices array
-                points31.resize(pointsCount);
 
-                // Even if no point lays inside bbox, an edge
-                // may intersect the bbox
+                // Road is maintained if any of points lays inside bbox, or an edge may intersect
+                // the bbox. Both cases are covered by intersection of bboxes
+                bool shouldNotSkip = (bbox31 == nullptr);
                 if (!shouldNotSkip && bbox31)
                 {
-                    assert(lastUnprocessedPointForBBox == points31.size());
+                    const Stopwatch roadBboxStopwatch(metric != nullptr);
 
                     shouldNotSkip =
                         roadBBox.contains(*bbox31) ||
                         bbox31->intersects(roadBBox);
+
+                    if (metric)
+                        metric->elapsedTimeForRoadsBbox += roadBboxStopwatch.elapsed();
                 }
 
                 // If map object didn't fit, skip it's entire content
@@ -777,21 +793,6 @@ void OsmAnd::ObfRoutingSectionReader_P::readRoad(
                 if (metric)
                     metric->elapsedTimeForNotSkippedRoadsPoints += roadPointsStopwatch.elapsed();
 
-                // In case bbox is not fully calculated, complete this task
-                auto pPointForBBox = points31.data() + lastUnprocessedPointForBBox;
-                while (lastUnprocessedPointForBBox < points31.size())
-                {
-                    const Stopwatch roadBboxStopwatch(metric != nullptr);
-
-                    roadBBox.enlargeToInclude(*pPointForBBox);
-
-                    if (metric)
-                        metric->elapsedTimeForRoadsBbox += roadBboxStopwatch.elapsed();
-
-                    lastUnprocessedPointForBBox++;
-                    pPointForBBox++;
-                }
-
                 // Finally, create the object
                 if (!road)
                     road.reset(new OsmAnd::Road(section));
@@ -805,6 +806,8 @@ void OsmAnd::ObfRoutingSectionReader_P::readRoad(
                 gpb::uint32 length;
                 cis->ReadVarint32(&length);
                 auto oldLimit = cis->PushLimit(length);
+                road->_packedAttributes = packedAttributes;
+                road->_pointsTypesBegin = packedAttributes->pointsIndices.size();
                 while (cis->BytesUntilLimit() > 0)
                 {
                     gpb::uint32 pointIdx;
@@ -814,15 +817,20 @@ void OsmAnd::ObfRoutingSectionReader_P::readRoad(
                     cis->ReadVarint32(&innerLength);
                     auto innerOldLimit = cis->PushLimit(innerLength);
 
-                    auto& pointTypes = road->pointsTypes.insert(pointIdx, QVector<uint32_t>()).value();
+                    packedAttributes->pointsIndices.push_back(pointIdx);
+                    const auto typesOffset = packedAttributes->types.size();
                     while (cis->BytesUntilLimit() > 0)
                     {
                         gpb::uint32 pointType;
                         cis->ReadVarint32(&pointType);
-                        pointTypes.push_back(pointType);
+                        packedAttributes->types.push_back(pointType);
                     }
+                    packedAttributes->typesOffsets.push_back(packedAttributes->types.size());
+                    packedAttributes->typesSetsIds.push_back(section->_p->obtainTypesSetId(
+                        packedAttributes->types.mid(typesOffset)));
                     cis->PopLimit(innerOldLimit);
                 }
+                road->_pointsTypesEnd = packedAttributes->pointsIndices.size();
                 cis->PopLimit(oldLimit);
                 break;
             }
@@ -1181,3 +1189,18 @@ void OsmAnd::ObfRoutingSectionReader_P::loadTreeNodes(
     for (const auto& rootNode : constOf(container.level->rootNodes))
         resultOut->push_back(rootNode);
 }
+
+void OsmAnd::ObfRoutingSectionReader_P::restoreTreeNodes(
+    const std::shared_ptr<const ObfRoutingSectionInfo>& section,
+    const RoutingDataLevel dataLevel,
+    const QList< std::shared_ptr<const ObfRoutingSectionLevelTreeNode> >& rootNodes)
+{
+    auto& container = section->_p->_levelContainers[static_cast<unsigned int>(dataLevel)];
+    QMutexLocker scopedLocker(&container.mutex);
+    if (container.level)
+        return;
+
+    std::shared_ptr<ObfRoutingSectionLevel> level(new ObfRoutingSectionLevel(dataLevel));
+    level->_p->_rootNodes = rootNodes;
+    container.level = level;
+}
@@ -7,11 +7,13 @@
 #include "QtExtensions.h"
 #include <QHash>
 #include <QSet>
+#include <QVector>
 
 #include "OsmAndCore.h"
 #include "CommonTypes.h"
 #include "ObfRoutingSectionInfo.h"
 #include "ObfRoutingSectionReader.h"
+#include "Road.h"
 
 namespace OsmAnd
 {
@@ -96,10 +98,16 @@ namespace OsmAnd
             const ObfReader_P& reader,
             QList<uint64_t>& ids);
 
+        struct RoadRestrictionEntry
+        {
+            uint32_t originInternalId;
+            ObfObjectId destinationId;
+            RoadRestriction type;
+        };
         static void readRoadsBlockRestrictions(
             const ObfReader_P& reader,
-            const QHash< uint32_t, std::shared_ptr<Road> >& roadsByInternalIds,
-            const QList<uint64_t>& roadsInternalIdToGlobalIdMap);
+            const QList<uint64_t>& roadsInternalIdToGlobalIdMap,
+            QVector<RoadRestrictionEntry>& outRestrictions);
 
         static void readRoad(
             const ObfReader_P& reader,
@@ -109,6 +117,7 @@ namespace OsmAnd
             const FilterRoadsByIdFunction filterById,
             const QList<uint64_t>& idsTable,
             uint32_t& internalId,
+            const std::shared_ptr<RoadsPackedAttributes>& packedAttributes,
             std::shared_ptr<Road>& road,
             ObfRoutingSectionReader_Metrics::Metric_loadRoads* const metric);
 
@@ -131,6 +140,12 @@ namespace OsmAnd
             const std::shared_ptr<const ObfRoutingSectionInfo>& section,
             const RoutingDataLevel dataLevel,
             QList< std::shared_ptr<const ObfRoutingSectionLevelTreeNode> >* resultOut);
+
+        // Used to restore section metadata from cached indexes instead of reading it from file
+        static void restoreTreeNodes(
+            const std::shared_ptr<const ObfRoutingSectionInfo>& section,
+            const RoutingDataLevel dataLevel,
+            const QList< std::shared_ptr<const ObfRoutingSectionLevelTreeNode> >& rootNodes);
         
     friend class OsmAnd::ObfRoutingSectionReader;
     friend class OsmAnd::ObfReader_P;
@@ -0,0 +1,229 @@
+#include "ObfRoutingSegmentsIndex.h"
+
+#include <cmath>
+#include <limits>
+
+#include "QtCommon.h"
+
+#include "Road.h"
+#include "Utilities.h"
+
+namespace
+{
+    // Distances beyond int32 range are way beyond any search radius anyway
+    inline int32_t clampTo32(const int64_t value)
+    {
+        return static_cast<int32_t>(std::min<int64_t>(value, std::numeric_limits<int32_t>::max()));
+    }
+}
+
+OsmAnd::ObfRoutingSegmentsIndex::ObfRoutingSegmentsIndex(const QList< std::shared_ptr<const Road> >& roads_)
+    : _cellWidth31(1)
+    , _cellHeight31(1)
+    , _columns(1)
+    , _rows(1)
+    , roads(roads_)
+{
+    auto segmentsCount = 0;
+    auto isAreaEmpty = true;
+    for (const auto& road : constOf(roads))
+    {
+        const auto& points31 = road->points31;
+        if (points31.size() <= 1)
+            continue;
+
+        segmentsCount += points31.size() - 1;
+        for (const auto& point31 : constOf(points31))
+        {
+            if (isAreaEmpty)
+                _area31 = AreaI(point31, point31);
+            else
+                _area31.enlargeToInclude(point31);
+            isAreaEmpty = false;
+        }
+    }
+    if (segmentsCount == 0)
+        return;
+
+    // Roads may go beyond the block, so grid covers roads themselves rather than area of block
+    const auto cellsPerSide = qBound(
+        1,
+        static_cast<int>(std::ceil(std::sqrt(static_cast<double>(segmentsCount) / SegmentsPerCell))),
+        static_cast<int>(MaxCellsPerSide));
+    _columns = cellsPerSide;
+    _rows = cellsPerSide;
+    _cellWidth31 = (static_cast<int64_t>(_area31.right()) - _area31.left()) / _columns + 1;
+    _cellHeight31 = (static_cast<int64_t>(_area31.bottom()) - _area31.top()) / _rows + 1;
+
+    const auto forEachCellOfSegment =
+        [this]
+        (const PointI& from31, const PointI& to31, const std::function<void (const int cellIndex)>& callback)
+        {
+            const auto firstColumn = columnOf(qMin(from31.x, to31.x));
+            const auto lastColumn = columnOf(qMax(from31.x, to31.x));
+            const auto firstRow = rowOf(qMin(from31.y, to31.y));
+            const auto lastRow = rowOf(qMax(from31.y, to31.y));
+            for (auto row = firstRow; row <= lastRow; row++)
+            {
+                for (auto column = firstColumn; column <= lastColumn; column++)
+                    callback(row * _columns + column);
+            }
+        };
+
+    // First count segments of each cell, then lay them out cell after cell
+    _cellOffsets.fill(0, _columns * _rows + 1);
+    for (const auto& road : constOf(roads))
+    {
+        const auto& points31 = road->points31;
+        for (auto pointIdx = 1, pointsCount = points31.size(); pointIdx < pointsCount; pointIdx++)
+        {
+            forEachCellOfSegment(points31[pointIdx - 1], points31[pointIdx],
+                [this]
+                (const int cellIndex)
+                {
+                    _cellOffsets[cellIndex + 1]++;
+                });
+        }
+    }
+    for (auto cellIndex = 0, cellsCount = _columns * _rows; cellIndex < cellsCount; cellIndex++)
+        _cellOffsets[cellIndex + 1] += _cellOffsets[cellIndex];
+
+    _segments.resize(_cellOffsets.last());
+    auto insertPositions = _cellOffsets;
+    for (auto roadIdx = 0, roadsCount = roads.size(); roadIdx < roadsCount; roadIdx++)
+    {
+        const auto& points31 = roads[roadIdx]->points31;
+        for (auto pointIdx = 1, pointsCount = points31.size(); pointIdx < pointsCount; pointIdx++)
+        {
+            Segment segment;
+            segment.roadIndex = roadIdx;
+            segment.pointIndex = pointIdx;
+            forEachCellOfSegment(points31[pointIdx - 1], points31[pointIdx],
+                [this, &insertPositions, segment]
+                (const int cellIndex)
+                {
+                    _segments[insertPositions[cellIndex]++] = segment;
+                });
+        }
+    }
+}
+
+OsmAnd::ObfRoutingSegmentsIndex::~ObfRoutingSegmentsIndex()
+{
+}
+
+int OsmAnd::ObfRoutingSegmentsIndex::columnOf(const int64_t x31) const
+{
+    return static_cast<int>(qBound<int64_t>(0, (x31 - _area31.left()) / _cellWidth31, _columns - 1));
+}
+
+int OsmAnd::ObfRoutingSegmentsIndex::rowOf(const int64_t y31) const
+{
+    return static_cast<int>(qBound<int64_t>(0, (y31 - _area31.top()) / _cellHeight31, _rows - 1));
+}
+
+double OsmAnd::ObfRoutingSegmentsIndex::squareDistanceToCell(
+    const int column,
+    const int row,
+    const PointI position31) const
+{
+    const auto left31 = _area31.left() + column * _cellWidth31;
+    const auto right31 = left31 + _cellWidth31 - 1;
+    const auto top31 = _area31.top() + row * _cellHeight31;
+    const auto bottom31 = top31 + _cellHeight31 - 1;
+
+    int64_t dx31 = 0;
+    if (position31.x < left31)
+        dx31 = left31 - position31.x;
+    else if (position31.x > right31)
+        dx31 = position31.x - right31;
+    int64_t dy31 = 0;
+    if (position31.y < top31)
+        dy31 = top31 - position31.y;
+    else if (position31.y > bottom31)
+        dy31 = position31.y - bottom31;
+
+    const auto dx = Utilities::x31toMeters(clampTo32(dx31));
+    const auto dy = Utilities::y31toMeters(clampTo32(dy31));
+    return dx * dx + dy * dy;
+}
+
+void OsmAnd::ObfRoutingSegmentsIndex::visitSegments(
+    const PointI position31,
+    const double sqDistanceLimit,
+    const SegmentVisitor visitor) const
+{
+    if (_segments.isEmpty())
+        return;
+
+    // Position outside of grid starts from nearest cell: along any axis it is not closer to other
+    // cells than that cell is, so bounds below still hold
+    auto limit = sqDistanceLimit;
+    const auto centerColumn = columnOf(position31.x);
+    const auto centerRow = rowOf(position31.y);
+    const auto ringsCount = 1 + qMax(
+        qMax(centerColumn, _columns - 1 - centerColumn),
+        qMax(centerRow, _rows - 1 - centerRow));
+    for (auto ring = 0; ring < ringsCount; ring++)
+    {
+        // Any cell of ring is at least (ring - 1) cells away along one of axes
+        if (ring > 1)
+        {
+            const auto ringDistance = qMin(
+                Utilities::x31toMeters(clampTo32((ring - 1) * _cellWidth31)),
+                Utilities::y31toMeters(clampTo32((ring - 1) * _cellHeight31)));
+            if (ringDistance * ringDistance > limit)
+                break;
+        }
+
+        for (auto row = centerRow - ring; row <= centerRow + ring; row++)
+        {
+            if (row < 0 || row >= _rows)
+                continue;
+
+            // Inner rows of ring have only first and last cells
+            const auto isOuterRow = (row == centerRow - ring || row == centerRow + ring);
+            const auto columnStep = isOuterRow ? 1 : 2 * ring;
+            for (auto column = centerColumn - ring; column <= centerColumn + ring; column += columnStep)
+            {
+                if (column < 0 || column >= _columns)
+                    continue;
+                if (squareDistanceToCell(column, row, position31) > limit)
+                    continue;
+
+                const auto cellIndex = row * _columns + column;
+                for (auto segmentIdx = _cellOffsets[cellIndex], segmentsEnd = _cellOffsets[cellIndex + 1];
+                    segmentIdx < segmentsEnd;
+                    segmentIdx++)
+                {
+                    limit = visitor(_segments[segmentIdx]);
+                }
+            }
+        }
+    }
+}
+
+double OsmAnd::ObfRoutingSegmentsIndex::projectOnSegment(
+    const Road& road,
+    const int pointIndex,
+    const PointI position31,
+    PointI& outProjection31)
+{
+    const auto& from31 = road.points31[pointIndex - 1];
+    const auto& to31 = road.points31[pointIndex];
+
+    const auto sqLength = Utilities::squareDistance31(to31.x, to31.y, from31.x, from31.y);
+    const auto projection = Utilities::projection31(from31.x, from31.y, to31.x, to31.y, position31.x, position31.y);
+    if (projection < 0)
+        outProjection31 = from31;
+    else if (projection >= sqLength)
+        outProjection31 = to31;
+    else
+    {
+        const auto factor = projection / sqLength;
+        outProjection31.x = from31.x + (to31.x - from31.x) * factor;
+        outProjection31.y = from31.y + (to31.y - from31.y) * factor;
+    }
+
+    return Utilities::squareDistance31(outProjection31.x, outProjection31.y, position31.x, position31.y);
+}
@@ -0,0 +1,78 @@
+#ifndef _OSMAND_CORE_OBF_ROUTING_SEGMENTS_INDEX_H_
+#define _OSMAND_CORE_OBF_ROUTING_SEGMENTS_INDEX_H_
+
+#include "stdlib_common.h"
+#include <functional>
+
+#include "QtExtensions.h"
+#include "ignore_warnings_on_external_includes.h"
+#include <QList>
+#include <QVector>
+#include "restore_internal_warnings.h"
+
+#include "OsmAndCore.h"
+#include "CommonTypes.h"
+
+namespace OsmAnd
+{
+    class Road;
+
+    // Uniform grid over segments of roads of a routing data block. Cells are visited in rings
+    // around queried position, and rings that can not hold anything closer than already found
+    // are not visited at all, so only a few segments near position get projected exactly. Exported
+    // only for unit tests
+    class OSMAND_CORE_API ObfRoutingSegmentsIndex Q_DECL_FINAL
+    {
+        Q_DISABLE_COPY_AND_MOVE(ObfRoutingSegmentsIndex);
+    public:
+        struct Segment
+        {
+            int roadIndex;
+            // Segment goes from previous point of road to this one
+            int pointIndex;
+        };
+
+        // Returns squared distance in meters, segments beyond which are of no interest anymore
+        typedef std::function<double (const Segment& segment)> SegmentVisitor;
+
+        enum : int {
+            SegmentsPerCell = 4,
+            MaxCellsPerSide = 256,
+        };
+
+    private:
+        AreaI _area31;
+        int64_t _cellWidth31;
+        int64_t _cellHeight31;
+        int _columns;
+        int _rows;
+
+        // Segments of cell N are _segments[_cellOffsets[N]] .. _segments[_cellOffsets[N + 1] - 1]
+        QVector<int> _cellOffsets;
+        QVector<Segment> _segments;
+
+        int columnOf(const int64_t x31) const;
+        int rowOf(const int64_t y31) const;
+        double squareDistanceToCell(const int column, const int row, const PointI position31) const;
+    protected:
+    public:
+        ObfRoutingSegmentsIndex(const QList< std::shared_ptr<const Road> >& roads);
+        ~ObfRoutingSegmentsIndex();
+
+        const QList< std::shared_ptr<const Road> > roads;
+
+        // Visits segments of cells that may be closer to position than the limit, nearest cells
+        // first. Visitor may lower the limit as it finds closer segments. Segment that crosses
+        // several cells may be visited more than once
+        void visitSegments(const PointI position31, const double sqDistanceLimit, const SegmentVisitor visitor) const;
+
+        // Projects position on segment of road, returns squared distance in meters to projection
+        static double projectOnSegment(
+            const Road& road,
+            const int pointIndex,
+            const PointI position31,
+            PointI& outProjection31);
+    };
+}
+
+#endif // !defined(_OSMAND_CORE_OBF_ROUTING_SEGMENTS_INDEX_H_)
@@ -0,0 +1,93 @@
+#include "ObfStringsPool.h"
+
+OsmAnd::ObfStringsPool::ObfStringsPool()
+{
+}
+
+OsmAnd::ObfStringsPool::~ObfStringsPool()
+{
+}
+
+OsmAnd::ObfStringsPool::Entry::Entry()
+    : recentlyUsed(0)
+{
+}
+
+OsmAnd::ObfStringsPool::Entry::Entry(const QString& string_)
+    : string(string_)
+    , recentlyUsed(0)
+{
+}
+
+OsmAnd::ObfStringsPool::Shard& OsmAnd::ObfStringsPool::getShard(const QByteArray& key)
+{
+    return _shards[qHash(key) % ShardsCount];
+}
+
+QString OsmAnd::ObfStringsPool::obtain(const std::string& utf8)
+{
+    // Lookup key references data of the string, so nothing is copied on hit
+    const auto key = QByteArray::fromRawData(utf8.data(), static_cast<int>(utf8.size()));
+    auto& shard = getShard(key);
+
+    {
+        QReadLocker scopedLocker(&shard.lock);
+
+        const auto citEntry = shard.strings.constFind(key);
+        if (citEntry != shard.strings.cend())
+        {
+            citEntry->recentlyUsed.storeRelease(1);
+            return citEntry->string;
+        }
+    }
+
+    const auto string = QString::fromUtf8(utf8.data(), static_cast<int>(utf8.size()));
+
+    {
+        QWriteLocker scopedLocker(&shard.lock);
+
+        // Other thread may have pooled same string meanwhile
+        const auto citEntry = shard.strings.constFind(key);
+        if (citEntry != shard.strings.cend())
+            return citEntry->string;
+
+        if (shard.strings.size() >= MaxPooledStringsPerShardCount)
+            shard.evictNoLock();
+        shard.strings.insert(QByteArray(utf8.data(), static_cast<int>(utf8.size())), Entry(string));
+    }
+
+    return string;
+}
+
+void OsmAnd::ObfStringsPool::Shard::evictNoLock()
+{
+    // Second chance: strings used since previous sweep survive this one. Pooled strings are
+    // shared with objects that use them, so eviction only limits memory held by the pool itself
+    auto itEntry = strings.begin();
+    while (itEntry != strings.end())
+    {
+        if (itEntry->recentlyUsed.fetchAndStoreRelaxed(0) == 0)
+            itEntry = strings.erase(itEntry);
+        else
+            ++itEntry;
+    }
+
+    // In case every string was in use, drop a quarter of them to make room
+    if (strings.size() >= MaxPooledStringsPerShardCount)
+    {
+        auto toEvictCount = strings.size() / 4;
+        itEntry = strings.begin();
+        while (toEvictCount-- > 0 && itEntry != strings.end())
+            itEntry = strings.erase(itEntry);
+    }
+}
+
+void OsmAnd::ObfStringsPool::clear()
+{
+    for (auto& shard : _shards)
+    {
+        QWriteLocker scopedLocker(&shard.lock);
+
+        shard.strings.clear();
+    }
+}
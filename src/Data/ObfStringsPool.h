@@ -0,0 +1,67 @@
+#ifndef _OSMAND_CORE_OBF_STRINGS_POOL_H_
+#define _OSMAND_CORE_OBF_STRINGS_POOL_H_
+
+#include "stdlib_common.h"
+#include <array>
+#include <string>
+
+#include "QtExtensions.h"
+#include "ignore_warnings_on_external_includes.h"
+#include <QByteArray>
+#include <QString>
+#include <QHash>
+#include <QReadWriteLock>
+#include <QAtomicInt>
+#include "restore_internal_warnings.h"
+
+#include "OsmAndCore.h"
+
+namespace OsmAnd
+{
+    // Pool of strings decoded from UTF-8 data of a section. Same strings (e.g. street names)
+    // repeat across neighbouring blocks, so each one is decoded once and then shared.
+    // Pool is split into shards, each behind a lock of its own, so that threads that read
+    // different blocks of a section rarely contend. Hits take only a read lock
+    class ObfStringsPool Q_DECL_FINAL
+    {
+        Q_DISABLE_COPY_AND_MOVE(ObfStringsPool);
+    public:
+        enum {
+            ShardsCount = 16,
+            MaxPooledStringsCount = 16384,
+            MaxPooledStringsPerShardCount = MaxPooledStringsCount / ShardsCount,
+        };
+
+    private:
+        struct Entry
+        {
+            Entry();
+            Entry(const QString& string);
+
+            QString string;
+            // Set on each hit and cleared by eviction sweep, so that only strings that were
+            // not used since previous sweep are evicted
+            mutable QAtomicInt recentlyUsed;
+        };
+
+        struct Shard
+        {
+            mutable QReadWriteLock lock;
+            QHash<QByteArray, Entry> strings;
+
+            void evictNoLock();
+        };
+        std::array<Shard, ShardsCount> _shards;
+
+        Shard& getShard(const QByteArray& key);
+    protected:
+    public:
+        ObfStringsPool();
+        ~ObfStringsPool();
+
+        QString obtain(const std::string& utf8);
+        void clear();
+    };
+}
+
+#endif // !defined(_OSMAND_CORE_OBF_STRINGS_POOL_H_)
@@ -0,0 +1,11 @@
+#include "ObfTransportSectionInfo_P.h"
+#include "ObfTransportSectionInfo.h"
+
+OsmAnd::ObfTransportSectionInfo_P::ObfTransportSectionInfo_P(ObfTransportSectionInfo* owner_)
+    : owner(owner_)
+{
+}
+
+OsmAnd::ObfTransportSectionInfo_P::~ObfTransportSectionInfo_P()
+{
+}
@@ -0,0 +1,40 @@
+#ifndef _OSMAND_CORE_OBF_TRANSPORT_SECTION_INFO_P_H_
+#define _OSMAND_CORE_OBF_TRANSPORT_SECTION_INFO_P_H_
+
+#include "stdlib_common.h"
+
+#include "QtExtensions.h"
+#include "ignore_warnings_on_external_includes.h"
+#include <QMutex>
+#include <QAtomicInt>
+#include "restore_internal_warnings.h"
+
+#include "OsmAndCore.h"
+#include "CommonTypes.h"
+#include "PrivateImplementation.h"
+
+namespace OsmAnd
+{
+    class TransportNetwork;
+
+    class ObfTransportSectionInfo;
+    class ObfTransportSectionInfo_P Q_DECL_FINAL
+    {
+    private:
+    protected:
+        ObfTransportSectionInfo_P(ObfTransportSectionInfo* owner);
+
+        mutable std::shared_ptr<const TransportNetwork> _network;
+        mutable QAtomicInt _networkBuilt;
+        mutable QMutex _networkBuildMutex;
+    public:
+        virtual ~ObfTransportSectionInfo_P();
+
+        ImplementationInterface<ObfTransportSectionInfo> owner;
+
+    friend class OsmAnd::ObfTransportSectionInfo;
+    friend class OsmAnd::TransportNetwork;
+    };
+}
+
+#endif // !defined(_OSMAND_CORE_OBF_TRANSPORT_SECTION_INFO_P_H_)
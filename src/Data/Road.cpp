@@ -39,13 +39,195 @@ const QHash<QString, QStringList> GEOCODING_ACCESS {
     }
 };
 
+OsmAnd::RoadsPackedAttributes::RoadsPackedAttributes()
+    : typesOffsets(1, 0)
+{
+}
+
+OsmAnd::RoadsPackedAttributes::~RoadsPackedAttributes()
+{
+}
+
 OsmAnd::Road::Road(const std::shared_ptr<const ObfRoutingSectionInfo>& section_)
     : ObfMapObject(section_)
+    , _pointsTypesBegin(0)
+    , _pointsTypesEnd(0)
+    , _restrictionsBegin(0)
+    , _restrictionsEnd(0)
+    , _typesSetId(0)
     , section(section_)
 {
     attributeMapping = section->getAttributeMapping();
 }
 
+uint32_t OsmAnd::Road::getTypesSetId() const
+{
+    return _typesSetId;
+}
+
+bool OsmAnd::Road::hasPointsTypes() const
+{
+    return _pointsTypesEnd > _pointsTypesBegin;
+}
+
+const uint32_t* OsmAnd::Road::getPointTypes(
+    const uint32_t pointIndex,
+    int* const outTypesCount,
+    uint32_t* const outTypesSetId /*= nullptr*/) const
+{
+    // Only few points of a road have types, so plain scan is enough
+    for (auto idx = _pointsTypesBegin; idx < _pointsTypesEnd; idx++)
+    {
+        if (_packedAttributes->pointsIndices[idx] != pointIndex)
+            continue;
+
+        const auto typesOffset = _packedAttributes->typesOffsets[idx];
+        if (outTypesCount)
+            *outTypesCount = _packedAttributes->typesOffsets[idx + 1] - typesOffset;
+        if (outTypesSetId)
+            *outTypesSetId = _packedAttributes->typesSetsIds[idx];
+        return _packedAttributes->types.constData() + typesOffset;
+    }
+
+    if (outTypesCount)
+        *outTypesCount = 0;
+    return nullptr;
+}
+
+int OsmAnd::Road::getRestrictionsCount() const
+{
+    return _restrictionsEnd - _restrictionsBegin;
+}
+
+OsmAnd::ObfObjectId OsmAnd::Road::getRestrictionDestination(const int restrictionIndex) const
+{
+    return _packedAttributes->restrictionsDestinations[_restrictionsBegin + restrictionIndex];
+}
+
+OsmAnd::RoadRestriction OsmAnd::Road::getRestrictionType(const int restrictionIndex) const
+{
+    return _packedAttributes->restrictionsTypes[_restrictionsBegin + restrictionIndex];
+}
+
+bool OsmAnd::Road::getRestriction(const ObfObjectId destinationRoadId, RoadRestriction* const outRestriction /*= nullptr*/) const
+{
+    for (auto idx = _restrictionsBegin; idx < _restrictionsEnd; idx++)
+    {
+        if (_packedAttributes->restrictionsDestinations[idx].id != destinationRoadId.id)
+            continue;
+
+        if (outRestriction)
+            *outRestriction = _packedAttributes->restrictionsTypes[idx];
+        return true;
+    }
+
+    return false;
+}
+
+QHash< uint32_t, QVector<uint32_t> > OsmAnd::Road::getPointsTypes() const
+{
+    QHash< uint32_t, QVector<uint32_t> > pointsTypes;
+    pointsTypes.reserve(_pointsTypesEnd - _pointsTypesBegin);
+    for (auto idx = _pointsTypesBegin; idx < _pointsTypesEnd; idx++)
+    {
+        const auto pTypesBegin = _packedAttributes->types.constData() + _packedAttributes->typesOffsets[idx];
+        const auto pTypesEnd = _packedAttributes->types.constData() + _packedAttributes->typesOffsets[idx + 1];
+
+        auto& pointTypes = pointsTypes[_packedAttributes->pointsIndices[idx]];
+        pointTypes.reserve(pTypesEnd - pTypesBegin);
+        for (auto pType = pTypesBegin; pType != pTypesEnd; ++pType)
+            pointTypes.push_back(*pType);
+    }
+    return pointsTypes;
+}
+
+QHash< OsmAnd::ObfObjectId, OsmAnd::RoadRestriction > OsmAnd::Road::getRestrictions() const
+{
+    QHash< ObfObjectId, RoadRestriction > restrictions;
+    restrictions.reserve(_restrictionsEnd - _restrictionsBegin);
+    for (auto idx = _restrictionsBegin; idx < _restrictionsEnd; idx++)
+        restrictions.insert(_packedAttributes->restrictionsDestinations[idx], _packedAttributes->restrictionsTypes[idx]);
+    return restrictions;
+}
+
+OsmAnd::RoadDirection OsmAnd::Road::getDirection() const
+{
+    const auto& decodeMap = section->getAttributeMapping()->routingDecodeMap;
+    for (const auto attributeId : constOf(attributeIds))
+    {
+        const auto rule = decodeMap.getRef(attributeId);
+        if (!rule)
+            continue;
+
+        if (rule->onewayDirection() != 0)
+            return static_cast<RoadDirection>(rule->onewayDirection());
+        else if (rule->roundabout())
+            return static_cast<RoadDirection>(1);
+    }
+
+    return RoadDirection::TwoWay;
+}
+
+bool OsmAnd::Road::isRoundabout() const
+{
+    const auto& decodeMap = section->getAttributeMapping()->routingDecodeMap;
+    for (const auto attributeId : constOf(attributeIds))
+    {
+        const auto rule = decodeMap.getRef(attributeId);
+        if (!rule)
+            continue;
+
+        if (rule->roundabout())
+            return true;
+        else if (rule->onewayDirection() != 0 && isLoop())
+            return true;
+    }
+
+    return false;
+}
+
+int OsmAnd::Road::getLanes() const
+{
+    const auto& decodeMap = section->getAttributeMapping()->routingDecodeMap;
+    for (const auto attributeId : constOf(attributeIds))
+    {
+        const auto rule = decodeMap.getRef(attributeId);
+        if (!rule)
+            continue;
+
+        const auto lanes = rule->lanes();
+        if (lanes != -1)
+            return lanes;
+    }
+
+    return -1;
+}
+
+QString OsmAnd::Road::getHighway() const
+{
+    const auto& decodeMap = section->getAttributeMapping()->routingDecodeMap;
+    for (const auto attributeId : constOf(attributeIds))
+    {
+        const auto rule = decodeMap.getRef(attributeId);
+        if (!rule)
+            continue;
+
+        const auto highway = rule->highwayRoad();
+        if (!highway.isNull())
+            return highway;
+    }
+
+    return QString();
+}
+
+bool OsmAnd::Road::isLoop() const
+{
+    if (points31.isEmpty())
+        return false;
+
+    return points31.first() == points31.last();
+}
+
 const bool OsmAnd::Road::hasGeocodingAccess() const
 {
     bool access = false;
@@ -265,139 +447,63 @@ bool OsmAnd::Road::bearingVsRouteDirection(double bearing) const
 }
 
 
-//OsmAnd::Road::Road( const std::shared_ptr<const Road>& that, int insertIdx, uint32_t x31, uint32_t y31 )
-//    : _ref(that)
-//    , _id(0)
-//    , _points(_ref->_points.size() + 1)
-//    , subsection(_ref->subsection)
-//    , id(_ref->_id)
-//    , names(_ref->_names)
-//    , points(_points)
-//    , types(_ref->_types)
-//    , pointsTypes(_pointsTypes)
-//    , restrictions(_ref->_restrictions)
-//{
-//    int pointIdx = 0;
-//    for(; pointIdx < insertIdx; pointIdx++)
-//    {
-//        _points[pointIdx] = _ref->_points[pointIdx];
-//        if (!_ref->_pointsTypes.isEmpty())
-//            _pointsTypes.insert(pointIdx, _ref->_pointsTypes[pointIdx]);
-//    }
-//    _points[pointIdx++] = PointI(x31, y31);
-//    for(const auto count = _points.size(); pointIdx < count; pointIdx++)
-//    {
-//        _points[pointIdx] = _ref->_points[pointIdx - 1];
-//        if (!_ref->_pointsTypes.isEmpty())
-//            _pointsTypes.insert(pointIdx, _ref->_pointsTypes[pointIdx]);
-//    }
-//}
-
 OsmAnd::Road::~Road()
 {
 }
 
-//double OsmAnd::Road::getDirectionDelta( uint32_t originIdx, bool forward ) const
-//{
-//    //NOTE: Victor: the problem to put more than 5 meters that BinaryRoutePlanner will treat
-//    // 2 consequent Turn Right as UT and here 2 points will have same turn angle
-//    // So it should be fix in both places
-//    return getDirectionDelta(originIdx, forward, 5);
-//}
-//
-//double OsmAnd::Road::getDirectionDelta( uint32_t originIdx, bool forward, float distance ) const
-//{
-//    auto itPoint = (_points.cbegin() + originIdx);
-//    const auto itOriginPoint = itPoint;
-//    float scannedDistance = 0.0;
-//    do
-//    {
-//        if (forward)
-//        {
-//            itPoint++;
-//            if (itPoint == _points.cend())
-//            {
-//                itPoint--;
-//                break;
-//            }
-//        }
-//        else
-//        {
-//            if (itPoint == _points.cbegin())
-//                break;
-//            itPoint--;
-//        }
-//
-//        // translate into meters
-//        scannedDistance +=
-//            Utilities::x31toMeters(qAbs((int64_t)itPoint->x - (int64_t)itOriginPoint->x)) +
-//            Utilities::y31toMeters(qAbs((int64_t)itPoint->y - (int64_t)itOriginPoint->y));
-//    } while ( scannedDistance < distance );
-//
-//    return -qAtan2(itOriginPoint->x - itPoint->x, itOriginPoint->y - itPoint->y);
-//}
-//
-//OsmAnd::RoadDirection OsmAnd::Road::getDirection() const
-//{
-//    const auto& encRules = subsection->section->_p->_encodingRules;
-//    for(const auto& type : constOf(types))
-//    {
-//        const auto& rule = encRules[type];
-//
-//        if (rule->_type == ObfRoutingSectionInfo_P::EncodingRule::OneWay)
-//            return static_cast<RoadDirection>(rule->_parsedValue.asSignedInt);
-//        else if (rule->_type == ObfRoutingSectionInfo_P::EncodingRule::Roundabout)
-//            return RoadDirection::OneWayForward;
-//    }
-//    
-//    return RoadDirection::TwoWay;
-//}
-//
-//bool OsmAnd::Road::isRoundabout() const
-//{
-//    const auto& encRules = subsection->section->_p->_encodingRules;
-//    for(const auto& type : constOf(types))
-//    {
-//        const auto& rule = encRules[type];
-//
-//        if (rule->isRoundabout())
-//            return true;
-//        else if (rule->getDirection() != RoadDirection::TwoWay && isLoop())
-//            return true;
-//    }
-//
-//    return false;
-//}
-//
-//int OsmAnd::Road::getLanes() const
-//{
-//    const auto& encRules = subsection->section->_p->_encodingRules;
-//    for(const auto& type : constOf(types))
-//    {
-//        const auto& rule = encRules[type];
-//
-//        if (rule->_type == ObfRoutingSectionInfo_P::EncodingRule::Lanes)
-//            return rule->_parsedValue.asUnsignedInt;
-//    }
-//    return -1;
-//}
-//
-//QString OsmAnd::Road::getHighway() const
-//{
-//    const auto& encRules = subsection->section->_p->_encodingRules;
-//    for(const auto& type : constOf(types))
-//    {
-//        const auto& rule = encRules[type];
-//
-//        if (rule->_type == ObfRoutingSectionInfo_P::EncodingRule::Highway)
-//            return rule->_value;
-//    }
-//    return QString();
-//}
-//
-//bool OsmAnd::Road::isLoop() const
-//{
-//    assert(_points.size() > 0);
-//
-//    return _points.first() == _points.last();
-//}
+std::shared_ptr<OsmAnd::Road> OsmAnd::Road::createWithInsertedPoint(
+    const std::shared_ptr<const Road>& road,
+    const int insertIdx,
+    const PointI& point31)
+{
+    const std::shared_ptr<Road> clone(new Road(road->section));
+    clone->id = road->id;
+    clone->isArea = road->isArea;
+    clone->points31 = road->points31;
+    clone->points31.insert(insertIdx, point31);
+    clone->computeBBox31();
+    clone->attributeIds = road->attributeIds;
+    clone->_typesSetId = road->_typesSetId;
+    clone->additionalAttributeIds = road->additionalAttributeIds;
+    clone->captions = road->captions;
+    clone->captionsOrder = road->captionsOrder;
+
+    if (!road->hasPointsTypes() && road->getRestrictionsCount() == 0)
+        return clone;
+
+    // Points after inserted one shift by one, so clone gets own copy of packed attributes
+    const std::shared_ptr<RoadsPackedAttributes> packedAttributes(new RoadsPackedAttributes());
+    const auto& source = *road->_packedAttributes;
+    for (auto idx = road->_pointsTypesBegin; idx < road->_pointsTypesEnd; idx++)
+    {
+        const auto pointIndex = source.pointsIndices[idx];
+        packedAttributes->pointsIndices.push_back(pointIndex < insertIdx ? pointIndex : pointIndex + 1);
+        for (auto typeIdx = source.typesOffsets[idx]; typeIdx < source.typesOffsets[idx + 1]; typeIdx++)
+            packedAttributes->types.push_back(source.types[typeIdx]);
+        packedAttributes->typesOffsets.push_back(packedAttributes->types.size());
+        packedAttributes->typesSetsIds.push_back(source.typesSetsIds[idx]);
+    }
+    for (auto idx = road->_restrictionsBegin; idx < road->_restrictionsEnd; idx++)
+    {
+        packedAttributes->restrictionsDestinations.push_back(source.restrictionsDestinations[idx]);
+        packedAttributes->restrictionsTypes.push_back(source.restrictionsTypes[idx]);
+    }
+
+    clone->_packedAttributes = packedAttributes;
+    clone->_pointsTypesEnd = packedAttributes->pointsIndices.size();
+    clone->_restrictionsEnd = packedAttributes->restrictionsDestinations.size();
+    return clone;
+}
+
+std::shared_ptr<OsmAnd::Road> OsmAnd::Road::create(
+    const std::shared_ptr<const ObfRoutingSectionInfo>& section,
+    const ObfObjectId id,
+    const QVector<PointI>& points31)
+{
+    const std::shared_ptr<Road> road(new Road(section));
+    road->id = id;
+    road->points31 = points31;
+    road->computeBBox31();
+    road->_typesSetId = section->_p->obtainTypesSetId(road->attributeIds);
+    return road;
+}
@@ -0,0 +1,286 @@
+#include "TransportJourneyPlanner.h"
+
+#include <cmath>
+#include <limits>
+
+#include "QtCommon.h"
+#include "ignore_warnings_on_external_includes.h"
+#include <QVector>
+#include "restore_internal_warnings.h"
+
+#include "TransportNetwork.h"
+#include "TransportStop.h"
+#include "TransportRoute.h"
+#include "IQueryController.h"
+#include "Utilities.h"
+
+OsmAnd::TransportJourneyPlanner::Settings::Settings()
+    : maxTransfers(3)
+    , maxWalkDistance(500.0)
+    , averageHeadway(600)
+{
+}
+
+OsmAnd::TransportJourneyPlanner::Leg::Leg()
+    : departureTime(0)
+    , arrivalTime(0)
+{
+}
+
+OsmAnd::TransportJourneyPlanner::Journey::Journey()
+    : arrivalTime(0)
+    , ridesCount(0)
+{
+}
+
+OsmAnd::TransportJourneyPlanner::TransportJourneyPlanner()
+{
+}
+
+OsmAnd::TransportJourneyPlanner::~TransportJourneyPlanner()
+{
+}
+
+bool OsmAnd::TransportJourneyPlanner::findEarliestArrival(
+    const std::shared_ptr<const TransportNetwork>& network,
+    const PointI& origin31,
+    const PointI& destination31,
+    const int departureTime,
+    Journey& outJourney,
+    const Settings& settings /*= Settings()*/,
+    const std::shared_ptr<const IQueryController>& queryController /*= nullptr*/)
+{
+    enum : int {
+        Unreached = std::numeric_limits<int>::max(),
+    };
+
+    // How stop was reached in a round, journey is unwound from destination by these
+    enum class LabelType
+    {
+        None,
+        Access,
+        Ride,
+        Walk,
+    };
+    struct Label
+    {
+        Label()
+            : type(LabelType::None)
+            , routeIndex(-1)
+            , fromStopIndex(-1)
+            , departureTime(0)
+        {
+        }
+
+        LabelType type;
+        int routeIndex;
+        int fromStopIndex;
+        int departureTime;
+    };
+
+    const auto stopsCount = network->stops.size();
+    const auto roundsCount = settings.maxTransfers + 2;
+    const auto boardingWait = settings.averageHeadway / 2;
+
+    // Round R of stop S is at [R * stopsCount + S]
+    QVector<int> arrivalTimes(roundsCount * stopsCount, Unreached);
+    QVector<Label> labels(roundsCount * stopsCount);
+    QVector<int> bestArrivalTimes(stopsCount, Unreached);
+    QVector<bool> isStopMarked(stopsCount, false);
+    QVector<int> markedStops;
+
+    auto bestDestinationArrival = static_cast<int>(Unreached);
+    auto bestRound = -1;
+    auto bestEgressStopIndex = -1;
+
+    const auto directDistance = Utilities::distance31(origin31, destination31);
+    if (directDistance <= settings.maxWalkDistance)
+        bestDestinationArrival = departureTime + static_cast<int>(std::ceil(directDistance / TransportNetwork::WalkingSpeed));
+
+    QVector<TransportNetwork::Transfer> egressStops;
+    network->findStopsAround(destination31, settings.maxWalkDistance, egressStops);
+    if (egressStops.isEmpty() && bestDestinationArrival == Unreached)
+        return false;
+
+    QVector<TransportNetwork::Transfer> accessStops;
+    network->findStopsAround(origin31, settings.maxWalkDistance, accessStops);
+    for (const auto& accessStop : constOf(accessStops))
+    {
+        const auto arrivalTime = departureTime + accessStop.time;
+        arrivalTimes[accessStop.stopIndex] = arrivalTime;
+        bestArrivalTimes[accessStop.stopIndex] = arrivalTime;
+        labels[accessStop.stopIndex].type = LabelType::Access;
+        labels[accessStop.stopIndex].departureTime = departureTime;
+        isStopMarked[accessStop.stopIndex] = true;
+        markedStops.push_back(accessStop.stopIndex);
+    }
+
+    // First position of each route to scan from in current round, -1 if route is not scanned
+    QVector<int> routesScanStart(network->routes.size(), -1);
+    QVector<int> routesToScan;
+    QVector< std::pair<int, int> > rideImprovedStops;
+    for (auto round = 1; round < roundsCount && !markedStops.isEmpty(); round++)
+    {
+        if (queryController && queryController->isAborted())
+            return false;
+
+        const auto previousRoundOffset = (round - 1) * stopsCount;
+        const auto roundOffset = round * stopsCount;
+
+        // Each route is scanned once, from the earliest of its stops improved in previous round
+        routesToScan.clear();
+        for (const auto stopIndex : constOf(markedStops))
+        {
+            isStopMarked[stopIndex] = false;
+            for (auto routeStopIdx = network->_stopRoutesOffsets[stopIndex], routeStopsEnd = network->_stopRoutesOffsets[stopIndex + 1];
+                routeStopIdx < routeStopsEnd;
+                routeStopIdx++)
+            {
+                const auto& routeStop = network->_stopRoutes[routeStopIdx];
+                auto& scanStart = routesScanStart[routeStop.routeIndex];
+                if (scanStart < 0)
+                {
+                    scanStart = routeStop.position;
+                    routesToScan.push_back(routeStop.routeIndex);
+                }
+                else
+                    scanStart = qMin(scanStart, routeStop.position);
+            }
+        }
+        markedStops.clear();
+
+        rideImprovedStops.clear();
+        for (const auto routeIndex : constOf(routesToScan))
+        {
+            const auto routeStopsOffset = network->_routeStopsOffsets[routeIndex];
+            const auto routeStopsCount = network->_routeStopsOffsets[routeIndex + 1] - routeStopsOffset;
+
+            // Time the vehicle caught so far would leave first stop of route
+            auto boardedStartTime = static_cast<int>(Unreached);
+            auto boardedStopIndex = -1;
+            for (auto position = routesScanStart[routeIndex]; position < routeStopsCount; position++)
+            {
+                const auto stopIndex = network->_routeStops[routeStopsOffset + position];
+                const auto stopTime = network->_routeStopsTimes[routeStopsOffset + position];
+
+                if (boardedStopIndex >= 0)
+                {
+                    const auto arrivalTime = boardedStartTime + stopTime;
+                    if (arrivalTime < bestArrivalTimes[stopIndex] && arrivalTime < bestDestinationArrival)
+                    {
+                        arrivalTimes[roundOffset + stopIndex] = arrivalTime;
+                        bestArrivalTimes[stopIndex] = arrivalTime;
+                        auto& label = labels[roundOffset + stopIndex];
+                        label.type = LabelType::Ride;
+                        label.routeIndex = routeIndex;
+                        label.fromStopIndex = boardedStopIndex;
+                        label.departureTime = arrivalTimes[previousRoundOffset + boardedStopIndex] + boardingWait;
+                        if (!isStopMarked[stopIndex])
+                        {
+                            isStopMarked[stopIndex] = true;
+                            markedStops.push_back(stopIndex);
+                        }
+                        rideImprovedStops.push_back(std::make_pair(stopIndex, arrivalTime));
+                    }
+                }
+
+                // Earlier vehicle can be caught at this stop
+                const auto previousArrivalTime = arrivalTimes[previousRoundOffset + stopIndex];
+                if (previousArrivalTime != Unreached && previousArrivalTime + boardingWait - stopTime < boardedStartTime)
+                {
+                    boardedStartTime = previousArrivalTime + boardingWait - stopTime;
+                    boardedStopIndex = stopIndex;
+                }
+            }
+            routesScanStart[routeIndex] = -1;
+        }
+
+        // Walking transfers start when stop was reached by ride, even if a walk reaches it sooner
+        for (const auto& rideImprovedStop : constOf(rideImprovedStops))
+        {
+            const auto stopIndex = rideImprovedStop.first;
+            const auto rideArrivalTime = rideImprovedStop.second;
+            for (auto transferIdx = network->_transfersOffsets[stopIndex], transfersEnd = network->_transfersOffsets[stopIndex + 1];
+                transferIdx < transfersEnd;
+                transferIdx++)
+            {
+                const auto& transfer = network->_transfers[transferIdx];
+                const auto arrivalTime = rideArrivalTime + transfer.time;
+                if (arrivalTime >= bestArrivalTimes[transfer.stopIndex] || arrivalTime >= bestDestinationArrival)
+                    continue;
+
+                arrivalTimes[roundOffset + transfer.stopIndex] = arrivalTime;
+                bestArrivalTimes[transfer.stopIndex] = arrivalTime;
+                auto& label = labels[roundOffset + transfer.stopIndex];
+                label.type = LabelType::Walk;
+                label.fromStopIndex = stopIndex;
+                label.departureTime = rideArrivalTime;
+                if (!isStopMarked[transfer.stopIndex])
+                {
+                    isStopMarked[transfer.stopIndex] = true;
+                    markedStops.push_back(transfer.stopIndex);
+                }
+            }
+        }
+
+        for (const auto& egressStop : constOf(egressStops))
+        {
+            const auto stopArrivalTime = arrivalTimes[roundOffset + egressStop.stopIndex];
+            if (stopArrivalTime == Unreached || stopArrivalTime + egressStop.time >= bestDestinationArrival)
+                continue;
+
+            bestDestinationArrival = stopArrivalTime + egressStop.time;
+            bestRound = round;
+            bestEgressStopIndex = egressStop.stopIndex;
+        }
+    }
+
+    if (bestDestinationArrival == Unreached)
+        return false;
+
+    outJourney = Journey();
+    outJourney.arrivalTime = bestDestinationArrival;
+    if (bestRound < 0)
+    {
+        Leg walk;
+        walk.departureTime = departureTime;
+        walk.arrivalTime = bestDestinationArrival;
+        outJourney.legs.push_back(walk);
+        return true;
+    }
+
+    Leg egressWalk;
+    egressWalk.fromStop = network->stops[bestEgressStopIndex];
+    egressWalk.departureTime = arrivalTimes[bestRound * stopsCount + bestEgressStopIndex];
+    egressWalk.arrivalTime = bestDestinationArrival;
+    outJourney.legs.push_front(egressWalk);
+
+    auto round = bestRound;
+    auto stopIndex = bestEgressStopIndex;
+    for (;;)
+    {
+        const auto& label = labels[round * stopsCount + stopIndex];
+
+        Leg leg;
+        leg.toStop = network->stops[stopIndex];
+        leg.departureTime = label.departureTime;
+        leg.arrivalTime = arrivalTimes[round * stopsCount + stopIndex];
+        if (label.type == LabelType::Access)
+        {
+            outJourney.legs.push_front(leg);
+            break;
+        }
+
+        leg.fromStop = network->stops[label.fromStopIndex];
+        if (label.type == LabelType::Ride)
+        {
+            leg.route = network->routes[label.routeIndex];
+            outJourney.ridesCount++;
+            round--;
+        }
+        outJourney.legs.push_front(leg);
+        stopIndex = label.fromStopIndex;
+    }
+
+    return true;
+}
@@ -0,0 +1,278 @@
+#include "TransportNetwork.h"
+
+#include <algorithm>
+#include <cmath>
+
+#include "QtCommon.h"
+#include "ignore_warnings_on_external_includes.h"
+#include <QHash>
+#include <QMutex>
+#include "restore_internal_warnings.h"
+
+#include "ObfReader.h"
+#include "ObfTransportSectionInfo.h"
+#include "ObfTransportSectionInfo_P.h"
+#include "ObfTransportSectionReader.h"
+#include "TransportStop.h"
+#include "TransportRoute.h"
+#include "IQueryController.h"
+#include "Utilities.h"
+
+const double OsmAnd::TransportNetwork::WalkingSpeed = 1.2;
+
+OsmAnd::TransportNetwork::TransportNetwork()
+{
+}
+
+OsmAnd::TransportNetwork::~TransportNetwork()
+{
+}
+
+double OsmAnd::TransportNetwork::getAverageSpeed(const TransportRoute& route)
+{
+    // OBF transport routes have no timetables, so travel time is estimated from distance
+    // with average speed of the kind of transport, in km/h
+    double speed = 18.0;
+    if (route.type == QLatin1String("subway"))
+        speed = 36.0;
+    else if (route.type == QLatin1String("train") || route.type == QLatin1String("railway"))
+        speed = 50.0;
+    else if (route.type == QLatin1String("light_rail") || route.type == QLatin1String("monorail"))
+        speed = 30.0;
+    else if (route.type == QLatin1String("share_taxi"))
+        speed = 20.0;
+    else if (route.type == QLatin1String("trolleybus"))
+        speed = 16.0;
+    else if (route.type == QLatin1String("tram"))
+        speed = 15.0;
+    else if (route.type == QLatin1String("funicular"))
+        speed = 10.0;
+
+    return speed / 3.6;
+}
+
+void OsmAnd::TransportNetwork::buildStopRoutes()
+{
+    const auto stopsCount = stops.size();
+    _stopRoutesOffsets.fill(0, stopsCount + 1);
+    for (const auto stopIndex : constOf(_routeStops))
+        _stopRoutesOffsets[stopIndex + 1]++;
+    for (auto stopIndex = 0; stopIndex < stopsCount; stopIndex++)
+        _stopRoutesOffsets[stopIndex + 1] += _stopRoutesOffsets[stopIndex];
+
+    _stopRoutes.resize(_routeStops.size());
+    auto insertPositions = _stopRoutesOffsets;
+    for (auto routeIndex = 0, routesCount = routes.size(); routeIndex < routesCount; routeIndex++)
+    {
+        const auto routeStopsOffset = _routeStopsOffsets[routeIndex];
+        for (auto position = 0, routeStopsCount = _routeStopsOffsets[routeIndex + 1] - routeStopsOffset;
+            position < routeStopsCount;
+            position++)
+        {
+            RouteStop routeStop;
+            routeStop.routeIndex = routeIndex;
+            routeStop.position = position;
+            _stopRoutes[insertPositions[_routeStops[routeStopsOffset + position]]++] = routeStop;
+        }
+    }
+}
+
+void OsmAnd::TransportNetwork::buildTransfers()
+{
+    const auto stopsCount = stops.size();
+    _stopsByX31.resize(stopsCount);
+    for (auto stopIndex = 0; stopIndex < stopsCount; stopIndex++)
+        _stopsByX31[stopIndex] = stopIndex;
+    std::sort(_stopsByX31.begin(), _stopsByX31.end(),
+        [this]
+        (const int l, const int r) -> bool
+        {
+            return stopsPositions31[l].x < stopsPositions31[r].x;
+        });
+
+    _transfersOffsets.fill(0, stopsCount + 1);
+    QVector<Transfer> stopsAround;
+    for (auto stopIndex = 0; stopIndex < stopsCount; stopIndex++)
+    {
+        findStopsAround(stopsPositions31[stopIndex], TransfersRadius, stopsAround);
+        for (const auto& stopAround : constOf(stopsAround))
+        {
+            if (stopAround.stopIndex != stopIndex)
+                _transfers.push_back(stopAround);
+        }
+        _transfersOffsets[stopIndex + 1] = _transfers.size();
+    }
+}
+
+void OsmAnd::TransportNetwork::findStopsAround(
+    const PointI& point31,
+    const double radiusInMeters,
+    QVector<Transfer>& outStops) const
+{
+    outStops.clear();
+
+    const auto radiusX31 = Utilities::metersToX31(radiusInMeters);
+    const auto radiusY31 = Utilities::metersToY31(radiusInMeters);
+    const auto itFirst = std::lower_bound(_stopsByX31.cbegin(), _stopsByX31.cend(), point31.x - radiusX31,
+        [this]
+        (const int stopIndex, const int64_t x31) -> bool
+        {
+            return stopsPositions31[stopIndex].x < x31;
+        });
+    for (auto itStop = itFirst; itStop != _stopsByX31.cend(); ++itStop)
+    {
+        const auto& position31 = stopsPositions31[*itStop];
+        if (position31.x > point31.x + radiusX31)
+            break;
+        if (qAbs(static_cast<int64_t>(position31.y) - point31.y) > radiusY31)
+            continue;
+
+        const auto distance = Utilities::distance31(point31, position31);
+        if (distance > radiusInMeters)
+            continue;
+
+        Transfer stop;
+        stop.stopIndex = *itStop;
+        stop.time = static_cast<int>(std::ceil(distance / WalkingSpeed));
+        outStops.push_back(stop);
+    }
+}
+
+std::shared_ptr<const OsmAnd::TransportNetwork> OsmAnd::TransportNetwork::build(
+    const std::shared_ptr<const ObfReader>& reader,
+    const std::shared_ptr<const ObfTransportSectionInfo>& section,
+    const std::shared_ptr<const IQueryController>& queryController /*= nullptr*/)
+{
+    const auto stringTable = std::make_shared<ObfSectionInfo::StringTable>();
+
+    // Stops are read in coordinates of their own zoom, largest area covers all of them
+    QList< std::shared_ptr<const TransportStop> > sectionStops;
+    const auto bbox = AreaI::largestPositive();
+    ObfTransportSectionReader::searchTransportStops(reader, section, &sectionStops, &bbox, stringTable.get(), nullptr, queryController);
+    if (queryController && queryController->isAborted())
+        return nullptr;
+
+    QVector<uint32_t> routesOffsets;
+    for (const auto& stop : constOf(sectionStops))
+    {
+        for (const auto routeOffset : constOf(stop->referencesToRoutes))
+        {
+            if (routeOffset >= section->offset && routeOffset - section->offset < section->length)
+                routesOffsets.push_back(routeOffset);
+        }
+    }
+
+    // Many stops refer to the same route, reading routes in file order also keeps seeks short
+    std::sort(routesOffsets.begin(), routesOffsets.end());
+    routesOffsets.erase(std::unique(routesOffsets.begin(), routesOffsets.end()), routesOffsets.end());
+    QList< std::shared_ptr<TransportRoute> > sectionRoutes;
+    for (const auto routeOffset : constOf(routesOffsets))
+    {
+        if (queryController && queryController->isAborted())
+            return nullptr;
+
+        const auto route = ObfTransportSectionReader::getTransportRoute(reader, section, routeOffset, stringTable.get(), false);
+        if (route && route->forwardStops.size() > 1)
+            sectionRoutes.push_back(route);
+    }
+    ObfTransportSectionReader::initializeStringTable(reader, section, stringTable.get());
+    QList< std::shared_ptr<const TransportRoute> > routes;
+    for (const auto& route : constOf(sectionRoutes))
+    {
+        ObfTransportSectionReader::initializeNames(false, stringTable.get(), route);
+        routes.push_back(route);
+    }
+
+    return build(sectionStops, routes);
+}
+
+std::shared_ptr<const OsmAnd::TransportNetwork> OsmAnd::TransportNetwork::build(
+    const QList< std::shared_ptr<const TransportStop> >& stops,
+    const QList< std::shared_ptr<const TransportRoute> >& routes)
+{
+    const std::shared_ptr<TransportNetwork> network(new TransportNetwork());
+
+    QHash<uint64_t, int> stopsIndices;
+    const auto registerStop =
+        [&network, &stopsIndices]
+        (const std::shared_ptr<const TransportStop>& stop) -> int
+        {
+            const auto citStopIndex = stopsIndices.constFind(stop->id.id);
+            if (citStopIndex != stopsIndices.cend())
+                return *citStopIndex;
+
+            const auto stopIndex = network->stops.size();
+            stopsIndices.insert(stop->id.id, stopIndex);
+            network->stops.push_back(stop);
+            network->stopsPositions31.push_back(PointI(
+                Utilities::get31TileNumberX(stop->location.longitude),
+                Utilities::get31TileNumberY(stop->location.latitude)));
+            return stopIndex;
+        };
+    for (const auto& stop : constOf(stops))
+        registerStop(stop);
+
+    network->_routeStopsOffsets.push_back(0);
+    for (const auto& route : constOf(routes))
+    {
+        if (route->forwardStops.size() <= 1)
+            continue;
+
+        // Vehicle goes along streets, so straight distances between stops are stretched to
+        // match length of the whole route, when it is known
+        auto straightDistance = 0.0;
+        for (auto position = 1; position < route->forwardStops.size(); position++)
+            straightDistance += Utilities::distance(route->forwardStops[position - 1]->location, route->forwardStops[position]->location);
+        auto stretchFactor = 1.0;
+        if (route->dist > 0 && straightDistance > 0.0)
+            stretchFactor = qBound(1.0, route->dist / straightDistance, 2.0);
+        const auto speed = getAverageSpeed(*route);
+
+        auto time = 0.0;
+        for (auto position = 0; position < route->forwardStops.size(); position++)
+        {
+            const auto& stop = route->forwardStops[position];
+            if (position > 0)
+            {
+                const auto distance = Utilities::distance(route->forwardStops[position - 1]->location, stop->location);
+                time += distance * stretchFactor / speed;
+                if (position > 1)
+                    time += DwellTime;
+            }
+
+            network->_routeStops.push_back(registerStop(stop));
+            network->_routeStopsTimes.push_back(static_cast<int>(std::ceil(time)));
+        }
+        network->_routeStopsOffsets.push_back(network->_routeStops.size());
+        network->routes.push_back(route);
+    }
+
+    network->buildStopRoutes();
+    network->buildTransfers();
+
+    return network;
+}
+
+std::shared_ptr<const OsmAnd::TransportNetwork> OsmAnd::TransportNetwork::obtain(
+    const std::shared_ptr<const ObfReader>& reader,
+    const std::shared_ptr<const ObfTransportSectionInfo>& section,
+    const std::shared_ptr<const IQueryController>& queryController /*= nullptr*/)
+{
+    if (section->_p->_networkBuilt.loadAcquire() != 0)
+        return section->_p->_network;
+
+    // Other thread that builds network of same section is waited for instead of building it twice
+    QMutexLocker scopedLocker(&section->_p->_networkBuildMutex);
+    if (section->_p->_network)
+        return section->_p->_network;
+
+    // Aborted build leaves nothing, so next caller builds network again
+    const auto network = build(reader, section, queryController);
+    if (!network)
+        return nullptr;
+    section->_p->_network = network;
+
+    section->_p->_networkBuilt.storeRelease(1);
+
+    return network;
+}
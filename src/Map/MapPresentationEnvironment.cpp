@@ -142,4 +142,10 @@ QHash<QString, int> OsmAnd::MapPresentationEnvironment::getGpxColors() const
     return _p->getGpxColors();
 }
 
-
+bool OsmAnd::MapPresentationEnvironment::mayProducePrimitives(
+    const ZoomLevel zoom,
+    const std::shared_ptr<const MapObject::AttributeMapping>& attributeMapping,
+    const QVector<uint32_t>& attributeIds) const
+{
+    return _p->mayProducePrimitives(zoom, attributeMapping, attributeIds);
+}
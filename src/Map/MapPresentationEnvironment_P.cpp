@@ -23,7 +23,8 @@
 #include "Logging.h"
 
 OsmAnd::MapPresentationEnvironment_P::MapPresentationEnvironment_P(MapPresentationEnvironment* owner_)
-    : owner(owner_)
+    : _objectSpecificOrderRulesCollected(false)
+    , owner(owner_)
 {
 }
 
@@ -70,9 +71,18 @@ QHash< OsmAnd::IMapStyle::ValueDefinitionId, OsmAnd::MapStyleConstantValue > Osm
 
 void OsmAnd::MapPresentationEnvironment_P::setSettings(const QHash< OsmAnd::IMapStyle::ValueDefinitionId, MapStyleConstantValue >& newSettings)
 {
-    QMutexLocker scopedLocker(&_settingsChangeMutex);
+    {
+        QMutexLocker scopedLocker(&_settingsChangeMutex);
+
+        _settings = newSettings;
+    }
 
-    _settings = newSettings;
+    // Settings may hide or show whole layers, so everything evaluated so far is stale
+    {
+        QWriteLocker scopedLocker(&_renderableAttributesLock);
+
+        _renderableAttributes.clear();
+    }
 }
 
 void OsmAnd::MapPresentationEnvironment_P::setSettings(const QHash< QString, QString >& newSettings)
@@ -538,3 +548,178 @@ QHash<QString, int> OsmAnd::MapPresentationEnvironment_P::getGpxColors() const
     }
     return result;
 }
+
+bool OsmAnd::MapPresentationEnvironment_P::mayProducePrimitives(
+    const ZoomLevel zoom,
+    const std::shared_ptr<const MapObject::AttributeMapping>& attributeMapping,
+    const QVector<uint32_t>& attributeIds) const
+{
+    if (!attributeMapping)
+        return true;
+
+    // Coastlines and land are used to fill tile background even if they are not drawn themselves
+    for (const auto attributeId : constOf(attributeIds))
+    {
+        if (attributeId == attributeMapping->naturalCoastlineAttributeId ||
+            attributeId == attributeMapping->naturalLandAttributeId ||
+            attributeId == attributeMapping->naturalCoastlineBrokenAttributeId ||
+            attributeId == attributeMapping->naturalCoastlineLineAttributeId)
+        {
+            return true;
+        }
+    }
+
+    {
+        QReadLocker scopedLocker(&_renderableAttributesLock);
+
+        const auto citRenderableAttributes = _renderableAttributes.constFind(attributeMapping.get());
+        if (citRenderableAttributes != _renderableAttributes.cend())
+        {
+            const auto& renderableAttributes = citRenderableAttributes->byZoom[zoom];
+
+            bool allEvaluated = true;
+            for (const auto attributeId : constOf(attributeIds))
+            {
+                const auto renderable = attributeId < renderableAttributes.size()
+                    ? renderableAttributes[attributeId]
+                    : 0;
+                if (renderable > 0)
+                    return true;
+                else if (renderable == 0)
+                    allEvaluated = false;
+            }
+            if (allEvaluated)
+                return false;
+        }
+    }
+
+    QWriteLocker scopedLocker(&_renderableAttributesLock);
+
+    auto& renderableAttributesEntry = _renderableAttributes[attributeMapping.get()];
+    renderableAttributesEntry.attributeMapping = attributeMapping;
+    auto& renderableAttributes = renderableAttributesEntry.byZoom[zoom];
+
+    bool mayProduce = false;
+    for (const auto attributeId : constOf(attributeIds))
+    {
+        if (attributeId >= renderableAttributes.size())
+            renderableAttributes.resize(attributeId + 1);
+
+        auto& renderable = renderableAttributes[attributeId];
+        if (renderable == 0)
+        {
+            // Unknown attributes are kept, same as they would be by primitiviser
+            const auto pAttribute = attributeMapping->decodeMap.getRef(attributeId);
+            renderable = (!pAttribute || evaluateMayProducePrimitives(zoom, *pAttribute)) ? 1 : -1;
+        }
+
+        if (renderable > 0)
+            mayProduce = true;
+    }
+
+    return mayProduce;
+}
+
+bool OsmAnd::MapPresentationEnvironment_P::isRuleNodeObjectSpecific(
+    const std::shared_ptr<const IMapStyle::IRuleNode>& ruleNode) const
+{
+    const auto& builtinValueDefs = owner->styleBuiltinValueDefs;
+
+    for (const auto& ruleValueEntry : rangeOf(constOf(ruleNode->getValuesRef())))
+    {
+        if (ruleValueEntry.key() == builtinValueDefs->id_INPUT_ADDITIONAL)
+            return true;
+
+        const auto& ruleValue = ruleValueEntry.value();
+        if (ruleValue.isDynamic && isRuleNodeObjectSpecific(ruleValue.asDynamicValue.attribute->getRootNodeRef()))
+            return true;
+    }
+
+    for (const auto& subnode : constOf(ruleNode->getOneOfConditionalSubnodesRef()))
+    {
+        if (isRuleNodeObjectSpecific(subnode))
+            return true;
+    }
+
+    for (const auto& subnode : constOf(ruleNode->getApplySubnodesRef()))
+    {
+        if (isRuleNodeObjectSpecific(subnode))
+            return true;
+    }
+
+    return false;
+}
+
+void OsmAnd::MapPresentationEnvironment_P::collectObjectSpecificOrderRules() const
+{
+    if (_objectSpecificOrderRulesCollected)
+        return;
+
+    const auto& ruleset = owner->mapStyle->getRuleset(MapStyleRulesetType::Order);
+    for (const auto& ruleEntry : rangeOf(constOf(ruleset)))
+    {
+        if (isRuleNodeObjectSpecific(ruleEntry.value()->getRootNodeRef()))
+            _objectSpecificOrderRules.insert(ruleEntry.key());
+    }
+
+    _objectSpecificOrderRulesCollected = true;
+}
+
+bool OsmAnd::MapPresentationEnvironment_P::evaluateMayProducePrimitives(
+    const ZoomLevel zoom,
+    const MapObject::AttributeMapping::TagValue& attribute) const
+{
+    const auto& builtinValueDefs = owner->styleBuiltinValueDefs;
+
+    // Rules that test other attributes of the object can not be evaluated without the object itself
+    collectObjectSpecificOrderRules();
+    MapStyleConstantValue tagId;
+    if (!owner->mapStyle->parseValue(attribute.tag, builtinValueDefs->id_INPUT_TAG, tagId))
+        tagId.asSimple.asUInt = std::numeric_limits<uint32_t>::max();
+    MapStyleConstantValue valueId;
+    if (!owner->mapStyle->parseValue(attribute.value, builtinValueDefs->id_INPUT_VALUE, valueId))
+        valueId.asSimple.asUInt = std::numeric_limits<uint32_t>::max();
+    if (_objectSpecificOrderRules.contains(TagValueId::compose(tagId.asSimple.asUInt, valueId.asSimple.asUInt)) ||
+        _objectSpecificOrderRules.contains(TagValueId::compose(tagId.asSimple.asUInt, IMapStyle::EmptyStringId)) ||
+        _objectSpecificOrderRules.contains(TagValueId::compose(IMapStyle::EmptyStringId, IMapStyle::EmptyStringId)))
+    {
+        return true;
+    }
+
+    // Otherwise order depends only on tag, value, zoom and shape of the object, so try all shapes
+    MapStyleEvaluator orderEvaluator(owner->mapStyle, owner->displayDensityFactor * owner->mapScaleFactor);
+    applyTo(orderEvaluator);
+    orderEvaluator.setIntegerValue(builtinValueDefs->id_INPUT_MINZOOM, zoom);
+    orderEvaluator.setIntegerValue(builtinValueDefs->id_INPUT_MAXZOOM, zoom);
+    orderEvaluator.setStringValue(builtinValueDefs->id_INPUT_TAG, attribute.tag);
+    orderEvaluator.setStringValue(builtinValueDefs->id_INPUT_VALUE, attribute.value);
+
+    MapStyleEvaluationResult evaluationResult;
+    for (int layer = static_cast<int>(MapObject::LayerType::Negative);
+        layer <= static_cast<int>(MapObject::LayerType::Positive);
+        layer++)
+    {
+        orderEvaluator.setIntegerValue(builtinValueDefs->id_INPUT_LAYER, layer);
+        for (int shape = 0; shape < 8; shape++)
+        {
+            orderEvaluator.setBooleanValue(builtinValueDefs->id_INPUT_AREA, (shape & 1) != 0);
+            orderEvaluator.setBooleanValue(builtinValueDefs->id_INPUT_POINT, (shape & 2) != 0);
+            orderEvaluator.setBooleanValue(builtinValueDefs->id_INPUT_CYCLE, (shape & 4) != 0);
+
+            evaluationResult.clear();
+            if (!orderEvaluator.evaluate(std::shared_ptr<const MapObject>(), MapStyleRulesetType::Order, &evaluationResult))
+                continue;
+
+            int objectType;
+            int order;
+            if (evaluationResult.getIntegerValue(builtinValueDefs->id_OUTPUT_OBJECT_TYPE, objectType) &&
+                evaluationResult.getIntegerValue(builtinValueDefs->id_OUTPUT_ORDER, order) &&
+                order >= 0)
+            {
+                return true;
+            }
+        }
+    }
+
+    return false;
+}
@@ -2,12 +2,16 @@
 #define _OSMAND_CORE_MAP_PRESENTATION_ENVIRONMENT_P_H_
 
 #include "stdlib_common.h"
+#include <array>
 
 #include "QtExtensions.h"
 #include "ignore_warnings_on_external_includes.h"
 #include <QMap>
 #include <QHash>
 #include <QMutex>
+#include <QReadWriteLock>
+#include <QSet>
+#include <QVector>
 #include "restore_internal_warnings.h"
 
 #include "ignore_warnings_on_external_includes.h"
@@ -20,6 +24,7 @@
 #include "MapStyleConstantValue.h"
 #include "MapRasterizer.h"
 #include "MapPresentationEnvironment.h"
+#include "MapObject.h"
 
 class SkBitmap;
 
@@ -85,6 +90,22 @@ namespace OsmAnd
         mutable QMutex _iconShieldsMutex;
         mutable QHash< QString, std::shared_ptr<const SkBitmap> > _iconShields;
 
+        // Per attribute mapping and zoom, whether decoded attribute may produce primitives:
+        // 0 if not yet evaluated, 1 if it may, -1 if it surely does not
+        struct RenderableAttributes
+        {
+            std::shared_ptr<const MapObject::AttributeMapping> attributeMapping;
+            std::array< QVector<int8_t>, ZoomLevelsCount > byZoom;
+        };
+        mutable QReadWriteLock _renderableAttributesLock;
+        mutable QHash< const MapObject::AttributeMapping*, RenderableAttributes > _renderableAttributes;
+        mutable bool _objectSpecificOrderRulesCollected;
+        mutable QSet<TagValueId> _objectSpecificOrderRules;
+
+        bool isRuleNodeObjectSpecific(const std::shared_ptr<const IMapStyle::IRuleNode>& ruleNode) const;
+        void collectObjectSpecificOrderRules() const;
+        bool evaluateMayProducePrimitives(const ZoomLevel zoom, const MapObject::AttributeMapping::TagValue& attribute) const;
+
         QByteArray obtainResourceByName(const QString& name) const;
     public:
         virtual ~MapPresentationEnvironment_P();
@@ -115,6 +136,11 @@ namespace OsmAnd
         QHash<QString, int> getLineRenderingAttributes(const QString& renderAttrName) const;
         QHash<QString, int> getGpxColors() const;
 
+        bool mayProducePrimitives(
+            const ZoomLevel zoom,
+            const std::shared_ptr<const MapObject::AttributeMapping>& attributeMapping,
+            const QVector<uint32_t>& attributeIds) const;
+
     friend class OsmAnd::MapPresentationEnvironment;
     };
 }
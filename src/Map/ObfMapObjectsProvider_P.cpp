@@ -7,6 +7,7 @@
 #endif // !defined(OSMAND_PERFORMANCE_METRICS)
 
 #include "MapDataProviderHelpers.h"
+#include "MapPresentationEnvironment.h"
 #include "ObfsCollection.h"
 #include "ObfDataInterface.h"
 #include "ObfMapSectionInfo.h"
@@ -223,6 +224,21 @@ bool OsmAnd::ObfMapObjectsProvider_P::obtainTiledObfMapObjects(
 
             return true;
         };
+    ObfMapSectionReader::FilterByAttributesFunction binaryMapObjectsAttributesFilteringFunctor;
+    if (const auto environment = owner->environment)
+    {
+        binaryMapObjectsAttributesFilteringFunctor =
+            [environment]
+            (const std::shared_ptr<const ObfMapSectionInfo>& section,
+                const QVector<uint32_t>& attributeIds,
+                const ZoomLevel requestedZoomLevel) -> bool
+            {
+                return environment->mayProducePrimitives(
+                    requestedZoomLevel,
+                    section->getAttributeMapping(),
+                    attributeIds);
+            };
+    }
 
     // Roads:
     QList< std::shared_ptr< const ObfRoutingSectionReader::DataBlock > > referencedRoadsDataBlocks;
@@ -329,7 +345,9 @@ bool OsmAnd::ObfMapObjectsProvider_P::obtainTiledObfMapObjects(
             _binaryMapObjectsDataBlocksCache.get(),
             &referencedBinaryMapObjectsDataBlocks,
             nullptr,// query queryController
-            loadMapObjectsMetric.get());
+            loadMapObjectsMetric.get(),
+            binaryMapObjectsAttributesFilteringFunctor,
+            owner->environment != nullptr);
     }
     else if (owner->mode == ObfMapObjectsProvider::Mode::OnlyRoads)
     {
@@ -380,7 +398,9 @@ bool OsmAnd::ObfMapObjectsProvider_P::obtainTiledObfMapObjects(
             &referencedRoadsDataBlocks,
             nullptr,// query queryController
             loadMapObjectsMetric.get(),
-            loadRoadsMetric.get());
+            loadRoadsMetric.get(),
+            binaryMapObjectsAttributesFilteringFunctor,
+            owner->environment != nullptr);
     }
 
     // Process loaded-and-shared map objects (both binary and roads)
@@ -0,0 +1,66 @@
+#include "MemoryInputStream.h"
+
+namespace OsmAnd
+{
+    namespace gpb = google::protobuf;
+}
+
+OsmAnd::MemoryInputStream::MemoryInputStream(
+    const std::shared_ptr<const void>& memoryOwner_,
+    const uint8_t* const data_,
+    const qint64 size_)
+    : _memoryOwner(memoryOwner_)
+    , _data(data_)
+    , _size(size_)
+    , _currentPosition(0)
+{
+}
+
+OsmAnd::MemoryInputStream::~MemoryInputStream()
+{
+}
+
+bool OsmAnd::MemoryInputStream::Next(const void** data, int* size)
+{
+    if (Q_UNLIKELY(_currentPosition < 0 || _currentPosition >= _size))
+    {
+        *data = nullptr;
+        *size = 0;
+        return false;
+    }
+
+    // Whole remaining block is returned at once, limited by what protobuf can address
+    auto availableSize = _size - _currentPosition;
+    if (availableSize > std::numeric_limits<int>::max())
+        availableSize = std::numeric_limits<int>::max();
+
+    *data = _data + _currentPosition;
+    *size = static_cast<int>(availableSize);
+    _currentPosition += availableSize;
+    return true;
+}
+
+void OsmAnd::MemoryInputStream::BackUp(int count)
+{
+    if (count > _currentPosition)
+        _currentPosition = 0;
+    else
+        _currentPosition -= count;
+}
+
+bool OsmAnd::MemoryInputStream::Skip(int count)
+{
+    if (Q_UNLIKELY(_currentPosition + count > _size))
+    {
+        _currentPosition = _size;
+        return false;
+    }
+
+    _currentPosition += count;
+    return true;
+}
+
+OsmAnd::gpb::int64 OsmAnd::MemoryInputStream::ByteCount() const
+{
+    return static_cast<gpb::int64>(_currentPosition);
+}
@@ -13,8 +13,10 @@
 #include "ObfReader.h"
 #include "ObfInfo.h"
 #include "ObfMapSectionReader.h"
+#include "ObfMapSectionReader_Metrics.h"
 #include "ObfMapSectionInfo.h"
 #include "ObfRoutingSectionReader.h"
+#include "ObfRoutingSectionReader_Metrics.h"
 #include "ObfRoutingSectionInfo.h"
 #include "ObfPoiSectionReader.h"
 #include "ObfPoiSectionInfo.h"
@@ -28,12 +30,19 @@
 #include "Street.h"
 #include "TransportStop.h"
 #include "TransportRoute.h"
+#include "TransportNetwork.h"
+#include "TransportStopsInAreaSearch.h"
 #include "IQueryController.h"
 #include "FunctorQueryController.h"
 #include "QKeyValueIterator.h"
+#include "Utilities.h"
+#include "Logging.h"
 
-OsmAnd::ObfDataInterface::ObfDataInterface(const QList< std::shared_ptr<const ObfReader> >& obfReaders_)
+OsmAnd::ObfDataInterface::ObfDataInterface(
+    const QList< std::shared_ptr<const ObfReader> >& obfReaders_,
+    const std::shared_ptr<Concurrent::WorkerPool>& workerPool_ /*= nullptr*/)
     : obfReaders(obfReaders_)
+    , workerPool(workerPool_)
 {
 }
 
@@ -41,6 +50,102 @@ OsmAnd::ObfDataInterface::~ObfDataInterface()
 {
 }
 
+template<typename RESULT, typename... ARGS>
+std::function<RESULT (ARGS...)> OsmAnd::ObfDataInterface::serializedCallback(
+    const std::function<RESULT (ARGS...)>& callback) const
+{
+    if (!workerPool || !callback)
+        return callback;
+
+    const auto mutex = &_callbacksMutex;
+    return
+        [callback, mutex]
+        (ARGS... args) -> RESULT
+        {
+            QMutexLocker scopedLocker(mutex);
+            return callback(args...);
+        };
+}
+
+OsmAnd::ObfMapSectionReader::FilterByAttributesFunction OsmAnd::ObfDataInterface::requestedZoomOf(
+    const ObfMapSectionReader::FilterByAttributesFunction& filterByAttributes,
+    const ZoomLevel requestedZoom)
+{
+    if (!filterByAttributes)
+        return filterByAttributes;
+
+    // Basemap is read from less detailed zoom than requested, while objects are going to be shown on requested one
+    return
+        [filterByAttributes, requestedZoom]
+        (const std::shared_ptr<const ObfMapSectionInfo>& section,
+        const QVector<uint32_t>& attributeIds,
+        const ZoomLevel readZoom) -> bool
+        {
+            return filterByAttributes(section, attributeIds, requestedZoom);
+        };
+}
+
+bool OsmAnd::ObfDataInterface::canReadSectionsConcurrently(const std::shared_ptr<const ObfReader>& obfReader) const
+{
+    // Only memory-mapped reader can be used from several threads at once, other readers
+    // belong to thread that leased them
+    return workerPool && obfReader->memoryMapped;
+}
+
+template<typename SECTION_INFO, typename RESULT, typename READ_SECTION>
+void OsmAnd::ObfDataInterface::readSections(
+    const QList< SectionEntry<SECTION_INFO> >& sections,
+    QVector<RESULT>& outResults,
+    const READ_SECTION readSection,
+    const std::shared_ptr<const IQueryController>& queryController) const
+{
+    // Each section has result of its own, so that they can be merged in order of sections
+    outResults.clear();
+    outResults.resize(sections.size());
+    const auto results = outResults.data();
+    const auto readSectionAt =
+        [&sections, results, &readSection, &queryController]
+        (const int sectionIndex)
+        {
+            if (queryController && queryController->isAborted())
+                return;
+
+            const auto& section = sections[sectionIndex];
+            readSection(section.first, section.second, results[sectionIndex]);
+        };
+
+    // Sections of readers bound to a thread are read by calling thread, the rest by workers
+    QVector<Concurrent::WorkerPool::Job> jobs;
+    QVector<int> callingThreadSectionsIndices;
+    for (auto sectionIndex = 0, sectionsCount = sections.size(); sectionIndex < sectionsCount; sectionIndex++)
+    {
+        if (!canReadSectionsConcurrently(sections[sectionIndex].first))
+        {
+            callingThreadSectionsIndices.push_back(sectionIndex);
+            continue;
+        }
+
+        jobs.push_back(
+            [readSectionAt, sectionIndex]
+            ()
+            {
+                readSectionAt(sectionIndex);
+            });
+    }
+    const auto readCallingThreadSections =
+        [&readSectionAt, &callingThreadSectionsIndices]
+        ()
+        {
+            for (const auto sectionIndex : constOf(callingThreadSectionsIndices))
+                readSectionAt(sectionIndex);
+        };
+
+    if (jobs.isEmpty())
+        readCallingThreadSections();
+    else
+        workerPool->executeAndWait(jobs, readCallingThreadSections);
+}
+
 bool OsmAnd::ObfDataInterface::loadObfFiles(
     QList< std::shared_ptr<const ObfFile> >* outFiles /*= nullptr*/,
     const std::shared_ptr<const IQueryController>& queryController /*= nullptr*/)
@@ -69,11 +174,12 @@ bool OsmAnd::ObfDataInterface::loadBinaryMapObjects(
     ObfMapSectionReader::DataBlocksCache* cache /*= nullptr*/,
     QList< std::shared_ptr<const ObfMapSectionReader::DataBlock> >* outReferencedCacheEntries /*= nullptr*/,
     const std::shared_ptr<const IQueryController>& queryController /*= nullptr*/,
-    ObfMapSectionReader_Metrics::Metric_loadMapObjects* const metric /*= nullptr*/)
+    ObfMapSectionReader_Metrics::Metric_loadMapObjects* const metric /*= nullptr*/,
+    const ObfMapSectionReader::FilterByAttributesFunction filterByAttributes /*= nullptr*/,
+    const bool simplifyGeometry /*= false*/)
 {
-    auto mergedSurfaceType = MapSurfaceType::Undefined;
+    QList< SectionEntry<ObfMapSectionInfo> > mapSections;
     std::shared_ptr<const ObfReader> basemapReader;
-
     for (const auto& obfReader : constOf(obfReaders))
     {
         if (queryController && queryController->isAborted())
@@ -100,88 +206,262 @@ bool OsmAnd::ObfDataInterface::loadBinaryMapObjects(
         }
 
         for (const auto& mapSection : constOf(obfInfo->mapSections))
+            mapSections.push_back(SectionEntry<ObfMapSectionInfo>(obfReader, mapSection));
+    }
+
+    // In case there's basemap available and requested zoom is more detailed than basemap max zoom level,
+    // read tile from MaxBasemapZoomLevel that covers requested tile
+    std::shared_ptr<const ObfReader> lessDetailedBasemapReader;
+    const AreaI *pBasemapBBox31 = nullptr;
+    AreaI basemapBBox31;
+    if (basemapReader && zoom > static_cast<ZoomLevel>(ObfMapSectionLevel::MaxBasemapZoomLevel))
+    {
+        const auto& obfInfo = basemapReader->obtainInfo();
+
+        // Calculate proper bbox31 on MaxBasemapZoomLevel (if possible)
+        if (bbox31)
         {
-            if (queryController && queryController->isAborted())
-                return false;
+            pBasemapBBox31 = &basemapBBox31;
+            basemapBBox31 = Utilities::roundBoundingBox31(
+                *bbox31,
+                static_cast<ZoomLevel>(ObfMapSectionLevel::MaxBasemapZoomLevel));
+        }
+
+        lessDetailedBasemapReader = basemapReader;
+        for (const auto& mapSection : constOf(obfInfo->mapSections))
+            mapSections.push_back(SectionEntry<ObfMapSectionInfo>(basemapReader, mapSection));
+    }
+
+    // Read objects from each map section
+    struct MapSectionResult
+    {
+        MapSectionResult()
+            : surfaceType(MapSurfaceType::Undefined)
+        {
+        }
 
-            // Read objects from each map section
-            auto surfaceTypeToMerge = MapSurfaceType::Undefined;
+        QList< std::shared_ptr<const OsmAnd::BinaryMapObject> > mapObjects;
+        QList< std::shared_ptr<const ObfMapSectionReader::DataBlock> > referencedCacheEntries;
+        MapSurfaceType surfaceType;
+        ObfMapSectionReader_Metrics::Metric_loadMapObjects metric;
+    };
+    QVector<MapSectionResult> results;
+    const auto serializedFilterById = serializedCallback(filterById);
+    // Attribute filter only classifies types, so it's invoked concurrently without serialization
+    const auto filterByAttributesAtRequestedZoom = requestedZoomOf(filterByAttributes, zoom);
+    readSections(mapSections, results,
+        [zoom, bbox31, &lessDetailedBasemapReader, pBasemapBBox31, resultOut, &serializedFilterById, &filterByAttributesAtRequestedZoom, cache, outReferencedCacheEntries, &queryController, metric, simplifyGeometry]
+        (const std::shared_ptr<const ObfReader>& obfReader, const Ref<ObfMapSectionInfo>& mapSection, MapSectionResult& outResult)
+        {
+            const auto isLessDetailedBasemap = (obfReader == lessDetailedBasemapReader);
             OsmAnd::ObfMapSectionReader::loadMapObjects(
                 obfReader,
                 mapSection,
-                zoom,
-                bbox31,
-                resultOut,
-                &surfaceTypeToMerge,
-                filterById,
+                isLessDetailedBasemap ? static_cast<ZoomLevel>(ObfMapSectionLevel::MaxBasemapZoomLevel) : zoom,
+                isLessDetailedBasemap ? pBasemapBBox31 : bbox31,
+                resultOut ? &outResult.mapObjects : nullptr,
+                &outResult.surfaceType,
+                serializedFilterById,
                 nullptr,
                 cache,
-                outReferencedCacheEntries,
+                outReferencedCacheEntries ? &outResult.referencedCacheEntries : nullptr,
                 queryController,
-                metric);
-            if (surfaceTypeToMerge != MapSurfaceType::Undefined)
+                metric ? &outResult.metric : nullptr,
+                filterByAttributesAtRequestedZoom,
+                simplifyGeometry);
+        },
+        queryController);
+
+    // Merge results in same order as they would have been read sequentially
+    auto mergedSurfaceType = MapSurfaceType::Undefined;
+    for (auto sectionIndex = 0, sectionsCount = mapSections.size(); sectionIndex < sectionsCount; sectionIndex++)
+    {
+        const auto& result = results[sectionIndex];
+        if (resultOut)
+            resultOut->append(result.mapObjects);
+        if (outReferencedCacheEntries)
+            outReferencedCacheEntries->append(result.referencedCacheEntries);
+        if (metric)
+        {
+#define MERGE_METRIC_FIELD(type, name, measurement) metric->name += result.metric.name
+            OsmAnd__ObfMapSectionReader_Metrics__Metric_loadMapObjects__FIELDS(MERGE_METRIC_FIELD);
+#undef MERGE_METRIC_FIELD
+        }
+
+        // Basemap must always have a surface type defined
+        assert(mapSections[sectionIndex].first != lessDetailedBasemapReader || result.surfaceType != MapSurfaceType::Undefined);
+        if (result.surfaceType == MapSurfaceType::Undefined)
+            continue;
+
+        if (mergedSurfaceType == MapSurfaceType::Undefined)
+            mergedSurfaceType = result.surfaceType;
+        else if (mergedSurfaceType != result.surfaceType)
+            mergedSurfaceType = MapSurfaceType::Mixed;
+    }
+    if (queryController && queryController->isAborted())
+        return false;
+
+    // In case there was a basemap present, Undefined is Land
+    if (mergedSurfaceType == MapSurfaceType::Undefined && !basemapReader)
+        mergedSurfaceType = MapSurfaceType::FullLand;
+
+    if (outSurfaceType)
+        *outSurfaceType = mergedSurfaceType;
+
+    return true;
+}
+
+bool OsmAnd::ObfDataInterface::loadTiledBinaryMapObjects(
+    QVector< QList< std::shared_ptr<const OsmAnd::BinaryMapObject> > >* tilesResultsOut,
+    QVector<MapSurfaceType>* outTilesSurfaceTypes,
+    const ZoomLevel zoom,
+    const QVector<AreaI>& tilesBBoxes31,
+    const ObfMapSectionReader::FilterByIdFunction filterById /*= nullptr*/,
+    ObfMapSectionReader::DataBlocksCache* cache /*= nullptr*/,
+    QList< std::shared_ptr<const ObfMapSectionReader::DataBlock> >* outReferencedCacheEntries /*= nullptr*/,
+    const std::shared_ptr<const IQueryController>& queryController /*= nullptr*/,
+    ObfMapSectionReader_Metrics::Metric_loadMapObjects* const metric /*= nullptr*/,
+    const ObfMapSectionReader::FilterByAttributesFunction filterByAttributes /*= nullptr*/,
+    const bool simplifyGeometry /*= false*/)
+{
+    QList< SectionEntry<ObfMapSectionInfo> > mapSections;
+    std::shared_ptr<const ObfReader> basemapReader;
+    for (const auto& obfReader : constOf(obfReaders))
+    {
+        if (queryController && queryController->isAborted())
+            return false;
+
+        const auto& obfInfo = obfReader->obtainInfo();
+
+        // Handle main basemap
+        if (obfInfo->isBasemapWithCoastlines)
+        {
+            // In case there's more than 1 basemap reader present, use only first and warn about this fact
+            if (basemapReader)
             {
-                if (mergedSurfaceType == MapSurfaceType::Undefined)
-                    mergedSurfaceType = surfaceTypeToMerge;
-                else if (mergedSurfaceType != surfaceTypeToMerge)
-                    mergedSurfaceType = MapSurfaceType::Mixed;
+                LogPrintf(LogSeverityLevel::Warning, "More than 1 basemap available");
+                continue;
             }
+
+            // Save basemap reader for later use
+            basemapReader = obfReader;
+
+            // In case requested zoom is more detailed than basemap max zoom, skip basemap processing for now
+            if (zoom > static_cast<ZoomLevel>(ObfMapSectionLevel::MaxBasemapZoomLevel))
+                continue;
         }
+
+        for (const auto& mapSection : constOf(obfInfo->mapSections))
+            mapSections.push_back(SectionEntry<ObfMapSectionInfo>(obfReader, mapSection));
     }
 
     // In case there's basemap available and requested zoom is more detailed than basemap max zoom level,
-    // read tile from MaxBasemapZoomLevel that covers requested tile
+    // read tiles from MaxBasemapZoomLevel that cover requested tiles
+    std::shared_ptr<const ObfReader> lessDetailedBasemapReader;
+    QVector<AreaI> basemapTilesBBoxes31;
     if (basemapReader && zoom > static_cast<ZoomLevel>(ObfMapSectionLevel::MaxBasemapZoomLevel))
     {
         const auto& obfInfo = basemapReader->obtainInfo();
 
-        // Calculate proper bbox31 on MaxBasemapZoomLevel (if possible)
-        const AreaI *pBasemapBBox31 = nullptr;
-        AreaI basemapBBox31;
-        if (bbox31)
+        basemapTilesBBoxes31.reserve(tilesBBoxes31.size());
+        for (const auto& tileBBox31 : constOf(tilesBBoxes31))
         {
-            pBasemapBBox31 = &basemapBBox31;
-            basemapBBox31 = Utilities::roundBoundingBox31(
-                *bbox31,
-                static_cast<ZoomLevel>(ObfMapSectionLevel::MaxBasemapZoomLevel));
+            basemapTilesBBoxes31.push_back(Utilities::roundBoundingBox31(
+                tileBBox31,
+                static_cast<ZoomLevel>(ObfMapSectionLevel::MaxBasemapZoomLevel)));
         }
 
+        lessDetailedBasemapReader = basemapReader;
         for (const auto& mapSection : constOf(obfInfo->mapSections))
-        {
-            if (queryController && queryController->isAborted())
-                return false;
+            mapSections.push_back(SectionEntry<ObfMapSectionInfo>(basemapReader, mapSection));
+    }
 
-            // Read objects from each map section
-            auto surfaceTypeToMerge = MapSurfaceType::Undefined;
-            OsmAnd::ObfMapSectionReader::loadMapObjects(
-                basemapReader,
+    // Read objects from each map section
+    struct MapSectionResult
+    {
+        QVector< QList< std::shared_ptr<const OsmAnd::BinaryMapObject> > > tilesMapObjects;
+        QList< std::shared_ptr<const ObfMapSectionReader::DataBlock> > referencedCacheEntries;
+        QVector<MapSurfaceType> tilesSurfaceTypes;
+        ObfMapSectionReader_Metrics::Metric_loadMapObjects metric;
+    };
+    QVector<MapSectionResult> results;
+    const auto serializedFilterById = serializedCallback(filterById);
+    // Attribute filter only classifies types, so it's invoked concurrently without serialization
+    const auto filterByAttributesAtRequestedZoom = requestedZoomOf(filterByAttributes, zoom);
+    readSections(mapSections, results,
+        [zoom, &tilesBBoxes31, &lessDetailedBasemapReader, &basemapTilesBBoxes31, tilesResultsOut, &serializedFilterById, &filterByAttributesAtRequestedZoom, cache, outReferencedCacheEntries, &queryController, metric, simplifyGeometry]
+        (const std::shared_ptr<const ObfReader>& obfReader, const Ref<ObfMapSectionInfo>& mapSection, MapSectionResult& outResult)
+        {
+            const auto isLessDetailedBasemap = (obfReader == lessDetailedBasemapReader);
+            OsmAnd::ObfMapSectionReader::loadTiledMapObjects(
+                obfReader,
                 mapSection,
-                static_cast<ZoomLevel>(ObfMapSectionLevel::MaxBasemapZoomLevel),
-                pBasemapBBox31,
-                resultOut,
-                &surfaceTypeToMerge,
-                filterById,
-                nullptr,
+                isLessDetailedBasemap ? static_cast<ZoomLevel>(ObfMapSectionLevel::MaxBasemapZoomLevel) : zoom,
+                isLessDetailedBasemap ? basemapTilesBBoxes31 : tilesBBoxes31,
+                tilesResultsOut ? &outResult.tilesMapObjects : nullptr,
+                &outResult.tilesSurfaceTypes,
+                serializedFilterById,
                 cache,
-                outReferencedCacheEntries,
+                outReferencedCacheEntries ? &outResult.referencedCacheEntries : nullptr,
                 queryController,
-                metric);
+                metric ? &outResult.metric : nullptr,
+                filterByAttributesAtRequestedZoom,
+                simplifyGeometry);
+        },
+        queryController);
+
+    // Merge results in same order as they would have been read sequentially
+    const auto tilesCount = tilesBBoxes31.size();
+    if (tilesResultsOut)
+    {
+        tilesResultsOut->clear();
+        tilesResultsOut->resize(tilesCount);
+    }
+    QVector<MapSurfaceType> mergedTilesSurfaceTypes(tilesCount, MapSurfaceType::Undefined);
+    for (const auto& result : constOf(results))
+    {
+        if (tilesResultsOut && !result.tilesMapObjects.isEmpty())
+        {
+            for (auto tileIndex = 0; tileIndex < tilesCount; tileIndex++)
+                (*tilesResultsOut)[tileIndex].append(result.tilesMapObjects[tileIndex]);
+        }
+        if (outReferencedCacheEntries)
+            outReferencedCacheEntries->append(result.referencedCacheEntries);
+        if (metric)
+        {
+#define MERGE_METRIC_FIELD(type, name, measurement) metric->name += result.metric.name
+            OsmAnd__ObfMapSectionReader_Metrics__Metric_loadMapObjects__FIELDS(MERGE_METRIC_FIELD);
+#undef MERGE_METRIC_FIELD
+        }
+
+        for (auto tileIndex = 0; tileIndex < result.tilesSurfaceTypes.size(); tileIndex++)
+        {
+            const auto surfaceTypeToMerge = result.tilesSurfaceTypes[tileIndex];
+            if (surfaceTypeToMerge == MapSurfaceType::Undefined)
+                continue;
 
-            // Basemap must always have a surface type defined
-            assert(surfaceTypeToMerge != MapSurfaceType::Undefined);
+            auto& mergedSurfaceType = mergedTilesSurfaceTypes[tileIndex];
             if (mergedSurfaceType == MapSurfaceType::Undefined)
                 mergedSurfaceType = surfaceTypeToMerge;
             else if (mergedSurfaceType != surfaceTypeToMerge)
                 mergedSurfaceType = MapSurfaceType::Mixed;
         }
     }
+    if (queryController && queryController->isAborted())
+        return false;
 
     // In case there was a basemap present, Undefined is Land
-    if (mergedSurfaceType == MapSurfaceType::Undefined && !basemapReader)
-        mergedSurfaceType = MapSurfaceType::FullLand;
+    if (!basemapReader)
+    {
+        for (auto& mergedSurfaceType : mergedTilesSurfaceTypes)
+        {
+            if (mergedSurfaceType == MapSurfaceType::Undefined)
+                mergedSurfaceType = MapSurfaceType::FullLand;
+        }
+    }
 
-    if (outSurfaceType)
-        *outSurfaceType = mergedSurfaceType;
+    if (outTilesSurfaceTypes)
+        *outTilesSurfaceTypes = mergedTilesSurfaceTypes;
 
     return true;
 }
@@ -197,6 +477,7 @@ bool OsmAnd::ObfDataInterface::loadRoads(
     const std::shared_ptr<const IQueryController>& queryController /*= nullptr*/,
     ObfRoutingSectionReader_Metrics::Metric_loadRoads* const metric /*= nullptr*/)
 {
+    QList< RoutingSectionsEntry > routingSections;
     for (const auto& obfReader : constOf(obfReaders))
     {
         if (queryController && queryController->isAborted())
@@ -204,26 +485,75 @@ bool OsmAnd::ObfDataInterface::loadRoads(
 
         const auto& obfInfo = obfReader->obtainInfo();
         for (const auto& routingSection : constOf(obfInfo->routingSections))
-        {
-            if (queryController && queryController->isAborted())
-                return false;
+            routingSections.push_back(RoutingSectionsEntry(obfReader, routingSection));
+    }
+
+    return loadRoadsFromSections(
+        routingSections,
+        dataLevel,
+        bbox31,
+        resultOut,
+        filterById,
+        cache,
+        outReferencedCacheEntries,
+        queryController,
+        metric);
+}
 
+bool OsmAnd::ObfDataInterface::loadRoadsFromSections(
+    const QList< RoutingSectionsEntry >& routingSections,
+    const RoutingDataLevel dataLevel,
+    const AreaI* const bbox31,
+    QList< std::shared_ptr<const OsmAnd::Road> >* resultOut,
+    const FilterRoadsByIdFunction filterById,
+    ObfRoutingSectionReader::DataBlocksCache* cache,
+    QList< std::shared_ptr<const ObfRoutingSectionReader::DataBlock> >* outReferencedCacheEntries,
+    const std::shared_ptr<const IQueryController>& queryController,
+    ObfRoutingSectionReader_Metrics::Metric_loadRoads* const metric)
+{
+    struct RoutingSectionResult
+    {
+        QList< std::shared_ptr<const OsmAnd::Road> > roads;
+        QList< std::shared_ptr<const ObfRoutingSectionReader::DataBlock> > referencedCacheEntries;
+        ObfRoutingSectionReader_Metrics::Metric_loadRoads metric;
+    };
+    QVector<RoutingSectionResult> results;
+    const auto serializedFilterById = serializedCallback(filterById);
+    readSections(routingSections, results,
+        [dataLevel, bbox31, resultOut, &serializedFilterById, cache, outReferencedCacheEntries, &queryController, metric]
+        (const std::shared_ptr<const ObfReader>& obfReader, const Ref<ObfRoutingSectionInfo>& routingSection, RoutingSectionResult& outResult)
+        {
             OsmAnd::ObfRoutingSectionReader::loadRoads(
                 obfReader,
                 routingSection,
                 dataLevel,
                 bbox31,
-                resultOut,
-                filterById,
+                resultOut ? &outResult.roads : nullptr,
+                serializedFilterById,
                 nullptr,
                 cache,
-                outReferencedCacheEntries,
+                outReferencedCacheEntries ? &outResult.referencedCacheEntries : nullptr,
                 queryController,
-                metric);
+                metric ? &outResult.metric : nullptr);
+        },
+        queryController);
+
+    // Merge results in same order as they would have been read sequentially
+    for (const auto& result : constOf(results))
+    {
+        if (resultOut)
+            resultOut->append(result.roads);
+        if (outReferencedCacheEntries)
+            outReferencedCacheEntries->append(result.referencedCacheEntries);
+        if (metric)
+        {
+#define MERGE_METRIC_FIELD(type, name, measurement) metric->name += result.metric.name
+            OsmAnd__ObfRoutingSectionReader_Metrics__Metric_loadRoads__FIELDS(MERGE_METRIC_FIELD);
+#undef MERGE_METRIC_FIELD
         }
     }
 
-    return true;
+    return !(queryController && queryController->isAborted());
 }
 
 bool OsmAnd::ObfDataInterface::loadRoutingTreeNodes(
@@ -262,127 +592,41 @@ bool OsmAnd::ObfDataInterface::loadMapObjects(
     QList< std::shared_ptr<const ObfRoutingSectionReader::DataBlock> >* outReferencedRoadsCacheEntries /*= nullptr*/,
     const std::shared_ptr<const IQueryController>& queryController /*= nullptr*/,
     ObfMapSectionReader_Metrics::Metric_loadMapObjects* const binaryMapObjectsMetric /*= nullptr*/,
-    ObfRoutingSectionReader_Metrics::Metric_loadRoads* const roadsMetric /*= nullptr*/)
+    ObfRoutingSectionReader_Metrics::Metric_loadRoads* const roadsMetric /*= nullptr*/,
+    const ObfMapSectionReader::FilterByAttributesFunction filterMapObjectsByAttributes /*= nullptr*/,
+    const bool simplifyMapObjectsGeometry /*= false*/)
 {
-    auto mergedSurfaceType = MapSurfaceType::Undefined;
-    std::shared_ptr<const ObfReader> basemapReader;
+    const auto binaryMapObjectsLoaded = loadBinaryMapObjects(
+        outBinaryMapObjects,
+        outSurfaceType,
+        zoom,
+        bbox31,
+        filterMapObjectsById,
+        binaryMapObjectsCache,
+        outReferencedBinaryMapObjectsCacheEntries,
+        queryController,
+        binaryMapObjectsMetric,
+        filterMapObjectsByAttributes,
+        simplifyMapObjectsGeometry);
+    if (!binaryMapObjectsLoaded)
+        return false;
 
-    QSet<QString> processedMapSectionsNames;
-
-    for (const auto& obfReader : constOf(obfReaders))
+    if (zoom > ObfMapSectionLevel::MaxBasemapZoomLevel)
     {
-        if (queryController && queryController->isAborted())
-            return false;
-
-        const auto& obfInfo = obfReader->obtainInfo();
-
-        // Handle basemap
-        if (obfInfo->isBasemapWithCoastlines)
+        // Remember which map sections were processed (by name). Basemap is not among them,
+        // since it was either read from less detailed zoom or skipped as a duplicate
+        QSet<QString> processedMapSectionsNames;
+        for (const auto& obfReader : constOf(obfReaders))
         {
-            // In case there's more than 1 basemap reader present, use only first and warn about this fact
-            if (basemapReader)
-            {
-                LogPrintf(LogSeverityLevel::Warning, "More than 1 basemap available");
-                continue;
-            }
-
-            // Save basemap reader for later use
-            basemapReader = obfReader;
-
-            // In case requested zoom is more detailed than basemap max zoom, skip basemap processing for now
-            if (zoom > static_cast<ZoomLevel>(ObfMapSectionLevel::MaxBasemapZoomLevel))
+            const auto& obfInfo = obfReader->obtainInfo();
+            if (obfInfo->isBasemapWithCoastlines)
                 continue;
-        }
-
-        for (const auto& mapSection : constOf(obfInfo->mapSections))
-        {
-            if (queryController && queryController->isAborted())
-                return false;
-
-            // Remember that this section was processed (by name)
-            processedMapSectionsNames.insert(mapSection->name);
-
-            // Read objects from each map section
-            auto surfaceTypeToMerge = MapSurfaceType::Undefined;
-            OsmAnd::ObfMapSectionReader::loadMapObjects(
-                obfReader,
-                mapSection,
-                zoom,
-                bbox31,
-                outBinaryMapObjects,
-                &surfaceTypeToMerge,
-                filterMapObjectsById,
-                nullptr,
-                binaryMapObjectsCache,
-                outReferencedBinaryMapObjectsCacheEntries,
-                queryController,
-                binaryMapObjectsMetric);
-            if (surfaceTypeToMerge != MapSurfaceType::Undefined)
-            {
-                if (mergedSurfaceType == MapSurfaceType::Undefined)
-                    mergedSurfaceType = surfaceTypeToMerge;
-                else if (mergedSurfaceType != surfaceTypeToMerge)
-                    mergedSurfaceType = MapSurfaceType::Mixed;
-            }
-        }
-    }
-
-    // In case there's basemap available and requested zoom is more detailed than basemap max zoom level,
-    // read tile from MaxBasemapZoomLevel that covers requested tile
-    if (basemapReader && zoom > static_cast<ZoomLevel>(ObfMapSectionLevel::MaxBasemapZoomLevel))
-    {
-        const auto& obfInfo = basemapReader->obtainInfo();
-
-        // Calculate proper bbox31 on MaxBasemapZoomLevel (if possible)
-        const AreaI *pBasemapBBox31 = nullptr;
-        AreaI basemapBBox31;
-        if (bbox31)
-        {
-            pBasemapBBox31 = &basemapBBox31;
-            basemapBBox31 = Utilities::roundBoundingBox31(
-                *bbox31,
-                static_cast<ZoomLevel>(ObfMapSectionLevel::MaxBasemapZoomLevel));
-        }
-
-        for (const auto& mapSection : constOf(obfInfo->mapSections))
-        {
-            if (queryController && queryController->isAborted())
-                return false;
-
-            // Read objects from each map section
-            auto surfaceTypeToMerge = MapSurfaceType::Undefined;
-            OsmAnd::ObfMapSectionReader::loadMapObjects(
-                basemapReader,
-                mapSection,
-                static_cast<ZoomLevel>(ObfMapSectionLevel::MaxBasemapZoomLevel),
-                pBasemapBBox31,
-                outBinaryMapObjects,
-                &surfaceTypeToMerge,
-                filterMapObjectsById,
-                nullptr,
-                binaryMapObjectsCache,
-                outReferencedBinaryMapObjectsCacheEntries,
-                queryController,
-                binaryMapObjectsMetric);
 
-            // Basemap must always have a surface type defined
-            assert(surfaceTypeToMerge != MapSurfaceType::Undefined);
-            if (mergedSurfaceType == MapSurfaceType::Undefined)
-                mergedSurfaceType = surfaceTypeToMerge;
-            else if (mergedSurfaceType != surfaceTypeToMerge)
-                mergedSurfaceType = MapSurfaceType::Mixed;
+            for (const auto& mapSection : constOf(obfInfo->mapSections))
+                processedMapSectionsNames.insert(mapSection->name);
         }
-    }
-
-    // In case there was a basemap present, Undefined is Land
-    if (mergedSurfaceType == MapSurfaceType::Undefined && !basemapReader)
-        mergedSurfaceType = MapSurfaceType::FullLand;
 
-    if (outSurfaceType)
-        *outSurfaceType = mergedSurfaceType;
-
-    if (zoom > ObfMapSectionLevel::MaxBasemapZoomLevel)
-    {
+        QList< RoutingSectionsEntry > routingSections;
         for (const auto& obfReader : constOf(obfReaders))
         {
             if (queryController && queryController->isAborted())
@@ -396,29 +640,25 @@ bool OsmAnd::ObfDataInterface::loadMapObjects(
 
             for (const auto& routingSection : constOf(obfInfo->routingSections))
             {
-                // Check if request is aborted
-                if (queryController && queryController->isAborted())
-                    return false;
-
                 // Check that map section with same name was not processed from other file
                 if (processedMapSectionsNames.contains(routingSection->name))
                     continue;
 
-                // Read objects from each map section
-                OsmAnd::ObfRoutingSectionReader::loadRoads(
-                    obfReader,
-                    routingSection,
-                    RoutingDataLevel::Detailed,
-                    bbox31,
-                    outRoads,
-                    filterRoadsById,
-                    nullptr,
-                    roadsCache,
-                    outReferencedRoadsCacheEntries,
-                    queryController,
-                    roadsMetric);
+                routingSections.push_back(RoutingSectionsEntry(obfReader, routingSection));
             }
         }
+
+        // Read objects from each routing section
+        return loadRoadsFromSections(
+            routingSections,
+            RoutingDataLevel::Detailed,
+            bbox31,
+            outRoads,
+            filterRoadsById,
+            roadsCache,
+            outReferencedRoadsCacheEntries,
+            queryController,
+            roadsMetric);
     }
 
     return true;
@@ -482,6 +722,7 @@ bool OsmAnd::ObfDataInterface::loadAmenities(
     const ObfPoiSectionReader::VisitorFunction visitor /*= nullptr*/,
     const std::shared_ptr<const IQueryController>& queryController /*= nullptr*/)
 {
+    QList< SectionEntry<ObfPoiSectionInfo> > poiSections;
     for (const auto& obfReader : constOf(obfReaders))
     {
         if (queryController && queryController->isAborted())
@@ -490,9 +731,6 @@ bool OsmAnd::ObfDataInterface::loadAmenities(
         const auto& obfInfo = obfReader->obtainInfo();
         for (const auto& poiSection : constOf(obfInfo->poiSections))
         {
-            if (queryController && queryController->isAborted())
-                return false;
-
             if (pBbox31)
             {
                 bool accept = false;
@@ -504,6 +742,17 @@ bool OsmAnd::ObfDataInterface::loadAmenities(
                     continue;
             }
 
+            poiSections.push_back(SectionEntry<ObfPoiSectionInfo>(obfReader, poiSection));
+        }
+    }
+
+    QVector< QList< std::shared_ptr<const OsmAnd::Amenity> > > results;
+    const auto serializedTileFilter = serializedCallback(tileFilter);
+    const auto serializedVisitor = serializedCallback(visitor);
+    readSections(poiSections, results,
+        [outAmenities, pBbox31, &serializedTileFilter, zoomFilter, categoriesFilter, &serializedVisitor, &queryController]
+        (const std::shared_ptr<const ObfReader>& obfReader, const Ref<ObfPoiSectionInfo>& poiSection, QList< std::shared_ptr<const OsmAnd::Amenity> >& outResult)
+        {
             QSet<ObfPoiCategoryId> categoriesFilterById;
             if (categoriesFilter)
             {
@@ -515,7 +764,7 @@ bool OsmAnd::ObfDataInterface::loadAmenities(
                     queryController);
 
                 if (!categories)
-                    continue;
+                    return;
 
                 for (const auto& categoriesFilterEntry : rangeOf(constOf(*categoriesFilter)))
                 {
@@ -546,17 +795,24 @@ bool OsmAnd::ObfDataInterface::loadAmenities(
             OsmAnd::ObfPoiSectionReader::loadAmenities(
                 obfReader,
                 poiSection,
-                outAmenities,
+                outAmenities ? &outResult : nullptr,
                 pBbox31,
-                tileFilter,
+                serializedTileFilter,
                 zoomFilter,
                 categoriesFilter ? &categoriesFilterById : nullptr,
-                visitor,
+                serializedVisitor,
                 queryController);
-        }
+        },
+        queryController);
+
+    // Merge results in same order as they would have been read sequentially
+    if (outAmenities)
+    {
+        for (const auto& result : constOf(results))
+            outAmenities->append(result);
     }
 
-    return true;
+    return !(queryController && queryController->isAborted());
 }
 
 bool OsmAnd::ObfDataInterface::scanAmenitiesByName(
@@ -798,6 +1054,7 @@ bool OsmAnd::ObfDataInterface::scanAddressesByName(
     const ObfAddressSectionReader::VisitorFunction visitor /*= nullptr*/,
     const std::shared_ptr<const IQueryController>& queryController /*= nullptr*/)
 {
+    QList< SectionEntry<ObfAddressSectionInfo> > addressSections;
     for (const auto& obfReader : constOf(obfReaders))
     {
         if (queryController && queryController->isAborted())
@@ -806,9 +1063,6 @@ bool OsmAnd::ObfDataInterface::scanAddressesByName(
         const auto& obfInfo = obfReader->obtainInfo();
         for (const auto& addressSection : constOf(obfInfo->addressSections))
         {
-            if (queryController && queryController->isAborted())
-                return false;
-
             if (bbox31)
             {
                 bool accept = false;
@@ -820,22 +1074,39 @@ bool OsmAnd::ObfDataInterface::scanAddressesByName(
                     continue;
             }
 
+            addressSections.push_back(SectionEntry<ObfAddressSectionInfo>(obfReader, addressSection));
+        }
+    }
+
+    QVector< QList< std::shared_ptr<const OsmAnd::Address> > > results;
+    const auto serializedVisitor = serializedCallback(visitor);
+    readSections(addressSections, results,
+        [&query, matcherMode, outAddresses, bbox31, streetGroupTypesFilter, includeStreets, strictMatch, &serializedVisitor, &queryController]
+        (const std::shared_ptr<const ObfReader>& obfReader, const Ref<ObfAddressSectionInfo>& addressSection, QList< std::shared_ptr<const OsmAnd::Address> >& outResult)
+        {
             OsmAnd::ObfAddressSectionReader::scanAddressesByName(
                 obfReader,
                 addressSection,
                 query,
                 matcherMode,
-                outAddresses,
+                outAddresses ? &outResult : nullptr,
                 bbox31,
                 streetGroupTypesFilter,
                 includeStreets,
                 strictMatch,
-                visitor,
+                serializedVisitor,
                 queryController);
-        }
+        },
+        queryController);
+
+    // Merge results in same order as they would have been read sequentially
+    if (outAddresses)
+    {
+        for (const auto& result : constOf(results))
+            outAddresses->append(result);
     }
 
-    return true;
+    return !(queryController && queryController->isAborted());
 }
 
 bool OsmAnd::ObfDataInterface::loadStreetGroups(
@@ -1234,6 +1505,50 @@ bool OsmAnd::ObfDataInterface::getTransportRoutes(
     return true;
 }
 
+bool OsmAnd::ObfDataInterface::obtainTransportNetworks(
+    QList< std::shared_ptr<const TransportNetwork> >* outTransportNetworks,
+    const AreaI* const bbox31 /*= nullptr*/,
+    const std::shared_ptr<const IQueryController>& queryController /*= nullptr*/)
+{
+    for (const auto& obfReader : constOf(obfReaders))
+    {
+        const auto& obfInfo = obfReader->obtainInfo();
+        for (const auto& transportSection : constOf(obfInfo->transportSections))
+        {
+            if (queryController && queryController->isAborted())
+                return false;
+
+            if (transportSection->stopsLength == 0)
+                continue;
+
+            // Area of section is in coordinates of transport stops zoom
+            if (bbox31)
+            {
+                const auto stopsBBox = AreaI(
+                    bbox31->top() >> (31 - TransportStopsInAreaSearch::TRANSPORT_STOP_ZOOM),
+                    bbox31->left() >> (31 - TransportStopsInAreaSearch::TRANSPORT_STOP_ZOOM),
+                    bbox31->bottom() >> (31 - TransportStopsInAreaSearch::TRANSPORT_STOP_ZOOM),
+                    bbox31->right() >> (31 - TransportStopsInAreaSearch::TRANSPORT_STOP_ZOOM));
+                if (!transportSection->area31.contains(stopsBBox) &&
+                    !transportSection->area31.intersects(stopsBBox) &&
+                    !stopsBBox.contains(transportSection->area31))
+                {
+                    continue;
+                }
+            }
+
+            const auto transportNetwork = TransportNetwork::obtain(obfReader, transportSection.shared_ptr(), queryController);
+            if (!transportNetwork)
+                return false;
+
+            if (outTransportNetworks)
+                outTransportNetworks->push_back(transportNetwork);
+        }
+    }
+
+    return true;
+}
+
 bool OsmAnd::ObfDataInterface::transportStopBelongsTo(const std::shared_ptr<const TransportStop>& s)
 {
     for (const auto& obfReader : constOf(obfReaders))
@@ -40,6 +40,26 @@ bool OsmAnd::ObfsCollection::remove(const SourceOriginId entryId)
     return _p->remove(entryId);
 }
 
+void OsmAnd::ObfsCollection::setMaxIdleObfReaders(const unsigned int maxIdleObfReaders)
+{
+    _p->setMaxIdleObfReaders(maxIdleObfReaders);
+}
+
+void OsmAnd::ObfsCollection::setMaxOpenObfReaders(const unsigned int maxOpenObfReaders)
+{
+    _p->setMaxOpenObfReaders(maxOpenObfReaders);
+}
+
+void OsmAnd::ObfsCollection::setUseMemoryMappedObfReaders(const bool useMemoryMappedObfReaders)
+{
+    _p->setUseMemoryMappedObfReaders(useMemoryMappedObfReaders);
+}
+
+void OsmAnd::ObfsCollection::setDataInterfaceWorkerPool(const std::shared_ptr<Concurrent::WorkerPool>& workerPool)
+{
+    _p->setDataInterfaceWorkerPool(workerPool);
+}
+
 QList< std::shared_ptr<const OsmAnd::ObfFile> >OsmAnd::ObfsCollection::getObfFiles() const
 {
     return _p->getObfFiles();
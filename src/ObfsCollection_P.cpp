@@ -4,6 +4,9 @@
 #include <cassert>
 
 #include "QtCommon.h"
+#include <QThread>
+#include <QFileInfo>
+#include <QDateTime>
 
 #include "OsmAndCore_private.h"
 #include "ObfReader.h"
@@ -21,7 +24,15 @@ OsmAnd::ObfsCollection_P::ObfsCollection_P(ObfsCollection* owner_)
     , _fileSystemWatcher(new QFileSystemWatcher())
     , _lastUnusedSourceOriginId(0)
     , _collectedSourcesInvalidated(1)
+    , _obfReadersPool(new ObfReadersPool())
 {
+    for (auto& collectedSourcesBounds : _collectedSourcesBounds)
+    {
+        collectedSourcesBounds = CollectedSourcesBoundsTree(
+            AreaI::largestPositive(),
+            CollectedSourcesBoundsTreeMaxDepth);
+    }
+
     _fileSystemWatcher->moveToThread(gMainThread);
 
     _onDirectoryChangedConnection = QObject::connect(
@@ -57,6 +68,9 @@ void OsmAnd::ObfsCollection_P::collectSources() const
 
     const Stopwatch collectSourcesStopwatch(true);
 
+    // Pooled readers may refer to files that are gone or changed, readers of other files stay
+    _obfReadersPool->purgeChanged();
+
     std::shared_ptr<CachedOsmandIndexes> cachedOsmandIndexes = nullptr;
     QFile* indCache = NULL;
     if (_sourcesOrigins.size() > 0)
@@ -197,12 +211,92 @@ void OsmAnd::ObfsCollection_P::collectSources() const
     if (indCache)
         delete indCache;
 
+    updateCollectedSourcesBounds();
+
     // Decrement invalidations counter with number of processed onces
     _collectedSourcesInvalidated.fetchAndAddOrdered(-invalidationsToProcess);
 
     LogPrintf(LogSeverityLevel::Info, "Collected OBF sources in %fs", collectSourcesStopwatch.elapsed());
 }
 
+void OsmAnd::ObfsCollection_P::updateCollectedSourcesBounds() const
+{
+    // Only files that were added or removed since last time are touched. Files that had no
+    // information on previous update are checked again, since it may have been read since then
+    QHash< const ObfFile*, std::shared_ptr<const ObfFile> > collectedSources;
+    for (const auto& collectedSourcesFromOrigin : constOf(_collectedSources))
+    {
+        for (const auto& obfFile : constOf(collectedSourcesFromOrigin))
+            collectedSources.insert(obfFile.get(), obfFile);
+    }
+
+    QSet<const ObfFile*> removedSources;
+    for (const auto& boundedSource : rangeOf(constOf(_boundedCollectedSources)))
+    {
+        if (collectedSources.value(boundedSource.key()) != boundedSource.value())
+            removedSources.insert(boundedSource.key());
+    }
+    if (!removedSources.isEmpty())
+    {
+        for (auto& collectedSourcesBounds : _collectedSourcesBounds)
+        {
+            collectedSourcesBounds.removeSlow(
+                [removedSources]
+                (const CollectedSourceBounds& bounds, const CollectedSourcesBoundsTree::BBox& bbox) -> bool
+                {
+                    return removedSources.contains(bounds.obfFile.get());
+                });
+        }
+        for (const auto& removedSource : constOf(removedSources))
+            _boundedCollectedSources.remove(removedSource);
+    }
+
+    _unboundedCollectedSources.clear();
+    for (const auto& obfFile : constOf(collectedSources))
+    {
+        if (_boundedCollectedSources.contains(obfFile.get()))
+            continue;
+
+        const auto& obfInfo = obfFile->obfInfo;
+        if (!obfInfo || obfInfo->isBasemap || obfInfo->isBasemapWithCoastlines)
+        {
+            _unboundedCollectedSources.push_back(obfFile);
+            continue;
+        }
+
+        insertCollectedSourceBounds(obfFile);
+        _boundedCollectedSources.insert(obfFile.get(), obfFile);
+    }
+}
+
+void OsmAnd::ObfsCollection_P::insertCollectedSourceBounds(const std::shared_ptr<const ObfFile>& obfFile) const
+{
+    const auto& obfInfo = obfFile->obfInfo;
+
+    auto& mapBounds = _collectedSourcesBounds[static_cast<int>(ObfDataType::Map)];
+    for (const auto& mapSection : constOf(obfInfo->mapSections))
+    {
+        for (const auto& level : constOf(mapSection->levels))
+            mapBounds.insert({ obfFile, level->minZoom, level->maxZoom }, level->area31);
+    }
+
+    auto& routingBounds = _collectedSourcesBounds[static_cast<int>(ObfDataType::Routing)];
+    for (const auto& routingSection : constOf(obfInfo->routingSections))
+        routingBounds.insert({ obfFile, MinZoomLevel, MaxZoomLevel }, routingSection->area31);
+
+    auto& addressBounds = _collectedSourcesBounds[static_cast<int>(ObfDataType::Address)];
+    for (const auto& addressSection : constOf(obfInfo->addressSections))
+        addressBounds.insert({ obfFile, MinZoomLevel, MaxZoomLevel }, addressSection->area31);
+
+    auto& poiBounds = _collectedSourcesBounds[static_cast<int>(ObfDataType::POI)];
+    for (const auto& poiSection : constOf(obfInfo->poiSections))
+        poiBounds.insert({ obfFile, MinZoomLevel, MaxZoomLevel }, poiSection->area31);
+
+    auto& transportBounds = _collectedSourcesBounds[static_cast<int>(ObfDataType::Transport)];
+    for (const auto& transportSection : constOf(obfInfo->transportSections))
+        transportBounds.insert({ obfFile, MinZoomLevel, MaxZoomLevel }, transportSection->area31);
+}
+
 QList<OsmAnd::ObfsCollection::SourceOriginId> OsmAnd::ObfsCollection_P::getSourceOriginIds() const
 {
     QReadLocker scopedLocker(&_sourcesOriginsLock);
@@ -305,17 +399,286 @@ QList< std::shared_ptr<const OsmAnd::ObfFile> > OsmAnd::ObfsCollection_P::getObf
     return obfFiles;
 }
 
+void OsmAnd::ObfsCollection_P::setMaxIdleObfReaders(const unsigned int maxIdleObfReaders)
+{
+    QList< std::shared_ptr<ObfReader> > evictedReaders;
+    {
+        QMutexLocker scopedLocker(&_obfReadersPool->mutex);
+
+        _obfReadersPool->maxIdleReaders = maxIdleObfReaders;
+        _obfReadersPool->evictExcessive(evictedReaders);
+    }
+}
+
+void OsmAnd::ObfsCollection_P::setMaxOpenObfReaders(const unsigned int maxOpenObfReaders)
+{
+    QMutexLocker scopedLocker(&_obfReadersPool->mutex);
+
+    _obfReadersPool->maxOpenReaders = maxOpenObfReaders;
+}
+
+void OsmAnd::ObfsCollection_P::setUseMemoryMappedObfReaders(const bool useMemoryMappedObfReaders)
+{
+    QMutexLocker scopedLocker(&_obfReadersPool->mutex);
+
+    if (_obfReadersPool->memoryMapped == useMemoryMappedObfReaders)
+        return;
+    _obfReadersPool->memoryMapped = useMemoryMappedObfReaders;
+
+    // Readers of other kind are not going to be reused
+    scopedLocker.unlock();
+    _obfReadersPool->purge();
+}
+
+void OsmAnd::ObfsCollection_P::setDataInterfaceWorkerPool(const std::shared_ptr<Concurrent::WorkerPool>& workerPool)
+{
+    QMutexLocker scopedLocker(&_dataInterfaceWorkerPoolMutex);
+
+    _dataInterfaceWorkerPool = workerPool;
+}
+
+std::shared_ptr<OsmAnd::Concurrent::WorkerPool> OsmAnd::ObfsCollection_P::getDataInterfaceWorkerPool() const
+{
+    QMutexLocker scopedLocker(&_dataInterfaceWorkerPoolMutex);
+
+    return _dataInterfaceWorkerPool;
+}
+
+std::shared_ptr<const OsmAnd::ObfReader> OsmAnd::ObfsCollection_P::leaseObfReader(
+    const std::shared_ptr<const ObfFile>& obfFile) const
+{
+    const auto& pool = _obfReadersPool;
+
+    std::shared_ptr<ObfReader> obfReader;
+    ObfReadersPool::Key key;
+    unsigned int leaseGeneration;
+    bool memoryMapped;
+    QList< std::shared_ptr<ObfReader> > evictedReaders;
+    {
+        QMutexLocker scopedLocker(&pool->mutex);
+
+        memoryMapped = pool->memoryMapped;
+        leaseGeneration = pool->generation;
+        key = ObfReadersPool::Key(obfFile, memoryMapped ? nullptr : QThread::currentThreadId());
+
+        const auto itIdleReader = pool->idleReaders.find(key);
+        if (itIdleReader != pool->idleReaders.end())
+        {
+            obfReader = *itIdleReader;
+            pool->idleReadersLRU.removeOne(key);
+
+            // Memory-mapped reader stays in pool, since it's shared by all threads
+            if (memoryMapped)
+            {
+                pool->idleReadersLRU.append(key);
+                return obfReader;
+            }
+
+            pool->idleReaders.erase(itIdleReader);
+        }
+
+        if (!obfReader && !memoryMapped && pool->maxOpenReaders > 0)
+        {
+            // Evicted readers are destroyed after lock is released, so they are still counted
+            const auto openReadersCount =
+                [&pool, &evictedReaders]
+                () -> unsigned int
+                {
+                    return static_cast<unsigned int>(pool->openReadersCount.load() - evictedReaders.size());
+                };
+
+            // Idle readers of other files and threads give their file handles away first
+            for (auto itKey = pool->idleReadersLRU.begin();
+                openReadersCount() >= pool->maxOpenReaders && itKey != pool->idleReadersLRU.end();)
+            {
+                if (itKey->threadId)
+                {
+                    evictedReaders.push_back(pool->idleReaders.take(*itKey));
+                    itKey = pool->idleReadersLRU.erase(itKey);
+                }
+                else
+                    ++itKey;
+            }
+
+            // Otherwise all threads share memory-mapped reader of this file, that needs no more handles
+            if (openReadersCount() >= pool->maxOpenReaders)
+            {
+                memoryMapped = true;
+                key = ObfReadersPool::Key(obfFile, nullptr);
+
+                const auto citSharedReader = pool->idleReaders.constFind(key);
+                if (citSharedReader != pool->idleReaders.cend())
+                {
+                    pool->idleReadersLRU.removeOne(key);
+                    pool->idleReadersLRU.append(key);
+                    return *citSharedReader;
+                }
+            }
+        }
+
+        if (!obfReader && !memoryMapped)
+            pool->openReadersCount.ref();
+    }
+
+    if (!obfReader)
+    {
+        if (memoryMapped)
+        {
+            obfReader.reset(new ObfReader(obfFile, true));
+            pool->release(key, obfReader, leaseGeneration);
+            return obfReader;
+        }
+
+        const std::weak_ptr<ObfReadersPool> weakPool(pool);
+        obfReader.reset(new ObfReader(obfFile, false),
+            [weakPool]
+            (ObfReader* const obfReader)
+            {
+                delete obfReader;
+
+                if (const auto pool = weakPool.lock())
+                    pool->openReadersCount.deref();
+            });
+    }
+
+    // Reader returns to pool of the thread it was leased by once all references to it are released
+    const std::weak_ptr<ObfReadersPool> weakPool(pool);
+    return std::shared_ptr<const ObfReader>(obfReader.get(),
+        [weakPool, key, obfReader, leaseGeneration]
+        (const ObfReader* const)
+        {
+            if (const auto pool = weakPool.lock())
+                pool->release(key, obfReader, leaseGeneration);
+        });
+}
+
+OsmAnd::ObfsCollection_P::ObfReadersPool::Key::Key()
+    : fileSize(0)
+    , lastModifiedTime(0)
+    , threadId(nullptr)
+{
+}
+
+OsmAnd::ObfsCollection_P::ObfReadersPool::Key::Key(const std::shared_ptr<const ObfFile>& obfFile, const Qt::HANDLE threadId_)
+    : filePath(obfFile->filePath)
+    , fileSize(obfFile->fileSize)
+    , lastModifiedTime(obfFile->lastModifiedTime)
+    , threadId(threadId_)
+{
+}
+
+OsmAnd::ObfsCollection_P::ObfReadersPool::ObfReadersPool()
+    : maxIdleReaders(ObfsCollection::DefaultMaxIdleObfReaders)
+    , maxOpenReaders(ObfsCollection::DefaultMaxOpenObfReaders)
+    , memoryMapped(false)
+    , generation(0)
+    , openReadersCount(0)
+{
+}
+
+OsmAnd::ObfsCollection_P::ObfReadersPool::~ObfReadersPool()
+{
+}
+
+void OsmAnd::ObfsCollection_P::ObfReadersPool::release(
+    const Key& key,
+    const std::shared_ptr<ObfReader>& obfReader,
+    const unsigned int leaseGeneration)
+{
+    // Evicted readers are closed after lock is released
+    QList< std::shared_ptr<ObfReader> > evictedReaders;
+    {
+        QMutexLocker scopedLocker(&mutex);
+
+        if (leaseGeneration != generation || !obfReader->isOpened())
+            return;
+
+        // Same thread may have leased several readers of same file, keep only one of them
+        if (idleReaders.contains(key))
+            return;
+
+        idleReaders.insert(key, obfReader);
+        idleReadersLRU.append(key);
+        evictExcessive(evictedReaders);
+    }
+}
+
+void OsmAnd::ObfsCollection_P::ObfReadersPool::purge()
+{
+    QHash< Key, std::shared_ptr<ObfReader> > purgedReaders;
+    {
+        QMutexLocker scopedLocker(&mutex);
+
+        generation++;
+        purgedReaders.swap(idleReaders);
+        idleReadersLRU.clear();
+    }
+}
+
+void OsmAnd::ObfsCollection_P::ObfReadersPool::purgeChanged()
+{
+    QSet<Key> keys;
+    {
+        QMutexLocker scopedLocker(&mutex);
+
+        keys = idleReaders.keys().toSet();
+    }
+
+    // Files are checked without lock, since leasing doesn't have to wait for that
+    QSet<QString> changedFiles;
+    QSet<QString> checkedFiles;
+    for (const auto& key : constOf(keys))
+    {
+        if (checkedFiles.contains(key.filePath))
+            continue;
+        checkedFiles.insert(key.filePath);
+
+        const QFileInfo fileInfo(key.filePath);
+        if (!fileInfo.exists() ||
+            static_cast<uint64_t>(fileInfo.size()) != key.fileSize ||
+            fileInfo.lastModified().toMSecsSinceEpoch() != key.lastModifiedTime)
+        {
+            changedFiles.insert(key.filePath);
+        }
+    }
+    if (changedFiles.isEmpty())
+        return;
+
+    QList< std::shared_ptr<ObfReader> > purgedReaders;
+    {
+        QMutexLocker scopedLocker(&mutex);
+
+        auto itKey = idleReadersLRU.begin();
+        while (itKey != idleReadersLRU.end())
+        {
+            if (changedFiles.contains(itKey->filePath) && keys.contains(*itKey))
+            {
+                purgedReaders.push_back(idleReaders.take(*itKey));
+                itKey = idleReadersLRU.erase(itKey);
+            }
+            else
+                ++itKey;
+        }
+    }
+}
+
+void OsmAnd::ObfsCollection_P::ObfReadersPool::evictExcessive(QList< std::shared_ptr<ObfReader> >& outEvictedReaders)
+{
+    while (static_cast<unsigned int>(idleReaders.size()) > maxIdleReaders)
+        outEvictedReaders.push_back(idleReaders.take(idleReadersLRU.takeFirst()));
+}
+
 std::shared_ptr<OsmAnd::ObfDataInterface> OsmAnd::ObfsCollection_P::obtainDataInterface(
     const std::shared_ptr<const ObfFile> obfFile) const
 {
-    return std::shared_ptr<ObfDataInterface>(new ObfDataInterface({ std::make_shared<ObfReader>(obfFile) }));
+    return std::shared_ptr<ObfDataInterface>(new ObfDataInterface({ leaseObfReader(obfFile) }, getDataInterfaceWorkerPool()));
 }
 
 std::shared_ptr<OsmAnd::ObfDataInterface> OsmAnd::ObfsCollection_P::obtainDataInterface(
     const QList< std::shared_ptr<const ResourcesManager::LocalResource> > localResources) const
 {
     QList< std::shared_ptr<const ObfReader> > obfReaders;
-    return std::shared_ptr<ObfDataInterface>(new ObfDataInterface(obfReaders));
+    return std::shared_ptr<ObfDataInterface>(new ObfDataInterface(obfReaders, getDataInterfaceWorkerPool()));
 }
 
 std::shared_ptr<OsmAnd::ObfDataInterface> OsmAnd::ObfsCollection_P::obtainDataInterface(
@@ -330,6 +693,64 @@ std::shared_ptr<OsmAnd::ObfDataInterface> OsmAnd::ObfsCollection_P::obtainDataIn
 
     // Create ObfReaders from collected sources
     QList< std::shared_ptr<const ObfReader> > obfReaders;
+    bool hasNewlyInformedSources = false;
+    if (pBbox31)
+    {
+        QReadLocker scopedLocker(&_collectedSourcesLock);
+
+        // Bounded sources are selected using bounds trees, so that only files that intersect
+        // requested area are touched at all. Readers go in order of data types, and within each
+        // data type in order in which bounds tree yields intersected bounds (not sorted by file).
+        // Unbounded sources are appended after all bounded ones
+        QSet<const ObfFile*> selectedSources;
+        for (auto dataTypeIndex = 0u; dataTypeIndex < _collectedSourcesBounds.size(); dataTypeIndex++)
+        {
+            if (!desiredDataTypes.isSet(static_cast<ObfDataType>(dataTypeIndex)))
+                continue;
+
+            QList<CollectedSourceBounds> intersectedBounds;
+            _collectedSourcesBounds[dataTypeIndex].query(*pBbox31, intersectedBounds, false,
+                [minZoomLevel, maxZoomLevel]
+                (const CollectedSourceBounds& bounds, const CollectedSourcesBoundsTree::BBox& bbox) -> bool
+                {
+                    return minZoomLevel <= bounds.maxZoom && bounds.minZoom <= maxZoomLevel;
+                });
+
+            for (const auto& bounds : constOf(intersectedBounds))
+            {
+                if (selectedSources.contains(bounds.obfFile.get()))
+                    continue;
+                selectedSources.insert(bounds.obfFile.get());
+
+                auto obfReader = leaseObfReader(bounds.obfFile);
+                if (!obfReader->isOpened() || !obfReader->obtainInfo())
+                    continue;
+
+                obfReaders.push_back(qMove(obfReader));
+            }
+        }
+
+        // Unbounded sources are basemaps or files without information, so they are checked as before
+        obfReaders.reserve(obfReaders.size() + _unboundedCollectedSources.size());
+        for (const auto& obfFile : constOf(_unboundedCollectedSources))
+        {
+            const auto hadInfo = static_cast<bool>(obfFile->obfInfo);
+            auto obfReader = leaseObfReader(obfFile);
+            if (!obfReader->isOpened() || !obfReader->obtainInfo())
+                continue;
+            hasNewlyInformedSources = hasNewlyInformedSources || !hadInfo;
+
+            if (!obfFile->obfInfo->isBasemap && !obfFile->obfInfo->isBasemapWithCoastlines)
+            {
+                bool accept = obfFile->obfInfo->containsDataFor(pBbox31, minZoomLevel, maxZoomLevel, desiredDataTypes);
+                if (!accept)
+                    continue;
+            }
+
+            obfReaders.push_back(qMove(obfReader));
+        }
+    }
+    else
     {
         QReadLocker scopedLocker(&_collectedSourcesLock);
 
@@ -349,9 +770,11 @@ std::shared_ptr<OsmAnd::ObfDataInterface> OsmAnd::ObfsCollection_P::obtainDataIn
                 }
 
                 // Otherwise, open file in any case to repeat check
-                std::shared_ptr<const ObfReader> obfReader(new ObfReader(obfFile));
+                const auto hadInfo = static_cast<bool>(obfFile->obfInfo);
+                auto obfReader = leaseObfReader(obfFile);
                 if (!obfReader->isOpened() || !obfReader->obtainInfo())
                     continue;
+                hasNewlyInformedSources = hasNewlyInformedSources || !hadInfo;
 
                 // Repeat checks if needed
                 if (!obfFile->obfInfo->isBasemap && !obfFile->obfInfo->isBasemapWithCoastlines)
@@ -366,7 +789,30 @@ std::shared_ptr<OsmAnd::ObfDataInterface> OsmAnd::ObfsCollection_P::obtainDataIn
         }
     }
 
-    return std::shared_ptr<ObfDataInterface>(new ObfDataInterface(obfReaders));
+    if (hasNewlyInformedSources)
+        boundNewlyInformedSources();
+
+    return std::shared_ptr<ObfDataInterface>(new ObfDataInterface(obfReaders, getDataInterfaceWorkerPool()));
+}
+
+void OsmAnd::ObfsCollection_P::boundNewlyInformedSources() const
+{
+    QWriteLocker scopedLocker(&_collectedSourcesLock);
+
+    // Files whose information was read since sources were collected are moved to bounds trees,
+    // so next queries don't have to check them directly
+    auto itUnboundedSource = mutableIteratorOf(_unboundedCollectedSources);
+    while (itUnboundedSource.hasNext())
+    {
+        const auto& obfFile = itUnboundedSource.next();
+        const auto& obfInfo = obfFile->obfInfo;
+        if (!obfInfo || obfInfo->isBasemap || obfInfo->isBasemapWithCoastlines)
+            continue;
+
+        insertCollectedSourceBounds(obfFile);
+        _boundedCollectedSources.insert(obfFile.get(), obfFile);
+        itUnboundedSource.remove();
+    }
 }
 
 void OsmAnd::ObfsCollection_P::onDirectoryChanged(const QString& path)
@@ -2,23 +2,31 @@
 #define _OSMAND_CORE_OBFS_COLLECTION_P_H_
 
 #include "stdlib_common.h"
+#include <array>
 
 #include "QtExtensions.h"
 #include <QDir>
 #include <QHash>
 #include <QSet>
 #include <QReadWriteLock>
+#include <QMutex>
+#include <QAtomicInt>
+#include <QPair>
+#include <QList>
 #include <QFileSystemWatcher>
 #include <QEventLoop>
 
 #include "OsmAndCore.h"
 #include "CommonTypes.h"
 #include "PrivateImplementation.h"
+#include "QuadTree.h"
+#include "DataCommonTypes.h"
 #include "ObfsCollection.h"
 
 namespace OsmAnd
 {
     class ObfFile;
+    class ObfReader;
     class ObfDataInterface;
 
     class ObfsCollection;
@@ -80,6 +88,107 @@ namespace OsmAnd
         mutable QHash< ObfsCollection::SourceOriginId, QHash<QString, std::shared_ptr<ObfFile> > > _collectedSources;
         mutable QReadWriteLock _collectedSourcesLock;
         void collectSources() const;
+
+        // Bounds of sections of collected sources, one tree per data type, so that selecting
+        // files for an area doesn't check every section of every file
+        struct CollectedSourceBounds
+        {
+            std::shared_ptr<const ObfFile> obfFile;
+            ZoomLevel minZoom;
+            ZoomLevel maxZoom;
+
+            inline bool operator==(const CollectedSourceBounds& that) const
+            {
+                return obfFile == that.obfFile && minZoom == that.minZoom && maxZoom == that.maxZoom;
+            }
+
+            inline bool operator!=(const CollectedSourceBounds& that) const
+            {
+                return !(*this == that);
+            }
+        };
+        typedef QuadTree<CollectedSourceBounds, AreaI::CoordType> CollectedSourcesBoundsTree;
+        enum {
+            CollectedSourcesBoundsTreeMaxDepth = 12,
+        };
+        mutable std::array<CollectedSourcesBoundsTree, static_cast<int>(ObfDataType::Transport) + 1> _collectedSourcesBounds;
+        mutable QHash< const ObfFile*, std::shared_ptr<const ObfFile> > _boundedCollectedSources;
+        // Basemaps and files without information yet are not bounded and always checked directly
+        mutable QList< std::shared_ptr<const ObfFile> > _unboundedCollectedSources;
+        void updateCollectedSourcesBounds() const;
+        void insertCollectedSourceBounds(const std::shared_ptr<const ObfFile>& obfFile) const;
+        void boundNewlyInformedSources() const;
+
+        struct ObfReadersPool Q_DECL_FINAL
+        {
+            // Readers are pooled by file identity (path, size and modification time) rather than by
+            // ObfFile instance, since same file is collected again as another instance.
+            // Memory-mapped readers use null thread
+            struct Key
+            {
+                Key();
+                Key(const std::shared_ptr<const ObfFile>& obfFile, const Qt::HANDLE threadId);
+
+                QString filePath;
+                uint64_t fileSize;
+                int64_t lastModifiedTime;
+                Qt::HANDLE threadId;
+
+                inline bool operator==(const Key& that) const
+                {
+                    return threadId == that.threadId &&
+                        fileSize == that.fileSize &&
+                        lastModifiedTime == that.lastModifiedTime &&
+                        filePath == that.filePath;
+                }
+
+                inline bool operator!=(const Key& that) const
+                {
+                    return !(*this == that);
+                }
+
+                friend inline uint qHash(const Key& key, uint seed = 0) Q_DECL_NOTHROW
+                {
+                    return ::qHash(key.filePath, seed) ^
+                        ::qHash(key.fileSize, seed) ^
+                        ::qHash(key.lastModifiedTime, seed) ^
+                        ::qHash(key.threadId, seed);
+                }
+            };
+
+            ObfReadersPool();
+            ~ObfReadersPool();
+
+            mutable QMutex mutex;
+            unsigned int maxIdleReaders;
+            unsigned int maxOpenReaders;
+            bool memoryMapped;
+            unsigned int generation;
+            QHash< Key, std::shared_ptr<ObfReader> > idleReaders;
+            QList<Key> idleReadersLRU;
+
+            // Readers that own file handle, both idle and leased ones. Decreased once reader is
+            // destroyed, which may happen without lock
+            QAtomicInt openReadersCount;
+
+            void release(
+                const Key& key,
+                const std::shared_ptr<ObfReader>& obfReader,
+                const unsigned int leaseGeneration);
+            void purge();
+            // Drops idle readers of files that are gone or were changed since reader was opened
+            void purgeChanged();
+            void evictExcessive(QList< std::shared_ptr<ObfReader> >& outEvictedReaders);
+
+        private:
+            Q_DISABLE_COPY_AND_MOVE(ObfReadersPool);
+        };
+        const std::shared_ptr<ObfReadersPool> _obfReadersPool;
+        std::shared_ptr<const ObfReader> leaseObfReader(const std::shared_ptr<const ObfFile>& obfFile) const;
+
+        std::shared_ptr<Concurrent::WorkerPool> _dataInterfaceWorkerPool;
+        mutable QMutex _dataInterfaceWorkerPoolMutex;
+        std::shared_ptr<Concurrent::WorkerPool> getDataInterfaceWorkerPool() const;
     public:
         virtual ~ObfsCollection_P();
 
@@ -90,6 +199,11 @@ namespace OsmAnd
         ObfsCollection::SourceOriginId addFile(const QFileInfo& fileInfo);
         bool remove(const ObfsCollection::SourceOriginId entryId);
 
+        void setMaxIdleObfReaders(const unsigned int maxIdleObfReaders);
+        void setMaxOpenObfReaders(const unsigned int maxOpenObfReaders);
+        void setUseMemoryMappedObfReaders(const bool useMemoryMappedObfReaders);
+        void setDataInterfaceWorkerPool(const std::shared_ptr<Concurrent::WorkerPool>& workerPool);
+
         QList< std::shared_ptr<const ObfFile> > getObfFiles() const;
         std::shared_ptr<OsmAnd::ObfDataInterface> obtainDataInterface(
             const std::shared_ptr<const ObfFile> obfFile) const;
@@ -89,6 +89,16 @@ bool OsmAnd::ResourcesManager::isLocalResource(const QString& id) const
     return _p->isLocalResource(id);
 }
 
+void OsmAnd::ResourcesManager::setUseMemoryMappedObfReaders(const bool useMemoryMappedObfReaders)
+{
+    _p->setUseMemoryMappedObfReaders(useMemoryMappedObfReaders);
+}
+
+bool OsmAnd::ResourcesManager::getUseMemoryMappedObfReaders() const
+{
+    return _p->getUseMemoryMappedObfReaders();
+}
+
 bool OsmAnd::ResourcesManager::isRepositoryAvailable() const
 {
     return _p->isRepositoryAvailable();
@@ -31,6 +31,7 @@ OsmAnd::ResourcesManager_P::ResourcesManager_P(
     : owner(owner_)
     , _fileSystemWatcher(new QFileSystemWatcher())
     , _localResourcesLock(QReadWriteLock::Recursive)
+    , _useMemoryMappedObfReaders(0)
     , _resourcesInRepositoryLoaded(false)
     , _webClient(webClient_)
     , changesManager(new IncrementalChangesManager(webClient_, owner_))
@@ -268,7 +269,11 @@ bool OsmAnd::ResourcesManager_P::loadLocalResourcesFromPath(
     if (!isUnmanagedStorage)
     {
         auto cachedOsmandIndexes = std::make_shared<CachedOsmandIndexes>();
-        QFile indCache(QDir(owner->localStoragePath).absoluteFilePath(QLatin1String("ind.cache")));
+        // "ind.cache" belongs to OsmAnd app, so it's only read, while own cache is kept aside
+        const QFile appIndCache(QDir(owner->localStoragePath).absoluteFilePath(QLatin1String("ind.cache")));
+        if (appIndCache.exists())
+            cachedOsmandIndexes->readFromFile(appIndCache.fileName(), CachedOsmandIndexes::VERSION);
+        QFile indCache(QDir(owner->localStoragePath).absoluteFilePath(QLatin1String("ind_core.cache")));
         if (indCache.exists())
         {
             cachedOsmandIndexes->readFromFile(indCache.fileName(), CachedOsmandIndexes::VERSION);
@@ -963,6 +968,23 @@ void OsmAnd::ResourcesManager_P::loadRepositoryFromCache()
     _resourcesInRepositoryLoaded = true;
 }
 
+void OsmAnd::ResourcesManager_P::setUseMemoryMappedObfReaders(const bool useMemoryMappedObfReaders)
+{
+    _useMemoryMappedObfReaders.storeRelease(useMemoryMappedObfReaders ? 1 : 0);
+}
+
+bool OsmAnd::ResourcesManager_P::getUseMemoryMappedObfReaders() const
+{
+    return _useMemoryMappedObfReaders.loadAcquire() != 0;
+}
+
+std::shared_ptr<const OsmAnd::ObfReader> OsmAnd::ResourcesManager_P::createObfReader(
+    const std::shared_ptr<const ObfFile>& obfFile) const
+{
+    // Mapping is shared by all memory-mapped readers of the file, so new reader costs nothing
+    return std::make_shared<ObfReader>(obfFile, getUseMemoryMappedObfReaders());
+}
+
 bool OsmAnd::ResourcesManager_P::isRepositoryAvailable() const
 {
     return _resourcesInRepositoryLoaded;
@@ -1229,7 +1251,11 @@ bool OsmAnd::ResourcesManager_P::installObfFromFile(
         return false;
 
     auto cachedOsmandIndexes = std::make_shared<CachedOsmandIndexes>();
-    QFile indCache(QDir(owner->localStoragePath).absoluteFilePath(QLatin1String("ind.cache")));
+    // "ind.cache" belongs to OsmAnd app, so it's only read, while own cache is kept aside
+    const QFile appIndCache(QDir(owner->localStoragePath).absoluteFilePath(QLatin1String("ind.cache")));
+    if (appIndCache.exists())
+        cachedOsmandIndexes->readFromFile(appIndCache.fileName(), CachedOsmandIndexes::VERSION);
+    QFile indCache(QDir(owner->localStoragePath).absoluteFilePath(QLatin1String("ind_core.cache")));
     if (indCache.exists())
     {
         cachedOsmandIndexes->readFromFile(indCache.fileName(), CachedOsmandIndexes::VERSION);
@@ -1714,7 +1740,7 @@ QList< std::shared_ptr<const OsmAnd::ObfFile> > OsmAnd::ResourcesManager_P::Obfs
 std::shared_ptr<OsmAnd::ObfDataInterface> OsmAnd::ResourcesManager_P::ObfsCollectionProxy::obtainDataInterface(
     const std::shared_ptr<const ObfFile> obfFile) const
 {
-    return std::shared_ptr<ObfDataInterface>(new ObfDataInterfaceProxy({ std::make_shared<ObfReader>(obfFile) }, {}));
+    return std::shared_ptr<ObfDataInterface>(new ObfDataInterfaceProxy({ owner->createObfReader(obfFile) }, {}));
 }
 
 std::shared_ptr<OsmAnd::ObfDataInterface> OsmAnd::ResourcesManager_P::ObfsCollectionProxy::obtainDataInterface(
@@ -1747,13 +1773,11 @@ std::shared_ptr<OsmAnd::ObfDataInterface> OsmAnd::ResourcesManager_P::ObfsCollec
         
         if (obfMetadata->obfFile->obfInfo->isBasemapWithCoastlines)
             otherBasemapPresent = true;
-        std::shared_ptr<const ObfReader> obfReader(new ObfReader(obfMetadata->obfFile));
-        obfReaders.push_back(qMove(obfReader));
+        obfReaders.push_back(owner->createObfReader(obfMetadata->obfFile));
     }
     if (!otherBasemapPresent && owner->_miniBasemapObfFile)
     {
-        std::shared_ptr<const ObfReader> obfReader(new ObfReader(owner->_miniBasemapObfFile));
-        obfReaders.push_back(qMove(obfReader));
+        obfReaders.push_back(owner->createObfReader(owner->_miniBasemapObfFile));
     }
     
     return std::shared_ptr<ObfDataInterface>(new ObfDataInterfaceProxy(obfReaders, lockedResources));
@@ -1818,13 +1842,11 @@ std::shared_ptr<OsmAnd::ObfDataInterface> OsmAnd::ResourcesManager_P::ObfsCollec
 
         if (obfMetadata->obfFile->obfInfo->isBasemapWithCoastlines)
             otherBasemapPresent = true;
-        std::shared_ptr<const ObfReader> obfReader(new ObfReader(obfMetadata->obfFile));
-        obfReaders.push_back(qMove(obfReader));
+        obfReaders.push_back(owner->createObfReader(obfMetadata->obfFile));
     }
     if (!otherBasemapPresent && owner->_miniBasemapObfFile)
     {
-        std::shared_ptr<const ObfReader> obfReader(new ObfReader(owner->_miniBasemapObfFile));
-        obfReaders.push_back(qMove(obfReader));
+        obfReaders.push_back(owner->createObfReader(owner->_miniBasemapObfFile));
     }
 
     sortReaders(obfReaders);
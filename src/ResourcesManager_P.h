@@ -9,6 +9,7 @@
 #include <QHash>
 #include <QString>
 #include <QReadWriteLock>
+#include <QAtomicInt>
 #include <QFileSystemWatcher>
 #include <QXmlStreamReader>
 
@@ -90,6 +91,8 @@ namespace OsmAnd
             QHash< QString, std::shared_ptr<const LocalResource> > &outResult) const;
 
         std::shared_ptr<const ObfFile> _miniBasemapObfFile;
+        QAtomicInt _useMemoryMappedObfReaders;
+        std::shared_ptr<const ObfReader> createObfReader(const std::shared_ptr<const ObfFile>& obfFile) const;
 
         mutable QReadWriteLock _resourcesInRepositoryLock;
         mutable QHash< QString, std::shared_ptr<const ResourceInRepository> > _resourcesInRepository;
@@ -230,6 +233,10 @@ namespace OsmAnd
         std::shared_ptr<const LocalResource> getLocalResource(const QString& id) const;
         bool isLocalResource(const QString& id) const;
 
+        // OBF readers:
+        void setUseMemoryMappedObfReaders(const bool useMemoryMappedObfReaders);
+        bool getUseMemoryMappedObfReaders() const;
+
         // Resources in repository:
         bool isRepositoryAvailable() const;
         bool updateRepository() const;
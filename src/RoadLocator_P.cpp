@@ -4,6 +4,7 @@
 #include "Road.h"
 #include "IObfsCollection.h"
 #include "ObfDataInterface.h"
+#include "ObfRoutingSegmentsIndex.h"
 #include "Utilities.h"
 
 OsmAnd::RoadLocator_P::RoadLocator_P(RoadLocator* const owner_)
@@ -156,33 +157,8 @@ std::shared_ptr<const OsmAnd::Road> OsmAnd::RoadLocator_P::findNearestRoad(
 
         for (auto idx = 1, count = points31.size(); idx < count; idx++)
         {
-            const auto& cpx31 = points31[idx].x;
-            const auto& cpy31 = points31[idx].y;
-            const auto& ppx31 = points31[idx - 1].x;
-            const auto& ppy31 = points31[idx - 1].y;
-
-            auto sqDistance = Utilities::squareDistance31(cpx31, cpy31, ppx31, ppy31);
-
-            uint32_t rx31;
-            uint32_t ry31;
-            auto projection = Utilities::projection31(ppx31, ppy31, cpx31, cpy31, position31.x, position31.y);
-            if (projection < 0)
-            {
-                rx31 = ppx31;
-                ry31 = ppy31;
-            }
-            else if (projection >= sqDistance)
-            {
-                rx31 = cpx31;
-                ry31 = cpy31;
-            }
-            else
-            {
-                const auto& factor = projection / sqDistance;
-                rx31 = ppx31 + (cpx31 - ppx31) * factor;
-                ry31 = ppy31 + (cpy31 - ppy31) * factor;
-            }
-            sqDistance = Utilities::squareDistance31(rx31, ry31, position31.x, position31.y);
+            PointI projection31;
+            const auto sqDistance = ObfRoutingSegmentsIndex::projectOnSegment(*road, idx, position31, projection31);
 
             if (!minDistanceRoad || sqDistance < minSqDistance)
             {
@@ -230,39 +206,14 @@ QVector<std::pair<std::shared_ptr<const OsmAnd::Road>, std::shared_ptr<const Osm
         double minSqDistance = std::numeric_limits<double>::max();
         for (auto idx = 1, count = points31.size(); idx < count; idx++)
         {
-            const auto& cpx31 = points31[idx].x;
-            const auto& cpy31 = points31[idx].y;
-            const auto& ppx31 = points31[idx - 1].x;
-            const auto& ppy31 = points31[idx - 1].y;
-
-            auto sqDistance = Utilities::squareDistance31(cpx31, cpy31, ppx31, ppy31);
-
-            uint32_t rx31;
-            uint32_t ry31;
-            auto projection = Utilities::projection31(ppx31, ppy31, cpx31, cpy31, position31.x, position31.y);
-            if (projection < 0)
-            {
-                rx31 = ppx31;
-                ry31 = ppy31;
-            }
-            else if (projection >= sqDistance)
-            {
-                rx31 = cpx31;
-                ry31 = cpy31;
-            }
-            else
-            {
-                const auto& factor = projection / sqDistance;
-                rx31 = ppx31 + (cpx31 - ppx31) * factor;
-                ry31 = ppy31 + (cpy31 - ppy31) * factor;
-            }
-            sqDistance = Utilities::squareDistance31(rx31, ry31, position31.x, position31.y);
+            PointI projection31;
+            const auto sqDistance = ObfRoutingSegmentsIndex::projectOnSegment(*road, idx, position31, projection31);
 
             if (sqDistance < minSqDistance)
             {
                 minSqDistance = sqDistance;
-                roadInfo->preciseX = rx31;
-                roadInfo->preciseY = ry31;
+                roadInfo->preciseX = projection31.x;
+                roadInfo->preciseY = projection31.y;
                 roadInfo->distSquare = minSqDistance;
             }
         }
@@ -311,3 +262,142 @@ QList<std::shared_ptr<const OsmAnd::Road>> OsmAnd::RoadLocator_P::findRoadsInAre
 
     return filteredRoads;
 }
+
+std::shared_ptr<const OsmAnd::Road> OsmAnd::RoadLocator_P::findNearestRoadInDataBlocks(
+    const QList< std::shared_ptr<const ObfRoutingSectionReader::DataBlock> >& dataBlocks,
+    const PointI position31,
+    const double radiusInMeters,
+    const ObfRoutingSectionReader::VisitorFunction filter,
+    int* const outNearestRoadPointIndex,
+    double* const outDistanceToNearestRoadPoint)
+{
+    if (outNearestRoadPointIndex)
+        *outNearestRoadPointIndex = -1;
+    if (outDistanceToNearestRoadPoint)
+        *outDistanceToNearestRoadPoint = -1.0;
+
+    std::shared_ptr<const Road> minDistanceRoad;
+    int minDistancePointIdx = -1;
+    double minSqDistance = radiusInMeters * radiusInMeters;
+
+    // Road is checked by filter once, no matter how many of its segments are visited
+    QHash<const Road*, bool> filterResults;
+    for (const auto& dataBlock : constOf(dataBlocks))
+    {
+        const auto segmentsIndex = dataBlock->getSegmentsIndex();
+        segmentsIndex->visitSegments(
+            position31,
+            minSqDistance,
+            [&segmentsIndex, position31, &filter, &filterResults, &minDistanceRoad, &minDistancePointIdx, &minSqDistance]
+            (const ObfRoutingSegmentsIndex::Segment& segment) -> double
+            {
+                const auto& road = segmentsIndex->roads[segment.roadIndex];
+                if (filter)
+                {
+                    auto itFilterResult = filterResults.find(road.get());
+                    if (itFilterResult == filterResults.end())
+                        itFilterResult = filterResults.insert(road.get(), filter(road));
+                    if (!*itFilterResult)
+                        return minSqDistance;
+                }
+
+                PointI projection31;
+                const auto sqDistance = ObfRoutingSegmentsIndex::projectOnSegment(
+                    *road,
+                    segment.pointIndex,
+                    position31,
+                    projection31);
+                if (minDistanceRoad ? sqDistance < minSqDistance : sqDistance <= minSqDistance)
+                {
+                    minDistanceRoad = road;
+                    minDistancePointIdx = segment.pointIndex;
+                    minSqDistance = sqDistance;
+                }
+
+                return minSqDistance;
+            });
+    }
+
+    if (minDistanceRoad)
+    {
+        if (outNearestRoadPointIndex)
+            *outNearestRoadPointIndex = minDistancePointIdx;
+        if (outDistanceToNearestRoadPoint)
+            *outDistanceToNearestRoadPoint = qSqrt(minSqDistance);
+    }
+
+    return minDistanceRoad;
+}
+
+QVector<std::pair<std::shared_ptr<const OsmAnd::Road>, std::shared_ptr<const OsmAnd::RoadInfo>>> OsmAnd::RoadLocator_P::sortedRoadsInDataBlocksByDistance(
+    const QList< std::shared_ptr<const ObfRoutingSectionReader::DataBlock> >& dataBlocks,
+    const PointI position31,
+    const double radiusInMeters,
+    const ObfRoutingSectionReader::VisitorFunction filter)
+{
+    const auto sqRadius = radiusInMeters * radiusInMeters;
+
+    // Nearest projection of each road, roads rejected by filter are kept with null info
+    QHash<const Road*, std::pair<std::shared_ptr<const Road>, std::shared_ptr<RoadInfo>>> nearestProjections;
+    for (const auto& dataBlock : constOf(dataBlocks))
+    {
+        const auto segmentsIndex = dataBlock->getSegmentsIndex();
+        segmentsIndex->visitSegments(
+            position31,
+            sqRadius,
+            [&segmentsIndex, position31, sqRadius, &filter, &nearestProjections]
+            (const ObfRoutingSegmentsIndex::Segment& segment) -> double
+            {
+                const auto& road = segmentsIndex->roads[segment.roadIndex];
+                auto itNearestProjection = nearestProjections.find(road.get());
+                if (itNearestProjection == nearestProjections.end())
+                {
+                    std::shared_ptr<RoadInfo> roadInfo;
+                    if (!filter || filter(road))
+                    {
+                        roadInfo = std::make_shared<RoadInfo>();
+                        roadInfo->distSquare = std::numeric_limits<double>::max();
+                        roadInfo->preciseX = 0;
+                        roadInfo->preciseY = 0;
+                    }
+                    itNearestProjection = nearestProjections.insert(road.get(), std::make_pair(road, roadInfo));
+                }
+                const auto& roadInfo = itNearestProjection->second;
+                if (!roadInfo)
+                    return sqRadius;
+
+                PointI projection31;
+                const auto sqDistance = ObfRoutingSegmentsIndex::projectOnSegment(
+                    *road,
+                    segment.pointIndex,
+                    position31,
+                    projection31);
+                if (sqDistance < roadInfo->distSquare)
+                {
+                    roadInfo->distSquare = sqDistance;
+                    roadInfo->preciseX = projection31.x;
+                    roadInfo->preciseY = projection31.y;
+                }
+
+                return sqRadius;
+            });
+    }
+
+    QVector<std::pair<std::shared_ptr<const Road>, std::shared_ptr<const RoadInfo>>> result;
+    for (const auto& nearestProjection : constOf(nearestProjections))
+    {
+        if (!nearestProjection.second || nearestProjection.second->distSquare > sqRadius)
+            continue;
+        result.append(std::make_pair(nearestProjection.first, nearestProjection.second));
+    }
+
+    std::sort(result.begin(), result.end(),
+        []
+        (const std::pair<std::shared_ptr<const Road>, std::shared_ptr<const RoadInfo>>& a,
+            const std::pair<std::shared_ptr<const Road>, std::shared_ptr<const RoadInfo>>& b)
+        {
+            return a.second->distSquare < b.second->distSquare;
+        });
+
+    return result;
+}
@@ -5,6 +5,7 @@
 
 #include "QtExtensions.h"
 #include <QList>
+#include <QHash>
 
 #include "OsmAndCore.h"
 #include "CommonTypes.h"
@@ -85,6 +86,20 @@ namespace OsmAnd
             const double radiusInMeters,
             const ObfRoutingSectionReader::VisitorFunction filter);
 
+        // Same as above, but over all roads of data blocks, using segments index of each block
+        static std::shared_ptr<const Road> findNearestRoadInDataBlocks(
+            const QList< std::shared_ptr<const ObfRoutingSectionReader::DataBlock> >& dataBlocks,
+            const PointI position31,
+            const double radiusInMeters,
+            const ObfRoutingSectionReader::VisitorFunction filter,
+            int* const outNearestRoadPointIndex,
+            double* const outDistanceToNearestRoadPoint);
+        static QVector<std::pair<std::shared_ptr<const Road>, std::shared_ptr<const RoadInfo>>> sortedRoadsInDataBlocksByDistance(
+            const QList< std::shared_ptr<const ObfRoutingSectionReader::DataBlock> >& dataBlocks,
+            const PointI position31,
+            const double radiusInMeters,
+            const ObfRoutingSectionReader::VisitorFunction filter);
+
         friend class OsmAnd::RoadLocator;
     };
 }
@@ -0,0 +1,595 @@
+#include "RouteMatcher.h"
+
+#include <cmath>
+#include <limits>
+#include <queue>
+#include <vector>
+#include <algorithm>
+
+#include <OsmAndCore/QtExtensions.h>
+#include <QtCore>
+
+#include "RoutePlanner.h"
+#include "GeoInfoDocument.h"
+#include "Utilities.h"
+#include "WorkerPool.h"
+
+namespace
+{
+    // Same projection as route planner uses to find closest road point
+    double projectOnSegment(
+        const OsmAnd::PointI& from31,
+        const OsmAnd::PointI& to31,
+        const OsmAnd::PointI& point31,
+        OsmAnd::PointI& outProjection31)
+    {
+        const auto sqLength = OsmAnd::Utilities::squareDistance31(to31.x, to31.y, from31.x, from31.y);
+        const auto projection = OsmAnd::Utilities::projection31(from31.x, from31.y, to31.x, to31.y, point31.x, point31.y);
+        if (projection < 0)
+            outProjection31 = from31;
+        else if (projection >= sqLength)
+            outProjection31 = to31;
+        else
+        {
+            const auto factor = projection / sqLength;
+            outProjection31.x = from31.x + (to31.x - from31.x) * factor;
+            outProjection31.y = from31.y + (to31.y - from31.y) * factor;
+        }
+
+        return OsmAnd::Utilities::squareDistance31(outProjection31.x, outProjection31.y, point31.x, point31.y);
+    }
+}
+
+struct OsmAnd::RouteMatcher::NearbyRoads
+{
+    NearbyRoads()
+        : areaId(std::numeric_limits<uint64_t>::max())
+    {
+    }
+
+    uint64_t areaId;
+    QList< std::shared_ptr<const Road> > roads;
+    QVector<AreaI> bboxes31;
+};
+
+// Roads that route planner context reads from OBF files
+class OsmAnd::RouteMatcher::RoutePlannerRoadsGraph : public IRoadsGraph
+{
+private:
+    std::unique_ptr<RoutePlannerContext::CalculationContext> _calculationContext;
+protected:
+public:
+    RoutePlannerRoadsGraph(RoutePlannerContext* const context);
+    virtual ~RoutePlannerRoadsGraph();
+
+    RoutePlannerContext* const context;
+
+    virtual uint64_t getAreaId(const PointI& point31);
+    virtual void obtainRoadsAround(const PointI& point31, QList< std::shared_ptr<const Road> >& outRoads);
+    virtual void obtainRoadsAt(
+        const PointI& point31,
+        QList< std::pair< std::shared_ptr<const Road>, uint32_t > >& outRoads);
+    virtual RoadDirection getDirection(const std::shared_ptr<const Road>& road);
+    virtual void releaseSearchData();
+};
+
+OsmAnd::RouteMatcher::RoutePlannerRoadsGraph::RoutePlannerRoadsGraph(RoutePlannerContext* const context_)
+    : _calculationContext(new RoutePlannerContext::CalculationContext(context_))
+    , context(context_)
+{
+}
+
+OsmAnd::RouteMatcher::RoutePlannerRoadsGraph::~RoutePlannerRoadsGraph()
+{
+}
+
+uint64_t OsmAnd::RouteMatcher::RoutePlannerRoadsGraph::getAreaId(const PointI& point31)
+{
+    return RoutePlanner::getRoutingTileId(context, point31.x, point31.y, true);
+}
+
+void OsmAnd::RouteMatcher::RoutePlannerRoadsGraph::obtainRoadsAround(
+    const PointI& point31,
+    QList< std::shared_ptr<const Road> >& outRoads)
+{
+    // Roads of the tile with the point and of all tiles around it
+    const auto tileSize31 = 1u << (31 - context->_roadTilesLoadingZoomLevel);
+    const auto tileCenterX31 = (static_cast<uint32_t>(point31.x) & ~(tileSize31 - 1)) + tileSize31 / 2;
+    const auto tileCenterY31 = (static_cast<uint32_t>(point31.y) & ~(tileSize31 - 1)) + tileSize31 / 2;
+    RoutePlanner::loadRoads(context, tileCenterX31, tileCenterY31, context->_roadTilesLoadingZoomLevel, outRoads);
+}
+
+void OsmAnd::RouteMatcher::RoutePlannerRoadsGraph::obtainRoadsAt(
+    const PointI& point31,
+    QList< std::pair< std::shared_ptr<const Road>, uint32_t > >& outRoads)
+{
+    auto segment = RoutePlanner::loadRouteCalculationSegment(_calculationContext.get(), point31.x, point31.y);
+    while (segment)
+    {
+        outRoads.push_back(std::make_pair(segment->road, segment->pointIndex));
+        segment = segment->next;
+    }
+}
+
+OsmAnd::RoadDirection OsmAnd::RouteMatcher::RoutePlannerRoadsGraph::getDirection(const std::shared_ptr<const Road>& road)
+{
+    return context->profileContext->getDirection(road);
+}
+
+void OsmAnd::RouteMatcher::RoutePlannerRoadsGraph::releaseSearchData()
+{
+    // Segments made by search are released, tiles stay loaded in context
+    _calculationContext.reset(new RoutePlannerContext::CalculationContext(context));
+}
+
+OsmAnd::RouteMatcher::IRoadsGraph::IRoadsGraph()
+{
+}
+
+OsmAnd::RouteMatcher::IRoadsGraph::~IRoadsGraph()
+{
+}
+
+void OsmAnd::RouteMatcher::IRoadsGraph::releaseSearchData()
+{
+}
+
+OsmAnd::RouteMatcher::Settings::Settings()
+    : searchRadius(50.0)
+    , maxCandidatesCount(5)
+    , positionSigma(10.0)
+    , transitionBeta(10.0)
+    , maxRouteDistanceFactor(3.0)
+    , minPointsDistance(20.0)
+{
+}
+
+OsmAnd::RouteMatcher::MatchedPoint::MatchedPoint()
+    : pointIndex(0)
+    , distance(0.0)
+{
+}
+
+OsmAnd::RouteMatcher::RouteMatcher()
+{
+}
+
+OsmAnd::RouteMatcher::~RouteMatcher()
+{
+}
+
+void OsmAnd::RouteMatcher::obtainNearbyRoads(
+    IRoadsGraph* graph,
+    const PointI& point31,
+    NearbyRoads& inOutNearbyRoads)
+{
+    // Roads around the point are kept while points stay in the same area, so consecutive
+    // points don't collect and deduplicate them again
+    const auto areaId = graph->getAreaId(point31);
+    if (areaId == inOutNearbyRoads.areaId)
+        return;
+
+    QList< std::shared_ptr<const Road> > roads;
+    graph->obtainRoadsAround(point31, roads);
+
+    inOutNearbyRoads.areaId = areaId;
+    inOutNearbyRoads.roads.clear();
+    inOutNearbyRoads.bboxes31.clear();
+
+    // Roads that go through several tiles may come once per tile
+    QSet<uint64_t> processedRoads;
+    for (const auto& road : constOf(roads))
+    {
+        if (road->points31.size() <= 1 || processedRoads.contains(road->id))
+            continue;
+        processedRoads.insert(road->id);
+
+        AreaI bbox31(road->points31.first(), road->points31.first());
+        for (const auto& point : constOf(road->points31))
+            bbox31.enlargeToInclude(point);
+
+        inOutNearbyRoads.roads.push_back(road);
+        inOutNearbyRoads.bboxes31.push_back(bbox31);
+    }
+}
+
+void OsmAnd::RouteMatcher::findCandidates(
+    const NearbyRoads& nearbyRoads,
+    const PointI& point31,
+    const Settings& settings,
+    QVector<MatchedPoint>& outCandidates)
+{
+    outCandidates.clear();
+
+    const auto radiusX31 = Utilities::metersToX31(settings.searchRadius);
+    const auto radiusY31 = Utilities::metersToY31(settings.searchRadius);
+    const auto sqRadius = settings.searchRadius * settings.searchRadius;
+    for (auto roadIdx = 0, roadsCount = nearbyRoads.roads.size(); roadIdx < roadsCount; roadIdx++)
+    {
+        const auto& bbox31 = nearbyRoads.bboxes31[roadIdx];
+        if (point31.x < bbox31.left() - radiusX31 || point31.x > bbox31.right() + radiusX31 ||
+            point31.y < bbox31.top() - radiusY31 || point31.y > bbox31.bottom() + radiusY31)
+        {
+            continue;
+        }
+
+        // Each road gives single candidate, at its nearest segment
+        const auto candidate = matchToRoad(nearbyRoads.roads[roadIdx], point31);
+        if (candidate.distance * candidate.distance <= sqRadius)
+            outCandidates.push_back(candidate);
+    }
+
+    std::sort(outCandidates.begin(), outCandidates.end(),
+        []
+        (const MatchedPoint& l, const MatchedPoint& r) -> bool
+        {
+            return l.distance < r.distance;
+        });
+    if (outCandidates.size() > settings.maxCandidatesCount)
+        outCandidates.resize(settings.maxCandidatesCount);
+}
+
+OsmAnd::RouteMatcher::MatchedPoint OsmAnd::RouteMatcher::matchToRoad(
+    const std::shared_ptr<const Road>& road,
+    const PointI& point31)
+{
+    MatchedPoint matchedPoint;
+
+    auto minSqDistance = std::numeric_limits<double>::max();
+    const auto& points = road->points31;
+    for (auto pointIdx = 1, pointsCount = points.size(); pointIdx < pointsCount; pointIdx++)
+    {
+        PointI projection31;
+        const auto sqDistance = projectOnSegment(points[pointIdx - 1], points[pointIdx], point31, projection31);
+        if (sqDistance >= minSqDistance)
+            continue;
+
+        minSqDistance = sqDistance;
+        matchedPoint.road = road;
+        matchedPoint.pointIndex = pointIdx;
+        matchedPoint.point31 = projection31;
+    }
+    if (matchedPoint.road)
+        matchedPoint.distance = qSqrt(minSqDistance);
+
+    return matchedPoint;
+}
+
+bool OsmAnd::RouteMatcher::isMovementAllowed(
+    IRoadsGraph* graph,
+    const std::shared_ptr<const Road>& road,
+    const bool towardsLastPoint)
+{
+    // Same convention as in route search: one-way roads marked as reverse go from first point to last
+    const auto direction = graph->getDirection(road);
+    if (towardsLastPoint)
+        return (direction == RoadDirection::TwoWay || direction == RoadDirection::OneWayReverse);
+    return (direction == RoadDirection::TwoWay || direction == RoadDirection::OneWayForward);
+}
+
+void OsmAnd::RouteMatcher::measureRouteDistances(
+    IRoadsGraph* graph,
+    const MatchedPoint& from,
+    const QVector<MatchedPoint>& targets,
+    const double maxDistance,
+    QVector<double>& outDistances)
+{
+    const auto targetsCount = targets.size();
+    outDistances.fill(std::numeric_limits<double>::infinity(), targetsCount);
+
+    // Dijkstra search by distance over road points, limited by the distance. Turns and turn
+    // restrictions are not taken into account, matching only needs to know how far targets are
+    struct Node
+    {
+        double distance;
+        std::shared_ptr<const Road> road;
+        uint32_t pointIndex;
+
+        inline bool operator>(const Node& that) const
+        {
+            return distance > that.distance;
+        }
+    };
+    std::priority_queue< Node, std::vector<Node>, std::greater<Node> > queue;
+    QSet<uint64_t> settledNodes;
+    const auto enqueue =
+        [&queue, &settledNodes, maxDistance]
+        (const std::shared_ptr<const Road>& road, const uint32_t pointIndex, const double distance)
+        {
+            if (distance > maxDistance || settledNodes.contains(RoutePlanner::encodeRoutePointId(road, pointIndex)))
+                return;
+            queue.push({ distance, road, pointIndex });
+        };
+
+    // Target on the same segment is reached without leaving it, if road goes that way
+    const auto& fromRoad = from.road;
+    const auto& fromSegmentStart = fromRoad->points31[from.pointIndex - 1];
+    const auto fromOffset = Utilities::distance31(fromSegmentStart.x, fromSegmentStart.y, from.point31.x, from.point31.y);
+    for (auto targetIdx = 0; targetIdx < targetsCount; targetIdx++)
+    {
+        const auto& target = targets[targetIdx];
+        if (target.road->id != fromRoad->id || target.pointIndex != from.pointIndex)
+            continue;
+
+        const auto targetOffset = Utilities::distance31(fromSegmentStart.x, fromSegmentStart.y, target.point31.x, target.point31.y);
+        if (isMovementAllowed(graph, fromRoad, targetOffset >= fromOffset))
+            outDistances[targetIdx] = qAbs(targetOffset - fromOffset);
+    }
+
+    const auto& fromSegmentEnd = fromRoad->points31[from.pointIndex];
+    if (isMovementAllowed(graph, fromRoad, true))
+        enqueue(fromRoad, from.pointIndex, Utilities::distance31(from.point31.x, from.point31.y, fromSegmentEnd.x, fromSegmentEnd.y));
+    if (isMovementAllowed(graph, fromRoad, false))
+        enqueue(fromRoad, from.pointIndex - 1, fromOffset);
+
+    QList< std::pair< std::shared_ptr<const Road>, uint32_t > > roadsAtPoint;
+    while (!queue.empty())
+    {
+        const auto node = queue.top();
+        queue.pop();
+
+        // Once all targets are reached, nothing closer can be found beyond the farthest of them
+        auto farthestTargetDistance = 0.0;
+        for (const auto distance : constOf(outDistances))
+            farthestTargetDistance = qMax(farthestTargetDistance, distance);
+        if (node.distance >= farthestTargetDistance)
+            break;
+
+        const auto nodeId = RoutePlanner::encodeRoutePointId(node.road, node.pointIndex);
+        if (settledNodes.contains(nodeId))
+            continue;
+        settledNodes.insert(nodeId);
+
+        const auto& road = node.road;
+        const auto& point = road->points31[node.pointIndex];
+        const auto canGoTowardsLastPoint = isMovementAllowed(graph, road, true);
+        const auto canGoTowardsFirstPoint = isMovementAllowed(graph, road, false);
+
+        for (auto targetIdx = 0; targetIdx < targetsCount; targetIdx++)
+        {
+            const auto& target = targets[targetIdx];
+            if (target.road->id != road->id)
+                continue;
+
+            const auto entersSegment =
+                (target.pointIndex == node.pointIndex + 1 && canGoTowardsLastPoint) ||
+                (target.pointIndex == node.pointIndex && canGoTowardsFirstPoint);
+            if (!entersSegment)
+                continue;
+
+            const auto distance = node.distance + Utilities::distance31(point.x, point.y, target.point31.x, target.point31.y);
+            outDistances[targetIdx] = qMin(outDistances[targetIdx], distance);
+        }
+
+        if (canGoTowardsLastPoint && node.pointIndex + 1 < road->points31.size())
+        {
+            const auto& nextPoint = road->points31[node.pointIndex + 1];
+            enqueue(road, node.pointIndex + 1, node.distance + Utilities::distance31(point.x, point.y, nextPoint.x, nextPoint.y));
+        }
+        if (canGoTowardsFirstPoint && node.pointIndex > 0)
+        {
+            const auto& previousPoint = road->points31[node.pointIndex - 1];
+            enqueue(road, node.pointIndex - 1, node.distance + Utilities::distance31(point.x, point.y, previousPoint.x, previousPoint.y));
+        }
+
+        // Other roads that go through this point are entered at no cost
+        roadsAtPoint.clear();
+        graph->obtainRoadsAt(point, roadsAtPoint);
+        for (const auto& roadAtPoint : constOf(roadsAtPoint))
+        {
+            if (roadAtPoint.first->id != road->id || roadAtPoint.second != node.pointIndex)
+                enqueue(roadAtPoint.first, roadAtPoint.second, node.distance);
+        }
+    }
+}
+
+bool OsmAnd::RouteMatcher::matchTrace(
+    RoutePlannerContext* context,
+    const QList< std::pair<double, double> >& trace,
+    QVector<MatchedPoint>& outMatchedPoints,
+    const Settings& settings /*= Settings()*/,
+    const IQueryController* const controller /*= nullptr*/)
+{
+    assert(context != nullptr);
+
+    RoutePlannerRoadsGraph graph(context);
+    return matchTrace(&graph, trace, outMatchedPoints, settings, controller);
+}
+
+bool OsmAnd::RouteMatcher::matchTrace(
+    IRoadsGraph* graph,
+    const QList< std::pair<double, double> >& trace,
+    QVector<MatchedPoint>& outMatchedPoints,
+    const Settings& settings /*= Settings()*/,
+    const IQueryController* const controller /*= nullptr*/)
+{
+    assert(graph != nullptr);
+
+    outMatchedPoints.fill(MatchedPoint(), trace.size());
+
+    // Step is a point of trace with own candidates. Points too close to it go after it and
+    // are put on the road of candidate chosen for the step
+    struct Step
+    {
+        int pointIdx;
+        QVector<int> followingPointsIdx;
+        QVector<MatchedPoint> candidates;
+        QVector<double> scores;
+        QVector<int> parents;
+    };
+    QVector<Step> chain;
+    QVector<PointI> points31(trace.size());
+    for (auto pointIdx = 0; pointIdx < trace.size(); pointIdx++)
+    {
+        points31[pointIdx] = PointI(
+            Utilities::get31TileNumberX(trace[pointIdx].second),
+            Utilities::get31TileNumberY(trace[pointIdx].first));
+    }
+
+    // Chain is resolved from its most likely last candidate back through parents
+    const auto finishChain =
+        [&chain, &outMatchedPoints, &points31]
+        ()
+        {
+            if (chain.isEmpty())
+                return;
+
+            const auto& lastScores = chain.last().scores;
+            auto candidateIdx = static_cast<int>(std::max_element(lastScores.cbegin(), lastScores.cend()) - lastScores.cbegin());
+            for (auto stepIdx = chain.size() - 1; stepIdx >= 0; stepIdx--)
+            {
+                const auto& step = chain[stepIdx];
+                const auto& candidate = step.candidates[candidateIdx];
+                outMatchedPoints[step.pointIdx] = candidate;
+                for (const auto followingPointIdx : constOf(step.followingPointsIdx))
+                    outMatchedPoints[followingPointIdx] = matchToRoad(candidate.road, points31[followingPointIdx]);
+
+                candidateIdx = step.parents[candidateIdx];
+            }
+            chain.clear();
+        };
+
+    NearbyRoads nearbyRoads;
+    for (auto pointIdx = 0; pointIdx < trace.size(); pointIdx++)
+    {
+        if (controller && controller->isAborted())
+            return false;
+
+        const auto& point31 = points31[pointIdx];
+        const auto& location = trace[pointIdx];
+
+        auto straightDistance = 0.0;
+        if (!chain.isEmpty())
+        {
+            const auto& previousLocation = trace[chain.last().pointIdx];
+            straightDistance = Utilities::distance(location.second, location.first, previousLocation.second, previousLocation.first);
+            if (straightDistance < settings.minPointsDistance)
+            {
+                chain.last().followingPointsIdx.push_back(pointIdx);
+                continue;
+            }
+        }
+
+        Step step;
+        step.pointIdx = pointIdx;
+        obtainNearbyRoads(graph, point31, nearbyRoads);
+        findCandidates(nearbyRoads, point31, settings, step.candidates);
+        if (step.candidates.isEmpty())
+        {
+            // Point without roads around breaks the chain and stays unmatched
+            finishChain();
+            continue;
+        }
+
+        const auto candidatesCount = step.candidates.size();
+        QVector<double> emissionScores(candidatesCount);
+        for (auto candidateIdx = 0; candidateIdx < candidatesCount; candidateIdx++)
+        {
+            const auto normalizedDistance = step.candidates[candidateIdx].distance / settings.positionSigma;
+            emissionScores[candidateIdx] = -0.5 * normalizedDistance * normalizedDistance;
+        }
+        step.scores.fill(-std::numeric_limits<double>::infinity(), candidatesCount);
+        step.parents.fill(-1, candidatesCount);
+
+        if (!chain.isEmpty())
+        {
+            const auto& previousStep = chain.last();
+            const auto maxDistance = straightDistance * settings.maxRouteDistanceFactor + 2.0 * settings.searchRadius;
+
+            QVector<double> routeDistances;
+            for (auto previousIdx = 0; previousIdx < previousStep.candidates.size(); previousIdx++)
+            {
+                const auto previousScore = previousStep.scores[previousIdx];
+                if (std::isinf(previousScore))
+                    continue;
+
+                measureRouteDistances(graph, previousStep.candidates[previousIdx], step.candidates, maxDistance, routeDistances);
+                for (auto candidateIdx = 0; candidateIdx < candidatesCount; candidateIdx++)
+                {
+                    if (std::isinf(routeDistances[candidateIdx]))
+                        continue;
+
+                    const auto transitionScore = -qAbs(routeDistances[candidateIdx] - straightDistance) / settings.transitionBeta;
+                    const auto score = previousScore + transitionScore + emissionScores[candidateIdx];
+                    if (score <= step.scores[candidateIdx])
+                        continue;
+                    step.scores[candidateIdx] = score;
+                    step.parents[candidateIdx] = previousIdx;
+                }
+            }
+            graph->releaseSearchData();
+
+            // No candidate is reachable from previous ones, so matching starts over
+            if (std::all_of(step.scores.cbegin(), step.scores.cend(), [](const double score) { return std::isinf(score); }))
+                finishChain();
+        }
+        if (chain.isEmpty())
+        {
+            step.scores = emissionScores;
+            step.parents.fill(-1);
+        }
+
+        chain.push_back(step);
+    }
+    finishChain();
+
+    return true;
+}
+
+bool OsmAnd::RouteMatcher::matchTraces(
+    const ContextFactory contextFactory,
+    const QList< QList< std::pair<double, double> > >& traces,
+    QVector< QVector<MatchedPoint> >& outMatchedTraces,
+    const Settings& settings /*= Settings()*/,
+    Concurrent::WorkerPool* const workerPool /*= nullptr*/,
+    const IQueryController* const controller /*= nullptr*/)
+{
+    outMatchedTraces.fill(QVector<MatchedPoint>(), traces.size());
+
+    // Each job writes only own item, so storage is obtained before any of them runs
+    const auto matchedTraces = outMatchedTraces.data();
+    QVector<Concurrent::WorkerPool::Job> jobs;
+    jobs.reserve(traces.size());
+    for (auto traceIdx = 0; traceIdx < traces.size(); traceIdx++)
+    {
+        jobs.push_back(
+            [contextFactory, &traces, traceIdx, matchedTraces, &settings, controller]
+            ()
+            {
+                if (controller && controller->isAborted())
+                    return;
+
+                const auto context = contextFactory();
+                if (context)
+                    matchTrace(context.get(), traces[traceIdx], matchedTraces[traceIdx], settings, controller);
+            });
+    }
+
+    if (workerPool)
+        workerPool->executeAndWait(jobs);
+    else
+    {
+        Concurrent::WorkerPool localWorkerPool;
+        localWorkerPool.executeAndWait(jobs);
+    }
+
+    return !(controller && controller->isAborted());
+}
+
+QList< QList< std::pair<double, double> > > OsmAnd::RouteMatcher::getTraces(const std::shared_ptr<const GeoInfoDocument>& document)
+{
+    QList< QList< std::pair<double, double> > > traces;
+    for (const auto& track : constOf(document->tracks))
+    {
+        for (const auto& segment : constOf(track->segments))
+        {
+            QList< std::pair<double, double> > trace;
+            for (const auto& point : constOf(segment->points))
+                trace.push_back(std::make_pair(point->position.latitude, point->position.longitude));
+            if (!trace.isEmpty())
+                traces.push_back(trace);
+        }
+    }
+
+    return traces;
+}
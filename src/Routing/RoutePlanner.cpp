@@ -1,7 +1,10 @@
 #include "RoutePlanner.h"
 
+#include <cmath>
 #include <queue>
 #include <ctime>
+#include <atomic>
+#include <limits>
 
 #include <OsmAndCore/QtExtensions.h>
 #include <QtCore>
@@ -14,9 +17,36 @@
 #include "Logging.h"
 #include "LoggingAssert.h"
 #include "Utilities.h"
-#include "PlainQueryFilter.h"
 #include "QKeyValueIterator.h"
 #include "QCachingIterator.h"
+#include "RoutingHierarchy.h"
+#include "Thread.h"
+#include "WorkerPool.h"
+
+namespace
+{
+    // Query controller of search that runs within another query, FunctorQueryController isn't
+    // used since its header brings Qt-style iteratorOf() into scope
+    class NestedQueryController : public OsmAnd::IQueryController
+    {
+    private:
+        const std::function<bool ()> _isAborted;
+    public:
+        NestedQueryController(const std::function<bool ()> isAborted)
+            : _isAborted(isAborted)
+        {
+        }
+
+        virtual ~NestedQueryController()
+        {
+        }
+
+        virtual bool isAborted() const
+        {
+            return _isAborted();
+        }
+    };
+}
 
 OsmAnd::RoutePlanner::RoutePlanner()
 {
@@ -26,10 +56,104 @@ OsmAnd::RoutePlanner::~RoutePlanner()
 {
 }
 
+class OsmAnd::RoutePlanner::RoutePlannerRoadsGraph : public IRoadsGraph
+{
+private:
+    const std::unique_ptr<RoutePlannerContext::CalculationContext> _calculationContext;
+protected:
+public:
+    RoutePlannerRoadsGraph(RoutePlannerContext* const context);
+    virtual ~RoutePlannerRoadsGraph();
+
+    RoutePlannerContext* const context;
+
+    virtual void obtainRoadsAt(
+        const PointI& point31,
+        const std::shared_ptr<const Road>& fromRoad,
+        QList< std::pair< std::shared_ptr<const Road>, uint32_t > >& outRoads);
+    virtual RoadDirection getDirection(const std::shared_ptr<const Road>& road);
+    virtual float getObstacleTime(const std::shared_ptr<const Road>& road, const uint32_t pointIndex);
+    virtual float getTime(const std::shared_ptr<const Road>& road, const float distance, const float obstaclesTime);
+    virtual float getTurnTime(
+        const std::shared_ptr<const Road>& fromRoad,
+        const uint32_t fromEnteredPointIndex,
+        const uint32_t fromPointIndex,
+        const std::shared_ptr<const Road>& toRoad,
+        const uint32_t toPointIndex,
+        const uint32_t toEndPointIndex);
+};
+
+OsmAnd::RoutePlanner::RoutePlannerRoadsGraph::RoutePlannerRoadsGraph(RoutePlannerContext* const context_)
+    : _calculationContext(new RoutePlannerContext::CalculationContext(context_))
+    , context(context_)
+{
+}
+
+OsmAnd::RoutePlanner::RoutePlannerRoadsGraph::~RoutePlannerRoadsGraph()
+{
+}
+
+void OsmAnd::RoutePlanner::RoutePlannerRoadsGraph::obtainRoadsAt(
+    const PointI& point31,
+    const std::shared_ptr<const Road>& fromRoad,
+    QList< std::pair< std::shared_ptr<const Road>, uint32_t > >& outRoads)
+{
+    const auto segmentsAtPoint = loadRouteCalculationSegment(_calculationContext.get(), point31.x, point31.y);
+    QList< std::shared_ptr<RoutePlannerContext::RouteCalculationSegment> > allowedSegments;
+    if (processRestrictions(_calculationContext.get(), allowedSegments, fromRoad, segmentsAtPoint, false))
+    {
+        for (const auto& segment : constOf(allowedSegments))
+            outRoads.push_back(std::make_pair(segment->road, segment->pointIndex));
+        return;
+    }
+
+    for (auto segment = segmentsAtPoint; segment; segment = segment->next)
+        outRoads.push_back(std::make_pair(segment->road, segment->pointIndex));
+}
+
+OsmAnd::RoadDirection OsmAnd::RoutePlanner::RoutePlannerRoadsGraph::getDirection(const std::shared_ptr<const Road>& road)
+{
+    return context->profileContext->getDirection(road);
+}
+
+float OsmAnd::RoutePlanner::RoutePlannerRoadsGraph::getObstacleTime(const std::shared_ptr<const Road>& road, const uint32_t pointIndex)
+{
+    return context->profileContext->getRoutingObstaclesExtraTime(road, pointIndex);
+}
+
+float OsmAnd::RoutePlanner::RoutePlannerRoadsGraph::getTime(
+    const std::shared_ptr<const Road>& road,
+    const float distance,
+    const float obstaclesTime)
+{
+    return calculateTimeWithObstacles(_calculationContext.get(), road, distance, obstaclesTime);
+}
+
+float OsmAnd::RoutePlanner::RoutePlannerRoadsGraph::getTurnTime(
+    const std::shared_ptr<const Road>& fromRoad,
+    const uint32_t fromEnteredPointIndex,
+    const uint32_t fromPointIndex,
+    const std::shared_ptr<const Road>& toRoad,
+    const uint32_t toPointIndex,
+    const uint32_t toEndPointIndex)
+{
+    return calculateTurnTime(_calculationContext.get(),
+        toRoad, toPointIndex, toEndPointIndex,
+        fromRoad, fromEnteredPointIndex, fromPointIndex);
+}
+
+OsmAnd::RoutePlanner::IRoadsGraph::IRoadsGraph()
+{
+}
+
+OsmAnd::RoutePlanner::IRoadsGraph::~IRoadsGraph()
+{
+}
+
 bool OsmAnd::RoutePlanner::findClosestRoadPoint(
     OsmAnd::RoutePlannerContext* context,
     double latitude, double longitude,
-    std::shared_ptr<const OsmAnd::Model::Road>* closestRoad /*= nullptr*/,
+    std::shared_ptr<const OsmAnd::Road>* closestRoad /*= nullptr*/,
     uint32_t* closestPointIndex /*= nullptr*/,
     double* sqDistanceToClosestPoint /*= nullptr*/,
     uint32_t* _rx31 /*= nullptr*/, uint32_t* _ry31 /*= nullptr*/ )
@@ -37,18 +161,18 @@ bool OsmAnd::RoutePlanner::findClosestRoadPoint(
     const auto x31 = Utilities::get31TileNumberX(longitude);
     const auto y31 = Utilities::get31TileNumberY(latitude);
 
-    QList< std::shared_ptr<const Model::Road> > roads;
+    QList< std::shared_ptr<const Road> > roads;
     loadRoads(context, x31, y31, 17, roads);
     if (roads.isEmpty())
         loadRoads(context, x31, y31, 15, roads);
 
-    std::shared_ptr<const OsmAnd::Model::Road> minDistanceRoad;
+    std::shared_ptr<const OsmAnd::Road> minDistanceRoad;
     uint32_t minDistancePointIdx;
     double minSqDistance = std::numeric_limits<double>::max();
     uint32_t min31x, min31y;
     for(const auto& road : constOf(roads))
     {
-        const auto& points = road->points;
+        const auto& points = road->points31;
         if (points.size() <= 1)
             continue;
 
@@ -111,7 +235,7 @@ bool OsmAnd::RoutePlanner::findClosestRoadPoint(
 
 bool OsmAnd::RoutePlanner::findClosestRouteSegment( OsmAnd::RoutePlannerContext* context, double latitude, double longitude, std::shared_ptr<OsmAnd::RoutePlannerContext::RouteCalculationSegment>& routeSegment )
 {
-    std::shared_ptr<const OsmAnd::Model::Road> closestRoad;
+    std::shared_ptr<const OsmAnd::Road> closestRoad;
     uint32_t closestPointIndex;
     uint32_t rx31, ry31;
 
@@ -119,7 +243,7 @@ bool OsmAnd::RoutePlanner::findClosestRouteSegment( OsmAnd::RoutePlannerContext*
         return false;
 
     // will be bug if it is not inserted
-    std::shared_ptr<Model::Road> clonedRoad(new Model::Road(closestRoad, closestPointIndex, rx31, ry31));
+    const auto clonedRoad = Road::createWithInsertedPoint(closestRoad, closestPointIndex, PointI(rx31, ry31));
     routeSegment.reset(new RoutePlannerContext::RouteCalculationSegment(clonedRoad, closestPointIndex));
     // Cache road in tiles it goes through
     cacheRoad(context, clonedRoad);
@@ -127,12 +251,12 @@ bool OsmAnd::RoutePlanner::findClosestRouteSegment( OsmAnd::RoutePlannerContext*
     return true;
 }
 
-void OsmAnd::RoutePlanner::cacheRoad( RoutePlannerContext* context, const std::shared_ptr<Model::Road>& road )
+void OsmAnd::RoutePlanner::cacheRoad( RoutePlannerContext* context, const std::shared_ptr<Road>& road )
 {
     if (!context->profileContext->acceptsRoad(road))
         return;
 
-    for(const auto& point : constOf(road->points))
+    for(const auto& point : constOf(road->points31))
     {
         const auto& px31 = point.x;
         const auto& py31 = point.y;
@@ -141,14 +265,14 @@ void OsmAnd::RoutePlanner::cacheRoad( RoutePlannerContext* context, const std::s
 
         auto itCache = context->_cachedRoadsInTiles.find(tileId);
         if (itCache == context->_cachedRoadsInTiles.end())
-            itCache = context->_cachedRoadsInTiles.insert(tileId, QList< std::shared_ptr<Model::Road> >());
+            itCache = context->_cachedRoadsInTiles.insert(tileId, QList< std::shared_ptr<Road> >());
 
         if (!itCache->contains(road))
             itCache->push_back(road);
     }
 }
 
-void OsmAnd::RoutePlanner::loadRoads( RoutePlannerContext* context, uint32_t x31, uint32_t y31, uint32_t zoomAround, QList< std::shared_ptr<const Model::Road> >& roads )
+void OsmAnd::RoutePlanner::loadRoads( RoutePlannerContext* context, uint32_t x31, uint32_t y31, uint32_t zoomAround, QList< std::shared_ptr<const Road> >& roads )
 {
     auto coordinatesShift = 1 << (31 - context->_roadTilesLoadingZoomLevel);
     uint32_t t;
@@ -176,9 +300,9 @@ void OsmAnd::RoutePlanner::loadRoads( RoutePlannerContext* context, uint32_t x31
     }
 }
 
-void OsmAnd::RoutePlanner::loadRoadsFromTile( RoutePlannerContext* context, uint64_t tileId, QList< std::shared_ptr<const Model::Road> >& roads )
+void OsmAnd::RoutePlanner::loadRoadsFromTile( RoutePlannerContext* context, uint64_t tileId, QList< std::shared_ptr<const Road> >& roads )
 {
-    QMap<uint64_t, std::shared_ptr<const Model::Road> > duplicates;
+    QMap<uint64_t, std::shared_ptr<const Road> > duplicates;
 
     auto itRoadsInTile = context->_cachedRoadsInTiles.constFind(tileId);
     if (itRoadsInTile != context->_cachedRoadsInTiles.cend())
@@ -193,10 +317,10 @@ void OsmAnd::RoutePlanner::loadRoadsFromTile( RoutePlannerContext* context, uint
         }
     }
 
-    auto itIndexedSubsectionContexts = context->_indexedSubsectionsContexts.constFind(tileId);
-    assert(itIndexedSubsectionContexts != context->_indexedSubsectionsContexts.cend());
-    for(auto& subsectionContext : *itIndexedSubsectionContexts)
-        subsectionContext->collectRoads(roads, &duplicates);
+    auto itIndexedTilesContexts = context->_indexedTilesContexts.constFind(tileId);
+    assert(itIndexedTilesContexts != context->_indexedTilesContexts.cend());
+    for(auto& tileContext : *itIndexedTilesContexts)
+        tileContext->collectRoads(roads, &duplicates);
 }
 
 uint32_t OsmAnd::RoutePlanner::getCurrentEstimatedSize(RoutePlannerContext* context)
@@ -227,72 +351,48 @@ uint64_t OsmAnd::RoutePlanner::getRoutingTileId( RoutePlannerContext* context, u
         }
     }
 
-    auto itIndexedSubsectionContexts = context->_indexedSubsectionsContexts.constFind(tileId);
-    if (itIndexedSubsectionContexts == context->_indexedSubsectionsContexts.cend())
+    auto itIndexedTilesContexts = context->_indexedTilesContexts.constFind(tileId);
+    if (itIndexedTilesContexts == context->_indexedTilesContexts.cend())
     {
-        QList< std::shared_ptr<RoutePlannerContext::RoutingSubsectionContext> > subsectionContexts;
-        loadTileHeader(context, x31, y31, subsectionContexts);
-        itIndexedSubsectionContexts = context->_indexedSubsectionsContexts.insert(tileId, subsectionContexts);
+        QList< std::shared_ptr<RoutePlannerContext::RoutingTileContext> > tilesContexts;
+        loadTileHeader(context, x31, y31, tilesContexts);
+        itIndexedTilesContexts = context->_indexedTilesContexts.insert(tileId, tilesContexts);
     }
 
-    assert(itIndexedSubsectionContexts != context->_indexedSubsectionsContexts.cend());
-    for(const auto& subsectionContext : constOf(*itIndexedSubsectionContexts))
+    assert(itIndexedTilesContexts != context->_indexedTilesContexts.cend());
+    for(const auto& tileContext : constOf(*itIndexedTilesContexts))
     {
-        if (subsectionContext->isLoaded())
+        if (tileContext->isLoaded())
             continue;
 
-        loadSubregionContext(subsectionContext.get());
+        loadTileContext(tileContext.get());
     }
 
     return tileId;
 }
 
-void OsmAnd::RoutePlanner::loadTileHeader( RoutePlannerContext* context, uint32_t x31, uint32_t y31, QList< std::shared_ptr<RoutePlannerContext::RoutingSubsectionContext> >& subsectionsContexts )
+void OsmAnd::RoutePlanner::loadTileHeader( RoutePlannerContext* context, uint32_t x31, uint32_t y31, QList< std::shared_ptr<RoutePlannerContext::RoutingTileContext> >& tilesContexts )
 {
-    const auto zoomToLoad = 31 - context->_roadTilesLoadingZoomLevel;
-    auto xTileId = x31 >> (31 - context->_roadTilesLoadingZoomLevel);
-    auto yTileId = y31 >> (31 - context->_roadTilesLoadingZoomLevel);
-
-    AreaI bbox31;
-    bbox31.left = xTileId << zoomToLoad;
-    bbox31.right = (xTileId + 1) << zoomToLoad;
-    bbox31.top = yTileId << zoomToLoad;
-    bbox31.bottom = (yTileId + 1) << zoomToLoad;
-    PlainQueryFilter filter(nullptr, &bbox31);
+    const auto zoom = static_cast<ZoomLevel>(context->_roadTilesLoadingZoomLevel);
+    const auto tileId = TileId::fromXY(x31 >> (31 - zoom), y31 >> (31 - zoom));
+    const auto bbox31 = Utilities::tileBoundingBox31(tileId, zoom);
 
     for(const auto& source : constOf(context->sources))
     {
         const auto& obfInfo = source->obtainInfo();
         for(const auto& routingSection : constOf(obfInfo->routingSections))
         {
-            QList< std::shared_ptr<const ObfRoutingSubsectionInfo> > subsections;
-            ObfRoutingSectionReader::querySubsections(
-                source,
-                context->_useBasemap ? routingSection->baseSubsections : routingSection->subsections,
-                &subsections,
-                &filter,
-                [](const std::shared_ptr<const ObfRoutingSubsectionInfo>& subsection)
-                {
-                    return subsection->containsData();
-                });
-            for(const auto& subsection : constOf(subsections))
-            {
-                auto itSubsectionContext = context->_subsectionsContextsLUT.constFind(subsection.get());
-                if (itSubsectionContext == context->_subsectionsContextsLUT.cend())
-                {
-                    const std::shared_ptr<RoutePlannerContext::RoutingSubsectionContext> subsectionContext(new RoutePlannerContext::RoutingSubsectionContext(context, source, subsection));
-                    itSubsectionContext = context->_subsectionsContextsLUT.insert(subsection.get(), subsectionContext);
-                    context->_subsectionsContexts.push_back(qMove(subsectionContext));
-                }
+            if (!routingSection->area31.intersects(bbox31) && !routingSection->area31.contains(bbox31))
+                continue;
 
-                subsectionsContexts.push_back(*itSubsectionContext);
-            }
+            const std::shared_ptr<RoutePlannerContext::RoutingTileContext> tileContext(new RoutePlannerContext::RoutingTileContext(context, source, routingSection, tileId, zoom));
+            context->_tilesContexts.push_back(tileContext);
+            tilesContexts.push_back(tileContext);
         }
     }
-
 }
 
-void OsmAnd::RoutePlanner::loadSubregionContext( RoutePlannerContext::RoutingSubsectionContext* context )
+void OsmAnd::RoutePlanner::loadTileContext( RoutePlannerContext::RoutingTileContext* context )
 {
     const auto wasUnloaded = !context->isLoaded();
     const auto loadsCount = context->getLoadsCounter();
@@ -300,16 +400,21 @@ void OsmAnd::RoutePlanner::loadSubregionContext( RoutePlannerContext::RoutingSub
         context->owner->_routeStatistics->timeToLoadBegin = std::chrono::steady_clock::now();
     }
     context->markLoaded();
-    ObfRoutingSectionReader::loadSubsectionData(context->origin, context->subsection, nullptr, nullptr, nullptr,
-        [=] (const std::shared_ptr<const OsmAnd::Model::Road>& road)
-        {
-            if (!context->owner->profileContext->acceptsRoad(road))
-                return false;
 
-            context->registerRoad(road);
-            return false;
-        }
-    );
+    // Decoded roads come from cache shared with other contexts, only profile-specific index is built here
+    context->_tile = context->owner->tilesCache->obtainTile(
+        context->origin,
+        context->section,
+        context->owner->_useBasemap ? RoutingDataLevel::Basemap : RoutingDataLevel::Detailed,
+        context->tileId,
+        context->zoom);
+    for(const auto& road : constOf(context->_tile->roads))
+    {
+        if (!context->owner->profileContext->acceptsRoad(road))
+            continue;
+
+        context->registerRoad(road);
+    }
 
     if (context->owner->_routeStatistics) {
         context->owner->_routeStatistics->timeToLoad += (uint64_t) (
@@ -427,14 +532,720 @@ OsmAnd::RouteCalculationResult OsmAnd::RoutePlanner::calculateRoute(
     }
 
     std::unique_ptr<RoutePlannerContext::CalculationContext> calculationContext(new RoutePlannerContext::CalculationContext(context));
+    if (!context->_hierarchies.isEmpty())
+    {
+        OsmAnd::RouteCalculationResult result;
+        if (calculateRouteUsingHierarchy(calculationContext.get(), points[0], points[1], leftSideNavigation, controller, result))
+            return result;
+    }
     return calculateRoute(calculationContext.get(), routeCalculationSegments[0], routeCalculationSegments[1], leftSideNavigation, controller);
 }
 
+bool OsmAnd::RoutePlanner::calculateRouteUsingHierarchy(
+    OsmAnd::RoutePlannerContext::CalculationContext* context,
+    const std::pair<double, double>& from,
+    const std::pair<double, double>& to,
+    bool leftSideNavigation,
+    const IQueryController* const controller,
+    OsmAnd::RouteCalculationResult& outResult)
+{
+    // Closest point on road lies between road points [idx - 1] and [idx]
+    std::shared_ptr<const Road> startRoad;
+    uint32_t startPointIdx;
+    uint32_t startX31, startY31;
+    if (!findClosestRoadPoint(context->owner, from.first, from.second, &startRoad, &startPointIdx, nullptr, &startX31, &startY31))
+        return false;
+    std::shared_ptr<const Road> targetRoad;
+    uint32_t targetPointIdx;
+    uint32_t targetX31, targetY31;
+    if (!findClosestRoadPoint(context->owner, to.first, to.second, &targetRoad, &targetPointIdx, nullptr, &targetX31, &targetY31))
+        return false;
+    const PointI startPoint(startX31, startY31);
+    const PointI targetPoint(targetX31, targetY31);
+
+    for(const auto& hierarchy : constOf(context->owner->_hierarchies))
+    {
+        QVector<RoutingHierarchy::Terminal> sources;
+        QVector<uint32_t> sourcesEdges;
+        collectHierarchyTerminals(context, hierarchy, startRoad, startPointIdx, startPoint, true, sources, sourcesEdges);
+        QVector<RoutingHierarchy::Terminal> targets;
+        QVector<uint32_t> targetsEdges;
+        collectHierarchyTerminals(context, hierarchy, targetRoad, targetPointIdx, targetPoint, false, targets, targetsEdges);
+
+        if (sources.isEmpty() || targets.isEmpty())
+            continue;
+
+        // Route within single road piece is left to regular search
+        for(const auto edgeId : constOf(targetsEdges))
+        {
+            if (sourcesEdges.contains(edgeId))
+                return false;
+        }
+
+        QVector<uint32_t> pathEdges;
+        int sourceIdx;
+        int targetIdx;
+        if (!hierarchy->findPath(sources, targets, pathEdges, &sourceIdx, &targetIdx, nullptr, controller))
+            continue;
+
+        // Closest points are inserted into road clones, that shifts indices of following points by one
+        QVector< std::shared_ptr<RouteSegment> > route;
+        const auto& startEdge = hierarchy->edges[sourcesEdges[sourceIdx]];
+        const auto startRoadClone = Road::createWithInsertedPoint(startRoad, startPointIdx, PointI(startX31, startY31));
+        route.push_back(std::shared_ptr<RouteSegment>(new RouteSegment(
+            startRoadClone,
+            startPointIdx,
+            startEdge.endPointIndex >= startPointIdx ? startEdge.endPointIndex + 1 : startEdge.endPointIndex)));
+
+        for(const auto edgeId : constOf(pathEdges))
+        {
+            const auto& edge = hierarchy->edges[edgeId];
+            const auto road = loadRoad(context, edge.roadId, hierarchy->nodes[edge.from].location31);
+            if (!road)
+            {
+                LogPrintf(LogSeverityLevel::Warning, "Road %llu from routing hierarchy was not found", edge.roadId);
+                return false;
+            }
+
+            route.push_back(std::shared_ptr<RouteSegment>(new RouteSegment(road, edge.startPointIndex, edge.endPointIndex)));
+        }
+
+        const auto& targetEdge = hierarchy->edges[targetsEdges[targetIdx]];
+        const auto targetRoadClone = Road::createWithInsertedPoint(targetRoad, targetPointIdx, PointI(targetX31, targetY31));
+        route.push_back(std::shared_ptr<RouteSegment>(new RouteSegment(
+            targetRoadClone,
+            targetEdge.startPointIndex >= targetPointIdx ? targetEdge.startPointIndex + 1 : targetEdge.startPointIndex,
+            targetPointIdx)));
+
+        outResult = completeRoute(context, route, leftSideNavigation);
+        return true;
+    }
+
+    return false;
+}
+
+void OsmAnd::RoutePlanner::collectHierarchyTerminals(
+    OsmAnd::RoutePlannerContext::CalculationContext* context,
+    const std::shared_ptr<const RoutingHierarchy>& hierarchy,
+    const std::shared_ptr<const Road>& road,
+    uint32_t pointIdx,
+    const PointI& point31,
+    bool isSource,
+    QVector<RoutingHierarchy::Terminal>& outTerminals,
+    QVector<uint32_t>& outEdges)
+{
+    const auto roadEdges = hierarchy->getRoadEdges(road->id);
+    for(const auto edgeId : constOf(roadEdges))
+    {
+        const auto& edge = hierarchy->edges[edgeId];
+        if (qMin(edge.startPointIndex, edge.endPointIndex) >= pointIdx || qMax(edge.startPointIndex, edge.endPointIndex) < pointIdx)
+            continue;
+
+        const auto isIncrement = edge.startPointIndex < edge.endPointIndex;
+        float distance;
+        if (isSource)
+        {
+            // Search starts at the end of road piece closest point lies on
+            auto idx = isIncrement ? pointIdx : pointIdx - 1;
+            distance = Utilities::distance31(point31, road->points31[idx]);
+            for(; idx != edge.endPointIndex; isIncrement ? idx++ : idx--)
+                distance += Utilities::distance31(road->points31[idx], road->points31[isIncrement ? idx + 1 : idx - 1]);
+        }
+        else
+        {
+            // And ends at the beginning of road piece closest point lies on
+            const auto lastPointIdx = isIncrement ? pointIdx - 1 : pointIdx;
+            distance = Utilities::distance31(road->points31[lastPointIdx], point31);
+            for(auto idx = edge.startPointIndex; idx != lastPointIdx; isIncrement ? idx++ : idx--)
+                distance += Utilities::distance31(road->points31[idx], road->points31[isIncrement ? idx + 1 : idx - 1]);
+        }
+
+        RoutingHierarchy::Terminal terminal;
+        terminal.node = isSource ? edge.to : edge.from;
+        terminal.time = calculateTimeWithObstacles(context, road, distance, 0.0f);
+        outTerminals.push_back(terminal);
+        outEdges.push_back(edgeId);
+    }
+}
+
+bool OsmAnd::RoutePlanner::calculateTimesMatrix(
+    OsmAnd::RoutePlannerContext* context,
+    const QList< std::pair<double, double> >& origins,
+    const QList< std::pair<double, double> >& destinations,
+    QVector<float>& outTimes,
+    const IQueryController* const controller /*= nullptr*/)
+{
+    assert(context != nullptr);
+
+    // Points are matched to roads once, tiles loaded for that stay in context for all pairs
+    const auto findRoadPoints =
+        [context]
+        (const QList< std::pair<double, double> >& points) -> QVector<RoadPoint>
+        {
+            QVector<RoadPoint> roadPoints(points.size());
+            for(auto idx = 0; idx < points.size(); idx++)
+            {
+                auto& roadPoint = roadPoints[idx];
+                uint32_t x31, y31;
+                if (findClosestRoadPoint(context, points[idx].first, points[idx].second, &roadPoint.road, &roadPoint.pointIndex, nullptr, &x31, &y31))
+                    roadPoint.point31 = PointI(x31, y31);
+                else
+                    roadPoint.road.reset();
+            }
+            return roadPoints;
+        };
+    const auto originsRoadPoints = findRoadPoints(origins);
+    const auto destinationsRoadPoints = findRoadPoints(destinations);
+
+    const auto originsCount = origins.size();
+    const auto destinationsCount = destinations.size();
+    outTimes.fill(std::numeric_limits<float>::infinity(), originsCount * destinationsCount);
+    QVector<bool> resolved(originsCount * destinationsCount, false);
+
+    std::unique_ptr<RoutePlannerContext::CalculationContext> calculationContext(new RoutePlannerContext::CalculationContext(context));
+    Concurrent::WorkerPool workerPool;
+    for(const auto& hierarchy : constOf(context->_hierarchies))
+    {
+        QVector< QVector<RoutingHierarchy::Terminal> > sources(originsCount);
+        QVector< QVector<uint32_t> > sourcesEdges(originsCount);
+        for(auto originIdx = 0; originIdx < originsCount; originIdx++)
+        {
+            const auto& roadPoint = originsRoadPoints[originIdx];
+            if (roadPoint.road)
+                collectHierarchyTerminals(calculationContext.get(), hierarchy, roadPoint.road, roadPoint.pointIndex, roadPoint.point31, true, sources[originIdx], sourcesEdges[originIdx]);
+        }
+        QVector< QVector<RoutingHierarchy::Terminal> > targets(destinationsCount);
+        QVector< QVector<uint32_t> > targetsEdges(destinationsCount);
+        for(auto destinationIdx = 0; destinationIdx < destinationsCount; destinationIdx++)
+        {
+            const auto& roadPoint = destinationsRoadPoints[destinationIdx];
+            if (roadPoint.road)
+                collectHierarchyTerminals(calculationContext.get(), hierarchy, roadPoint.road, roadPoint.pointIndex, roadPoint.point31, false, targets[destinationIdx], targetsEdges[destinationIdx]);
+        }
+
+        QVector<float> times;
+        if (!hierarchy->calculateTimesMatrix(sources, targets, times, &workerPool, controller))
+            return false;
+
+        for(auto originIdx = 0; originIdx < originsCount; originIdx++)
+        {
+            for(auto destinationIdx = 0; destinationIdx < destinationsCount; destinationIdx++)
+            {
+                const auto cellIdx = originIdx * destinationsCount + destinationIdx;
+                if (resolved[cellIdx] || std::isinf(times[cellIdx]))
+                    continue;
+
+                // Route within single road piece is left to regular search
+                bool sameRoadPiece = false;
+                for(const auto edgeId : constOf(targetsEdges[destinationIdx]))
+                    sameRoadPiece = sameRoadPiece || sourcesEdges[originIdx].contains(edgeId);
+                if (sameRoadPiece)
+                    continue;
+
+                outTimes[cellIdx] = times[cellIdx];
+                resolved[cellIdx] = true;
+            }
+        }
+    }
+
+    // Each origin with unresolved pairs is searched once for all its destinations, searches share
+    // tiles of context and run in parallel. Search that exceeds memory limit of context gives up
+    QVector<int> searchedOrigins;
+    QVector< QVector<float> > originsTimes(originsCount);
+    QVector<bool> originsSearchesCompleted(originsCount, false);
+    QVector<Concurrent::WorkerPool::Job> jobs;
+    std::atomic<bool> memoryExceeded(false);
+    for(auto originIdx = 0; originIdx < originsCount; originIdx++)
+    {
+        if (!originsRoadPoints[originIdx].road)
+            continue;
+
+        QVector<RoadPoint> unresolvedDestinations(destinationsCount);
+        auto hasUnresolvedDestinations = false;
+        for(auto destinationIdx = 0; destinationIdx < destinationsCount; destinationIdx++)
+        {
+            if (resolved[originIdx * destinationsCount + destinationIdx])
+                continue;
+
+            unresolvedDestinations[destinationIdx] = destinationsRoadPoints[destinationIdx];
+            hasUnresolvedDestinations = hasUnresolvedDestinations || unresolvedDestinations[destinationIdx].road;
+        }
+        if (!hasUnresolvedDestinations)
+            continue;
+
+        searchedOrigins.push_back(originIdx);
+        const auto pOriginTimes = originsTimes.data() + originIdx;
+        const auto pSearchCompleted = originsSearchesCompleted.data() + originIdx;
+        const auto& origin = originsRoadPoints[originIdx];
+        jobs.push_back(
+            [context, controller, &memoryExceeded, origin, unresolvedDestinations, pOriginTimes, pSearchCompleted]
+            ()
+            {
+                int checksCount = 0;
+                const NestedQueryController searchController(
+                    [context, controller, &memoryExceeded, &checksCount]
+                    () -> bool
+                    {
+                        if (controller && controller->isAborted())
+                            return true;
+                        if (memoryExceeded.load())
+                            return true;
+                        if (++checksCount % 1000 != 0)
+                            return false;
+
+                        QMutexLocker scopedLocker(&context->_tilesMutex);
+                        if (context->getCurrentEstimatedSize() > context->_memoryUsageLimit)
+                            memoryExceeded.store(true);
+                        return memoryExceeded.load();
+                    });
+
+                RoutePlannerRoadsGraph graph(context);
+                *pSearchCompleted = calculateTimesFromRoadPoint(&graph, origin, unresolvedDestinations, *pOriginTimes, &searchController);
+            });
+    }
+    if (!jobs.isEmpty())
+        workerPool.executeAndWait(jobs);
+    if (controller && controller->isAborted())
+        return false;
+
+    for(const auto originIdx : constOf(searchedOrigins))
+    {
+        const auto& originTimes = originsTimes[originIdx];
+        for(auto destinationIdx = 0; destinationIdx < destinationsCount; destinationIdx++)
+        {
+            const auto cellIdx = originIdx * destinationsCount + destinationIdx;
+            if (resolved[cellIdx] || !destinationsRoadPoints[destinationIdx].road)
+                continue;
+
+            // Completed search that didn't reach destination means there's no route to it
+            if (!std::isinf(originTimes[destinationIdx]) || originsSearchesCompleted[originIdx])
+            {
+                outTimes[cellIdx] = originTimes[destinationIdx];
+                resolved[cellIdx] = true;
+            }
+        }
+    }
+
+    // Regular search is left only for pairs origin search gave up on, it shares tiles state of
+    // context, so these pairs are calculated one by one
+    for(auto originIdx = 0; originIdx < originsCount; originIdx++)
+    {
+        if (!originsRoadPoints[originIdx].road)
+            continue;
+
+        for(auto destinationIdx = 0; destinationIdx < destinationsCount; destinationIdx++)
+        {
+            const auto cellIdx = originIdx * destinationsCount + destinationIdx;
+            if (resolved[cellIdx] || !destinationsRoadPoints[destinationIdx].road)
+                continue;
+
+            if (controller && controller->isAborted())
+                return false;
+
+            // Search modifies segments it starts from, so they are obtained for each pair
+            std::shared_ptr<RoutePlannerContext::RouteCalculationSegment> from;
+            std::shared_ptr<RoutePlannerContext::RouteCalculationSegment> to;
+            if (!findClosestRouteSegment(context, origins[originIdx].first, origins[originIdx].second, from) ||
+                !findClosestRouteSegment(context, destinations[destinationIdx].first, destinations[destinationIdx].second, to))
+            {
+                continue;
+            }
+
+            std::unique_ptr<RoutePlannerContext::CalculationContext> pairCalculationContext(new RoutePlannerContext::CalculationContext(context));
+            const auto result = calculateRoute(pairCalculationContext.get(), from, to, false, controller);
+            if (result.list.isEmpty())
+                continue;
+
+            auto time = 0.0f;
+            for(const auto& routeSegment : constOf(result.list))
+                time += routeSegment->time;
+            outTimes[cellIdx] = time;
+        }
+    }
+
+    return !(controller && controller->isAborted());
+}
+
+bool OsmAnd::RoutePlanner::calculateIsochrone(
+    OsmAnd::RoutePlannerContext* context,
+    double latitude, double longitude,
+    const IsochroneCostType costType,
+    const float limit,
+    QList<IsochroneSegment>& outSegments,
+    QVector<PointI>* const outOutline31 /*= nullptr*/,
+    const IQueryController* const controller /*= nullptr*/)
+{
+    assert(context != nullptr);
+
+    outSegments.clear();
+    if (outOutline31)
+        outOutline31->clear();
+
+    RoadPoint origin;
+    uint32_t startX31, startY31;
+    if (!findClosestRoadPoint(context, latitude, longitude, &origin.road, &origin.pointIndex, nullptr, &startX31, &startY31))
+        return false;
+    origin.point31 = PointI(startX31, startY31);
+
+    RoutePlannerRoadsGraph graph(context);
+    return calculateIsochrone(&graph, origin, costType, limit, outSegments, outOutline31, controller);
+}
+
+bool OsmAnd::RoutePlanner::calculateIsochrone(
+    IRoadsGraph* const graph,
+    const RoadPoint& origin,
+    const IsochroneCostType costType,
+    const float limit,
+    QList<IsochroneSegment>& outSegments,
+    QVector<PointI>* const outOutline31 /*= nullptr*/,
+    const IQueryController* const controller /*= nullptr*/)
+{
+    outSegments.clear();
+    if (outOutline31)
+        outOutline31->clear();
+
+    QVector<PointI> reachedPoints31;
+    reachedPoints31.push_back(origin.point31);
+    const auto collectSegment =
+        [&outSegments, &reachedPoints31, limit]
+        (const IsochroneSegment& segment, const PointI& fromPoint31) -> bool
+        {
+            outSegments.push_back(segment);
+
+            const auto& toPoint31 = segment.road->points31[segment.toPointIndex];
+            if (segment.toCost <= limit)
+            {
+                reachedPoints31.push_back(toPoint31);
+                return true;
+            }
+
+            // Limit is reached somewhere within the segment
+            const auto factor = (limit - segment.fromCost) / (segment.toCost - segment.fromCost);
+            reachedPoints31.push_back(PointI(
+                fromPoint31.x + static_cast<int32_t>((static_cast<int64_t>(toPoint31.x) - fromPoint31.x) * factor),
+                fromPoint31.y + static_cast<int32_t>((static_cast<int64_t>(toPoint31.y) - fromPoint31.y) * factor)));
+            return true;
+        };
+    if (!searchFromRoadPoint(graph, origin, costType, limit, collectSegment, controller))
+        return false;
+
+    if (outOutline31)
+    {
+        // Farthest reached point in each sector around origin
+        enum : int {
+            OutlineSectorsCount = 72,
+        };
+        const auto& start31 = origin.point31;
+        QVector<double> sectorsSqDistances(OutlineSectorsCount, -1.0);
+        QVector<PointI> sectorsPoints31(OutlineSectorsCount);
+        for (const auto& reachedPoint31 : constOf(reachedPoints31))
+        {
+            const auto dx = static_cast<double>(reachedPoint31.x) - start31.x;
+            const auto dy = static_cast<double>(reachedPoint31.y) - start31.y;
+            const auto angle = std::atan2(dy, dx) + M_PI;
+            const auto sector = qBound(0, static_cast<int>(angle / (2.0 * M_PI) * OutlineSectorsCount), OutlineSectorsCount - 1);
+            const auto sqDistance = dx * dx + dy * dy;
+            if (sqDistance <= sectorsSqDistances[sector])
+                continue;
+            sectorsSqDistances[sector] = sqDistance;
+            sectorsPoints31[sector] = reachedPoint31;
+        }
+        for (auto sector = 0; sector < OutlineSectorsCount; sector++)
+        {
+            if (sectorsSqDistances[sector] > 0.0)
+                outOutline31->push_back(sectorsPoints31[sector]);
+        }
+        if (outOutline31->size() < 3)
+            outOutline31->clear();
+    }
+
+    return true;
+}
+
+bool OsmAnd::RoutePlanner::searchFromRoadPoint(
+    IRoadsGraph* const graph,
+    const RoadPoint& origin,
+    const IsochroneCostType costType,
+    const float limit,
+    const SegmentVisitor visitor,
+    const IQueryController* const controller /*= nullptr*/)
+{
+    // Road point reached while moving along the road in given direction. Road was entered at
+    // another point, turn time to next road is measured from it
+    struct Entry
+    {
+        float cost;
+        std::shared_ptr<const Road> road;
+        uint32_t enteredPointIndex;
+        uint32_t pointIndex;
+        bool forwardDirection;
+        // Roads of the point where road was entered were already tried from the previous road
+        bool canLeaveRoad;
+
+        inline bool operator>(const Entry& that) const
+        {
+            return cost > that.cost;
+        }
+    };
+    std::priority_queue< Entry, std::vector<Entry>, std::greater<Entry> > queue;
+    QSet<uint64_t> visitedPoints;
+
+    const auto isMovementAllowed =
+        [graph]
+        (const std::shared_ptr<const Road>& road, const uint32_t pointIndex, const bool forwardDirection) -> bool
+        {
+            if (forwardDirection ? (pointIndex + 1 >= road->points31.size()) : (pointIndex == 0))
+                return false;
+
+            const auto direction = graph->getDirection(road);
+            if (forwardDirection)
+                return (direction == RoadDirection::TwoWay || direction == RoadDirection::OneWayReverse);
+            return (direction == RoadDirection::TwoWay || direction == RoadDirection::OneWayForward);
+        };
+    const auto costOfPassing =
+        [graph, costType]
+        (const std::shared_ptr<const Road>& road, const float distance, const float obstaclesTime) -> float
+        {
+            if (costType == IsochroneCostType::Distance)
+                return distance;
+            return graph->getTime(road, distance, obstaclesTime);
+        };
+    // Returns false once visitor stops the search
+    const auto passSegment =
+        [&queue, &visitedPoints, &visitor, limit]
+        (const Entry& from, const uint32_t fromPointIndex, const PointI& fromPoint31, const uint32_t toPointIndex, const float toCost) -> bool
+        {
+            IsochroneSegment segment;
+            segment.road = from.road;
+            segment.fromPointIndex = fromPointIndex;
+            segment.toPointIndex = toPointIndex;
+            segment.fromCost = from.cost;
+            segment.toCost = toCost;
+            if (!visitor(segment, fromPoint31))
+                return false;
+
+            if (toCost > limit || visitedPoints.contains(encodeRoutePointId(from.road, toPointIndex, from.forwardDirection)))
+                return true;
+
+            Entry next;
+            next.cost = toCost;
+            next.road = from.road;
+            next.enteredPointIndex = from.enteredPointIndex;
+            next.pointIndex = toPointIndex;
+            next.forwardDirection = from.forwardDirection;
+            next.canLeaveRoad = true;
+            queue.push(next);
+            return true;
+        };
+
+    // Origin lies on segment of road, so search starts towards both its ends
+    const auto& startRoad = origin.road;
+    const auto startPointIdx = origin.pointIndex;
+    const auto& start31 = origin.point31;
+    for (const auto forwardDirection : { true, false })
+    {
+        const auto fromPointIdx = forwardDirection ? startPointIdx - 1 : startPointIdx;
+        if (!isMovementAllowed(startRoad, fromPointIdx, forwardDirection))
+            continue;
+
+        const auto toPointIdx = forwardDirection ? startPointIdx : startPointIdx - 1;
+        const auto obstacleTime = graph->getObstacleTime(startRoad, toPointIdx);
+        if (obstacleTime < 0)
+            continue;
+
+        Entry start;
+        start.cost = 0.0f;
+        start.road = startRoad;
+        start.enteredPointIndex = startPointIdx;
+        start.pointIndex = fromPointIdx;
+        start.forwardDirection = forwardDirection;
+        start.canLeaveRoad = false;
+
+        const auto& toPoint31 = startRoad->points31[toPointIdx];
+        const auto distance = Utilities::distance31(start31.x, start31.y, toPoint31.x, toPoint31.y);
+        if (!passSegment(start, fromPointIdx, start31, toPointIdx, costOfPassing(startRoad, distance, obstacleTime)))
+            return true;
+    }
+
+    QList< std::pair< std::shared_ptr<const Road>, uint32_t > > roadsAtPoint;
+    while (!queue.empty())
+    {
+        if (controller && controller->isAborted())
+            return false;
+
+        const auto entry = queue.top();
+        queue.pop();
+
+        const auto& road = entry.road;
+        const auto pointId = encodeRoutePointId(road, entry.pointIndex, entry.forwardDirection);
+        if (visitedPoints.contains(pointId))
+            continue;
+        visitedPoints.insert(pointId);
+
+        const auto& point31 = road->points31[entry.pointIndex];
+
+        // Further along the same road
+        if (isMovementAllowed(road, entry.pointIndex, entry.forwardDirection))
+        {
+            const auto nextPointIdx = entry.forwardDirection ? entry.pointIndex + 1 : entry.pointIndex - 1;
+            const auto obstacleTime = graph->getObstacleTime(road, nextPointIdx);
+            if (obstacleTime >= 0)
+            {
+                const auto& nextPoint31 = road->points31[nextPointIdx];
+                const auto distance = Utilities::distance31(point31.x, point31.y, nextPoint31.x, nextPoint31.y);
+                if (!passSegment(entry, entry.pointIndex, point31, nextPointIdx, entry.cost + costOfPassing(road, distance, obstacleTime)))
+                    return true;
+            }
+        }
+
+        // Other roads that go through this point, except ones that turn restrictions of the road forbid
+        if (!entry.canLeaveRoad)
+            continue;
+        roadsAtPoint.clear();
+        graph->obtainRoadsAt(point31, road, roadsAtPoint);
+        for (const auto& roadAtPoint : constOf(roadsAtPoint))
+        {
+            const auto& otherRoad = roadAtPoint.first;
+            const auto otherPointIdx = roadAtPoint.second;
+            if (otherRoad->id == road->id)
+                continue;
+
+            for (const auto forwardDirection : { true, false })
+            {
+                if (!isMovementAllowed(otherRoad, otherPointIdx, forwardDirection) ||
+                    visitedPoints.contains(encodeRoutePointId(otherRoad, otherPointIdx, forwardDirection)))
+                {
+                    continue;
+                }
+
+                auto cost = entry.cost;
+                if (costType == IsochroneCostType::Time)
+                {
+                    cost += graph->getTurnTime(
+                        road, entry.enteredPointIndex, entry.pointIndex,
+                        otherRoad, otherPointIdx, forwardDirection ? otherRoad->points31.size() - 1 : 0);
+                }
+                if (cost > limit)
+                    continue;
+
+                Entry next;
+                next.cost = cost;
+                next.road = otherRoad;
+                next.enteredPointIndex = otherPointIdx;
+                next.pointIndex = otherPointIdx;
+                next.forwardDirection = forwardDirection;
+                next.canLeaveRoad = false;
+                queue.push(next);
+            }
+        }
+    }
+
+    return true;
+}
+
+bool OsmAnd::RoutePlanner::calculateTimesFromRoadPoint(
+    IRoadsGraph* const graph,
+    const RoadPoint& origin,
+    const QVector<RoadPoint>& destinations,
+    QVector<float>& outTimes,
+    const IQueryController* const controller /*= nullptr*/)
+{
+    outTimes.fill(std::numeric_limits<float>::infinity(), destinations.size());
+
+    QMultiHash<ObfObjectId, int> destinationsByRoads;
+    auto unreachedCount = 0;
+    for (auto destinationIdx = 0; destinationIdx < destinations.size(); destinationIdx++)
+    {
+        const auto& destination = destinations[destinationIdx];
+        if (!destination.road)
+            continue;
+
+        destinationsByRoads.insert(destination.road->id, destinationIdx);
+        unreachedCount++;
+    }
+    if (unreachedCount == 0)
+        return true;
+
+    // Segments are passed in order of time they are passed from, so destination is settled once
+    // that time is not less than time destination was reached in. Maximal time is kept as upper
+    // bound of times of reached destinations, since these only decrease
+    auto maxReachedTime = 0.0f;
+    auto settledTime = 0.0f;
+    const auto reachDestinations =
+        [&destinations, &destinationsByRoads, &outTimes, &unreachedCount, &maxReachedTime, &settledTime]
+        (const IsochroneSegment& segment, const PointI& fromPoint31) -> bool
+        {
+            settledTime = segment.fromCost;
+            if (unreachedCount == 0 && settledTime >= maxReachedTime)
+                return false;
+
+            const auto& road = segment.road;
+            for (auto itDestinationIdx = destinationsByRoads.constFind(road->id);
+                itDestinationIdx != destinationsByRoads.cend() && itDestinationIdx.key() == road->id;
+                ++itDestinationIdx)
+            {
+                const auto destinationIdx = *itDestinationIdx;
+                const auto& destination = destinations[destinationIdx];
+                if (qMin(segment.fromPointIndex, segment.toPointIndex) + 1 != destination.pointIndex ||
+                    qMax(segment.fromPointIndex, segment.toPointIndex) != destination.pointIndex)
+                {
+                    continue;
+                }
+
+                // Segment passed from origin may start past destination
+                const auto& toPoint31 = road->points31[segment.toPointIndex];
+                const auto length = Utilities::distance31(fromPoint31, toPoint31);
+                const auto distanceToDestination = Utilities::distance31(fromPoint31, destination.point31);
+                if (distanceToDestination + Utilities::distance31(destination.point31, toPoint31) > length + 1.0)
+                    continue;
+
+                const auto time = length > 0.0
+                    ? segment.fromCost + static_cast<float>((segment.toCost - segment.fromCost) * distanceToDestination / length)
+                    : segment.fromCost;
+                auto& destinationTime = outTimes[destinationIdx];
+                if (std::isinf(destinationTime))
+                    unreachedCount--;
+                if (time < destinationTime)
+                    destinationTime = time;
+                maxReachedTime = qMax(maxReachedTime, destinationTime);
+            }
+
+            return true;
+        };
+    if (searchFromRoadPoint(graph, origin, IsochroneCostType::Time, std::numeric_limits<float>::infinity(), reachDestinations, controller))
+        return true;
+
+    // Times that weren't settled yet may be not the least ones
+    for (auto& time : outTimes)
+    {
+        if (time > settledTime)
+            time = std::numeric_limits<float>::infinity();
+    }
+    return false;
+}
+
+std::shared_ptr<const OsmAnd::Road> OsmAnd::RoutePlanner::loadRoad(
+    OsmAnd::RoutePlannerContext::CalculationContext* context,
+    uint64_t roadId,
+    const PointI& point31)
+{
+    auto segment = loadRouteCalculationSegment(context, point31.x, point31.y);
+    while(segment)
+    {
+        if (segment->road->id == roadId)
+            return segment->road;
+        segment = segment->next;
+    }
+    return nullptr;
+}
+
 void OsmAnd::RoutePlanner::printDebugInformation(OsmAnd::RoutePlannerContext::CalculationContext* ctx, int directSegmentSize, int reverseSegmentSize,
            std::shared_ptr<RoutePlannerContext::RouteCalculationSegment> finalSegment) {
 
     std::shared_ptr<RouteStatistics> st = ctx->owner->_routeStatistics;
     if (st) {
+        st->sizeOfDQueue = directSegmentSize;
+        st->sizeOfRQueue = reverseSegmentSize;
         st->timeToCalculate += (uint64_t) (
                     std::chrono::duration<double, std::milli> (std::chrono::steady_clock::now() - st->timeToCalculateBegin).count());
         LogPrintf(LogSeverityLevel::Debug, "Time to calculate %llu, time to load %llu ", st->timeToCalculate, st->timeToLoad);
@@ -457,8 +1268,8 @@ OsmAnd::RouteCalculationResult OsmAnd::RoutePlanner::calculateRoute(
     const IQueryController* const controller /*= nullptr*/)
 {
 
-    context->_startPoint = from->road->points[from->pointIndex];
-    context->_targetPoint = to_->road->points[to_->pointIndex];
+    context->_startPoint = from->road->points31[from->pointIndex];
+    context->_targetPoint = to_->road->points31[to_->pointIndex];
 
     #ifndef ROUTE_STATISTICS
         context->_routeStatistics = nullptr;
@@ -480,7 +1291,7 @@ OsmAnd::RouteCalculationResult OsmAnd::RoutePlanner::calculateRoute(
         // Mark here as positive for further check
         context->_entranceRoadId = encodeRoutePointId(from->road, from->pointIndex, true);
 
-        auto roadDirectionDelta = from->road->getDirectionDelta(from->pointIndex, true);
+        auto roadDirectionDelta = from->road->directionRoute(from->pointIndex, true);
         auto delta = roadDirectionDelta - context->owner->_initialHeading;
 
         if (qAbs(Utilities::normalizedAngleRadians(delta)) <= M_PI / 3.0)
@@ -508,8 +1319,8 @@ OsmAnd::RouteCalculationResult OsmAnd::RoutePlanner::calculateRoute(
     RoadSegmentsPriorityQueue graphReverseSegments(roadSegmentsComparator);
     
     // Set to not visit one segment twice (stores road.id << X + segmentStart)
-    QMap<uint64_t, std::shared_ptr<RoutePlannerContext::RouteCalculationSegment> > visitedDirectSegments;
-    QMap<uint64_t, std::shared_ptr<RoutePlannerContext::RouteCalculationSegment> > visitedOppositeSegments;
+    RoutePlannerContext::VisitedSegments visitedDirectSegments;
+    RoutePlannerContext::VisitedSegments visitedOppositeSegments;
     
     auto to = to_;
     const auto runRecalculation = checkPartialRecalculationPossible(context, visitedOppositeSegments, to);
@@ -531,11 +1342,21 @@ OsmAnd::RouteCalculationResult OsmAnd::RoutePlanner::calculateRoute(
     bool initialized = false;
 
     RoadSegmentsPriorityQueue* pGraphSegments = reverseSearch ? &graphReverseSegments : &graphDirectSegments;
-    loadBorderPoints(context);
-
 
     std::shared_ptr<RoutePlannerContext::RouteCalculationSegment> finalSegment;
-    while (!pGraphSegments->empty())
+    if (context->owner->_parallelBidirectionalSearch && !runRecalculation && context->owner->_planRoadDirection == 0)
+    {
+        QString errorMessage;
+        finalSegment = searchInParallel(
+            context,
+            graphDirectSegments, graphReverseSegments,
+            visitedDirectSegments, visitedOppositeSegments,
+            controller,
+            errorMessage);
+        if (!finalSegment)
+            return OsmAnd::RouteCalculationResult(errorMessage);
+    }
+    while (!finalSegment && !pGraphSegments->empty())
     {
 #if TRACE_DUMP_QUEUE
         LogPrintf(LogSeverityLevel::Debug, "---------------------------------------");
@@ -647,92 +1468,136 @@ OsmAnd::RouteCalculationResult OsmAnd::RoutePlanner::calculateRoute(
 
     if (!finalSegment)
         return OsmAnd::RouteCalculationResult("Route could not be calculated");
+    if (context->owner->_routeStatistics)
+        context->owner->_routeStatistics->visitedSegments = visitedDirectSegments.size() + visitedOppositeSegments.size();
     printDebugInformation(context, graphDirectSegments.size(), graphReverseSegments.size(), finalSegment);
 
     return prepareResult(context, finalSegment, leftSideNavigation);
 }
 
-void OsmAnd::RoutePlanner::loadBorderPoints( OsmAnd::RoutePlannerContext::CalculationContext* context )
+std::shared_ptr<OsmAnd::RoutePlannerContext::RouteCalculationSegment> OsmAnd::RoutePlanner::searchInParallel(
+    OsmAnd::RoutePlannerContext::CalculationContext* context,
+    RoadSegmentsPriorityQueue& graphDirectSegments,
+    RoadSegmentsPriorityQueue& graphReverseSegments,
+    RoutePlannerContext::VisitedSegments& visitedDirectSegments,
+    RoutePlannerContext::VisitedSegments& visitedOppositeSegments,
+    const IQueryController* const controller,
+    QString& outErrorMessage)
 {
-    AreaI bbox31;
-    bbox31.left = std::min(context->_startPoint.x, context->_targetPoint.x);
-    bbox31.right = std::max(context->_startPoint.x, context->_targetPoint.x);
-    bbox31.top = std::min(context->_startPoint.y, context->_targetPoint.y);
-    bbox31.bottom = std::max(context->_startPoint.y, context->_targetPoint.y);
-    PlainQueryFilter filter(nullptr, &bbox31);
-    
-    //NOTE: one tile of 12th zoom around (?)
-    const uint32_t zoomAround = 10;
-    const uint32_t distAround = 1 << (31 - zoomAround);
-    const auto leftBorderBoundary = bbox31.left - distAround;
-    const auto rightBorderBoundary = bbox31.right + distAround;
-    
-    QMap<uint32_t, std::shared_ptr<RoutePlannerContext::BorderLine> > borderLinesLUT;
-    for(const auto& entry : rangeOf(constOf(context->owner->_subsectionsContextsLUT)))
-    {
-        const auto& subsection = entry.key();
-        const auto& source = context->owner->_sourcesLUT[subsection->section.get()];
+    // Each direction publishes visited segments to a table the other one reads without locks
+    RoutePlannerContext::MeetingSegments directMeetingSegments(context->getSegmentsPool(false));
+    RoutePlannerContext::MeetingSegments reverseMeetingSegments(context->getSegmentsPool(true));
+    visitedDirectSegments.publishTo(&directMeetingSegments);
+    visitedOppositeSegments.publishTo(&reverseMeetingSegments);
+
+    QMutex resultMutex;
+    std::shared_ptr<RoutePlannerContext::RouteCalculationSegment> bestFinalSegment;
+    std::atomic<float> bestDistance(std::numeric_limits<float>::infinity());
+    std::atomic<bool> stopped(false);
+    uint32_t iterations[2] = { 0, 0 };
+
+    const auto heuristicCoefficient = context->owner->_heuristicCoefficient;
+    const auto search =
+        [&]
+        (const bool reverseSearch)
+        {
+            auto& graphSegments = reverseSearch ? graphReverseSegments : graphDirectSegments;
+            auto& visitedSegments = reverseSearch ? visitedOppositeSegments : visitedDirectSegments;
+            auto& oppositeSegments = reverseSearch ? visitedDirectSegments : visitedOppositeSegments;
 
-        ObfRoutingSectionReader::loadSubsectionBorderBoxLinesPoints(source, subsection->section, nullptr, &filter, nullptr,
-            [&] (const std::shared_ptr<const OsmAnd::ObfRoutingBorderLinePoint>& point)
+            while (!stopped.load())
             {
-                if (point->location.x <= leftBorderBoundary || point->location.x >= rightBorderBoundary)
-                    return false;
+                if (graphSegments.empty())
+                {
+                    // Frontier is exhausted: if nothing was found yet, nothing will be
+                    QMutexLocker scopedLocker(&resultMutex);
+                    if (!bestFinalSegment)
+                    {
+                        outErrorMessage = reverseSearch
+                            ? QLatin1String("Route is not found to selected target point.")
+                            : QLatin1String("Route is not found from selected start point.");
+                        stopped.store(true);
+                    }
+                    return;
+                }
 
-                if (!context->owner->profileContext->acceptsBorderLinePoint(subsection->section, point))
-                    return false;
+                // Frontier can't improve route found so far, since its estimates only grow
+                const auto segment = graphSegments.top();
+                if (segment->_distanceFromStart + heuristicCoefficient * segment->_distanceToEnd >= bestDistance.load())
+                    return;
+                graphSegments.pop();
 
-                auto itBorderLine = borderLinesLUT.constFind(point->location.y);
-                if (itBorderLine == borderLinesLUT.cend())
+                if (dynamic_cast<RoutePlannerContext::RouteCalculationFinalSegment*>(segment.get()))
                 {
-                    std::shared_ptr<RoutePlannerContext::BorderLine> line(new RoutePlannerContext::BorderLine());
-
-                    line->_y31 = point->location.y;
-                    
-                    auto lft = point->bboxedClone(leftBorderBoundary);
-                    line->_borderPoints.push_back(lft);
-                    auto rht = point->bboxedClone(rightBorderBoundary);
-                    line->_borderPoints.push_back(rht);
-                    
-                    context->_borderLines.push_back(line);
-                    itBorderLine = borderLinesLUT.insert(line->_y31, line);
+                    QMutexLocker scopedLocker(&resultMutex);
+                    if (segment->_distanceFromStart < bestDistance.load())
+                    {
+                        bestFinalSegment = segment;
+                        bestDistance.store(segment->_distanceFromStart);
+                    }
+                    return;
                 }
 
-                (*itBorderLine)->_borderPoints.push_back(point);
+                bool memoryExceeded;
+                {
+                    QMutexLocker scopedLocker(&context->owner->_tilesMutex);
+                    memoryExceeded = context->owner->getCurrentEstimatedSize() > context->owner->_memoryUsageLimit;
+                }
+                if (memoryExceeded)
+                {
+                    QMutexLocker scopedLocker(&resultMutex);
+                    outErrorMessage = "There is no enough memory " + QString::number(context->owner->_memoryUsageLimit/(1<<20)) + " Mb";
+                    stopped.store(true);
+                    return;
+                }
 
-                return false;
+                calculateRouteSegment(context, reverseSearch, graphSegments, visitedSegments, segment, oppositeSegments, true);
+                calculateRouteSegment(context, reverseSearch, graphSegments, visitedSegments, segment, oppositeSegments, false);
+                iterations[reverseSearch ? 1 : 0]++;
+
+                if (controller && controller->isAborted())
+                {
+                    QMutexLocker scopedLocker(&resultMutex);
+                    outErrorMessage = QLatin1String("Aborted");
+                    stopped.store(true);
+                    return;
+                }
             }
-        );
-    }
+        };
 
-    qSort(context->_borderLines.begin(), context->_borderLines.end(), [](const std::shared_ptr<RoutePlannerContext::BorderLine>& l, const std::shared_ptr<RoutePlannerContext::BorderLine>& r) -> bool
-    {
-        return l->_y31 < r->_y31;
-    });
-    
-    context->_borderLinesY31.reserve(context->_borderLines.size());
-    for(const auto& line : constOf(context->_borderLines))
-    {
-        // FIXME borders approach
-        // not less then 14th zoom
-        /*TODO:if (i > 0 && borderLineCoordinates[i - 1] >> 17 == borderLineCoordinates[i] >> 17) {
-            throw new IllegalStateException();
-        }*/
+    Concurrent::Thread reverseSearchThread(
+        [search]
+        ()
+        {
+            search(true);
+        });
+    reverseSearchThread.start();
+    search(false);
+    reverseSearchThread.wait();
+
+    visitedDirectSegments.publishTo(nullptr);
+    visitedOppositeSegments.publishTo(nullptr);
 
-        context->_borderLinesY31.push_back(line->_y31);
+    if (context->owner->_routeStatistics)
+    {
+        context->owner->_routeStatistics->forwardIterations += iterations[0];
+        context->owner->_routeStatistics->backwardIterations += iterations[1];
     }
 
-    updateDistanceForBorderPoints(context, context->_startPoint, true);
-    updateDistanceForBorderPoints(context, context->_targetPoint, false);
+    if (stopped.load())
+        return nullptr;
+    if (!bestFinalSegment)
+        outErrorMessage = QLatin1String("Route could not be calculated");
+    return bestFinalSegment;
 }
 
-uint64_t OsmAnd::RoutePlanner::encodeRoutePointId( const std::shared_ptr<const Model::Road>& road, uint64_t pointIndex, bool positive )
+uint64_t OsmAnd::RoutePlanner::encodeRoutePointId( const std::shared_ptr<const Road>& road, uint64_t pointIndex, bool positive )
 {
     assert((pointIndex >> RoutePointsBitSpace) == 0);
     return (road->id << RoutePointsBitSpace) | (pointIndex << 1) | (positive ? 1 : 0);
 }
 
-uint64_t OsmAnd::RoutePlanner::encodeRoutePointId( const std::shared_ptr<const Model::Road>& road, uint64_t pointIndex)
+uint64_t OsmAnd::RoutePlanner::encodeRoutePointId( const std::shared_ptr<const Road>& road, uint64_t pointIndex)
 {
     return (road->id << 10) | pointIndex;
 }
@@ -754,9 +1619,9 @@ void OsmAnd::RoutePlanner::calculateRouteSegment(
     OsmAnd::RoutePlannerContext::CalculationContext* context,
     bool reverseWaySearch,
     RoadSegmentsPriorityQueue& graphSegments,
-    QMap<uint64_t, std::shared_ptr<RoutePlannerContext::RouteCalculationSegment> >& visitedSegments,
+    RoutePlannerContext::VisitedSegments& visitedSegments,
     const std::shared_ptr<RoutePlannerContext::RouteCalculationSegment>& segment,
-    QMap<uint64_t, std::shared_ptr<RoutePlannerContext::RouteCalculationSegment> >& oppositeSegments,
+    RoutePlannerContext::VisitedSegments& oppositeSegments,
     bool forwardDirection )
 {
     const bool initDirectionAllowed = checkIfInitialMovementAllowedOnSegment(context, reverseWaySearch, visitedSegments, segment, forwardDirection, segment->road);
@@ -768,7 +1633,7 @@ void OsmAnd::RoutePlanner::calculateRouteSegment(
     if (segment->parent && directionAllowed)
     {
         obstaclesTime = calculateTurnTime(context,
-            segment, forwardDirection ? segment->road->points.size() - 1 : 0,  
+            segment, forwardDirection ? segment->road->points31.size() - 1 : 0,  
             segment->parent, segment->parentEndPointIndex);
     }
 
@@ -783,7 +1648,7 @@ void OsmAnd::RoutePlanner::calculateRouteSegment(
     auto segmentEnd = segment->pointIndex;
     while (directionAllowed)
     {
-        if ((segmentEnd == 0 && !forwardDirection) || (segmentEnd + 1 >= segment->road->points.size() && forwardDirection))
+        if ((segmentEnd == 0 && !forwardDirection) || (segmentEnd + 1 >= segment->road->points31.size() && forwardDirection))
         {
             directionAllowed = false;
             continue;
@@ -793,8 +1658,8 @@ void OsmAnd::RoutePlanner::calculateRouteSegment(
 
         visitedSegments.insert(encodeRoutePointId(segment->road, intervalId, forwardDirection), segment);
 
-        const auto& point = segment->road->points[segmentEnd];
-        const auto& prevPoint = segment->road->points[prevInd];
+        const auto& point = segment->road->points31[segmentEnd];
+        const auto& prevPoint = segment->road->points31[prevInd];
         
         // causing bugs in first route calculation
         // if (point == prevPoint) continue;
@@ -849,7 +1714,7 @@ void OsmAnd::RoutePlanner::calculateRouteSegment(
 
         // could be expensive calculation
         // 3. get intersected ways
-        auto nextSegment = loadRouteCalculationSegment(context->owner, point.x, point.y); // ctx.config.memoryLimitation - ctx.memoryOverhead
+        auto nextSegment = loadRouteCalculationSegment(context, point.x, point.y, reverseWaySearch); // ctx.config.memoryLimitation - ctx.memoryOverhead
         if (!nextSegment) 
             continue;
         if ( (nextSegment == segment || nextSegment->road->id == segment->road->id) && !nextSegment->next )
@@ -860,7 +1725,7 @@ void OsmAnd::RoutePlanner::calculateRouteSegment(
         auto otherSegment = nextSegment;
         while(otherSegment)
         {
-            if (otherSegment->road->id != segment->road->id || otherSegment->pointIndex != 0 || otherSegment->road->getDirection() != Model::RoadDirection::OneWayForward)
+            if (otherSegment->road->id != segment->road->id || otherSegment->pointIndex != 0 || otherSegment->road->getDirection() != RoadDirection::OneWayForward)
             {
                 outgoingConnections = true;
                 break;
@@ -891,29 +1756,36 @@ float OsmAnd::RoutePlanner::calculateTurnTime(
     const std::shared_ptr<RoutePlannerContext::RouteCalculationSegment>& a, uint32_t aEndPointIndex,
     const std::shared_ptr<RoutePlannerContext::RouteCalculationSegment>& b, uint32_t bEndPointIndex )
 {
-    auto itPointTypesB = b->road->pointsTypes.constFind(bEndPointIndex);
-    if (itPointTypesB != b->road->pointsTypes.cend())
-    {
-        const auto& pointTypesB = *itPointTypesB;
+    return calculateTurnTime(context, a->road, a->pointIndex, aEndPointIndex, b->road, b->pointIndex, bEndPointIndex);
+}
 
+float OsmAnd::RoutePlanner::calculateTurnTime(
+    OsmAnd::RoutePlannerContext::CalculationContext* context,
+    const std::shared_ptr<const Road>& aRoad, uint32_t aPointIndex, uint32_t aEndPointIndex,
+    const std::shared_ptr<const Road>& bRoad, uint32_t bPointIndex, uint32_t bEndPointIndex)
+{
+    int pointTypesBCount = 0;
+    const auto pPointTypesB = bRoad->getPointTypes(bEndPointIndex, &pointTypesBCount);
+    if (pPointTypesB)
+    {
         // Check that there are no traffic signals, since they don't add turn info
-        const auto& encRules = b->road->subsection->section->_p->_encodingRules;
-        for(const auto& pointType : constOf(pointTypesB))
+        const auto& decodeMap = bRoad->section->getAttributeMapping()->routingDecodeMap;
+        for (auto pointTypeIdx = 0; pointTypeIdx < pointTypesBCount; pointTypeIdx++)
         {
-            const auto& rule = encRules[pointType];
-            if (rule->_tag == "highway" && rule->_value == "traffic_signals")
+            const auto rule = decodeMap.getRef(pPointTypesB[pointTypeIdx]);
+            if (rule && rule->getTag() == QLatin1String("highway") && rule->getValue() == QLatin1String("traffic_signals"))
                 return 0;
         }
     }
 
     auto roundaboutTurnTime = context->owner->profileContext->profile->roundaboutTurn;
-    if (roundaboutTurnTime > 0 && !b->road->isRoundabout() && a->road->isRoundabout())
+    if (roundaboutTurnTime > 0 && !bRoad->isRoundabout() && aRoad->isRoundabout())
         return roundaboutTurnTime;
     
     if (context->owner->profileContext->profile->leftTurn > 0 || context->owner->profileContext->profile->rightTurn > 0)
     {
-        auto a1 = a->road->getDirectionDelta(a->pointIndex, a->pointIndex < aEndPointIndex);
-        auto a2 = b->road->getDirectionDelta(bEndPointIndex, bEndPointIndex < b->pointIndex);
+        auto a1 = aRoad->directionRoute(aPointIndex, aPointIndex < aEndPointIndex);
+        auto a2 = bRoad->directionRoute(bEndPointIndex, bEndPointIndex < bPointIndex);
         auto diff = qAbs(Utilities::normalizedAngleRadians(a1 - a2 - M_PI));
 
         // more like UT
@@ -933,11 +1805,11 @@ float OsmAnd::RoutePlanner::calculateTurnTime(
 
 bool OsmAnd::RoutePlanner::checkIfInitialMovementAllowedOnSegment(
     OsmAnd::RoutePlannerContext::CalculationContext* context,
-    bool reverseWaySearch, QMap<uint64_t,
-    std::shared_ptr<RoutePlannerContext::RouteCalculationSegment> >& visitedSegments,
+    bool reverseWaySearch,
+    RoutePlannerContext::VisitedSegments& visitedSegments,
     const std::shared_ptr<RoutePlannerContext::RouteCalculationSegment>& segment,
     bool forwardDirection,
-    const std::shared_ptr<const Model::Road>& road )
+    const std::shared_ptr<const Road>& road )
 {
     bool directionAllowed;
 
@@ -948,20 +1820,20 @@ bool OsmAnd::RoutePlanner::checkIfInitialMovementAllowedOnSegment(
     if (!reverseWaySearch)
     {
         if (forwardDirection)
-            directionAllowed = (direction == Model::RoadDirection::TwoWay || direction == Model::RoadDirection::OneWayReverse);
+            directionAllowed = (direction == RoadDirection::TwoWay || direction == RoadDirection::OneWayReverse);
         else
-            directionAllowed = (direction == Model::RoadDirection::TwoWay || direction == Model::RoadDirection::OneWayForward);
+            directionAllowed = (direction == RoadDirection::TwoWay || direction == RoadDirection::OneWayForward);
     }
     else
     {
         if (forwardDirection)
-            directionAllowed = (direction == Model::RoadDirection::TwoWay || direction == Model::RoadDirection::OneWayForward);
+            directionAllowed = (direction == RoadDirection::TwoWay || direction == RoadDirection::OneWayForward);
         else
-            directionAllowed = (direction == Model::RoadDirection::TwoWay || direction == Model::RoadDirection::OneWayReverse);
+            directionAllowed = (direction == RoadDirection::TwoWay || direction == RoadDirection::OneWayReverse);
     }
     if (forwardDirection)
     {
-        if (middle == road->points.size() - 1 || visitedSegments.contains(encodeRoutePointId(road, middle, true)) || segment->_allowedDirection == -1)
+        if (middle == road->points31.size() - 1 || visitedSegments.contains(encodeRoutePointId(road, middle, true)) || segment->_allowedDirection == -1)
         {
             directionAllowed = false;
         }
@@ -982,8 +1854,8 @@ bool OsmAnd::RoutePlanner::checkIfOppositeSegmentWasVisited(
     bool reverseWaySearch,
     RoadSegmentsPriorityQueue& graphSegments,
     const std::shared_ptr<RoutePlannerContext::RouteCalculationSegment>& segment,
-    QMap<uint64_t, std::shared_ptr<RoutePlannerContext::RouteCalculationSegment> >& oppositeSegments,
-    const std::shared_ptr<const Model::Road>& road,
+    RoutePlannerContext::VisitedSegments& oppositeSegments,
+    const std::shared_ptr<const Road>& road,
     uint32_t segmentEnd,
     bool forwardDirection,
     uint32_t intervalId,
@@ -992,32 +1864,43 @@ bool OsmAnd::RoutePlanner::checkIfOppositeSegmentWasVisited(
 {
     const auto id = encodeRoutePointId(road, intervalId, !forwardDirection);
 
-    auto itOppositeSegment = oppositeSegments.constFind(id);
-    if (itOppositeSegment == oppositeSegments.cend())
-        return false;
+    std::shared_ptr<RoutePlannerContext::RouteCalculationSegment> oppositeSegment;
+    float oppositeDistanceFromStart;
+    if (const auto meetingSegments = oppositeSegments.getMeetingSegments())
+    {
+        // Opposite direction runs in parallel, so only its published state can be used
+        const auto entry = meetingSegments->find(id);
+        if (!entry || entry->pointIndex != segmentEnd)
+            return false;
 
-    auto oppositeSegment = *itOppositeSegment;
-    if (oppositeSegment->pointIndex != segmentEnd)
-        return false;
+        oppositeSegment = entry->segment;
+        oppositeDistanceFromStart = entry->distanceFromStart;
+    }
+    else
+    {
+        oppositeSegment = oppositeSegments.value(id);
+        if (!oppositeSegment || oppositeSegment->pointIndex != segmentEnd)
+            return false;
+
+        oppositeDistanceFromStart = oppositeSegment->_distanceFromStart;
+    }
 
-    auto finalSegment = new RoutePlannerContext::RouteCalculationFinalSegment(road, segment->pointIndex);
+    const auto finalSegment = createFinalSegment(context->getSegmentsPool(reverseWaySearch), road, segment->pointIndex);
     auto distStartObstacles = segment->_distanceFromStart + calculateTimeWithObstacles(context, road, segmentDist, obstaclesTime);
     finalSegment->_parent = segment->_parent;
     finalSegment->_parentEndPointIndex = segment->_parentEndPointIndex;
-    finalSegment->_distanceFromStart = oppositeSegment->_distanceFromStart + distStartObstacles;
+    finalSegment->_distanceFromStart = oppositeDistanceFromStart + distStartObstacles;
     finalSegment->_distanceToEnd = 0;
     finalSegment->_reverseWaySearch = reverseWaySearch;
     finalSegment->_opposite = oppositeSegment;
 
-    graphSegments.push(std::shared_ptr<RoutePlannerContext::RouteCalculationSegment>(
-        dynamic_cast<RoutePlannerContext::RouteCalculationSegment*>(finalSegment)
-    ));
+    graphSegments.push(finalSegment);
     return true;
 }
 
 float OsmAnd::RoutePlanner::calculateTimeWithObstacles(
     OsmAnd::RoutePlannerContext::CalculationContext* context,
-    const std::shared_ptr<const Model::Road>& road,
+    const std::shared_ptr<const Road>& road,
     float distOnRoadToPass,
     float obstaclesTime)
 {
@@ -1037,7 +1920,7 @@ float OsmAnd::RoutePlanner::calculateTimeWithObstacles(
 bool OsmAnd::RoutePlanner::processRestrictions(
     OsmAnd::RoutePlannerContext::CalculationContext* context,
     QList< std::shared_ptr<RoutePlannerContext::RouteCalculationSegment> >& prescripted,
-    const std::shared_ptr<const Model::Road>& road,
+    const std::shared_ptr<const Road>& road,
     const std::shared_ptr<RoutePlannerContext::RouteCalculationSegment>& inputNext,
     bool reverseWay)
 {
@@ -1045,7 +1928,7 @@ bool OsmAnd::RoutePlanner::processRestrictions(
 
     auto exclusiveRestriction = false;
     auto next = inputNext;
-    if (!reverseWay && road->restrictions.size() == 0)
+    if (!reverseWay && road->getRestrictionsCount() == 0)
         return false;
     
     if (!context->owner->profileContext->profile->restrictionsAware)
@@ -1053,19 +1936,17 @@ bool OsmAnd::RoutePlanner::processRestrictions(
     
     while(next)
     {
-        Model::RoadRestriction type = Model::RoadRestriction::Invalid;
+        RoadRestriction type = RoadRestriction::Invalid;
         if (!reverseWay)
         {
-            auto itRestriction = road->restrictions.constFind(next->road->id);
-            if (itRestriction != road->restrictions.cend())
-                type = *itRestriction;
+            road->getRestriction(next->road->id, &type);
         }
         else
         {
-            for(const auto& restriction : rangeOf(constOf(next->road->restrictions)))
+            for (auto restrictionIdx = 0; restrictionIdx < next->road->getRestrictionsCount(); restrictionIdx++)
             {
-                const auto& restrictedTo = restriction.key();
-                const auto& crt = restriction.value();
+                const auto restrictedTo = next->road->getRestrictionDestination(restrictionIdx);
+                const auto crt = next->road->getRestrictionType(restrictionIdx);
 
                 if (restrictedTo == road->id)
                 {
@@ -1074,7 +1955,7 @@ bool OsmAnd::RoutePlanner::processRestrictions(
                 }
 
                 // Check if there is restriction only to the other than current road
-                if (crt == Model::RoadRestriction::OnlyRightTurn || crt == Model::RoadRestriction::OnlyLeftTurn || crt == Model::RoadRestriction::OnlyStraightOn)
+                if (crt == RoadRestriction::OnlyRightTurn || crt == RoadRestriction::OnlyLeftTurn || crt == RoadRestriction::OnlyStraightOn)
                 {
                     // check if that restriction applies to considered junction
                     auto foundNext = inputNext;
@@ -1086,24 +1967,24 @@ bool OsmAnd::RoutePlanner::processRestrictions(
                         foundNext = foundNext->next;
                     }
                     if (foundNext)
-                        type = Model::RoadRestriction::Special_ReverseWayOnly; // special constant
+                        type = RoadRestriction::Special_ReverseWayOnly; // special constant
                 }
             }
         }
 
-        if (type == Model::RoadRestriction::Special_ReverseWayOnly)
+        if (type == RoadRestriction::Special_ReverseWayOnly)
         {
             // next = next.next; continue;
         }
-        else if (type == Model::RoadRestriction::Invalid && exclusiveRestriction)
+        else if (type == RoadRestriction::Invalid && exclusiveRestriction)
         {
             // next = next.next; continue;
         }
-        else if (type == Model::RoadRestriction::NoLeftTurn || type == Model::RoadRestriction::NoRightTurn || type == Model::RoadRestriction::NoUTurn || type == Model::RoadRestriction::NoStraightOn)
+        else if (type == RoadRestriction::NoLeftTurn || type == RoadRestriction::NoRightTurn || type == RoadRestriction::NoUTurn || type == RoadRestriction::NoStraightOn)
         {
             // next = next.next; continue;
         }
-        else if (type == Model::RoadRestriction::Invalid)
+        else if (type == RoadRestriction::Invalid)
         {
             // case no restriction
             notForbidden.push_back(next);
@@ -1135,7 +2016,7 @@ bool OsmAnd::RoutePlanner::processRestrictions(
 void OsmAnd::RoutePlanner::processIntersections(
     OsmAnd::RoutePlannerContext::CalculationContext* context,
     RoadSegmentsPriorityQueue& graphSegments,
-    QMap<uint64_t, std::shared_ptr<RoutePlannerContext::RouteCalculationSegment> >& visitedSegments,
+    RoutePlannerContext::VisitedSegments& visitedSegments,
     float distFromStart,
     const std::shared_ptr<RoutePlannerContext::RouteCalculationSegment>& segment, 
     uint32_t segmentEnd,
@@ -1161,7 +2042,7 @@ void OsmAnd::RoutePlanner::processIntersections(
     while(current)
     {
         auto nextPlusNotAllowed =
-            (current->pointIndex == current->road->points.size() - 1) ||
+            (current->pointIndex == current->road->points31.size() - 1) ||
             visitedSegments.contains(encodeRoutePointId(current->road, current->pointIndex, true));
 
         auto nextMinusNotAllowed =
@@ -1177,11 +2058,11 @@ void OsmAnd::RoutePlanner::processIntersections(
         {
             auto targetEnd = reverseWaySearch ? context->_startPoint : context->_targetPoint;
             
-            auto distanceToEnd = h(context, segment->road->points[segmentEnd], targetEnd, current);
+            auto distanceToEnd = h(context, segment->road->points31[segmentEnd], targetEnd, current);
             
             // assigned to wrong direction
             if (current->_assignedDirection == -searchDirection)
-                current.reset(new RoutePlannerContext::RouteCalculationSegment(current->road, current->pointIndex));
+                current = createSegment(context->getSegmentsPool(reverseWaySearch), current->road, current->pointIndex);
 
             if (!current->parent ||
                 roadPriorityComparator(
@@ -1283,7 +2164,7 @@ void OsmAnd::RoutePlanner::processIntersections(
 
 bool OsmAnd::RoutePlanner::checkPartialRecalculationPossible(
     OsmAnd::RoutePlannerContext::CalculationContext* context,
-    QMap<uint64_t, std::shared_ptr<RoutePlannerContext::RouteCalculationSegment> >& visitedOppositeSegments,
+    RoutePlannerContext::VisitedSegments& visitedOppositeSegments,
     std::shared_ptr<RoutePlannerContext::RouteCalculationSegment>& outSegment)
 {
     if (context->owner->_previouslyCalculatedRoute.isEmpty() || qFuzzyCompare(context->owner->_partialRecalculationDistanceLimit, 0))
@@ -1328,53 +2209,18 @@ bool OsmAnd::RoutePlanner::checkPartialRecalculationPossible(
     return true;*/
 }
 
-void OsmAnd::RoutePlanner::updateDistanceForBorderPoints( RoutePlannerContext::CalculationContext* context, const PointI& sPoint, bool isDistanceToStart )
-{
-    const auto positive = !context->_borderLines.isEmpty() && sPoint.y < context->_borderLines.first()->_y31;
-
-    /*if (borderLines.length > 0 && !plus && sy< borderLines[borderLines.length - 1].borderLine){
-        throw new IllegalStateException();
-    }*/
-
-    auto itLine = positive ? context->_borderLines.cbegin() : context->_borderLines.cend() - 1;
-    auto itPrevLine = itLine;
-    for(auto c = 0; c < context->_borderLines.size(); c++, itPrevLine = positive ? itLine++ : itLine--)
-    {
-        const auto& line = *itLine;
-
-        for(const auto& borderPoint : constOf(line->_borderPoints))
-        {
-            auto distance = Utilities::distance31(sPoint.x, sPoint.y, borderPoint->location.x, borderPoint->location.y);
-
-            if (itLine != itPrevLine)
-            {
-                auto prevLine = *itPrevLine;
-
-                for(const auto& prevLinePoint : constOf(prevLine->_borderPoints))
-                {
-                    auto d = Utilities::distance31(prevLinePoint->location.x, prevLinePoint->location.y, borderPoint->location.x, borderPoint->location.y) +
-                        isDistanceToStart ? prevLinePoint->distanceToStartPoint : prevLinePoint->distanceToEndPoint;
-
-                    if (d < distance)
-                        distance = d;
-                }
-            }
-
-            if (isDistanceToStart)
-                borderPoint->distanceToStartPoint = distance;
-            else
-                borderPoint->distanceToEndPoint = distance;
-        }
-    }
-}
-
 std::shared_ptr<OsmAnd::RoutePlannerContext::RouteCalculationSegment> OsmAnd::RoutePlanner::loadRouteCalculationSegment(
-    OsmAnd::RoutePlannerContext* context,
-    uint32_t x31, uint32_t y31)
+    OsmAnd::RoutePlannerContext::CalculationContext* calculationContext,
+    uint32_t x31, uint32_t y31,
+    bool reverseWaySearch /*= false*/)
 {
+    const auto context = calculationContext->owner;
+    const auto& segmentsPool = calculationContext->getSegmentsPool(reverseWaySearch);
+    QMutexLocker scopedLocker(&context->_tilesMutex);
+
     auto tileId = getRoutingTileId(context, x31, y31, false);
 
-    QMap<uint64_t, std::shared_ptr<const Model::Road> > processed;
+    QMap<uint64_t, std::shared_ptr<const Road> > processed;
     std::shared_ptr<RoutePlannerContext::RouteCalculationSegment> original;
 
     const auto& itCachedRoads = context->_cachedRoadsInTiles.constFind(tileId);
@@ -1384,7 +2230,7 @@ std::shared_ptr<OsmAnd::RoutePlannerContext::RouteCalculationSegment> OsmAnd::Ro
         for(const auto& road : constOf(cachedRoads))
         {
             uint32_t pointIdx = 0;
-            for(auto itPoint = iteratorOf(constOf(road->points)); itPoint; ++itPoint, pointIdx++)
+            for(auto itPoint = iteratorOf(constOf(road->points31)); itPoint; ++itPoint, pointIdx++)
             {
                 const auto& point = *itPoint;
                 auto id = encodeRoutePointId(road, pointIdx);
@@ -1393,24 +2239,52 @@ std::shared_ptr<OsmAnd::RoutePlannerContext::RouteCalculationSegment> OsmAnd::Ro
 
                 processed.insert(id, road);
 
-                std::shared_ptr<RoutePlannerContext::RouteCalculationSegment> segment(new RoutePlannerContext::RouteCalculationSegment(road, pointIdx));
+                const auto segment = createSegment(segmentsPool, road, pointIdx);
                 segment->_next = original;
                 original = segment;
             }
         }
     }
 
-    auto itSubregionsContexts = context->_indexedSubsectionsContexts.constFind(tileId);
-    if (itSubregionsContexts != context->_indexedSubsectionsContexts.cend())
+    auto itTilesContexts = context->_indexedTilesContexts.constFind(tileId);
+    if (itTilesContexts != context->_indexedTilesContexts.cend())
     {
-        const auto& subregionsContexts = *itSubregionsContexts;
-        for(const auto& subregionsContext : constOf(subregionsContexts))
-            original = subregionsContext->loadRouteCalculationSegment(x31, y31, processed, original);
+        const auto& tilesContexts = *itTilesContexts;
+        for(const auto& tileContext : constOf(tilesContexts))
+            original = tileContext->loadRouteCalculationSegment(x31, y31, processed, original, segmentsPool);
     }
 
     return original;
 }
 
+std::shared_ptr<OsmAnd::RoutePlannerContext::RouteCalculationSegment> OsmAnd::RoutePlanner::createSegment(
+    const std::shared_ptr<RoutePlannerContext::RouteCalculationSegmentsPool>& pool,
+    const std::shared_ptr<const Road>& road,
+    uint32_t pointIndex)
+{
+    typedef RoutePlannerContext::RouteCalculationSegment Segment;
+
+    const auto segment = new(pool->allocate(sizeof(Segment), alignof(Segment))) Segment(road, pointIndex);
+    return std::shared_ptr<Segment>(
+        segment,
+        RoutePlannerContext::RouteCalculationSegmentsPool::Deleter(),
+        RoutePlannerContext::RouteCalculationSegmentsPool::Allocator<Segment>(pool));
+}
+
+std::shared_ptr<OsmAnd::RoutePlannerContext::RouteCalculationFinalSegment> OsmAnd::RoutePlanner::createFinalSegment(
+    const std::shared_ptr<RoutePlannerContext::RouteCalculationSegmentsPool>& pool,
+    const std::shared_ptr<const Road>& road,
+    uint32_t pointIndex)
+{
+    typedef RoutePlannerContext::RouteCalculationFinalSegment Segment;
+
+    const auto segment = new(pool->allocate(sizeof(Segment), alignof(Segment))) Segment(road, pointIndex);
+    return std::shared_ptr<Segment>(
+        segment,
+        RoutePlannerContext::RouteCalculationSegmentsPool::Deleter(),
+        RoutePlannerContext::RouteCalculationSegmentsPool::Allocator<Segment>(pool));
+}
+
 double OsmAnd::RoutePlanner::h(
     OsmAnd::RoutePlannerContext::CalculationContext* context,
     const PointI& start, const PointI& end,
@@ -1,10 +1,16 @@
 #include "RoutePlanner.h"
 #include "RoutePlannerContext.h"
+
+#include <OsmAndCore/QtExtensions.h>
+#include <QFile>
+
 #include "QKeyValueIterator.h"
 #include "QCachingIterator.h"
 #include "Logging.h"
 #include "Utilities.h"
 #include "ObfReader.h"
+#include "ObfFile.h"
+#include "RoutingProfile.h"
 
 OsmAnd::RoutePlannerContext::RoutePlannerContext(
     const QList< std::shared_ptr<ObfReader> >& sources,
@@ -13,7 +19,8 @@ OsmAnd::RoutePlannerContext::RoutePlannerContext(
     bool useBasemap,
     float initialHeading /*= std::numeric_limits<float>::quiet_NaN()*/,
     QHash<QString, QString>* options /*=nullptr*/,
-    size_t memoryLimit  )
+    size_t memoryLimit,
+    const std::shared_ptr<RoutingTilesCache>& tilesCache_ /*= nullptr*/)
     : _useBasemap(useBasemap)
     , _memoryUsageLimit(memoryLimit)
     , _loadedTiles(0)
@@ -22,17 +29,31 @@ OsmAnd::RoutePlannerContext::RoutePlannerContext(
     , configuration(routingConfig)
     , _routeStatistics(new RouteStatistics)
     , profileContext(new RoutingProfileContext(configuration->routingProfiles[vehicle], options))
+    , tilesCache(tilesCache_ ? tilesCache_ : RoutingTilesCache::globalInstance())
 {
     _partialRecalculationDistanceLimit = Utilities::parseArbitraryFloat(configuration->resolveAttribute(vehicle, "recalculateDistanceHelp"), 10000.0f);
     _heuristicCoefficient = Utilities::parseArbitraryFloat(configuration->resolveAttribute(vehicle, "heuristicCoefficient"), 1.0f);
     _planRoadDirection = Utilities::parseArbitraryInt(configuration->resolveAttribute(vehicle, "planRoadDirection"), 0);
     _roadTilesLoadingZoomLevel = Utilities::parseArbitraryUInt(configuration->resolveAttribute(vehicle, "zoomToLoadTiles"), DefaultRoadTilesLoadingZoomLevel);
-
+    _parallelBidirectionalSearch = Utilities::parseArbitraryBool(configuration->resolveAttribute(vehicle, "parallelBidirectionalSearch"), false);
+
+    // Hierarchy covers only detailed roads, ignores turn restrictions and is built with default
+    // options, so routes it finds may differ from what regular search finds otherwise
+    const auto canUseHierarchies =
+        !_useBasemap &&
+        !profileContext->profile->restrictionsAware &&
+        (!options || options->isEmpty());
     for(const auto& source : constOf(sources))
     {
-        const auto& obfInfo = source->obtainInfo();
-        for(const auto& routingSection : constOf(obfInfo->routingSections))
-            _sourcesLUT.insert(routingSection.get(), source);
+        if (!canUseHierarchies)
+            break;
+
+        const auto hierarchy = RoutingHierarchiesCache::globalInstance()->obtainHierarchy(
+            source->obfFile->filePath,
+            source->obfFile->fileSize,
+            profileContext->profile->name);
+        if (hierarchy)
+            _hierarchies.push_back(hierarchy);
     }
 }
 
@@ -40,15 +61,22 @@ OsmAnd::RoutePlannerContext::~RoutePlannerContext()
 {
 }
 
-OsmAnd::RoutePlannerContext::RoutingSubsectionContext::RoutingSubsectionContext( RoutePlannerContext* owner, const std::shared_ptr<ObfReader>& origin, const std::shared_ptr<const ObfRoutingSubsectionInfo>& subsection )
-    : subsection(subsection)
+OsmAnd::RoutePlannerContext::RoutingTileContext::RoutingTileContext(
+    RoutePlannerContext* owner,
+    const std::shared_ptr<ObfReader>& origin,
+    const std::shared_ptr<const ObfRoutingSectionInfo>& section,
+    const TileId tileId,
+    const ZoomLevel zoom)
+    : section(section)
+    , tileId(tileId)
+    , zoom(zoom)
     , owner(owner)
     ,_mixedLoadsCounter(0)
     , origin(origin)
 {
 }
 
-OsmAnd::RoutePlannerContext::RoutingSubsectionContext::~RoutingSubsectionContext()
+OsmAnd::RoutePlannerContext::RoutingTileContext::~RoutingTileContext()
 {
 }
 
@@ -56,7 +84,7 @@ OsmAnd::RoutePlannerContext::RoutingSubsectionContext::~RoutingSubsectionContext
 
 uint32_t OsmAnd::RoutePlannerContext::getCurrentlyLoadedTiles() {
     uint32_t cnt = 0;
-    for(const auto& t : this->_subsectionsContexts)
+    for(const auto& t : this->_tilesContexts)
     {
         if (t->isLoaded()) {
             cnt++;
@@ -79,8 +107,8 @@ uint32_t OsmAnd::RoutePlannerContext::getCurrentEstimatedSize() {
     return getCurrentlyLoadedTiles()*1000;
 }
 
-int compareSections(std::shared_ptr<OsmAnd::RoutePlannerContext::RoutingSubsectionContext> o1,
-                    std::shared_ptr<OsmAnd::RoutePlannerContext::RoutingSubsectionContext> o2) {
+int compareSections(std::shared_ptr<OsmAnd::RoutePlannerContext::RoutingTileContext> o1,
+                    std::shared_ptr<OsmAnd::RoutePlannerContext::RoutingTileContext> o2) {
     int v1 = (o1->getAccessCounter() + 1) * intpow(10, o1->getLoadsCounter() -1);
     int v2 = (o2->getAccessCounter() + 1) * intpow(10, o1->getLoadsCounter() -1);
     //return v1 < v2 ? -1 : (v1 == v2 ? 0 : 1);
@@ -90,9 +118,9 @@ int compareSections(std::shared_ptr<OsmAnd::RoutePlannerContext::RoutingSubsecti
 
 void OsmAnd::RoutePlannerContext::unloadUnusedTiles(size_t memoryTarget) {
     float desirableSize = memoryTarget * 0.7f;
-    QList< std::shared_ptr<RoutingSubsectionContext> > list;
+    QList< std::shared_ptr<RoutingTileContext> > list;
     int loaded = 0;
-    for(const auto& t : this->_subsectionsContexts) {
+    for(const auto& t : this->_tilesContexts) {
         if (t->isLoaded()) {
             list.push_back(t);
             loaded++;
@@ -105,7 +133,7 @@ void OsmAnd::RoutePlannerContext::unloadUnusedTiles(size_t memoryTarget) {
 
     int i = 0;
     while(getCurrentEstimatedSize() >= desirableSize && (list.size() - i) > loaded / 5 && i < list.size()) {
-        std::shared_ptr<RoutingSubsectionContext>  unload = list[i];
+        std::shared_ptr<RoutingTileContext>  unload = list[i];
         i++;
         unload->unload();
         if (_routeStatistics) {
@@ -117,14 +145,19 @@ void OsmAnd::RoutePlannerContext::unloadUnusedTiles(size_t memoryTarget) {
         OsmAnd::LogPrintf(OsmAnd::LogSeverityLevel::Info, "Unloaded tiles %d (loaded prevUnloaded %d, currently loaded %d)",  _routeStatistics->unloadedTiles,  _routeStatistics->loadedPrevUnloadedTiles, getCurrentlyLoadedTiles());
         OsmAnd::LogFlush();
     }
-    for(const auto& t : _subsectionsContexts)
+    for(const auto& t : _tilesContexts)
         t->_access /= 3;
 }
 
-void OsmAnd::RoutePlannerContext::RoutingSubsectionContext::registerRoad( const std::shared_ptr<const Model::Road>& road )
+std::shared_ptr<const OsmAnd::RouteStatistics> OsmAnd::RoutePlannerContext::getRouteStatistics() const
+{
+    return _routeStatistics;
+}
+
+void OsmAnd::RoutePlannerContext::RoutingTileContext::registerRoad( const std::shared_ptr<const Road>& road )
 {
     uint32_t idx = 0;
-    for(auto itPoint = iteratorOf(constOf(road->points)); itPoint; ++itPoint, idx++)
+    for(auto itPoint = iteratorOf(constOf(road->points31)); itPoint; ++itPoint, idx++)
     {
         const auto& point = *itPoint;
         const auto& x31 = point.x;
@@ -145,17 +178,17 @@ void OsmAnd::RoutePlannerContext::RoutingSubsectionContext::registerRoad( const
     }
 }
 
-bool OsmAnd::RoutePlannerContext::RoutingSubsectionContext::isLoaded() const
+bool OsmAnd::RoutePlannerContext::RoutingTileContext::isLoaded() const
 {
     return _mixedLoadsCounter  > 0;
 }
 
-uint32_t OsmAnd::RoutePlannerContext::RoutingSubsectionContext::getLoadsCounter() const
+uint32_t OsmAnd::RoutePlannerContext::RoutingTileContext::getLoadsCounter() const
 {
     return qAbs(_mixedLoadsCounter);
 }
 
-void OsmAnd::RoutePlannerContext::RoutingSubsectionContext::collectRoads( QList< std::shared_ptr<const Model::Road> >& output, QMap<uint64_t, std::shared_ptr<const Model::Road> >* duplicatesRegistry /*= nullptr*/ )
+void OsmAnd::RoutePlannerContext::RoutingTileContext::collectRoads( QList< std::shared_ptr<const Road> >& output, QMap<uint64_t, std::shared_ptr<const Road> >* duplicatesRegistry /*= nullptr*/ )
 {
     for(const auto& routeSegmentEntry : rangeOf(constOf(_roadSegments)))
     {
@@ -193,21 +226,23 @@ void OsmAnd::RoutePlannerContext::RoutingSubsectionContext::collectRoads( QList<
         */
 }
 
-void OsmAnd::RoutePlannerContext::RoutingSubsectionContext::markLoaded()
+void OsmAnd::RoutePlannerContext::RoutingTileContext::markLoaded()
 {
     _mixedLoadsCounter = qAbs(_mixedLoadsCounter) + 1;
 }
 
-void OsmAnd::RoutePlannerContext::RoutingSubsectionContext::unload()
+void OsmAnd::RoutePlannerContext::RoutingTileContext::unload()
 {
     _mixedLoadsCounter = -qAbs(_mixedLoadsCounter);
     _roadSegments.clear();
+    _tile.reset();
 }
 
-std::shared_ptr<OsmAnd::RoutePlannerContext::RouteCalculationSegment> OsmAnd::RoutePlannerContext::RoutingSubsectionContext::loadRouteCalculationSegment(
+std::shared_ptr<OsmAnd::RoutePlannerContext::RouteCalculationSegment> OsmAnd::RoutePlannerContext::RoutingTileContext::loadRouteCalculationSegment(
     uint32_t x31, uint32_t y31,
-    QMap<uint64_t, std::shared_ptr<const Model::Road> >& processed,
-    const std::shared_ptr<RouteCalculationSegment>& original_)
+    QMap<uint64_t, std::shared_ptr<const Road> >& processed,
+    const std::shared_ptr<RouteCalculationSegment>& original_,
+    const std::shared_ptr<RouteCalculationSegmentsPool>& segmentsPool)
 {
     uint64_t id = (static_cast<uint64_t>(x31) << 31) | y31;
     auto itSegment = _roadSegments.constFind(id);
@@ -222,11 +257,11 @@ std::shared_ptr<OsmAnd::RoutePlannerContext::RouteCalculationSegment> OsmAnd::Ro
         auto road = segment->road;
         auto roadPointId = RoutePlanner::encodeRoutePointId(road, segment->pointIndex);
         auto itOtherRoad = processed.constFind(roadPointId);
-        if (itOtherRoad == processed.cend() || (*itOtherRoad)->points.size() < road->points.size())
+        if (itOtherRoad == processed.cend() || (*itOtherRoad)->points31.size() < road->points31.size())
         {
             processed.insert(roadPointId, road);
 
-            std::shared_ptr<RouteCalculationSegment> newSegment(new RouteCalculationSegment(road, segment->pointIndex));
+            const auto newSegment = RoutePlanner::createSegment(segmentsPool, road, segment->pointIndex);
             newSegment->_next = original;
             original = newSegment;
         }
@@ -237,8 +272,175 @@ std::shared_ptr<OsmAnd::RoutePlannerContext::RouteCalculationSegment> OsmAnd::Ro
     return original;
 }
 
+OsmAnd::RoutePlannerContext::RouteCalculationSegmentsPool::RouteCalculationSegmentsPool()
+    : _chunkOffset(0)
+    , _chunkSize(0)
+{
+}
+
+OsmAnd::RoutePlannerContext::RouteCalculationSegmentsPool::~RouteCalculationSegmentsPool()
+{
+}
+
+void* OsmAnd::RoutePlannerContext::RouteCalculationSegmentsPool::allocate(size_t size, size_t alignment)
+{
+    auto offset = (_chunkOffset + alignment - 1) & ~(alignment - 1);
+    if (_chunks.empty() || offset + size > _chunkSize)
+    {
+        // Oversized request gets a chunk of its own
+        _chunkSize = qMax<size_t>(ChunkSize, size);
+        _chunks.emplace_back(new uint8_t[_chunkSize]);
+        offset = 0;
+    }
+
+    _chunkOffset = offset + size;
+    return _chunks.back().get() + offset;
+}
+
+namespace
+{
+    inline size_t hashRoutePointId(uint64_t id)
+    {
+        // Road ids are shifted left by point index bits, so low bits have to be mixed with high ones
+        id ^= id >> 33;
+        id *= 0xff51afd7ed558ccdULL;
+        id ^= id >> 33;
+        return static_cast<size_t>(id);
+    }
+}
+
+OsmAnd::RoutePlannerContext::MeetingSegments::MeetingSegments(const std::shared_ptr<RouteCalculationSegmentsPool>& pool)
+    : _buckets(new std::atomic<Entry*>[1u << BucketsCountLog2])
+    , _pool(pool)
+{
+    for (auto bucketIdx = 0u; bucketIdx < (1u << BucketsCountLog2); bucketIdx++)
+        _buckets[bucketIdx].store(nullptr, std::memory_order_relaxed);
+}
+
+OsmAnd::RoutePlannerContext::MeetingSegments::~MeetingSegments()
+{
+    // Memory of entries belongs to the pool, only release segments they hold
+    for (auto bucketIdx = 0u; bucketIdx < (1u << BucketsCountLog2); bucketIdx++)
+    {
+        auto entry = _buckets[bucketIdx].load(std::memory_order_relaxed);
+        while (entry)
+        {
+            const auto next = entry->next;
+            entry->~Entry();
+            entry = next;
+        }
+    }
+}
+
+void OsmAnd::RoutePlannerContext::MeetingSegments::insert(uint64_t id, const std::shared_ptr<RouteCalculationSegment>& segment)
+{
+    auto& bucket = _buckets[hashRoutePointId(id) & ((1u << BucketsCountLog2) - 1)];
+
+    const auto entry = new(_pool->allocate(sizeof(Entry), alignof(Entry))) Entry();
+    entry->id = id;
+    entry->pointIndex = segment->pointIndex;
+    entry->distanceFromStart = segment->_distanceFromStart;
+    entry->segment = segment;
+    entry->next = bucket.load(std::memory_order_relaxed);
+
+    // Entry has to be complete before it becomes visible to the other thread. Newer entry of
+    // the same id shadows older ones
+    bucket.store(entry, std::memory_order_release);
+}
+
+const OsmAnd::RoutePlannerContext::MeetingSegments::Entry* OsmAnd::RoutePlannerContext::MeetingSegments::find(uint64_t id) const
+{
+    auto entry = _buckets[hashRoutePointId(id) & ((1u << BucketsCountLog2) - 1)].load(std::memory_order_acquire);
+    while (entry && entry->id != id)
+        entry = entry->next;
+    return entry;
+}
+
+OsmAnd::RoutePlannerContext::VisitedSegments::VisitedSegments()
+    : _size(0)
+    , _meetingSegments(nullptr)
+{
+}
+
+OsmAnd::RoutePlannerContext::VisitedSegments::~VisitedSegments()
+{
+}
+
+size_t OsmAnd::RoutePlannerContext::VisitedSegments::findSlot(uint64_t id) const
+{
+    const auto mask = _entries.size() - 1;
+    auto slot = hashRoutePointId(id) & mask;
+    while (_entries[slot].segment && _entries[slot].id != id)
+        slot = (slot + 1) & mask;
+    return slot;
+}
+
+void OsmAnd::RoutePlannerContext::VisitedSegments::grow()
+{
+    std::vector<Entry> oldEntries;
+    oldEntries.swap(_entries);
+    _entries.resize(qMax<size_t>(InitialCapacity, oldEntries.size() * 2));
+
+    for(auto& entry : oldEntries)
+    {
+        if (!entry.segment)
+            continue;
+
+        _entries[findSlot(entry.id)] = qMove(entry);
+    }
+}
+
+void OsmAnd::RoutePlannerContext::VisitedSegments::insert(uint64_t id, const std::shared_ptr<RouteCalculationSegment>& segment)
+{
+    // Keep load factor under 1/2, so that probe sequences stay short
+    if ((_size + 1) * 2 > _entries.size())
+        grow();
+
+    auto& entry = _entries[findSlot(id)];
+    if (!entry.segment)
+        _size++;
+    entry.id = id;
+    entry.segment = segment;
+
+    if (_meetingSegments)
+        _meetingSegments->insert(id, segment);
+}
+
+bool OsmAnd::RoutePlannerContext::VisitedSegments::contains(uint64_t id) const
+{
+    if (_entries.empty())
+        return false;
+
+    return static_cast<bool>(_entries[findSlot(id)].segment);
+}
+
+std::shared_ptr<OsmAnd::RoutePlannerContext::RouteCalculationSegment> OsmAnd::RoutePlannerContext::VisitedSegments::value(uint64_t id) const
+{
+    if (_entries.empty())
+        return nullptr;
+
+    return _entries[findSlot(id)].segment;
+}
+
+size_t OsmAnd::RoutePlannerContext::VisitedSegments::size() const
+{
+    return _size;
+}
+
+void OsmAnd::RoutePlannerContext::VisitedSegments::publishTo(MeetingSegments* meetingSegments)
+{
+    _meetingSegments = meetingSegments;
+}
+
+OsmAnd::RoutePlannerContext::MeetingSegments* OsmAnd::RoutePlannerContext::VisitedSegments::getMeetingSegments() const
+{
+    return _meetingSegments;
+}
+
 OsmAnd::RoutePlannerContext::CalculationContext::CalculationContext( RoutePlannerContext* owner )
-    : owner(owner)
+    : _segmentsPool(new RouteCalculationSegmentsPool())
+    , _reverseSegmentsPool(new RouteCalculationSegmentsPool())
+    , owner(owner)
 {
 }
 
@@ -246,7 +448,12 @@ OsmAnd::RoutePlannerContext::CalculationContext::~CalculationContext()
 {
 }
 
-OsmAnd::RoutePlannerContext::RouteCalculationSegment::RouteCalculationSegment( const std::shared_ptr<const Model::Road>& road_, uint32_t pointIndex )
+const std::shared_ptr<OsmAnd::RoutePlannerContext::RouteCalculationSegmentsPool>& OsmAnd::RoutePlannerContext::CalculationContext::getSegmentsPool(bool reverseWaySearch)
+{
+    return reverseWaySearch ? _reverseSegmentsPool : _segmentsPool;
+}
+
+OsmAnd::RoutePlannerContext::RouteCalculationSegment::RouteCalculationSegment( const std::shared_ptr<const Road>& road_, uint32_t pointIndex )
     : _distanceFromStart(0)
     , _distanceToEnd(0)
     , next(_next)
@@ -280,7 +487,7 @@ void OsmAnd::RoutePlannerContext::RouteCalculationSegment::dump(const QString& p
     }
 }
 
-OsmAnd::RoutePlannerContext::RouteCalculationFinalSegment::RouteCalculationFinalSegment( const std::shared_ptr<const Model::Road>& road, uint32_t pointIndex )
+OsmAnd::RoutePlannerContext::RouteCalculationFinalSegment::RouteCalculationFinalSegment( const std::shared_ptr<const Road>& road, uint32_t pointIndex )
     : RouteCalculationSegment(road, pointIndex)
     , reverseWaySearch(_reverseWaySearch)
     , opposite(_opposite)
@@ -52,6 +52,14 @@ OsmAnd::RouteCalculationResult OsmAnd::RoutePlanner::prepareResult(
     }
     std::reverse(route.begin(), route.end());
 
+    return completeRoute(context, route, leftSideNavigation);
+}
+
+OsmAnd::RouteCalculationResult OsmAnd::RoutePlanner::completeRoute(
+    OsmAnd::RoutePlannerContext::CalculationContext* context,
+    QVector< std::shared_ptr<RouteSegment> >& route,
+    bool leftSideNavigation)
+{
     if (!validateAllPointsConnected(route))
         return OsmAnd::RouteCalculationResult("Calculated route has broken paths");
     splitRoadsAndAttachRoadSegments(context, route);
@@ -87,7 +95,7 @@ void OsmAnd::RoutePlanner::printRouteInfo(QVector< std::shared_ptr<RouteSegment>
 
 void OsmAnd::RoutePlanner::splitRoadsAndAttachRoadSegments( OsmAnd::RoutePlannerContext::CalculationContext* context, QVector< std::shared_ptr<RouteSegment> >& route )
 {
-    for(auto itSegment = iteratorOf(route); itSegment; ++itSegment)
+    for(auto itSegment = cachingIteratorOf(route); itSegment; ++itSegment)
     {
         auto segment = *itSegment;
         /*TODO:GC
@@ -154,11 +162,11 @@ void OsmAnd::RoutePlanner::attachRouteSegments(
     uint32_t pointIdx, bool isIncrement)
 {
     const auto& segment = *itSegment;
-    const auto& nextL = pointIdx < segment->road->points.size() - 1
-        ? segment->road->points[pointIdx + 1]
+    const auto& nextL = pointIdx < segment->road->points31.size() - 1
+        ? segment->road->points31[pointIdx + 1]
         : PointI();
     const auto& prevL = pointIdx > 0
-        ? segment->road->points[pointIdx - 1]
+        ? segment->road->points31[pointIdx - 1]
         : PointI();
 
     // by default make same as this road id
@@ -173,8 +181,8 @@ void OsmAnd::RoutePlanner::attachRouteSegments(
             std::shared_ptr<RouteSegment> attachedSegment;
 
             if (previousResult->startPointIndex < previousResult->endPointIndex &&
-                previousResult->endPointIndex < previousResult->road->points.size() - 1)
-                attachedSegment.reset(new RouteSegment(previousResult->road, previousResult->endPointIndex, previousResult->road->points.size() - 1));
+                previousResult->endPointIndex < previousResult->road->points31.size() - 1)
+                attachedSegment.reset(new RouteSegment(previousResult->road, previousResult->endPointIndex, previousResult->road->points31.size() - 1));
             else if (previousResult->startPointIndex > previousResult->endPointIndex && previousResult->endPointIndex > 0)
                 attachedSegment.reset(new RouteSegment(previousResult->road, previousResult->endPointIndex, 0));
 
@@ -184,8 +192,8 @@ void OsmAnd::RoutePlanner::attachRouteSegments(
     }
 
     // Try to attach all segments except with current id
-    const auto& p31 = segment->road->points[pointIdx];
-    auto rt = OsmAnd::RoutePlanner::loadRouteCalculationSegment(context->owner, p31.x, p31.y);
+    const auto& p31 = segment->road->points31[pointIdx];
+    auto rt = OsmAnd::RoutePlanner::loadRouteCalculationSegment(context, p31.x, p31.y);
     while(rt)
     {
         if (rt->road->id != segment->road->id && rt->road->id != previousRoadId)
@@ -194,18 +202,18 @@ void OsmAnd::RoutePlanner::attachRouteSegments(
             //TODO:GC:checkAndInitRouteRegion(ctx, rt->road);
             // TODO restrictions can be considered as well
             auto direction = context->owner->profileContext->getDirection(rt->road);
-            if ((direction == Model::RoadDirection::TwoWay || direction == Model::RoadDirection::OneWayReverse) && rt->pointIndex < rt->road->points.size() - 1)
+            if ((direction == RoadDirection::TwoWay || direction == RoadDirection::OneWayReverse) && rt->pointIndex < rt->road->points31.size() - 1)
             {
-                const auto& otherPoint = rt->road->points[rt->pointIndex + 1];
+                const auto& otherPoint = rt->road->points31[rt->pointIndex + 1];
                 if (otherPoint != nextL && otherPoint != prevL)
                 {
                     // if way contains same segment (nodes) as different way (do not attach it)
-                    attachedSegment.reset(new RouteSegment(rt->road, rt->pointIndex, rt->road->points.size() - 1));
+                    attachedSegment.reset(new RouteSegment(rt->road, rt->pointIndex, rt->road->points31.size() - 1));
                 }
             }
-            if ((direction == Model::RoadDirection::TwoWay || direction == Model::RoadDirection::OneWayForward) && rt->pointIndex > 0)
+            if ((direction == RoadDirection::TwoWay || direction == RoadDirection::OneWayForward) && rt->pointIndex > 0)
             {
-                const auto& otherPoint = rt->road->points[rt->pointIndex - 1];
+                const auto& otherPoint = rt->road->points31[rt->pointIndex - 1];
                 if (otherPoint != nextL && otherPoint != prevL)
                 {
                     // if way contains same segment (nodes) as different way (do not attach it)
@@ -235,8 +243,8 @@ void OsmAnd::RoutePlanner::calculateTimeSpeedInRoute( OsmAnd::RoutePlannerContex
         float distanceSum = 0;
         for(auto pointIdx = segment->startPointIndex; pointIdx != segment->endPointIndex; isIncrement ? pointIdx++ : pointIdx--)
         {
-            const auto& point1 = segment->road->points[pointIdx];
-            const auto& point2 = segment->road->points[pointIdx + (isIncrement ? +1 : -1)];
+            const auto& point1 = segment->road->points31[pointIdx];
+            const auto& point2 = segment->road->points31[pointIdx + (isIncrement ? +1 : -1)];
             auto distance = Utilities::distance(
                 Utilities::get31LongitudeX(point1.x), Utilities::get31LatitudeY(point1.y),
                 Utilities::get31LongitudeX(point2.x), Utilities::get31LatitudeY(point2.y)
@@ -266,8 +274,8 @@ bool OsmAnd::RoutePlanner::validateAllPointsConnected( const QVector< std::share
         auto prevSegment = route[i-1];
         auto segment = route[i];
 
-        const auto& point1 = prevSegment->road->points[prevSegment->endPointIndex];
-        const auto& point2 = segment->road->points[segment->startPointIndex];
+        const auto& point1 = prevSegment->road->points31[prevSegment->endPointIndex];
+        const auto& point2 = segment->road->points31[segment->startPointIndex];
         auto distance = Utilities::distance(
             Utilities::get31LongitudeX(point1.x), Utilities::get31LatitudeY(point1.y),
             Utilities::get31LongitudeX(point2.x), Utilities::get31LatitudeY(point2.y)
@@ -354,7 +362,7 @@ OsmAnd::TurnInfo attachKeepLeftInfoAndLanes(bool leftSide,
 
     QList<std::shared_ptr<OsmAnd::RouteSegment> > attachedRoutes = currentSegm->attachedRoutes[0];
     int ls = prevSegm->road->getLanes();
-    if (ls >= 0 && prevSegm->road->getDirection() == OsmAnd::Model::RoadDirection::TwoWay) {
+    if (ls >= 0 && prevSegm->road->getDirection() == OsmAnd::RoadDirection::TwoWay) {
         ls = (ls + 1) / 2;
     }
     int left = 0;
@@ -370,7 +378,7 @@ OsmAnd::TurnInfo attachKeepLeftInfoAndLanes(bool leftSide,
                 if ((ex < OsmAnd::RoutePlanner::MinTurnAngle || mpi < OsmAnd::RoutePlanner::MinTurnAngle) && ex >= 0) {
                     kl = true;
                     int lns = attached->road->getLanes();
-                    if (attached->road->getDirection() == OsmAnd::Model::RoadDirection::TwoWay) {
+                    if (attached->road->getDirection() == OsmAnd::RoadDirection::TwoWay) {
                         lns = (lns + 1) / 2;
                     }
                     if (lns > 0) {
@@ -380,7 +388,7 @@ OsmAnd::TurnInfo attachKeepLeftInfoAndLanes(bool leftSide,
                 } else if ((ex > -OsmAnd::RoutePlanner::MinTurnAngle || mpi < OsmAnd::RoutePlanner::MinTurnAngle) && ex <= 0) {
                     kr = true;
                     int lns = attached->road->getLanes();
-                    if (attached->road->getDirection() == OsmAnd::Model::RoadDirection::TwoWay) {
+                    if (attached->road->getDirection() == OsmAnd::RoadDirection::TwoWay) {
                         lns = (lns + 1) / 2;
                     }
                     if (lns > 0) {
@@ -397,7 +405,7 @@ OsmAnd::TurnInfo attachKeepLeftInfoAndLanes(bool leftSide,
         right = 1;
     }
     int current = currentSegm->road->getLanes();
-    if (currentSegm->road->getDirection() == OsmAnd::Model::RoadDirection::TwoWay) {
+    if (currentSegm->road->getDirection() == OsmAnd::RoadDirection::TwoWay) {
         current = (current + 1) / 2;
     }
     if (current <= 0) {
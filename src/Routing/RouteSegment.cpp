@@ -7,7 +7,7 @@
 #include "OsmAndCore/Utilities.h"
 #include "OsmAndCore/Logging.h"
 
-OsmAnd::RouteSegment::RouteSegment(const std::shared_ptr<const Model::Road>& road_, uint32_t startPointIndex_, uint32_t endPointIndex_)
+OsmAnd::RouteSegment::RouteSegment(const std::shared_ptr<const Road>& road_, uint32_t startPointIndex_, uint32_t endPointIndex_)
     : _road(road_)
     , _startPointIndex(startPointIndex_)
     , _endPointIndex(endPointIndex_)
@@ -22,7 +22,7 @@ OsmAnd::RouteSegment::RouteSegment(const std::shared_ptr<const Model::Road>& roa
     , turnInfo(_turnType)
     , description(_description)
 {
-    if (startPointIndex_ >= road_->points.size() || endPointIndex_ >= road_->points.size())
+    if (startPointIndex_ >= road_->points31.size() || endPointIndex_ >= road_->points31.size())
     {
         int i = 5;
     }
@@ -35,17 +35,17 @@ OsmAnd::RouteSegment::~RouteSegment()
 
 double OsmAnd::RouteSegment::getBearing( uint32_t pointIndex, bool isIncrement ) const
 {
-    return road->getDirectionDelta(pointIndex, isIncrement) / M_PI * 180.0;
+    return road->directionRoute(pointIndex, isIncrement) / M_PI * 180.0;
 }
 
 double OsmAnd::RouteSegment::getBearingBegin() const
 {
-    return road->getDirectionDelta(_startPointIndex, _startPointIndex < _endPointIndex) / M_PI * 180.0;
+    return road->directionRoute(_startPointIndex, _startPointIndex < _endPointIndex) / M_PI * 180.0;
 }
 
 double OsmAnd::RouteSegment::getBearingEnd() const
 {
-    return Utilities::normalizedAngleRadians(road->getDirectionDelta(_endPointIndex, _startPointIndex > _endPointIndex) - M_PI) / M_PI * 180.0;
+    return Utilities::normalizedAngleRadians(road->directionRoute(_endPointIndex, _startPointIndex > _endPointIndex) - M_PI) / M_PI * 180.0;
 }
 
 void OsmAnd::RouteSegment::dump( const QString& prefix /*= QString::null*/ ) const
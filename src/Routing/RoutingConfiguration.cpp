@@ -8,7 +8,7 @@
 #include <QStringList>
 
 #include "Common.h"
-#include "EmbeddedResources.h"
+#include "ICoreResourcesProvider.h"
 #include "Utilities.h"
 #include "Logging.h"
 #include "LoggingAssert.h"
@@ -154,7 +154,8 @@ void OsmAnd::RoutingConfiguration::parseRoutingParameter( QXmlStreamReader* xmlP
 
 void OsmAnd::RoutingConfiguration::loadDefault( RoutingConfiguration& outConfig )
 {
-    auto rawDefaultConfig = EmbeddedResources::decompressResource("routing.xml");
+    auto rawDefaultConfig = getCoreResourcesProvider()->getResource(
+        QLatin1String("routing/routing.xml"));
     QBuffer defaultConfig(&rawDefaultConfig);
     bool ok = false;
     ok = defaultConfig.open(QIODevice::ReadOnly | QIODevice::Text);
@@ -0,0 +1,889 @@
+#include "RoutingHierarchy.h"
+
+#include <queue>
+#include <vector>
+#include <atomic>
+
+#include <OsmAndCore/QtExtensions.h>
+#include "ignore_warnings_on_external_includes.h"
+#include <QFile>
+#include <QFileInfo>
+#include <QDateTime>
+#include <QDataStream>
+#include "restore_internal_warnings.h"
+
+#include "ObfReader.h"
+#include "ObfFile.h"
+#include "ObfRoutingSectionReader.h"
+#include "ObfRoutingSectionInfo.h"
+#include "RoutingProfile.h"
+#include "RoutingProfileContext.h"
+#include "Logging.h"
+#include "Utilities.h"
+#include "QKeyValueIterator.h"
+#include "WorkerPool.h"
+
+namespace
+{
+    typedef std::pair<float, uint32_t> QueueEntry;
+    typedef std::priority_queue< QueueEntry, std::vector<QueueEntry>, std::greater<QueueEntry> > MinQueue;
+
+    inline uint64_t encodePointId(const OsmAnd::PointI& point31)
+    {
+        return (static_cast<uint64_t>(point31.x) << 31) | static_cast<uint64_t>(point31.y);
+    }
+
+    // Same as RoutePlanner::calculateTimeWithObstacles()
+    inline float calculateTime(
+        OsmAnd::RoutingProfileContext* const profileContext,
+        const std::shared_ptr<const OsmAnd::Road>& road,
+        const float distance,
+        const float obstaclesTime)
+    {
+        const auto priority = profileContext->getSpeedPriority(road);
+        auto speed = profileContext->getSpeed(road) * priority;
+        if (qFuzzyCompare(speed, 0.0f))
+            speed = profileContext->profile->defaultSpeed * priority;
+        if (speed > profileContext->profile->maxSpeed)
+            speed = profileContext->profile->maxSpeed;
+
+        return obstaclesTime + distance / speed;
+    }
+
+    struct Contractor
+    {
+        Contractor(QVector<OsmAnd::RoutingHierarchy::Edge>& edges, const int nodesCount)
+            : edges(edges)
+            , outgoing(nodesCount)
+            , incoming(nodesCount)
+            , contracted(nodesCount, false)
+            , contractedNeighbours(nodesCount, 0)
+            , witnessTimes(nodesCount, std::numeric_limits<float>::infinity())
+        {
+            for (auto edgeId = 0; edgeId < edges.size(); edgeId++)
+            {
+                outgoing[edges[edgeId].from].push_back(edgeId);
+                incoming[edges[edgeId].to].push_back(edgeId);
+            }
+        }
+
+        QVector<OsmAnd::RoutingHierarchy::Edge>& edges;
+        std::vector< std::vector<uint32_t> > outgoing;
+        std::vector< std::vector<uint32_t> > incoming;
+        std::vector<bool> contracted;
+        std::vector<int> contractedNeighbours;
+
+        std::vector<float> witnessTimes;
+        std::vector<uint32_t> witnessTouched;
+
+        // Limited Dijkstra from source that avoids excluded node. Fills witnessTimes
+        void witnessSearch(const uint32_t source, const uint32_t excluded, const float maxTime, const int settledLimit)
+        {
+            for (const auto node : witnessTouched)
+                witnessTimes[node] = std::numeric_limits<float>::infinity();
+            witnessTouched.clear();
+
+            MinQueue queue;
+            witnessTimes[source] = 0.0f;
+            witnessTouched.push_back(source);
+            queue.push(QueueEntry(0.0f, source));
+
+            auto settledCount = 0;
+            while (!queue.empty() && settledCount < settledLimit)
+            {
+                const auto entry = queue.top();
+                queue.pop();
+                if (entry.first > witnessTimes[entry.second])
+                    continue;
+                if (entry.first > maxTime)
+                    break;
+                settledCount++;
+
+                for (const auto edgeId : outgoing[entry.second])
+                {
+                    const auto& edge = edges[edgeId];
+                    if (edge.to == excluded || contracted[edge.to])
+                        continue;
+
+                    const auto time = entry.first + edge.time;
+                    if (time >= witnessTimes[edge.to])
+                        continue;
+
+                    if (std::isinf(witnessTimes[edge.to]))
+                        witnessTouched.push_back(edge.to);
+                    witnessTimes[edge.to] = time;
+                    queue.push(QueueEntry(time, edge.to));
+                }
+            }
+        }
+
+        // Counts (or adds) shortcuts needed to contract node
+        int contract(const uint32_t node, const bool apply, const int settledLimit)
+        {
+            auto shortcutsCount = 0;
+            for (const auto inEdgeId : incoming[node])
+            {
+                // Copy, since adding shortcuts may reallocate edges
+                const auto inEdge = edges[inEdgeId];
+                if (contracted[inEdge.from] || inEdge.from == node)
+                    continue;
+
+                auto maxTime = 0.0f;
+                for (const auto outEdgeId : outgoing[node])
+                {
+                    const auto& outEdge = edges[outEdgeId];
+                    if (contracted[outEdge.to] || outEdge.to == node || outEdge.to == inEdge.from)
+                        continue;
+                    maxTime = qMax(maxTime, inEdge.time + outEdge.time);
+                }
+                if (maxTime <= 0.0f)
+                    continue;
+
+                witnessSearch(inEdge.from, node, maxTime, settledLimit);
+
+                const auto outEdgesIds = outgoing[node];
+                for (const auto outEdgeId : outEdgesIds)
+                {
+                    const auto outEdge = edges[outEdgeId];
+                    if (contracted[outEdge.to] || outEdge.to == node || outEdge.to == inEdge.from)
+                        continue;
+
+                    const auto time = inEdge.time + outEdge.time;
+                    if (witnessTimes[outEdge.to] <= time)
+                        continue;
+
+                    shortcutsCount++;
+                    if (!apply)
+                        continue;
+
+                    OsmAnd::RoutingHierarchy::Edge shortcut;
+                    shortcut.from = inEdge.from;
+                    shortcut.to = outEdge.to;
+                    shortcut.time = time;
+                    shortcut.roadId = 0;
+                    shortcut.startPointIndex = 0;
+                    shortcut.endPointIndex = 0;
+                    shortcut.firstChild = inEdgeId;
+                    shortcut.secondChild = outEdgeId;
+
+                    const uint32_t shortcutId = edges.size();
+                    edges.push_back(shortcut);
+                    outgoing[shortcut.from].push_back(shortcutId);
+                    incoming[shortcut.to].push_back(shortcutId);
+                }
+            }
+
+            return shortcutsCount;
+        }
+
+        int priorityOf(const uint32_t node, const int settledLimit)
+        {
+            auto removedEdgesCount = 0;
+            for (const auto edgeId : incoming[node])
+            {
+                if (!contracted[edges[edgeId].from])
+                    removedEdgesCount++;
+            }
+            for (const auto edgeId : outgoing[node])
+            {
+                if (!contracted[edges[edgeId].to])
+                    removedEdgesCount++;
+            }
+
+            return contract(node, false, settledLimit) - removedEdgesCount + contractedNeighbours[node];
+        }
+    };
+}
+
+OsmAnd::RoutingHierarchy::RoutingHierarchy(const QString& profileName_, const uint64_t obfFileSize_)
+    : profileName(profileName_)
+    , obfFileSize(obfFileSize_)
+    , nodes(_nodes)
+    , edges(_edges)
+{
+}
+
+OsmAnd::RoutingHierarchy::~RoutingHierarchy()
+{
+}
+
+QVector<uint32_t> OsmAnd::RoutingHierarchy::getRoadEdges(const uint64_t roadId) const
+{
+    return _roadsEdges.value(roadId);
+}
+
+void OsmAnd::RoutingHierarchy::buildSearchGraph()
+{
+    const auto nodesCount = _nodes.size();
+
+    _upwardOutgoingOffsets.fill(0, nodesCount + 1);
+    _upwardIncomingOffsets.fill(0, nodesCount + 1);
+    for (const auto& edge : constOf(_edges))
+    {
+        if (_nodes[edge.to].rank > _nodes[edge.from].rank)
+            _upwardOutgoingOffsets[edge.from + 1]++;
+        else
+            _upwardIncomingOffsets[edge.to + 1]++;
+    }
+    for (auto nodeId = 0; nodeId < nodesCount; nodeId++)
+    {
+        _upwardOutgoingOffsets[nodeId + 1] += _upwardOutgoingOffsets[nodeId];
+        _upwardIncomingOffsets[nodeId + 1] += _upwardIncomingOffsets[nodeId];
+    }
+
+    _upwardOutgoingEdges.resize(_upwardOutgoingOffsets[nodesCount]);
+    _upwardIncomingEdges.resize(_upwardIncomingOffsets[nodesCount]);
+    auto outgoingFill = _upwardOutgoingOffsets;
+    auto incomingFill = _upwardIncomingOffsets;
+    _roadsEdges.clear();
+    for (auto edgeId = 0; edgeId < _edges.size(); edgeId++)
+    {
+        const auto& edge = _edges[edgeId];
+        if (_nodes[edge.to].rank > _nodes[edge.from].rank)
+            _upwardOutgoingEdges[outgoingFill[edge.from]++] = edgeId;
+        else
+            _upwardIncomingEdges[incomingFill[edge.to]++] = edgeId;
+
+        if (!edge.isShortcut())
+            _roadsEdges[edge.roadId].push_back(edgeId);
+    }
+}
+
+void OsmAnd::RoutingHierarchy::unpackEdge(const uint32_t edgeId, QVector<uint32_t>& outEdges) const
+{
+    const auto& edge = _edges[edgeId];
+    if (!edge.isShortcut())
+    {
+        outEdges.push_back(edgeId);
+        return;
+    }
+
+    unpackEdge(edge.firstChild, outEdges);
+    unpackEdge(edge.secondChild, outEdges);
+}
+
+bool OsmAnd::RoutingHierarchy::findPath(
+    const QVector<Terminal>& sources,
+    const QVector<Terminal>& targets,
+    QVector<uint32_t>& outEdges,
+    int* const outSourceIndex /*= nullptr*/,
+    int* const outTargetIndex /*= nullptr*/,
+    float* const outTime /*= nullptr*/,
+    const IQueryController* const controller /*= nullptr*/) const
+{
+    struct Label
+    {
+        float time;
+        uint32_t parentEdge;
+        int terminalIndex;
+    };
+    QHash<uint32_t, Label> labels[2];
+    MinQueue queues[2];
+
+    for (auto terminalIndex = 0; terminalIndex < sources.size(); terminalIndex++)
+    {
+        const auto& terminal = sources[terminalIndex];
+        const auto itLabel = labels[0].constFind(terminal.node);
+        if (itLabel != labels[0].cend() && itLabel->time <= terminal.time)
+            continue;
+
+        labels[0].insert(terminal.node, { terminal.time, InvalidId, terminalIndex });
+        queues[0].push(QueueEntry(terminal.time, terminal.node));
+    }
+    for (auto terminalIndex = 0; terminalIndex < targets.size(); terminalIndex++)
+    {
+        const auto& terminal = targets[terminalIndex];
+        const auto itLabel = labels[1].constFind(terminal.node);
+        if (itLabel != labels[1].cend() && itLabel->time <= terminal.time)
+            continue;
+
+        labels[1].insert(terminal.node, { terminal.time, InvalidId, terminalIndex });
+        queues[1].push(QueueEntry(terminal.time, terminal.node));
+    }
+
+    auto bestTime = std::numeric_limits<float>::infinity();
+    uint32_t meetingNode = InvalidId;
+    auto iterationsCount = 0;
+    for (;;)
+    {
+        const auto forwardTop = queues[0].empty() ? std::numeric_limits<float>::infinity() : queues[0].top().first;
+        const auto backwardTop = queues[1].empty() ? std::numeric_limits<float>::infinity() : queues[1].top().first;
+
+        // Upward searches can't improve the best path once both frontiers are beyond it
+        if (qMin(forwardTop, backwardTop) >= bestTime)
+            break;
+
+        if (++iterationsCount % AbortCheckInterval == 0 && controller && controller->isAborted())
+            return false;
+
+        const auto direction = forwardTop <= backwardTop ? 0 : 1;
+        const auto entry = queues[direction].top();
+        queues[direction].pop();
+
+        const auto node = entry.second;
+        const auto label = labels[direction].value(node);
+        if (entry.first > label.time)
+            continue;
+
+        const auto itOppositeLabel = labels[1 - direction].constFind(node);
+        if (itOppositeLabel != labels[1 - direction].cend() && label.time + itOppositeLabel->time < bestTime)
+        {
+            bestTime = label.time + itOppositeLabel->time;
+            meetingNode = node;
+        }
+
+        const auto& offsets = direction == 0 ? _upwardOutgoingOffsets : _upwardIncomingOffsets;
+        const auto& upwardEdges = direction == 0 ? _upwardOutgoingEdges : _upwardIncomingEdges;
+        for (auto idx = offsets[node]; idx < offsets[node + 1]; idx++)
+        {
+            const auto edgeId = upwardEdges[idx];
+            const auto& edge = _edges[edgeId];
+            const auto otherNode = direction == 0 ? edge.to : edge.from;
+            const auto time = label.time + edge.time;
+
+            const auto itOtherLabel = labels[direction].constFind(otherNode);
+            if (itOtherLabel != labels[direction].cend() && itOtherLabel->time <= time)
+                continue;
+
+            labels[direction].insert(otherNode, { time, edgeId, label.terminalIndex });
+            queues[direction].push(QueueEntry(time, otherNode));
+        }
+    }
+
+    if (meetingNode == InvalidId)
+        return false;
+
+    QVector<uint32_t> forwardPath;
+    auto node = meetingNode;
+    auto label = labels[0].value(node);
+    const auto sourceIndex = label.terminalIndex;
+    while (label.parentEdge != InvalidId)
+    {
+        forwardPath.push_back(label.parentEdge);
+        node = _edges[label.parentEdge].from;
+        label = labels[0].value(node);
+    }
+    std::reverse(forwardPath.begin(), forwardPath.end());
+
+    QVector<uint32_t> backwardPath;
+    node = meetingNode;
+    label = labels[1].value(node);
+    const auto targetIndex = label.terminalIndex;
+    while (label.parentEdge != InvalidId)
+    {
+        backwardPath.push_back(label.parentEdge);
+        node = _edges[label.parentEdge].to;
+        label = labels[1].value(node);
+    }
+
+    outEdges.clear();
+    for (const auto edgeId : constOf(forwardPath))
+        unpackEdge(edgeId, outEdges);
+    for (const auto edgeId : constOf(backwardPath))
+        unpackEdge(edgeId, outEdges);
+
+    if (outSourceIndex)
+        *outSourceIndex = sourceIndex;
+    if (outTargetIndex)
+        *outTargetIndex = targetIndex;
+    if (outTime)
+        *outTime = bestTime;
+    return true;
+}
+
+bool OsmAnd::RoutingHierarchy::settleUpward(
+    const QVector<Terminal>& terminals,
+    const bool backward,
+    QHash<uint32_t, float>& outTimes,
+    const IQueryController* const controller) const
+{
+    MinQueue queue;
+    outTimes.clear();
+    for (const auto& terminal : constOf(terminals))
+    {
+        const auto itTime = outTimes.constFind(terminal.node);
+        if (itTime != outTimes.cend() && *itTime <= terminal.time)
+            continue;
+
+        outTimes.insert(terminal.node, terminal.time);
+        queue.push(QueueEntry(terminal.time, terminal.node));
+    }
+
+    const auto& offsets = backward ? _upwardIncomingOffsets : _upwardOutgoingOffsets;
+    const auto& upwardEdges = backward ? _upwardIncomingEdges : _upwardOutgoingEdges;
+    auto iterationsCount = 0;
+    while (!queue.empty())
+    {
+        if (++iterationsCount % AbortCheckInterval == 0 && controller && controller->isAborted())
+            return false;
+
+        const auto entry = queue.top();
+        queue.pop();
+        if (entry.first > outTimes.value(entry.second))
+            continue;
+
+        for (auto idx = offsets[entry.second]; idx < offsets[entry.second + 1]; idx++)
+        {
+            const auto& edge = _edges[upwardEdges[idx]];
+            const auto otherNode = backward ? edge.from : edge.to;
+            const auto time = entry.first + edge.time;
+
+            const auto itOtherTime = outTimes.constFind(otherNode);
+            if (itOtherTime != outTimes.cend() && *itOtherTime <= time)
+                continue;
+
+            outTimes.insert(otherNode, time);
+            queue.push(QueueEntry(time, otherNode));
+        }
+    }
+
+    return true;
+}
+
+bool OsmAnd::RoutingHierarchy::calculateTimesMatrix(
+    const QVector< QVector<Terminal> >& sources,
+    const QVector< QVector<Terminal> >& targets,
+    QVector<float>& outTimes,
+    Concurrent::WorkerPool* const workerPool /*= nullptr*/,
+    const IQueryController* const controller /*= nullptr*/) const
+{
+    const auto sourcesCount = sources.size();
+    const auto targetsCount = targets.size();
+    outTimes.fill(std::numeric_limits<float>::infinity(), sourcesCount * targetsCount);
+
+    const auto execute =
+        [workerPool]
+        (const QVector<Concurrent::WorkerPool::Job>& jobs)
+        {
+            if (workerPool)
+            {
+                workerPool->executeAndWait(jobs);
+                return;
+            }
+
+            for (const auto& job : constOf(jobs))
+                job();
+        };
+    std::atomic<bool> aborted(false);
+    QVector<Concurrent::WorkerPool::Job> jobs;
+
+    // Each job writes only own item, so storage is obtained before any of them runs
+    QVector< QHash<uint32_t, float> > backwardSpaces(targetsCount);
+    const auto pBackwardSpaces = backwardSpaces.data();
+    for (auto targetIdx = 0; targetIdx < targetsCount; targetIdx++)
+    {
+        jobs.push_back(
+            [this, &targets, &aborted, pBackwardSpaces, targetIdx, controller]
+            ()
+            {
+                if (aborted.load())
+                    return;
+                if (!settleUpward(targets[targetIdx], true, pBackwardSpaces[targetIdx], controller))
+                    aborted.store(true);
+            });
+    }
+    execute(jobs);
+    if (aborted.load())
+        return false;
+
+    struct BucketEntry
+    {
+        int targetIndex;
+        float time;
+    };
+    QHash< uint32_t, QVector<BucketEntry> > buckets;
+    for (auto targetIdx = 0; targetIdx < targetsCount; targetIdx++)
+    {
+        for (const auto& entry : rangeOf(constOf(backwardSpaces[targetIdx])))
+            buckets[entry.key()].push_back({ targetIdx, entry.value() });
+    }
+    backwardSpaces.clear();
+
+    const auto pTimes = outTimes.data();
+    jobs.clear();
+    for (auto sourceIdx = 0; sourceIdx < sourcesCount; sourceIdx++)
+    {
+        jobs.push_back(
+            [this, &sources, &buckets, &aborted, pTimes, sourceIdx, targetsCount, controller]
+            ()
+            {
+                if (aborted.load())
+                    return;
+
+                QHash<uint32_t, float> forwardSpace;
+                if (!settleUpward(sources[sourceIdx], false, forwardSpace, controller))
+                {
+                    aborted.store(true);
+                    return;
+                }
+
+                const auto row = pTimes + sourceIdx * targetsCount;
+                for (const auto& entry : rangeOf(constOf(forwardSpace)))
+                {
+                    const auto itBucket = buckets.constFind(entry.key());
+                    if (itBucket == buckets.cend())
+                        continue;
+
+                    for (const auto& bucketEntry : constOf(*itBucket))
+                    {
+                        const auto time = entry.value() + bucketEntry.time;
+                        if (time < row[bucketEntry.targetIndex])
+                            row[bucketEntry.targetIndex] = time;
+                    }
+                }
+            });
+    }
+    execute(jobs);
+
+    return !aborted.load();
+}
+
+bool OsmAnd::RoutingHierarchy::saveTo(const QString& filePath) const
+{
+    QFile file(filePath);
+    if (!file.open(QIODevice::WriteOnly | QIODevice::Truncate))
+    {
+        LogPrintf(LogSeverityLevel::Error, "Failed to open '%s' to write routing hierarchy", qPrintable(filePath));
+        return false;
+    }
+
+    QDataStream stream(&file);
+    stream.setVersion(QDataStream::Qt_5_0);
+    stream.setFloatingPointPrecision(QDataStream::SinglePrecision);
+
+    stream << static_cast<quint32>(FileSignature) << static_cast<quint32>(FileVersion);
+    stream << profileName << static_cast<quint64>(obfFileSize);
+
+    stream << static_cast<quint32>(_nodes.size());
+    for (const auto& node : constOf(_nodes))
+        stream << static_cast<qint32>(node.location31.x) << static_cast<qint32>(node.location31.y) << node.rank;
+
+    stream << static_cast<quint32>(_edges.size());
+    for (const auto& edge : constOf(_edges))
+    {
+        stream << edge.from << edge.to << edge.time;
+        stream << static_cast<quint64>(edge.roadId) << edge.startPointIndex << edge.endPointIndex;
+        stream << edge.firstChild << edge.secondChild;
+    }
+
+    file.close();
+    return stream.status() == QDataStream::Ok;
+}
+
+std::shared_ptr<OsmAnd::RoutingHierarchy> OsmAnd::RoutingHierarchy::loadFrom(const QString& filePath)
+{
+    QFile file(filePath);
+    if (!file.open(QIODevice::ReadOnly))
+        return nullptr;
+
+    QDataStream stream(&file);
+    stream.setVersion(QDataStream::Qt_5_0);
+    stream.setFloatingPointPrecision(QDataStream::SinglePrecision);
+
+    quint32 signature = 0;
+    quint32 version = 0;
+    stream >> signature >> version;
+    if (signature != FileSignature || version != FileVersion)
+    {
+        LogPrintf(LogSeverityLevel::Warning, "Routing hierarchy '%s' has unsupported format", qPrintable(filePath));
+        return nullptr;
+    }
+
+    QString profileName;
+    quint64 obfFileSize = 0;
+    stream >> profileName >> obfFileSize;
+    std::shared_ptr<RoutingHierarchy> hierarchy(new RoutingHierarchy(profileName, obfFileSize));
+
+    quint32 nodesCount = 0;
+    stream >> nodesCount;
+    hierarchy->_nodes.resize(nodesCount);
+    for (auto& node : hierarchy->_nodes)
+    {
+        qint32 x31 = 0;
+        qint32 y31 = 0;
+        stream >> x31 >> y31 >> node.rank;
+        node.location31 = PointI(x31, y31);
+    }
+
+    quint32 edgesCount = 0;
+    stream >> edgesCount;
+    hierarchy->_edges.resize(edgesCount);
+    for (auto& edge : hierarchy->_edges)
+    {
+        quint64 roadId = 0;
+        stream >> edge.from >> edge.to >> edge.time;
+        stream >> roadId >> edge.startPointIndex >> edge.endPointIndex;
+        stream >> edge.firstChild >> edge.secondChild;
+        edge.roadId = roadId;
+
+        if (edge.from >= nodesCount || edge.to >= nodesCount)
+        {
+            LogPrintf(LogSeverityLevel::Warning, "Routing hierarchy '%s' is corrupted", qPrintable(filePath));
+            return nullptr;
+        }
+    }
+
+    if (stream.status() != QDataStream::Ok)
+    {
+        LogPrintf(LogSeverityLevel::Warning, "Routing hierarchy '%s' is corrupted", qPrintable(filePath));
+        return nullptr;
+    }
+
+    hierarchy->buildSearchGraph();
+    return hierarchy;
+}
+
+QString OsmAnd::RoutingHierarchy::getSidecarFilePath(const QString& obfFilePath, const QString& profileName)
+{
+    return obfFilePath + QLatin1Char('.') + profileName + QLatin1String(".rch");
+}
+
+std::shared_ptr<OsmAnd::RoutingHierarchy> OsmAnd::RoutingHierarchy::build(
+    const std::shared_ptr<ObfReader>& source,
+    const std::shared_ptr<RoutingProfileContext>& profileContext,
+    const IQueryController* const controller /*= nullptr*/)
+{
+    // Collect all roads of the profile
+    QHash< uint64_t, std::shared_ptr<const Road> > roads;
+    const auto& obfInfo = source->obtainInfo();
+    for (const auto& routingSection : constOf(obfInfo->routingSections))
+    {
+        ObfRoutingSectionReader::loadRoads(
+            source,
+            routingSection,
+            RoutingDataLevel::Detailed,
+            nullptr,
+            nullptr,
+            nullptr,
+            [&roads, profileContext]
+            (const std::shared_ptr<const OsmAnd::Road>& road)
+            {
+                if (road->points31.size() < 2 || !profileContext->acceptsRoad(road))
+                    return false;
+
+                roads.insert(road->id, road);
+                return false;
+            });
+
+        if (controller && controller->isAborted())
+            return nullptr;
+    }
+
+    // Points shared by several roads are junctions. Road ends are always nodes
+    QHash<uint64_t, int> pointsUsage;
+    for (const auto& road : constOf(roads))
+    {
+        const auto& points = road->points31;
+        for (auto pointIdx = 0; pointIdx < points.size(); pointIdx++)
+        {
+            const auto isEnd = (pointIdx == 0 || pointIdx == points.size() - 1);
+            pointsUsage[encodePointId(points[pointIdx])] += isEnd ? 2 : 1;
+        }
+    }
+
+    std::shared_ptr<RoutingHierarchy> hierarchy(new RoutingHierarchy(profileContext->profile->name, source->obfFile->fileSize));
+    QHash<uint64_t, uint32_t> nodesIds;
+    const auto obtainNode =
+        [&nodesIds, &hierarchy]
+        (const PointI& point31) -> uint32_t
+        {
+            const auto pointId = encodePointId(point31);
+            auto itNodeId = nodesIds.constFind(pointId);
+            if (itNodeId == nodesIds.cend())
+            {
+                Node node;
+                node.location31 = point31;
+                node.rank = 0;
+                itNodeId = nodesIds.insert(pointId, hierarchy->_nodes.size());
+                hierarchy->_nodes.push_back(node);
+            }
+            return *itNodeId;
+        };
+
+    for (const auto& road : constOf(roads))
+    {
+        const auto& points = road->points31;
+        const auto direction = profileContext->getDirection(road);
+        const auto increasingAllowed = (direction == RoadDirection::TwoWay || direction == RoadDirection::OneWayReverse);
+        const auto decreasingAllowed = (direction == RoadDirection::TwoWay || direction == RoadDirection::OneWayForward);
+
+        uint32_t startPointIdx = 0;
+        auto distance = 0.0f;
+        auto obstaclesTime = 0.0f;
+        auto blocked = false;
+        for (auto pointIdx = 1u; pointIdx < points.size(); pointIdx++)
+        {
+            distance += Utilities::distance31(points[pointIdx - 1], points[pointIdx]);
+            const auto obstacleTime = profileContext->getRoutingObstaclesExtraTime(road, pointIdx);
+            if (obstacleTime < 0)
+                blocked = true;
+            else
+                obstaclesTime += obstacleTime;
+
+            if (pointsUsage[encodePointId(points[pointIdx])] < 2)
+                continue;
+
+            const auto fromNode = obtainNode(points[startPointIdx]);
+            const auto toNode = obtainNode(points[pointIdx]);
+            if (!blocked && fromNode != toNode)
+            {
+                Edge edge;
+                edge.time = calculateTime(profileContext.get(), road, distance, obstaclesTime);
+                edge.roadId = road->id;
+                edge.firstChild = InvalidId;
+                edge.secondChild = InvalidId;
+
+                if (increasingAllowed)
+                {
+                    edge.from = fromNode;
+                    edge.to = toNode;
+                    edge.startPointIndex = startPointIdx;
+                    edge.endPointIndex = pointIdx;
+                    hierarchy->_edges.push_back(edge);
+                }
+                if (decreasingAllowed)
+                {
+                    edge.from = toNode;
+                    edge.to = fromNode;
+                    edge.startPointIndex = pointIdx;
+                    edge.endPointIndex = startPointIdx;
+                    hierarchy->_edges.push_back(edge);
+                }
+            }
+
+            startPointIdx = pointIdx;
+            distance = 0.0f;
+            obstaclesTime = 0.0f;
+            blocked = false;
+        }
+    }
+    const auto originalEdgesCount = hierarchy->_edges.size();
+
+    if (!hierarchy->contract(controller))
+        return nullptr;
+
+    LogPrintf(LogSeverityLevel::Info, "Routing hierarchy of '%s' for '%s': %d roads, %d nodes, %d edges, %d shortcuts",
+        qPrintable(source->obfFile->filePath),
+        qPrintable(profileContext->profile->name),
+        roads.size(),
+        hierarchy->_nodes.size(),
+        originalEdgesCount,
+        hierarchy->_edges.size() - originalEdgesCount);
+
+    return hierarchy;
+}
+
+std::shared_ptr<OsmAnd::RoutingHierarchy> OsmAnd::RoutingHierarchy::build(
+    const QString& profileName,
+    const uint64_t obfFileSize,
+    const QVector<Node>& nodes,
+    const QVector<Edge>& edges,
+    const IQueryController* const controller /*= nullptr*/)
+{
+    std::shared_ptr<RoutingHierarchy> hierarchy(new RoutingHierarchy(profileName, obfFileSize));
+    hierarchy->_nodes = nodes;
+    hierarchy->_edges = edges;
+    if (!hierarchy->contract(controller))
+        return nullptr;
+
+    return hierarchy;
+}
+
+bool OsmAnd::RoutingHierarchy::contract(const IQueryController* const controller)
+{
+    // Contract nodes in order of edge difference, updating priorities lazily
+    const auto nodesCount = _nodes.size();
+    Contractor contractor(_edges, nodesCount);
+    std::priority_queue< std::pair<int, uint32_t>, std::vector< std::pair<int, uint32_t> >, std::greater< std::pair<int, uint32_t> > > contractionQueue;
+    for (auto nodeId = 0; nodeId < nodesCount; nodeId++)
+        contractionQueue.push(std::make_pair(contractor.priorityOf(nodeId, WitnessSearchSettledNodesLimit), nodeId));
+
+    uint32_t rank = 0;
+    while (!contractionQueue.empty())
+    {
+        const auto nodeId = contractionQueue.top().second;
+        contractionQueue.pop();
+        if (contractor.contracted[nodeId])
+            continue;
+
+        const auto priority = contractor.priorityOf(nodeId, WitnessSearchSettledNodesLimit);
+        if (!contractionQueue.empty() && priority > contractionQueue.top().first)
+        {
+            contractionQueue.push(std::make_pair(priority, nodeId));
+            continue;
+        }
+
+        contractor.contract(nodeId, true, WitnessSearchSettledNodesLimit);
+        contractor.contracted[nodeId] = true;
+        _nodes[nodeId].rank = rank++;
+        for (const auto edgeId : contractor.incoming[nodeId])
+            contractor.contractedNeighbours[contractor.edges[edgeId].from]++;
+        for (const auto edgeId : contractor.outgoing[nodeId])
+            contractor.contractedNeighbours[contractor.edges[edgeId].to]++;
+
+        if (rank % AbortCheckInterval == 0 && controller && controller->isAborted())
+            return false;
+    }
+
+    buildSearchGraph();
+    return true;
+}
+
+OsmAnd::RoutingHierarchiesCache::RoutingHierarchiesCache()
+{
+}
+
+OsmAnd::RoutingHierarchiesCache::~RoutingHierarchiesCache()
+{
+}
+
+std::shared_ptr<const OsmAnd::RoutingHierarchy> OsmAnd::RoutingHierarchiesCache::obtainHierarchy(
+    const QString& obfFilePath,
+    const uint64_t obfFileSize,
+    const QString& profileName)
+{
+    const auto sidecarFilePath = RoutingHierarchy::getSidecarFilePath(obfFilePath, profileName);
+    const QFileInfo sidecarFileInfo(sidecarFilePath);
+    const auto sidecarLastModifiedTime = sidecarFileInfo.exists()
+        ? sidecarFileInfo.lastModified().toMSecsSinceEpoch()
+        : -1;
+
+    QMutexLocker scopedLocker(&_mutex);
+
+    const auto citEntry = _entries.constFind(sidecarFilePath);
+    if (citEntry != _entries.cend() &&
+        citEntry->obfFileSize == obfFileSize &&
+        citEntry->sidecarLastModifiedTime == sidecarLastModifiedTime)
+    {
+        return citEntry->hierarchy;
+    }
+
+    // Sidecar is loaded under lock, so that contexts created at once don't load it several times
+    Entry entry;
+    entry.obfFileSize = obfFileSize;
+    entry.sidecarLastModifiedTime = sidecarLastModifiedTime;
+    if (sidecarLastModifiedTime >= 0)
+    {
+        const auto hierarchy = RoutingHierarchy::loadFrom(sidecarFilePath);
+        if (hierarchy && hierarchy->profileName == profileName && hierarchy->obfFileSize == obfFileSize)
+            entry.hierarchy = hierarchy;
+        else
+            LogPrintf(LogSeverityLevel::Warning, "Routing hierarchy '%s' is outdated and won't be used", qPrintable(sidecarFilePath));
+    }
+    _entries.insert(sidecarFilePath, entry);
+
+    return entry.hierarchy;
+}
+
+void OsmAnd::RoutingHierarchiesCache::clear()
+{
+    QMutexLocker scopedLocker(&_mutex);
+
+    _entries.clear();
+}
+
+std::shared_ptr<OsmAnd::RoutingHierarchiesCache> OsmAnd::RoutingHierarchiesCache::globalInstance()
+{
+    static const std::shared_ptr<RoutingHierarchiesCache> s_globalRoutingHierarchiesCache(new RoutingHierarchiesCache());
+    return s_globalRoutingHierarchiesCache;
+}
@@ -24,52 +24,107 @@ std::shared_ptr<OsmAnd::RoutingRulesetContext> OsmAnd::RoutingProfileContext::ge
     return _rulesetContexts[static_cast<int>(type)];
 }
 
-OsmAnd::Model::RoadDirection OsmAnd::RoutingProfileContext::getDirection( const std::shared_ptr<const OsmAnd::Model::Road>& road )
+uint64_t OsmAnd::RoutingProfileContext::getTypesSetKey( const ObfRoutingSectionInfo* const section, const uint32_t typesSetId )
 {
-    auto value = getRulesetContext(RoutingRuleset::OneWay)->evaluateAsInteger(road, 0);
-    return static_cast<Model::RoadDirection>(value);
+    return (static_cast<uint64_t>(static_cast<uint32_t>(section->runtimeGeneratedId)) << 32) | typesSetId;
 }
 
-bool OsmAnd::RoutingProfileContext::acceptsRoad( const std::shared_ptr<const OsmAnd::Model::Road>& road )
+OsmAnd::RoutingProfileContext::RoadAttributes OsmAnd::RoutingProfileContext::getRoadAttributes( const std::shared_ptr<const OsmAnd::Road>& road )
 {
-    auto value = getRulesetContext(RoutingRuleset::Access)->evaluateAsInteger(road, 0);
-    return value >= 0;
+    const auto typesSetKey = getTypesSetKey(road->section.get(), road->getTypesSetId());
+    {
+        QReadLocker scopedLocker(&_attributesCacheLock);
+
+        const auto itAttributes = _roadAttributesCache.constFind(typesSetKey);
+        if (itAttributes != _roadAttributesCache.cend())
+            return *itAttributes;
+    }
+
+    QWriteLocker scopedLocker(&_attributesCacheLock);
+
+    const auto itAttributes = _roadAttributesCache.constFind(typesSetKey);
+    if (itAttributes != _roadAttributesCache.cend())
+        return *itAttributes;
+
+    RoadAttributes attributes;
+    attributes.direction = static_cast<RoadDirection>(
+        getRulesetContext(RoutingRuleset::OneWay)->evaluateAsInteger(road, 0));
+    attributes.accepted = getRulesetContext(RoutingRuleset::Access)->evaluateAsInteger(road, 0) >= 0;
+    attributes.speedPriority = getRulesetContext(RoutingRuleset::RoadPriorities)->evaluateAsFloat(road, 1.0f);
+    attributes.speed = getRulesetContext(RoutingRuleset::RoadSpeed)->evaluateAsFloat(road, profile->defaultSpeed);
+    _roadAttributesCache.insert(typesSetKey, attributes);
+    return attributes;
+}
+
+OsmAnd::RoutingProfileContext::PointAttributes OsmAnd::RoutingProfileContext::getPointAttributes(
+    const std::shared_ptr<const ObfRoutingSectionInfo>& section,
+    const uint32_t* const pPointTypes,
+    const int pointTypesCount,
+    const uint32_t typesSetId )
+{
+    const auto typesSetKey = getTypesSetKey(section.get(), typesSetId);
+    {
+        QReadLocker scopedLocker(&_attributesCacheLock);
+
+        const auto itAttributes = _pointAttributesCache.constFind(typesSetKey);
+        if (itAttributes != _pointAttributesCache.cend())
+            return *itAttributes;
+    }
+
+    QWriteLocker scopedLocker(&_attributesCacheLock);
+
+    const auto itAttributes = _pointAttributesCache.constFind(typesSetKey);
+    if (itAttributes != _pointAttributesCache.cend())
+        return *itAttributes;
+
+    QVector<uint32_t> pointTypes(pointTypesCount);
+    std::copy(pPointTypes, pPointTypes + pointTypesCount, pointTypes.begin());
+
+    PointAttributes attributes;
+    attributes.obstaclesExtraTime = getRulesetContext(RoutingRuleset::Obstacles)->evaluateAsFloat(section, pointTypes, 0.0f);
+    attributes.routingObstaclesExtraTime = getRulesetContext(RoutingRuleset::RoutingObstacles)->evaluateAsFloat(section, pointTypes, 0.0f);
+    _pointAttributesCache.insert(typesSetKey, attributes);
+    return attributes;
+}
+
+OsmAnd::RoadDirection OsmAnd::RoutingProfileContext::getDirection( const std::shared_ptr<const OsmAnd::Road>& road )
+{
+    return getRoadAttributes(road).direction;
 }
 
-bool OsmAnd::RoutingProfileContext::acceptsBorderLinePoint( const std::shared_ptr<const ObfRoutingSectionInfo>& section, const std::shared_ptr<const ObfRoutingBorderLinePoint>& point )
+bool OsmAnd::RoutingProfileContext::acceptsRoad( const std::shared_ptr<const OsmAnd::Road>& road )
 {
-    auto value = getRulesetContext(RoutingRuleset::Access)->evaluateAsInteger(section, point->types, 0);
-    return value >= 0;
+    return getRoadAttributes(road).accepted;
 }
 
-float OsmAnd::RoutingProfileContext::getSpeedPriority( const std::shared_ptr<const OsmAnd::Model::Road>& road )
+float OsmAnd::RoutingProfileContext::getSpeedPriority( const std::shared_ptr<const OsmAnd::Road>& road )
 {
-    auto value = getRulesetContext(RoutingRuleset::RoadPriorities)->evaluateAsFloat(road, 1.0f);
-    return value;
+    return getRoadAttributes(road).speedPriority;
 }
 
-float OsmAnd::RoutingProfileContext::getSpeed( const std::shared_ptr<const OsmAnd::Model::Road>& road )
+float OsmAnd::RoutingProfileContext::getSpeed( const std::shared_ptr<const OsmAnd::Road>& road )
 {
-    auto value = getRulesetContext(RoutingRuleset::RoadSpeed)->evaluateAsFloat(road, profile->defaultSpeed);
-    return value;
+    return getRoadAttributes(road).speed;
 }
 
-float OsmAnd::RoutingProfileContext::getObstaclesExtraTime( const std::shared_ptr<const OsmAnd::Model::Road>& road, uint32_t pointIndex )
+float OsmAnd::RoutingProfileContext::getObstaclesExtraTime( const std::shared_ptr<const OsmAnd::Road>& road, uint32_t pointIndex )
 {
-    auto itPointTypes = road->pointsTypes.constFind(pointIndex);
-    if (itPointTypes == road->pointsTypes.cend())
+    int pointTypesCount = 0;
+    uint32_t typesSetId = 0;
+    const auto pPointTypes = road->getPointTypes(pointIndex, &pointTypesCount, &typesSetId);
+    if (!pPointTypes)
         return 0.0f;
 
-    auto value = getRulesetContext(RoutingRuleset::Obstacles)->evaluateAsFloat(road->subsection->section, *itPointTypes, 0.0f);
-    return value;
+    return getPointAttributes(road->section, pPointTypes, pointTypesCount, typesSetId).obstaclesExtraTime;
 }
 
-float OsmAnd::RoutingProfileContext::getRoutingObstaclesExtraTime( const std::shared_ptr<const OsmAnd::Model::Road>& road, uint32_t pointIndex )
+float OsmAnd::RoutingProfileContext::getRoutingObstaclesExtraTime( const std::shared_ptr<const OsmAnd::Road>& road, uint32_t pointIndex )
 {
-    auto itPointTypes = road->pointsTypes.constFind(pointIndex);
-    if (itPointTypes == road->pointsTypes.cend())
+    int pointTypesCount = 0;
+    uint32_t typesSetId = 0;
+    const auto pPointTypes = road->getPointTypes(pointIndex, &pointTypesCount, &typesSetId);
+    if (!pPointTypes)
         return 0.0f;
 
-    auto value = getRulesetContext(RoutingRuleset::RoutingObstacles)->evaluateAsFloat(road->subsection->section, *itPointTypes, 0.0f);
-    return value;
+    return getPointAttributes(road->section, pPointTypes, pointTypesCount, typesSetId).routingObstaclesExtraTime;
 }
@@ -4,7 +4,6 @@
 
 #include "Road.h"
 #include "ObfRoutingSectionInfo.h"
-#include "ObfRoutingSectionInfo_P.h"
 #include "RoutingProfile.h"
 #include "RoutingProfileContext.h"
 
@@ -48,7 +47,7 @@ OsmAnd::RoutingRulesetContext::~RoutingRulesetContext()
 {
 }
 
-int OsmAnd::RoutingRulesetContext::evaluateAsInteger( const std::shared_ptr<const Model::Road>& road, int defaultValue )
+int OsmAnd::RoutingRulesetContext::evaluateAsInteger( const std::shared_ptr<const Road>& road, int defaultValue )
 {
     int result;
     if (!evaluate(road, RoutingRuleExpression::ResultType::Integer, &result))
@@ -56,7 +55,7 @@ int OsmAnd::RoutingRulesetContext::evaluateAsInteger( const std::shared_ptr<cons
     return result;
 }
 
-float OsmAnd::RoutingRulesetContext::evaluateAsFloat( const std::shared_ptr<const Model::Road>& road, float defaultValue )
+float OsmAnd::RoutingRulesetContext::evaluateAsFloat( const std::shared_ptr<const Road>& road, float defaultValue )
 {
     float result;
     if (!evaluate(road, RoutingRuleExpression::ResultType::Float, &result))
@@ -80,9 +79,9 @@ float OsmAnd::RoutingRulesetContext::evaluateAsFloat( const std::shared_ptr<cons
     return result;
 }
 
-bool OsmAnd::RoutingRulesetContext::evaluate( const std::shared_ptr<const Model::Road>& road, RoutingRuleExpression::ResultType type, void* result )
+bool OsmAnd::RoutingRulesetContext::evaluate( const std::shared_ptr<const Road>& road, RoutingRuleExpression::ResultType type, void* result )
 {
-    return evaluate(encode(road->subsection->section, road->types), type, result);
+    return evaluate(encode(road->section, road->attributeIds), type, result);
 }
 
 bool OsmAnd::RoutingRulesetContext::evaluate( const QBitArray& types, RoutingRuleExpression::ResultType type, void* result )
@@ -108,10 +107,10 @@ QBitArray OsmAnd::RoutingRulesetContext::encode( const std::shared_ptr<const Obf
         auto itId = itTagValueAttribIdCache->find(type);
         if (itId == itTagValueAttribIdCache->end())
         {
-            const auto& encodingRule = section->_p->_encodingRules[type];
-            assert(encodingRule);
+            const auto rule = section->getAttributeMapping()->routingDecodeMap.getRef(type);
+            assert(rule);
 
-            auto id = ruleset->owner->registerTagValueAttribute(encodingRule->_tag, encodingRule->_value);
+            auto id = ruleset->owner->registerTagValueAttribute(rule->getTag(), rule->getValue());
             itId = itTagValueAttribIdCache->insert(type, id);
         }
         auto id = *itId;
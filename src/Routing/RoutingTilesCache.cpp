@@ -0,0 +1,188 @@
+#include "RoutingTilesCache.h"
+
+#include <algorithm>
+#include <vector>
+
+#include "ObfReader.h"
+#include "ObfRoutingSectionReader.h"
+#include "ObfRoutingSectionInfo.h"
+#include "QKeyValueIterator.h"
+#include "Utilities.h"
+
+OsmAnd::RoutingTilesCache::RoutingTilesCache(const size_t sizeLimit_ /*= DefaultSizeLimit*/)
+    : _accessCounter(0)
+    , _estimatedSize(0)
+    , _sizeLimit(sizeLimit_)
+{
+}
+
+OsmAnd::RoutingTilesCache::~RoutingTilesCache()
+{
+    for (const auto& entry : constOf(_entries))
+    {
+        if (entry.tile)
+            releaseTile(entry.tile);
+    }
+}
+
+std::shared_ptr<const OsmAnd::RoutingTilesCache::Tile> OsmAnd::RoutingTilesCache::obtainTile(
+    const std::shared_ptr<ObfReader>& reader,
+    const std::shared_ptr<const ObfRoutingSectionInfo>& section,
+    const RoutingDataLevel dataLevel,
+    const TileId tileId,
+    const ZoomLevel zoom,
+    bool* const outWasCached /*= nullptr*/)
+{
+    TileKey key;
+    key.section = section.get();
+    key.dataLevel = dataLevel;
+    key.zoom = zoom;
+    key.tileId = tileId;
+
+    {
+        QMutexLocker scopedLocker(&_mutex);
+
+        for (;;)
+        {
+            const auto itEntry = _entries.find(key);
+            if (itEntry == _entries.end())
+            {
+                Entry entry;
+                entry.section = section;
+                entry.isLoading = true;
+                entry.lastAccess = ++_accessCounter;
+                _entries.insert(key, entry);
+                break;
+            }
+
+            if (!itEntry->isLoading)
+            {
+                itEntry->lastAccess = ++_accessCounter;
+                if (outWasCached)
+                    *outWasCached = true;
+                return itEntry->tile;
+            }
+
+            // Other thread decodes same tile, so wait for it instead of decoding tile twice
+            _tileLoadedCondition.wait(&_mutex);
+        }
+    }
+
+    const std::shared_ptr<Tile> tile(new Tile());
+    tile->estimatedSize = 0;
+    const auto bbox31 = Utilities::tileBoundingBox31(tileId, zoom);
+    ObfRoutingSectionReader::loadRoads(
+        reader,
+        section,
+        dataLevel,
+        &bbox31,
+        &tile->roads,
+        nullptr,
+        nullptr,
+        &_dataBlocksCache,
+        &tile->dataBlocks);
+    for (const auto& road : constOf(tile->roads))
+    {
+        tile->estimatedSize += sizeof(Road) +
+            road->points31.size() * sizeof(PointI) +
+            road->attributeIds.size() * sizeof(uint32_t);
+    }
+
+    {
+        QMutexLocker scopedLocker(&_mutex);
+
+        auto& entry = _entries[key];
+        entry.tile = tile;
+        entry.isLoading = false;
+        _estimatedSize += tile->estimatedSize;
+
+        if (_estimatedSize > _sizeLimit)
+            evictUnusedTiles();
+    }
+    _tileLoadedCondition.wakeAll();
+
+    if (outWasCached)
+        *outWasCached = false;
+    return tile;
+}
+
+void OsmAnd::RoutingTilesCache::releaseTile(const std::shared_ptr<const Tile>& tile)
+{
+    for (const auto& dataBlock : constOf(tile->dataBlocks))
+    {
+        auto dataBlockReference = dataBlock;
+        _dataBlocksCache.releaseReference(dataBlock->id, dataBlockReference);
+    }
+}
+
+void OsmAnd::RoutingTilesCache::evictUnusedTiles()
+{
+    // Entry holds the only reference to tile no context borrows, and no other reference can
+    // appear without the lock
+    std::vector< std::pair<uint64_t, TileKey> > candidates;
+    for (const auto& entry : rangeOf(constOf(_entries)))
+    {
+        if (entry.value().isLoading || entry.value().tile.use_count() > 1)
+            continue;
+        candidates.push_back(std::make_pair(entry.value().lastAccess, entry.key()));
+    }
+    std::sort(candidates.begin(), candidates.end(),
+        []
+        (const std::pair<uint64_t, TileKey>& l, const std::pair<uint64_t, TileKey>& r) -> bool
+        {
+            return l.first < r.first;
+        });
+
+    // Evict a quarter below the limit, so that eviction doesn't run on each tile loaded
+    const auto targetSize = _sizeLimit - _sizeLimit / 4;
+    for (const auto& candidate : candidates)
+    {
+        if (_estimatedSize <= targetSize)
+            break;
+
+        const auto itEntry = _entries.find(candidate.second);
+        _estimatedSize -= itEntry->tile->estimatedSize;
+        releaseTile(itEntry->tile);
+        _entries.erase(itEntry);
+    }
+}
+
+size_t OsmAnd::RoutingTilesCache::getEstimatedSize() const
+{
+    QMutexLocker scopedLocker(&_mutex);
+
+    return _estimatedSize;
+}
+
+size_t OsmAnd::RoutingTilesCache::getSizeLimit() const
+{
+    QMutexLocker scopedLocker(&_mutex);
+
+    return _sizeLimit;
+}
+
+void OsmAnd::RoutingTilesCache::setSizeLimit(const size_t sizeLimit)
+{
+    QMutexLocker scopedLocker(&_mutex);
+
+    _sizeLimit = sizeLimit;
+    if (_estimatedSize > _sizeLimit)
+        evictUnusedTiles();
+}
+
+void OsmAnd::RoutingTilesCache::clear()
+{
+    QMutexLocker scopedLocker(&_mutex);
+
+    // Tiles being decoded or borrowed stay, they will be evicted later
+    const auto limit = _sizeLimit;
+    _sizeLimit = 0;
+    evictUnusedTiles();
+    _sizeLimit = limit;
+}
+
+std::shared_ptr<OsmAnd::RoutingTilesCache> OsmAnd::RoutingTilesCache::globalInstance()
+{
+    static const std::shared_ptr<RoutingTilesCache> s_globalRoutingTilesCache(new RoutingTilesCache());
+    return s_globalRoutingTilesCache;
+}
@@ -0,0 +1,182 @@
+#include <OsmAndCore/Routing/RoutePlannerContext.h>
+#include <OsmAndCore/Concurrent/Thread.h>
+
+#include <QtTest/QtTest>
+#include <QCoreApplication>
+#include <QAtomicInt>
+
+#include <memory>
+
+using namespace OsmAnd;
+using RouteCalculationSegment = RoutePlannerContext::RouteCalculationSegment;
+using RouteCalculationSegmentsPool = RoutePlannerContext::RouteCalculationSegmentsPool;
+using MeetingSegments = RoutePlannerContext::MeetingSegments;
+using VisitedSegments = RoutePlannerContext::VisitedSegments;
+
+class TestMeetingSegments : public QObject
+{
+    Q_OBJECT
+
+private:
+    struct Segment : public RouteCalculationSegment
+    {
+        Segment(const uint32_t pointIndex, const float distanceFromStart)
+            : RouteCalculationSegment(nullptr, pointIndex)
+        {
+            _distanceFromStart = distanceFromStart;
+        }
+
+        void setDistanceFromStart(const float distanceFromStart)
+        {
+            _distanceFromStart = distanceFromStart;
+        }
+    };
+
+    static std::shared_ptr<RouteCalculationSegment> createSegment(
+        const std::shared_ptr<RouteCalculationSegmentsPool>& pool,
+        const uint64_t id);
+private slots:
+    void findReturnsLatestEntry();
+    void visitedSegmentsPublishInserts();
+    void concurrentReaderSeesCompleteEntries();
+    void segmentsKeepPoolAlive();
+};
+
+std::shared_ptr<RouteCalculationSegment> TestMeetingSegments::createSegment(
+    const std::shared_ptr<RouteCalculationSegmentsPool>& pool,
+    const uint64_t id)
+{
+    // Same way as RoutePlanner creates segments: both segment and its control block live in pool
+    const auto segment = new(pool->allocate(sizeof(Segment), alignof(Segment))) Segment(
+        static_cast<uint32_t>(id & 0xFFFF), static_cast<float>(id));
+    return std::shared_ptr<RouteCalculationSegment>(
+        segment,
+        RouteCalculationSegmentsPool::Deleter(),
+        RouteCalculationSegmentsPool::Allocator<Segment>(pool));
+}
+
+void TestMeetingSegments::findReturnsLatestEntry()
+{
+    const std::shared_ptr<RouteCalculationSegmentsPool> pool(new RouteCalculationSegmentsPool());
+    MeetingSegments meetingSegments(pool);
+
+    for (uint64_t id = 1; id <= 1000; id++)
+        meetingSegments.insert(id << 16, createSegment(pool, id));
+    QVERIFY(!meetingSegments.find(0));
+    QVERIFY(!meetingSegments.find(1001ull << 16));
+
+    for (uint64_t id = 1; id <= 1000; id++)
+    {
+        const auto entry = meetingSegments.find(id << 16);
+        QVERIFY(entry);
+        QCOMPARE(entry->id, id << 16);
+        QCOMPARE(entry->pointIndex, static_cast<uint32_t>(id));
+        QCOMPARE(entry->distanceFromStart, static_cast<float>(id));
+    }
+
+    // Entry keeps state of segment at the moment it was inserted, later insert shadows it
+    const auto segment = createSegment(pool, 7);
+    meetingSegments.insert(7ull << 16, segment);
+    static_cast<Segment*>(segment.get())->setDistanceFromStart(1.0f);
+    QCOMPARE(meetingSegments.find(7ull << 16)->distanceFromStart, 7.0f);
+    meetingSegments.insert(7ull << 16, segment);
+    QCOMPARE(meetingSegments.find(7ull << 16)->distanceFromStart, 1.0f);
+    QCOMPARE(meetingSegments.find(7ull << 16)->segment, segment);
+}
+
+void TestMeetingSegments::visitedSegmentsPublishInserts()
+{
+    const std::shared_ptr<RouteCalculationSegmentsPool> pool(new RouteCalculationSegmentsPool());
+    MeetingSegments meetingSegments(pool);
+    VisitedSegments visitedSegments;
+
+    visitedSegments.insert(1, createSegment(pool, 1));
+    visitedSegments.publishTo(&meetingSegments);
+    QCOMPARE(visitedSegments.getMeetingSegments(), &meetingSegments);
+
+    // Enough inserts to make table grow several times
+    for (uint64_t id = 2; id <= 5000; id++)
+        visitedSegments.insert(id, createSegment(pool, id));
+    QCOMPARE(visitedSegments.size(), static_cast<size_t>(5000));
+
+    QVERIFY(!meetingSegments.find(1));
+    for (uint64_t id = 2; id <= 5000; id++)
+    {
+        QVERIFY(visitedSegments.contains(id));
+        QCOMPARE(visitedSegments.value(id)->pointIndex, static_cast<uint32_t>(id & 0xFFFF));
+
+        const auto entry = meetingSegments.find(id);
+        QVERIFY(entry);
+        QCOMPARE(entry->segment, visitedSegments.value(id));
+    }
+    QVERIFY(!visitedSegments.contains(5001));
+}
+
+void TestMeetingSegments::concurrentReaderSeesCompleteEntries()
+{
+    const uint64_t entriesCount = 200000;
+    const std::shared_ptr<RouteCalculationSegmentsPool> pool(new RouteCalculationSegmentsPool());
+    MeetingSegments meetingSegments(pool);
+
+    // Writer inserts ids in order while reader repeatedly looks up the last ones it expects. Any
+    // entry reader finds has to be fully initialized
+    QAtomicInt inconsistentEntriesCount(0);
+    QAtomicInt writerFinished(0);
+    Concurrent::Thread writer(
+        [&meetingSegments, &pool, &writerFinished, entriesCount]
+        ()
+        {
+            for (uint64_t id = 1; id <= entriesCount; id++)
+                meetingSegments.insert(id, createSegment(pool, id));
+            writerFinished.storeRelease(1);
+        });
+    writer.start();
+
+    uint64_t foundCount = 0;
+    uint64_t nextId = 1;
+    while (nextId <= entriesCount)
+    {
+        const auto finished = writerFinished.loadAcquire() != 0;
+        const auto entry = meetingSegments.find(nextId);
+        if (!entry)
+        {
+            if (finished)
+                break;
+            continue;
+        }
+
+        if (entry->id != nextId ||
+            entry->pointIndex != static_cast<uint32_t>(nextId & 0xFFFF) ||
+            entry->distanceFromStart != static_cast<float>(nextId) ||
+            !entry->segment ||
+            entry->segment->pointIndex != entry->pointIndex)
+        {
+            inconsistentEntriesCount.fetchAndAddOrdered(1);
+        }
+        foundCount++;
+        nextId++;
+    }
+    QVERIFY(writer.wait(30000));
+
+    QCOMPARE(inconsistentEntriesCount.loadAcquire(), 0);
+    QCOMPARE(foundCount, entriesCount);
+}
+
+void TestMeetingSegments::segmentsKeepPoolAlive()
+{
+    std::shared_ptr<RouteCalculationSegment> segment;
+    {
+        std::shared_ptr<RouteCalculationSegmentsPool> pool(new RouteCalculationSegmentsPool());
+        MeetingSegments meetingSegments(pool);
+        segment = createSegment(pool, 42);
+        meetingSegments.insert(42, segment);
+    }
+
+    // Table and the last owner of the pool are gone, but segment still lives in pool memory
+    QCOMPARE(segment.use_count(), 1L);
+    QCOMPARE(segment->pointIndex, 42u);
+    segment.reset();
+}
+
+QTEST_MAIN(TestMeetingSegments)
+#include "TestMeetingSegments.moc"
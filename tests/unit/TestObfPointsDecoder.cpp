@@ -0,0 +1,141 @@
+#include "ObfPointsDecoder.h"
+
+#include <QtTest/QtTest>
+#include <QCoreApplication>
+
+#include <cstdint>
+#include <vector>
+
+using namespace OsmAnd;
+using Implementation = ObfPointsDecoder::Implementation;
+
+class TestObfPointsDecoder : public QObject
+{
+    Q_OBJECT
+
+private:
+    static void appendVarint(std::vector<uint8_t>& data, uint32_t value);
+    static std::vector<uint8_t> encode(const QVector<PointI>& deltas);
+    static void compareImplementations(const std::vector<uint8_t>& data, const PointI& origin, const int shift);
+private slots:
+    void scalarDecodesDeltas();
+    void implementationsMatch_data();
+    void implementationsMatch();
+    void malformedDataIsReported();
+};
+
+void TestObfPointsDecoder::appendVarint(std::vector<uint8_t>& data, uint32_t value)
+{
+    while (value >= 0x80)
+    {
+        data.push_back(static_cast<uint8_t>(value | 0x80));
+        value >>= 7;
+    }
+    data.push_back(static_cast<uint8_t>(value));
+}
+
+std::vector<uint8_t> TestObfPointsDecoder::encode(const QVector<PointI>& deltas)
+{
+    std::vector<uint8_t> data;
+    for (const auto& delta : deltas)
+    {
+        appendVarint(data, (static_cast<uint32_t>(delta.x) << 1) ^ static_cast<uint32_t>(delta.x >> 31));
+        appendVarint(data, (static_cast<uint32_t>(delta.y) << 1) ^ static_cast<uint32_t>(delta.y >> 31));
+    }
+    return data;
+}
+
+void TestObfPointsDecoder::compareImplementations(const std::vector<uint8_t>& data, const PointI& origin, const int shift)
+{
+    QVector<PointI> scalarPoints;
+    AreaI scalarBBox(PointI(1 << 30, 1 << 30), PointI(0, 0));
+    const auto scalarOk = ObfPointsDecoder::decode(
+        data.data(), data.size(), origin, shift, scalarPoints, &scalarBBox, Implementation::Scalar);
+
+    QVector<PointI> simdPoints;
+    AreaI simdBBox(PointI(1 << 30, 1 << 30), PointI(0, 0));
+    const auto simdOk = ObfPointsDecoder::decode(
+        data.data(), data.size(), origin, shift, simdPoints, &simdBBox, Implementation::SSE41);
+
+    QCOMPARE(simdOk, scalarOk);
+    QCOMPARE(simdPoints, scalarPoints);
+    QCOMPARE(simdBBox, scalarBBox);
+}
+
+void TestObfPointsDecoder::scalarDecodesDeltas()
+{
+    const QVector<PointI> deltas = { PointI(1, -1), PointI(-64, 63), PointI(100000, -100000) };
+    const auto data = encode(deltas);
+
+    QVector<PointI> points;
+    QVERIFY(ObfPointsDecoder::decode(data.data(), data.size(), PointI(1000, 2000), 5, points, nullptr, Implementation::Scalar));
+
+    const QVector<PointI> expected = {
+        PointI(1000 + (1 << 5), 2000 - (1 << 5)),
+        PointI(1000 + (1 << 5) - (64 << 5), 2000 - (1 << 5) + (63 << 5)),
+        PointI(1000 + (1 << 5) - (64 << 5) + (100000 << 5), 2000 - (1 << 5) + (63 << 5) - (100000 << 5)),
+    };
+    QCOMPARE(points, expected);
+}
+
+void TestObfPointsDecoder::implementationsMatch_data()
+{
+    QTest::addColumn<int>("pointsCount");
+    QTest::addColumn<int>("largeDeltaEvery");
+
+    QTest::newRow("empty") << 0 << 0;
+    QTest::newRow("single point") << 1 << 0;
+    QTest::newRow("odd count of small deltas") << 37 << 0;
+    QTest::newRow("small deltas") << 1024 << 0;
+    QTest::newRow("mixed deltas") << 1024 << 3;
+    QTest::newRow("mostly large deltas") << 1024 << 1;
+}
+
+void TestObfPointsDecoder::implementationsMatch()
+{
+    QFETCH(int, pointsCount);
+    QFETCH(int, largeDeltaEvery);
+
+    if (!ObfPointsDecoder::isSupported(Implementation::SSE41))
+        QSKIP("SSE4.1 is not supported on this CPU");
+
+    // Deterministic pseudo-random deltas, so failures are reproducible
+    uint32_t seed = 12345;
+    const auto nextRandom =
+        [&seed]
+        () -> int32_t
+        {
+            seed = seed * 1103515245u + 12345u;
+            return static_cast<int32_t>((seed >> 8) & 0xffff);
+        };
+
+    QVector<PointI> deltas;
+    for (auto pointIdx = 0; pointIdx < pointsCount; pointIdx++)
+    {
+        const auto isLarge = largeDeltaEvery > 0 && (pointIdx % largeDeltaEvery) == 0;
+        const auto range = isLarge ? 20000 : 64;
+        deltas.push_back(PointI(nextRandom() % range - range / 2, nextRandom() % range - range / 2));
+    }
+
+    compareImplementations(encode(deltas), PointI(1 << 20, 1 << 21), 5);
+}
+
+void TestObfPointsDecoder::malformedDataIsReported()
+{
+    // Run of small deltas followed by truncated varint
+    QVector<PointI> deltas;
+    for (auto pointIdx = 0; pointIdx < 20; pointIdx++)
+        deltas.push_back(PointI(pointIdx % 7 - 3, 3 - pointIdx % 5));
+    auto data = encode(deltas);
+    data.push_back(0x80);
+
+    QVector<PointI> points;
+    QVERIFY(!ObfPointsDecoder::decode(data.data(), data.size(), PointI(0, 0), 5, points, nullptr, Implementation::Scalar));
+    QCOMPARE(points.size(), deltas.size());
+
+    if (ObfPointsDecoder::isSupported(Implementation::SSE41))
+        compareImplementations(data, PointI(0, 0), 5);
+}
+
+QTEST_MAIN(TestObfPointsDecoder)
+#include "TestObfPointsDecoder.moc"
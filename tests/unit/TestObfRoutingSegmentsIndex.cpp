@@ -0,0 +1,215 @@
+#include "ObfRoutingSegmentsIndex.h"
+
+#include <OsmAndCore/RoadLocator.h>
+#include <OsmAndCore/Data/Road.h>
+#include <OsmAndCore/Data/ObfRoutingSectionInfo.h>
+#include <OsmAndCore/Utilities.h>
+
+#include <QtTest/QtTest>
+#include <QCoreApplication>
+
+#include <cmath>
+#include <cstdint>
+#include <limits>
+#include <memory>
+
+using namespace OsmAnd;
+using Segment = ObfRoutingSegmentsIndex::Segment;
+
+class TestObfRoutingSegmentsIndex : public QObject
+{
+    Q_OBJECT
+
+private:
+    enum {
+        RoadsCount = 300,
+        QueriesCount = 1000,
+        // Roads are spread over a square about 4 kilometers wide, queries go a bit beyond it
+        AreaSize31 = 1 << 18,
+        QueriesMargin31 = 1 << 15,
+    };
+
+    // Fixed sequence, so failures are reproducible
+    uint32_t _randomState;
+    QList< std::shared_ptr<const Road> > _roads;
+    std::shared_ptr<const ObfRoutingSegmentsIndex> _index;
+    PointI _origin31;
+
+    uint32_t nextRandom(const uint32_t bound);
+    PointI nextQueryPosition31();
+    // Nearest road within radius as road locator finds it over the index
+    std::shared_ptr<const Road> findNearestRoadInIndex(
+        const ObfRoutingSegmentsIndex& index,
+        const PointI position31,
+        const double radiusInMeters,
+        double* const outDistance) const;
+    // Roads with any segment within radius, by exact projection on all segments
+    QSet<const Road*> findRoadsInRadius(const PointI position31, const double radiusInMeters) const;
+private slots:
+    void initTestCase();
+    void nearestRoadMatchesLinearScan();
+    void visitedSegmentsCoverRadius();
+    void emptyIndexVisitsNothing();
+};
+
+uint32_t TestObfRoutingSegmentsIndex::nextRandom(const uint32_t bound)
+{
+    _randomState = _randomState * 1664525u + 1013904223u;
+    return (_randomState >> 8) % bound;
+}
+
+PointI TestObfRoutingSegmentsIndex::nextQueryPosition31()
+{
+    return PointI(
+        _origin31.x - QueriesMargin31 + nextRandom(AreaSize31 + 2 * QueriesMargin31),
+        _origin31.y - QueriesMargin31 + nextRandom(AreaSize31 + 2 * QueriesMargin31));
+}
+
+std::shared_ptr<const Road> TestObfRoutingSegmentsIndex::findNearestRoadInIndex(
+    const ObfRoutingSegmentsIndex& index,
+    const PointI position31,
+    const double radiusInMeters,
+    double* const outDistance) const
+{
+    // Same visitor as in road locator
+    std::shared_ptr<const Road> nearestRoad;
+    auto minSqDistance = radiusInMeters * radiusInMeters;
+    index.visitSegments(
+        position31,
+        minSqDistance,
+        [&index, position31, &nearestRoad, &minSqDistance]
+        (const Segment& segment) -> double
+        {
+            const auto& road = index.roads[segment.roadIndex];
+            PointI projection31;
+            const auto sqDistance = ObfRoutingSegmentsIndex::projectOnSegment(*road, segment.pointIndex, position31, projection31);
+            if (nearestRoad ? sqDistance < minSqDistance : sqDistance <= minSqDistance)
+            {
+                nearestRoad = road;
+                minSqDistance = sqDistance;
+            }
+            return minSqDistance;
+        });
+
+    *outDistance = std::sqrt(minSqDistance);
+    return nearestRoad;
+}
+
+QSet<const Road*> TestObfRoutingSegmentsIndex::findRoadsInRadius(const PointI position31, const double radiusInMeters) const
+{
+    QSet<const Road*> roadsInRadius;
+    for (const auto& road : constOf(_roads))
+    {
+        for (auto pointIdx = 1; pointIdx < road->points31.size(); pointIdx++)
+        {
+            PointI projection31;
+            if (ObfRoutingSegmentsIndex::projectOnSegment(*road, pointIdx, position31, projection31) <= radiusInMeters * radiusInMeters)
+            {
+                roadsInRadius.insert(road.get());
+                break;
+            }
+        }
+    }
+    return roadsInRadius;
+}
+
+void TestObfRoutingSegmentsIndex::initTestCase()
+{
+    _randomState = 12345u;
+    _origin31 = PointI(Utilities::get31TileNumberX(5.0), Utilities::get31TileNumberY(52.0));
+
+    // Roads of 2 to 8 points, each point within about 200 meters of previous one. Some roads
+    // are long and cross many cells of grid
+    const std::shared_ptr<const ObfRoutingSectionInfo> section(new ObfRoutingSectionInfo(nullptr));
+    for (auto roadIdx = 0; roadIdx < RoadsCount; roadIdx++)
+    {
+        QVector<PointI> points31;
+        auto point31 = PointI(_origin31.x + nextRandom(AreaSize31), _origin31.y + nextRandom(AreaSize31));
+        const auto step31 = (roadIdx % 10 == 0) ? (1 << 16) : (1 << 14);
+        for (auto pointIdx = 0, pointsCount = 2 + static_cast<int>(nextRandom(7)); pointIdx < pointsCount; pointIdx++)
+        {
+            points31.push_back(point31);
+            point31.x += static_cast<int32_t>(nextRandom(step31)) - step31 / 2;
+            point31.y += static_cast<int32_t>(nextRandom(step31)) - step31 / 2;
+        }
+        _roads.push_back(Road::create(section, ObfObjectId::fromRawId(roadIdx + 1), points31));
+    }
+    _index.reset(new ObfRoutingSegmentsIndex(_roads));
+}
+
+void TestObfRoutingSegmentsIndex::nearestRoadMatchesLinearScan()
+{
+    QVector<int> foundCounts;
+    for (const auto radiusInMeters : { 30.0, 150.0, 1000.0 })
+    {
+        auto foundCount = 0;
+        for (auto queryIdx = 0; queryIdx < QueriesCount; queryIdx++)
+        {
+            const auto position31 = nextQueryPosition31();
+
+            double expectedDistance = -1.0;
+            const auto expectedRoad = RoadLocator::findNearestRoad(_roads, position31, radiusInMeters, nullptr, nullptr, &expectedDistance);
+            double distance = -1.0;
+            const auto road = findNearestRoadInIndex(*_index, position31, radiusInMeters, &distance);
+
+            QCOMPARE(static_cast<bool>(road), static_cast<bool>(expectedRoad));
+            if (!road)
+                continue;
+
+            // Roads may differ only if both are at the same distance
+            QVERIFY(qAbs(distance - expectedDistance) < 1e-6);
+            foundCount++;
+        }
+        foundCounts.push_back(foundCount);
+    }
+
+    // Both found and missed queries are compared
+    QVERIFY(foundCounts.first() < QueriesCount);
+    QVERIFY(foundCounts.last() > 0);
+}
+
+void TestObfRoutingSegmentsIndex::visitedSegmentsCoverRadius()
+{
+    const auto radiusInMeters = 150.0;
+    for (auto queryIdx = 0; queryIdx < QueriesCount; queryIdx++)
+    {
+        const auto position31 = nextQueryPosition31();
+
+        // Limit isn't lowered, so every segment within radius has to be visited
+        QSet<const Road*> visitedRoads;
+        _index->visitSegments(
+            position31,
+            radiusInMeters * radiusInMeters,
+            [this, position31, radiusInMeters, &visitedRoads]
+            (const Segment& segment) -> double
+            {
+                const auto& road = _index->roads[segment.roadIndex];
+                PointI projection31;
+                if (ObfRoutingSegmentsIndex::projectOnSegment(*road, segment.pointIndex, position31, projection31) <= radiusInMeters * radiusInMeters)
+                    visitedRoads.insert(road.get());
+                return radiusInMeters * radiusInMeters;
+            });
+
+        QCOMPARE(visitedRoads, findRoadsInRadius(position31, radiusInMeters));
+    }
+}
+
+void TestObfRoutingSegmentsIndex::emptyIndexVisitsNothing()
+{
+    const ObfRoutingSegmentsIndex index((QList< std::shared_ptr<const Road> >()));
+
+    auto visitedCount = 0;
+    index.visitSegments(
+        _origin31,
+        std::numeric_limits<double>::max(),
+        [&visitedCount]
+        (const Segment& segment) -> double
+        {
+            visitedCount++;
+            return std::numeric_limits<double>::max();
+        });
+    QCOMPARE(visitedCount, 0);
+}
+
+QTEST_MAIN(TestObfRoutingSegmentsIndex)
+#include "TestObfRoutingSegmentsIndex.moc"
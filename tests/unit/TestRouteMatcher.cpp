@@ -0,0 +1,191 @@
+#include <OsmAndCore/Routing/RouteMatcher.h>
+#include <OsmAndCore/Data/ObfRoutingSectionInfo.h>
+#include <OsmAndCore/Utilities.h>
+
+#include <QtTest/QtTest>
+#include <QCoreApplication>
+
+#include <memory>
+
+using namespace OsmAnd;
+using MatchedPoint = RouteMatcher::MatchedPoint;
+typedef QList< std::pair<double, double> > Trace;
+
+class TestRouteMatcher : public QObject
+{
+    Q_OBJECT
+
+private:
+    // All roads are in single area and go both ways
+    class RoadsGraph : public RouteMatcher::IRoadsGraph
+    {
+    public:
+        QList< std::shared_ptr<const Road> > roads;
+        int roadsAroundRequestsCount = 0;
+
+        virtual uint64_t getAreaId(const PointI& point31) Q_DECL_OVERRIDE
+        {
+            return 0;
+        }
+
+        virtual void obtainRoadsAround(const PointI& point31, QList< std::shared_ptr<const Road> >& outRoads) Q_DECL_OVERRIDE
+        {
+            roadsAroundRequestsCount++;
+            outRoads.append(roads);
+        }
+
+        virtual void obtainRoadsAt(
+            const PointI& point31,
+            QList< std::pair< std::shared_ptr<const Road>, uint32_t > >& outRoads) Q_DECL_OVERRIDE
+        {
+            for (const auto& road : constOf(roads))
+            {
+                for (auto pointIdx = 0; pointIdx < road->points31.size(); pointIdx++)
+                {
+                    if (road->points31[pointIdx] == point31)
+                        outRoads.push_back(std::make_pair(road, static_cast<uint32_t>(pointIdx)));
+                }
+            }
+        }
+
+        virtual RoadDirection getDirection(const std::shared_ptr<const Road>& road) Q_DECL_OVERRIDE
+        {
+            return RoadDirection::TwoWay;
+        }
+    };
+
+    enum : uint64_t {
+        MainRoadId = 1,
+        ParallelRoadId = 2,
+        ConnectorRoadId = 3,
+        SideRoadId = 4,
+    };
+
+    std::shared_ptr<const ObfRoutingSectionInfo> _section;
+    RoadsGraph _graph;
+
+    static PointI toPoint31(const double latitude, const double longitude);
+    void addRoad(const uint64_t id, const Trace& points);
+private slots:
+    void initTestCase();
+    void outlierStaysOnFollowedRoad();
+    void turnMovesToSideRoad();
+    void pointWithoutRoadsIsNotMatched();
+};
+
+PointI TestRouteMatcher::toPoint31(const double latitude, const double longitude)
+{
+    return PointI(Utilities::get31TileNumberX(longitude), Utilities::get31TileNumberY(latitude));
+}
+
+void TestRouteMatcher::addRoad(const uint64_t id, const Trace& points)
+{
+    QVector<PointI> points31;
+    for (const auto& point : points)
+        points31.push_back(toPoint31(point.first, point.second));
+    _graph.roads.push_back(Road::create(_section, ObfObjectId::fromRawId(id), points31));
+}
+
+void TestRouteMatcher::initTestCase()
+{
+    _section.reset(new ObfRoutingSectionInfo(nullptr));
+
+    // Main road goes east along 52.0 with a point each 0.001 degree. Parallel road is 0.0004 degree
+    // north of it and joins it only at the western end via connector. Side road leaves main road
+    // to the south at 5.005
+    Trace mainRoad;
+    Trace parallelRoad;
+    for (auto pointIdx = 0; pointIdx <= 10; pointIdx++)
+    {
+        mainRoad.push_back(std::make_pair(52.0, 5.0 + 0.001 * pointIdx));
+        parallelRoad.push_back(std::make_pair(52.0004, 5.0 + 0.001 * pointIdx));
+    }
+    addRoad(MainRoadId, mainRoad);
+    addRoad(ParallelRoadId, parallelRoad);
+    addRoad(ConnectorRoadId, { std::make_pair(52.0, 5.0), std::make_pair(52.0004, 5.0) });
+    addRoad(SideRoadId, { std::make_pair(52.0, 5.005), std::make_pair(51.999, 5.005), std::make_pair(51.997, 5.005) });
+}
+
+void TestRouteMatcher::outlierStaysOnFollowedRoad()
+{
+    // Fourth point is closer to parallel road, but getting there and back takes a long detour
+    const Trace trace = {
+        std::make_pair(52.00005, 5.0012),
+        std::make_pair(51.99996, 5.0022),
+        std::make_pair(52.00003, 5.0031),
+        std::make_pair(52.00024, 5.0041),
+        std::make_pair(51.99998, 5.0052),
+        std::make_pair(52.00004, 5.0063),
+        std::make_pair(51.99997, 5.0072),
+    };
+
+    QVector<MatchedPoint> matchedPoints;
+    QVERIFY(RouteMatcher::matchTrace(&_graph, trace, matchedPoints));
+    QCOMPARE(matchedPoints.size(), trace.size());
+    for (auto pointIdx = 0; pointIdx < trace.size(); pointIdx++)
+    {
+        const auto& matchedPoint = matchedPoints[pointIdx];
+        QVERIFY(matchedPoint.road);
+        QCOMPARE(static_cast<uint64_t>(matchedPoint.road->id), static_cast<uint64_t>(MainRoadId));
+        QCOMPARE(matchedPoint.point31.y, toPoint31(52.0, 5.0).y);
+    }
+
+    // Outlier is put onto main road right below it, though parallel road is closer
+    QVERIFY(matchedPoints[3].distance > 40.0 && matchedPoints[3].distance < RouteMatcher::Settings().searchRadius);
+    QCOMPARE(matchedPoints[3].pointIndex, 5u);
+
+    // All points are within one area, so its roads are obtained once
+    QCOMPARE(_graph.roadsAroundRequestsCount, 1);
+    _graph.roadsAroundRequestsCount = 0;
+}
+
+void TestRouteMatcher::turnMovesToSideRoad()
+{
+    // Trace goes east along main road and turns south onto side road
+    const Trace trace = {
+        std::make_pair(52.00004, 5.0021),
+        std::make_pair(51.99997, 5.0032),
+        std::make_pair(52.00003, 5.0043),
+        std::make_pair(51.99930, 5.00504),
+        std::make_pair(51.99860, 5.00497),
+        std::make_pair(51.99790, 5.00503),
+    };
+
+    QVector<MatchedPoint> matchedPoints;
+    QVERIFY(RouteMatcher::matchTrace(&_graph, trace, matchedPoints));
+    QCOMPARE(matchedPoints.size(), trace.size());
+    for (auto pointIdx = 0; pointIdx < trace.size(); pointIdx++)
+    {
+        const auto& matchedPoint = matchedPoints[pointIdx];
+        QVERIFY(matchedPoint.road);
+        QCOMPARE(
+            static_cast<uint64_t>(matchedPoint.road->id),
+            static_cast<uint64_t>(pointIdx < 3 ? MainRoadId : SideRoadId));
+        QVERIFY(matchedPoint.distance < 10.0);
+    }
+}
+
+void TestRouteMatcher::pointWithoutRoadsIsNotMatched()
+{
+    // Third point is about a kilometer north of any road, so matching starts over after it
+    const Trace trace = {
+        std::make_pair(52.00003, 5.0012),
+        std::make_pair(51.99998, 5.0023),
+        std::make_pair(52.01000, 5.0030),
+        std::make_pair(52.00002, 5.0041),
+        std::make_pair(51.99996, 5.0052),
+    };
+
+    QVector<MatchedPoint> matchedPoints;
+    QVERIFY(RouteMatcher::matchTrace(&_graph, trace, matchedPoints));
+    QCOMPARE(matchedPoints.size(), trace.size());
+    QVERIFY(!matchedPoints[2].road);
+    for (const auto pointIdx : { 0, 1, 3, 4 })
+    {
+        QVERIFY(matchedPoints[pointIdx].road);
+        QCOMPARE(static_cast<uint64_t>(matchedPoints[pointIdx].road->id), static_cast<uint64_t>(MainRoadId));
+    }
+}
+
+QTEST_MAIN(TestRouteMatcher)
+#include "TestRouteMatcher.moc"
@@ -0,0 +1,328 @@
+#include <OsmAndCore/Routing/RoutePlanner.h>
+#include <OsmAndCore/Data/ObfRoutingSectionInfo.h>
+#include <OsmAndCore/Utilities.h>
+
+#include <QtTest/QtTest>
+#include <QCoreApplication>
+
+#include <limits>
+#include <memory>
+
+using namespace OsmAnd;
+typedef QList< std::pair<double, double> > Polyline;
+
+class TestRoutePlannerSearch : public QObject
+{
+    Q_OBJECT
+
+private:
+    // All roads go both ways at the same speed, turns take no time
+    class RoadsGraph : public RoutePlanner::IRoadsGraph
+    {
+    public:
+        QList< std::shared_ptr<const Road> > roads;
+        // Roads turns onto which are restricted, by roads they are restricted from
+        QMultiHash<ObfObjectId, ObfObjectId> restrictedTurns;
+        // Largest point index of each road that search asked obstacle time for
+        QHash<ObfObjectId, int> maxRequestedPointsIndices;
+
+        virtual void obtainRoadsAt(
+            const PointI& point31,
+            const std::shared_ptr<const Road>& fromRoad,
+            QList< std::pair< std::shared_ptr<const Road>, uint32_t > >& outRoads) Q_DECL_OVERRIDE
+        {
+            for (const auto& road : constOf(roads))
+            {
+                if (restrictedTurns.contains(fromRoad->id, road->id))
+                    continue;
+
+                for (auto pointIdx = 0; pointIdx < road->points31.size(); pointIdx++)
+                {
+                    if (road->points31[pointIdx] == point31)
+                        outRoads.push_back(std::make_pair(road, static_cast<uint32_t>(pointIdx)));
+                }
+            }
+        }
+
+        virtual RoadDirection getDirection(const std::shared_ptr<const Road>& road) Q_DECL_OVERRIDE
+        {
+            return RoadDirection::TwoWay;
+        }
+
+        virtual float getObstacleTime(const std::shared_ptr<const Road>& road, const uint32_t pointIndex) Q_DECL_OVERRIDE
+        {
+            auto& maxPointIdx = maxRequestedPointsIndices[road->id];
+            maxPointIdx = qMax(maxPointIdx, static_cast<int>(pointIndex));
+            return 0.0f;
+        }
+
+        virtual float getTime(const std::shared_ptr<const Road>& road, const float distance, const float obstaclesTime) Q_DECL_OVERRIDE
+        {
+            return distance / Speed + obstaclesTime;
+        }
+
+        virtual float getTurnTime(
+            const std::shared_ptr<const Road>& fromRoad,
+            const uint32_t fromEnteredPointIndex,
+            const uint32_t fromPointIndex,
+            const std::shared_ptr<const Road>& toRoad,
+            const uint32_t toPointIndex,
+            const uint32_t toEndPointIndex) Q_DECL_OVERRIDE
+        {
+            return 0.0f;
+        }
+    };
+
+    enum : uint64_t {
+        MainRoadId = 1,
+        SideRoadId = 2,
+        IsolatedRoadId = 3,
+    };
+
+    // Meters per second
+    static constexpr float Speed = 10.0f;
+
+    std::shared_ptr<const ObfRoutingSectionInfo> _section;
+    RoadsGraph _graph;
+
+    static PointI toPoint31(const double latitude, const double longitude);
+    static PointI middle31(const PointI& a, const PointI& b);
+    void addRoad(const uint64_t id, const Polyline& points);
+    std::shared_ptr<const Road> getRoad(const uint64_t id) const;
+    // Point halfway between road points [pointIndex - 1] and [pointIndex]
+    RoadPoint getRoadPoint(const uint64_t roadId, const uint32_t pointIndex) const;
+    // Time from location to road point [fromPointIndex] and then along road to point [toPointIndex]
+    float getTimeAlongRoad(const uint64_t roadId, const PointI& from31, const uint32_t fromPointIndex, const uint32_t toPointIndex) const;
+    // Half a segment past the point where side road leaves main road
+    float getIsochroneLimit(const RoadPoint& origin) const;
+private slots:
+    void initTestCase();
+    void timesFromRoadPointMatchPaths();
+    void isochroneSegmentsCostTheirLength();
+    void isochroneOutlineEndsAtLimit();
+    void isochroneFollowsRestrictions();
+};
+
+constexpr float TestRoutePlannerSearch::Speed;
+
+PointI TestRoutePlannerSearch::toPoint31(const double latitude, const double longitude)
+{
+    return PointI(Utilities::get31TileNumberX(longitude), Utilities::get31TileNumberY(latitude));
+}
+
+PointI TestRoutePlannerSearch::middle31(const PointI& a, const PointI& b)
+{
+    return PointI(a.x + (b.x - a.x) / 2, a.y + (b.y - a.y) / 2);
+}
+
+void TestRoutePlannerSearch::addRoad(const uint64_t id, const Polyline& points)
+{
+    QVector<PointI> points31;
+    for (const auto& point : points)
+        points31.push_back(toPoint31(point.first, point.second));
+    _graph.roads.push_back(Road::create(_section, ObfObjectId::fromRawId(id), points31));
+}
+
+std::shared_ptr<const Road> TestRoutePlannerSearch::getRoad(const uint64_t id) const
+{
+    for (const auto& road : constOf(_graph.roads))
+    {
+        if (road->id == ObfObjectId::fromRawId(id))
+            return road;
+    }
+    return nullptr;
+}
+
+RoadPoint TestRoutePlannerSearch::getRoadPoint(const uint64_t roadId, const uint32_t pointIndex) const
+{
+    RoadPoint roadPoint;
+    roadPoint.road = getRoad(roadId);
+    roadPoint.pointIndex = pointIndex;
+    roadPoint.point31 = middle31(roadPoint.road->points31[pointIndex - 1], roadPoint.road->points31[pointIndex]);
+    return roadPoint;
+}
+
+float TestRoutePlannerSearch::getTimeAlongRoad(
+    const uint64_t roadId,
+    const PointI& from31,
+    const uint32_t fromPointIndex,
+    const uint32_t toPointIndex) const
+{
+    const auto& points31 = getRoad(roadId)->points31;
+    auto distance = Utilities::distance31(from31, points31[fromPointIndex]);
+    for (auto pointIdx = qMin(fromPointIndex, toPointIndex); pointIdx < qMax(fromPointIndex, toPointIndex); pointIdx++)
+        distance += Utilities::distance31(points31[pointIdx], points31[pointIdx + 1]);
+    return static_cast<float>(distance / Speed);
+}
+
+float TestRoutePlannerSearch::getIsochroneLimit(const RoadPoint& origin) const
+{
+    const auto& points31 = getRoad(MainRoadId)->points31;
+    return getTimeAlongRoad(MainRoadId, origin.point31, 2, 5) +
+        static_cast<float>(Utilities::distance31(points31[5], points31[6]) / Speed / 2.0);
+}
+
+void TestRoutePlannerSearch::initTestCase()
+{
+    _section.reset(new ObfRoutingSectionInfo(nullptr));
+
+    // Main road goes east along 52.0 with a point each 0.001 degree. Side road leaves it to the
+    // south at 5.005, isolated road doesn't touch any other road
+    Polyline mainRoad;
+    for (auto pointIdx = 0; pointIdx <= 10; pointIdx++)
+        mainRoad.push_back(std::make_pair(52.0, 5.0 + 0.001 * pointIdx));
+    addRoad(MainRoadId, mainRoad);
+    addRoad(SideRoadId, { std::make_pair(52.0, 5.005), std::make_pair(51.999, 5.005), std::make_pair(51.998, 5.005) });
+    addRoad(IsolatedRoadId, { std::make_pair(52.001, 5.0), std::make_pair(52.001, 5.001) });
+}
+
+void TestRoutePlannerSearch::timesFromRoadPointMatchPaths()
+{
+    // Origin is between 2nd and 3rd points of main road
+    const auto origin = getRoadPoint(MainRoadId, 2);
+    QVector<RoadPoint> destinations;
+    destinations.push_back(getRoadPoint(MainRoadId, 8));
+    destinations.push_back(getRoadPoint(SideRoadId, 2));
+    destinations.push_back(getRoadPoint(IsolatedRoadId, 1));
+    destinations.push_back(RoadPoint());
+    destinations.push_back(getRoadPoint(MainRoadId, 2));
+
+    _graph.maxRequestedPointsIndices.clear();
+    QVector<float> times;
+    QVERIFY(RoutePlanner::calculateTimesFromRoadPoint(&_graph, origin, destinations, times));
+    QCOMPARE(times.size(), destinations.size());
+
+    const auto mainRoadTime =
+        getTimeAlongRoad(MainRoadId, origin.point31, 2, 7) +
+        getTimeAlongRoad(MainRoadId, destinations[0].point31, 7, 7);
+    QVERIFY(qAbs(times[0] - mainRoadTime) < 0.01f);
+
+    const auto sideRoadTime =
+        getTimeAlongRoad(MainRoadId, origin.point31, 2, 5) +
+        getTimeAlongRoad(SideRoadId, destinations[1].point31, 1, 0);
+    QVERIFY(qAbs(times[1] - sideRoadTime) < 0.01f);
+
+    // Unreachable destination and destination without road are left without time, destination
+    // at origin takes none
+    QVERIFY(std::isinf(times[2]));
+    QVERIFY(std::isinf(times[3]));
+    QVERIFY(qAbs(times[4]) < 0.01f);
+
+    // Search can't tell isolated road is unreachable, so it passes the whole graph
+    QCOMPARE(_graph.maxRequestedPointsIndices.value(ObfObjectId::fromRawId(MainRoadId)), 10);
+
+    // Search stops once all destinations are settled, so far end of main road isn't passed
+    destinations.remove(2);
+    _graph.maxRequestedPointsIndices.clear();
+    QVERIFY(RoutePlanner::calculateTimesFromRoadPoint(&_graph, origin, destinations, times));
+    QVERIFY(_graph.maxRequestedPointsIndices.value(ObfObjectId::fromRawId(MainRoadId)) < 10);
+    QVERIFY(qAbs(times[0] - mainRoadTime) < 0.01f);
+    QVERIFY(qAbs(times[1] - sideRoadTime) < 0.01f);
+}
+
+void TestRoutePlannerSearch::isochroneSegmentsCostTheirLength()
+{
+    const auto origin = getRoadPoint(MainRoadId, 2);
+    const auto limit = getIsochroneLimit(origin);
+
+    for (const auto costType : { IsochroneCostType::Time, IsochroneCostType::Distance })
+    {
+        const auto costOfLength =
+            [costType]
+            (const double length) -> float
+            {
+                return static_cast<float>(costType == IsochroneCostType::Time ? length / Speed : length);
+            };
+        const auto costLimit = costType == IsochroneCostType::Time ? limit : limit * Speed;
+
+        QList<IsochroneSegment> segments;
+        QVERIFY(RoutePlanner::calculateIsochrone(&_graph, origin, costType, costLimit, segments));
+        QVERIFY(!segments.isEmpty());
+        for (const auto& segment : constOf(segments))
+        {
+            QCOMPARE(qAbs(static_cast<int>(segment.toPointIndex) - static_cast<int>(segment.fromPointIndex)), 1);
+            QVERIFY(segment.fromCost <= costLimit);
+
+            // Segments from origin start in the middle of road segment
+            const auto& points31 = segment.road->points31;
+            const auto& toPoint31 = points31[segment.toPointIndex];
+            const auto fromOrigin = segment.road == origin.road &&
+                qMax(segment.fromPointIndex, segment.toPointIndex) == origin.pointIndex;
+            const auto length = Utilities::distance31(fromOrigin ? origin.point31 : points31[segment.fromPointIndex], toPoint31);
+            if (fromOrigin)
+                QCOMPARE(segment.fromCost, 0.0f);
+            QVERIFY(qAbs(segment.toCost - segment.fromCost - costOfLength(length)) < 0.01f);
+        }
+    }
+}
+
+void TestRoutePlannerSearch::isochroneOutlineEndsAtLimit()
+{
+    const auto origin = getRoadPoint(MainRoadId, 2);
+    const auto limit = getIsochroneLimit(origin);
+
+    QList<IsochroneSegment> segments;
+    QVector<PointI> outline31;
+    QVERIFY(RoutePlanner::calculateIsochrone(&_graph, origin, IsochroneCostType::Time, limit, segments, &outline31));
+
+    // Main road is passed up to the middle of segment past side road, which ends its last segment
+    auto mainRoadEndReached = false;
+    for (const auto& segment : constOf(segments))
+    {
+        if (segment.road->id != ObfObjectId::fromRawId(MainRoadId) || segment.toPointIndex <= 5)
+            continue;
+
+        QCOMPARE(segment.fromPointIndex, 5u);
+        QCOMPARE(segment.toPointIndex, 6u);
+        QVERIFY(segment.fromCost < limit && segment.toCost > limit);
+        mainRoadEndReached = true;
+    }
+    QVERIFY(mainRoadEndReached);
+
+    // Outline goes through points where limit is reached on main and side roads, both half of
+    // main road segment away from the turn, and through western end of main road that is reached
+    // before the limit
+    const auto& mainRoadPoints31 = getRoad(MainRoadId)->points31;
+    const auto& sideRoadPoints31 = getRoad(SideRoadId)->points31;
+    const auto sideRoadFactor =
+        Utilities::distance31(mainRoadPoints31[5], mainRoadPoints31[6]) / 2.0 /
+        Utilities::distance31(sideRoadPoints31[0], sideRoadPoints31[1]);
+    const QVector<PointI> expectedOutline31 = {
+        middle31(mainRoadPoints31[5], mainRoadPoints31[6]),
+        PointI(
+            sideRoadPoints31[0].x,
+            sideRoadPoints31[0].y + static_cast<int32_t>((sideRoadPoints31[1].y - sideRoadPoints31[0].y) * sideRoadFactor)),
+        mainRoadPoints31[0],
+    };
+    QCOMPARE(outline31.size(), expectedOutline31.size());
+    for (const auto& expectedPoint31 : constOf(expectedOutline31))
+    {
+        auto minDistance = std::numeric_limits<double>::max();
+        for (const auto& point31 : constOf(outline31))
+            minDistance = qMin(minDistance, Utilities::distance31(point31, expectedPoint31));
+        QVERIFY(minDistance < 1.0);
+    }
+}
+
+void TestRoutePlannerSearch::isochroneFollowsRestrictions()
+{
+    const auto origin = getRoadPoint(MainRoadId, 2);
+    const auto limit = getIsochroneLimit(origin);
+
+    // Turn onto side road is restricted, so only main road is reached and outline of two points
+    // is dropped
+    _graph.restrictedTurns.insert(ObfObjectId::fromRawId(MainRoadId), ObfObjectId::fromRawId(SideRoadId));
+    QList<IsochroneSegment> segments;
+    QVector<PointI> outline31;
+    const auto calculated = RoutePlanner::calculateIsochrone(&_graph, origin, IsochroneCostType::Time, limit, segments, &outline31);
+    _graph.restrictedTurns.clear();
+    QVERIFY(calculated);
+
+    QVERIFY(!segments.isEmpty());
+    for (const auto& segment : constOf(segments))
+        QCOMPARE(static_cast<uint64_t>(segment.road->id), static_cast<uint64_t>(MainRoadId));
+    QVERIFY(outline31.isEmpty());
+}
+
+QTEST_MAIN(TestRoutePlannerSearch)
+#include "TestRoutePlannerSearch.moc"
@@ -0,0 +1,299 @@
+#include <OsmAndCore/Routing/RoutingHierarchy.h>
+#include <OsmAndCore/Concurrent/WorkerPool.h>
+
+#include <QtTest/QtTest>
+#include <QCoreApplication>
+#include <QTemporaryDir>
+#include <QFile>
+
+#include <limits>
+#include <memory>
+
+using namespace OsmAnd;
+
+class TestRoutingHierarchy : public QObject
+{
+    Q_OBJECT
+
+private:
+    typedef RoutingHierarchy::Node Node;
+    typedef RoutingHierarchy::Edge Edge;
+    typedef RoutingHierarchy::Terminal Terminal;
+
+    enum {
+        GridSize = 6,
+    };
+
+    QVector<Node> _nodes;
+    QVector<Edge> _edges;
+
+    static void addRoad(QVector<Edge>& edges, const uint32_t from, const uint32_t to, const float time, const bool oneWay);
+    // Plain Dijkstra over original edges, as a reference for hierarchy search
+    float findTime(const uint32_t source, const uint32_t target) const;
+    static void verifyPath(const RoutingHierarchy& hierarchy, const uint32_t source, const uint32_t target, const float expectedTime);
+    void verifyTimesMatrix(const RoutingHierarchy& hierarchy, Concurrent::WorkerPool* const workerPool) const;
+private slots:
+    void initTestCase();
+    void buildFindsShortestPaths();
+    void timesMatrixMatchesShortestPaths();
+    void saveAndLoadKeepHierarchy();
+    void loadRejectsTruncatedFile();
+    void cacheSharesLoadedHierarchy();
+};
+
+void TestRoutingHierarchy::addRoad(QVector<Edge>& edges, const uint32_t from, const uint32_t to, const float time, const bool oneWay)
+{
+    Edge edge;
+    edge.from = from;
+    edge.to = to;
+    edge.time = time;
+    edge.roadId = (static_cast<uint64_t>(qMin(from, to)) << 32) | qMax(from, to);
+    edge.startPointIndex = 0;
+    edge.endPointIndex = 1;
+    edge.firstChild = RoutingHierarchy::InvalidId;
+    edge.secondChild = RoutingHierarchy::InvalidId;
+    edges.push_back(edge);
+
+    if (oneWay)
+        return;
+
+    edge.from = to;
+    edge.to = from;
+    edge.startPointIndex = 1;
+    edge.endPointIndex = 0;
+    edges.push_back(edge);
+}
+
+float TestRoutingHierarchy::findTime(const uint32_t source, const uint32_t target) const
+{
+    QVector<float> times(_nodes.size(), std::numeric_limits<float>::infinity());
+    QVector<bool> settled(_nodes.size(), false);
+    times[source] = 0.0f;
+    for (;;)
+    {
+        auto node = -1;
+        for (auto nodeId = 0; nodeId < _nodes.size(); nodeId++)
+        {
+            if (!settled[nodeId] && !std::isinf(times[nodeId]) && (node < 0 || times[nodeId] < times[node]))
+                node = nodeId;
+        }
+        if (node < 0 || node == static_cast<int>(target))
+            break;
+        settled[node] = true;
+
+        for (const auto& edge : _edges)
+        {
+            if (edge.from == static_cast<uint32_t>(node))
+                times[edge.to] = qMin(times[edge.to], times[node] + edge.time);
+        }
+    }
+
+    return times[target];
+}
+
+void TestRoutingHierarchy::verifyPath(const RoutingHierarchy& hierarchy, const uint32_t source, const uint32_t target, const float expectedTime)
+{
+    QVector<uint32_t> pathEdges;
+    float time = 0.0f;
+    const auto found = hierarchy.findPath({ { source, 0.0f } }, { { target, 0.0f } }, pathEdges, nullptr, nullptr, &time);
+    QCOMPARE(found, !std::isinf(expectedTime));
+    if (!found)
+        return;
+    QVERIFY(qAbs(time - expectedTime) < 1e-3f);
+
+    // Path is unpacked into connected original edges
+    auto node = source;
+    auto pathTime = 0.0f;
+    for (const auto edgeId : pathEdges)
+    {
+        const auto& edge = hierarchy.edges[edgeId];
+        QVERIFY(!edge.isShortcut());
+        QCOMPARE(edge.from, node);
+        node = edge.to;
+        pathTime += edge.time;
+    }
+    QCOMPARE(node, target);
+    QVERIFY(qAbs(pathTime - expectedTime) < 1e-3f);
+}
+
+void TestRoutingHierarchy::verifyTimesMatrix(const RoutingHierarchy& hierarchy, Concurrent::WorkerPool* const workerPool) const
+{
+    // Groups of several terminals stand for route points that snap to more than one node
+    const QVector< QVector<Terminal> > sources = {
+        { { 0, 0.0f } },
+        { { 7, 0.5f }, { 20, 0.0f } },
+        { { 35, 2.0f }, { 30, 1.0f } },
+        { { 14, 0.0f } },
+    };
+    const QVector< QVector<Terminal> > targets = {
+        { { 35, 0.0f } },
+        { { 5, 1.0f }, { 11, 0.0f } },
+        { { 0, 0.0f } },
+    };
+
+    QVector<float> times;
+    QVERIFY(hierarchy.calculateTimesMatrix(sources, targets, times, workerPool));
+    QCOMPARE(times.size(), sources.size() * targets.size());
+
+    for (auto sourceIdx = 0; sourceIdx < sources.size(); sourceIdx++)
+    {
+        for (auto targetIdx = 0; targetIdx < targets.size(); targetIdx++)
+        {
+            auto expectedTime = std::numeric_limits<float>::infinity();
+            for (const auto& source : sources[sourceIdx])
+            {
+                for (const auto& target : targets[targetIdx])
+                    expectedTime = qMin(expectedTime, source.time + findTime(source.node, target.node) + target.time);
+            }
+
+            QVERIFY(qAbs(times[sourceIdx * targets.size() + targetIdx] - expectedTime) < 1e-3f);
+        }
+    }
+}
+
+void TestRoutingHierarchy::initTestCase()
+{
+    // Grid of two-way roads with uneven times, plus one-way diagonals that make some detours faster
+    for (auto y = 0; y < GridSize; y++)
+    {
+        for (auto x = 0; x < GridSize; x++)
+        {
+            Node node;
+            node.location31 = PointI(x * 1000, y * 1000);
+            node.rank = 0;
+            _nodes.push_back(node);
+        }
+    }
+    for (auto y = 0; y < GridSize; y++)
+    {
+        for (auto x = 0; x < GridSize; x++)
+        {
+            const uint32_t nodeId = y * GridSize + x;
+            if (x + 1 < GridSize)
+                addRoad(_edges, nodeId, nodeId + 1, 1.0f + ((x * 7 + y * 3) % 5), false);
+            if (y + 1 < GridSize)
+                addRoad(_edges, nodeId, nodeId + GridSize, 1.0f + ((x * 5 + y * 11) % 4), false);
+            if (x + 1 < GridSize && y + 1 < GridSize && (x + y) % 3 == 0)
+                addRoad(_edges, nodeId, nodeId + GridSize + 1, 1.5f, true);
+        }
+    }
+}
+
+void TestRoutingHierarchy::buildFindsShortestPaths()
+{
+    const auto hierarchy = RoutingHierarchy::build(QLatin1String("car"), 12345, _nodes, _edges);
+    QVERIFY(hierarchy);
+    QCOMPARE(hierarchy->nodes.size(), _nodes.size());
+    QVERIFY(hierarchy->edges.size() >= _edges.size());
+
+    for (auto source = 0; source < _nodes.size(); source += 5)
+    {
+        for (auto target = 0; target < _nodes.size(); target += 3)
+            verifyPath(*hierarchy, source, target, findTime(source, target));
+    }
+}
+
+void TestRoutingHierarchy::timesMatrixMatchesShortestPaths()
+{
+    const auto hierarchy = RoutingHierarchy::build(QLatin1String("car"), 12345, _nodes, _edges);
+    QVERIFY(hierarchy);
+
+    verifyTimesMatrix(*hierarchy, nullptr);
+
+    Concurrent::WorkerPool workerPool(Concurrent::WorkerPool::Order::FIFO, 4);
+    verifyTimesMatrix(*hierarchy, &workerPool);
+}
+
+void TestRoutingHierarchy::saveAndLoadKeepHierarchy()
+{
+    const auto hierarchy = RoutingHierarchy::build(QLatin1String("car"), 12345, _nodes, _edges);
+    QVERIFY(hierarchy);
+
+    QTemporaryDir dir;
+    QVERIFY(dir.isValid());
+    const auto filePath = RoutingHierarchy::getSidecarFilePath(dir.path() + QLatin1String("/grid.obf"), hierarchy->profileName);
+    QVERIFY(filePath.endsWith(QLatin1String("grid.obf.car.rch")));
+    QVERIFY(hierarchy->saveTo(filePath));
+
+    const auto loaded = RoutingHierarchy::loadFrom(filePath);
+    QVERIFY(loaded);
+    QCOMPARE(loaded->profileName, hierarchy->profileName);
+    QCOMPARE(loaded->obfFileSize, hierarchy->obfFileSize);
+
+    QCOMPARE(loaded->nodes.size(), hierarchy->nodes.size());
+    for (auto nodeId = 0; nodeId < hierarchy->nodes.size(); nodeId++)
+    {
+        QCOMPARE(loaded->nodes[nodeId].location31, hierarchy->nodes[nodeId].location31);
+        QCOMPARE(loaded->nodes[nodeId].rank, hierarchy->nodes[nodeId].rank);
+    }
+
+    QCOMPARE(loaded->edges.size(), hierarchy->edges.size());
+    for (auto edgeId = 0; edgeId < hierarchy->edges.size(); edgeId++)
+    {
+        const auto& loadedEdge = loaded->edges[edgeId];
+        const auto& edge = hierarchy->edges[edgeId];
+        QCOMPARE(loadedEdge.from, edge.from);
+        QCOMPARE(loadedEdge.to, edge.to);
+        QCOMPARE(loadedEdge.time, edge.time);
+        QCOMPARE(loadedEdge.roadId, edge.roadId);
+        QCOMPARE(loadedEdge.startPointIndex, edge.startPointIndex);
+        QCOMPARE(loadedEdge.endPointIndex, edge.endPointIndex);
+        QCOMPARE(loadedEdge.firstChild, edge.firstChild);
+        QCOMPARE(loadedEdge.secondChild, edge.secondChild);
+    }
+
+    const auto roadId = _edges.first().roadId;
+    QCOMPARE(loaded->getRoadEdges(roadId), hierarchy->getRoadEdges(roadId));
+
+    // Search graph is rebuilt on load
+    for (auto source = 0; source < _nodes.size(); source += 7)
+    {
+        for (auto target = 0; target < _nodes.size(); target += 4)
+            verifyPath(*loaded, source, target, findTime(source, target));
+    }
+}
+
+void TestRoutingHierarchy::loadRejectsTruncatedFile()
+{
+    const auto hierarchy = RoutingHierarchy::build(QLatin1String("car"), 12345, _nodes, _edges);
+    QVERIFY(hierarchy);
+
+    QTemporaryDir dir;
+    QVERIFY(dir.isValid());
+    const auto filePath = dir.path() + QLatin1String("/truncated.rch");
+    QVERIFY(hierarchy->saveTo(filePath));
+
+    QFile file(filePath);
+    QVERIFY(file.resize(file.size() / 2));
+    QVERIFY(!RoutingHierarchy::loadFrom(filePath));
+    QVERIFY(!RoutingHierarchy::loadFrom(dir.path() + QLatin1String("/missing.rch")));
+}
+
+void TestRoutingHierarchy::cacheSharesLoadedHierarchy()
+{
+    const auto hierarchy = RoutingHierarchy::build(QLatin1String("car"), 12345, _nodes, _edges);
+    QVERIFY(hierarchy);
+
+    QTemporaryDir dir;
+    QVERIFY(dir.isValid());
+    const auto obfFilePath = dir.path() + QLatin1String("/region.obf");
+    QVERIFY(hierarchy->saveTo(RoutingHierarchy::getSidecarFilePath(obfFilePath, QLatin1String("car"))));
+
+    RoutingHierarchiesCache cache;
+    const auto loaded = cache.obtainHierarchy(obfFilePath, 12345, QLatin1String("car"));
+    QVERIFY(loaded);
+    QCOMPARE(loaded->edges.size(), hierarchy->edges.size());
+    QCOMPARE(cache.obtainHierarchy(obfFilePath, 12345, QLatin1String("car")), loaded);
+
+    // Sidecar of other file size is outdated, sidecar of other profile is missing
+    QVERIFY(!cache.obtainHierarchy(obfFilePath, 54321, QLatin1String("car")));
+    QVERIFY(!cache.obtainHierarchy(obfFilePath, 12345, QLatin1String("bicycle")));
+
+    cache.clear();
+    const auto reloaded = cache.obtainHierarchy(obfFilePath, 12345, QLatin1String("car"));
+    QVERIFY(reloaded);
+    QVERIFY(reloaded != loaded);
+}
+
+QTEST_MAIN(TestRoutingHierarchy)
+#include "TestRoutingHierarchy.moc"
@@ -0,0 +1,151 @@
+#include <OsmAndCore/Data/TransportJourneyPlanner.h>
+#include <OsmAndCore/Data/TransportNetwork.h>
+#include <OsmAndCore/Data/TransportStop.h>
+#include <OsmAndCore/Data/TransportRoute.h>
+#include <OsmAndCore/Utilities.h>
+
+#include <QtTest/QtTest>
+#include <QCoreApplication>
+
+#include <memory>
+
+using namespace OsmAnd;
+using Journey = TransportJourneyPlanner::Journey;
+using Settings = TransportJourneyPlanner::Settings;
+
+class TestTransportJourneyPlanner : public QObject
+{
+    Q_OBJECT
+
+private:
+    enum : int {
+        DepartureTime = 8 * 3600,
+    };
+
+    QList< std::shared_ptr<const TransportStop> > _stops;
+    std::shared_ptr<TransportRoute> _westRoute;
+    std::shared_ptr<TransportRoute> _eastRoute;
+    std::shared_ptr<const TransportNetwork> _network;
+
+    static PointI toPoint31(const double latitude, const double longitude);
+    std::shared_ptr<TransportStop> addStop(const double latitude, const double longitude);
+    static Settings getSettings(const int maxTransfers);
+private slots:
+    void initTestCase();
+    void journeyIsUnwoundThroughTransfer();
+    void maxTransfersCutsJourneyOff();
+};
+
+PointI TestTransportJourneyPlanner::toPoint31(const double latitude, const double longitude)
+{
+    return PointI(Utilities::get31TileNumberX(longitude), Utilities::get31TileNumberY(latitude));
+}
+
+std::shared_ptr<TransportStop> TestTransportJourneyPlanner::addStop(const double latitude, const double longitude)
+{
+    const std::shared_ptr<TransportStop> stop(new TransportStop(nullptr));
+    stop->id = ObfObjectId::fromRawId(_stops.size() + 1);
+    stop->location = LatLon(latitude, longitude);
+    _stops.push_back(stop);
+    return stop;
+}
+
+Settings TestTransportJourneyPlanner::getSettings(const int maxTransfers)
+{
+    Settings settings;
+    settings.maxTransfers = maxTransfers;
+    settings.maxWalkDistance = 200.0;
+    return settings;
+}
+
+void TestTransportJourneyPlanner::initTestCase()
+{
+    // Two bus routes go east along 52.0. West route ends about 150 meters from where east route
+    // starts, which is close enough for walking transfer, but too far for access or egress walk.
+    // Origin and destination are farther apart than any walk
+    const auto westFirstStop = addStop(52.0, 5.0);
+    const auto westLastStop = addStop(52.0, 5.02);
+    const auto eastFirstStop = addStop(52.0, 5.0222);
+    const auto eastLastStop = addStop(52.0, 5.05);
+
+    _westRoute.reset(new TransportRoute());
+    _westRoute->type = QLatin1String("bus");
+    _westRoute->dist = 0;
+    _westRoute->forwardStops = { westFirstStop, westLastStop };
+    _eastRoute.reset(new TransportRoute());
+    _eastRoute->type = QLatin1String("bus");
+    _eastRoute->dist = 0;
+    _eastRoute->forwardStops = { eastFirstStop, eastLastStop };
+
+    _network = TransportNetwork::build(_stops, { _westRoute, _eastRoute });
+    QCOMPARE(_network->stops.size(), 4);
+    QCOMPARE(_network->routes.size(), 2);
+}
+
+void TestTransportJourneyPlanner::journeyIsUnwoundThroughTransfer()
+{
+    const auto origin31 = toPoint31(52.0, 4.9995);
+    const auto destination31 = toPoint31(52.0, 5.0505);
+
+    Journey journey;
+    QVERIFY(TransportJourneyPlanner::findEarliestArrival(_network, origin31, destination31, DepartureTime, journey, getSettings(1)));
+    QCOMPARE(journey.ridesCount, 2);
+
+    // Walk to first stop, ride, walking transfer, ride and walk from last stop
+    QCOMPARE(journey.legs.size(), 5);
+    const auto& accessWalk = journey.legs[0];
+    QVERIFY(!accessWalk.route && !accessWalk.fromStop);
+    QCOMPARE(accessWalk.toStop, _stops[0]);
+    QCOMPARE(accessWalk.departureTime, static_cast<int>(DepartureTime));
+
+    const auto& westRide = journey.legs[1];
+    QCOMPARE(westRide.route, std::static_pointer_cast<const TransportRoute>(_westRoute));
+    QCOMPARE(westRide.fromStop, _stops[0]);
+    QCOMPARE(westRide.toStop, _stops[1]);
+    // Boarding waits half of headway on average
+    QCOMPARE(westRide.departureTime, accessWalk.arrivalTime + Settings().averageHeadway / 2);
+
+    const auto& transferWalk = journey.legs[2];
+    QVERIFY(!transferWalk.route);
+    QCOMPARE(transferWalk.fromStop, _stops[1]);
+    QCOMPARE(transferWalk.toStop, _stops[2]);
+    QCOMPARE(transferWalk.departureTime, westRide.arrivalTime);
+
+    const auto& eastRide = journey.legs[3];
+    QCOMPARE(eastRide.route, std::static_pointer_cast<const TransportRoute>(_eastRoute));
+    QCOMPARE(eastRide.fromStop, _stops[2]);
+    QCOMPARE(eastRide.toStop, _stops[3]);
+
+    const auto& egressWalk = journey.legs[4];
+    QVERIFY(!egressWalk.route && !egressWalk.toStop);
+    QCOMPARE(egressWalk.fromStop, _stops[3]);
+    QCOMPARE(egressWalk.arrivalTime, journey.arrivalTime);
+
+    // Each leg starts no sooner than the previous one ends
+    for (auto legIdx = 0; legIdx < journey.legs.size(); legIdx++)
+    {
+        const auto& leg = journey.legs[legIdx];
+        QVERIFY(leg.departureTime < leg.arrivalTime);
+        if (legIdx > 0)
+            QVERIFY(journey.legs[legIdx - 1].arrivalTime <= leg.departureTime);
+    }
+}
+
+void TestTransportJourneyPlanner::maxTransfersCutsJourneyOff()
+{
+    const auto origin31 = toPoint31(52.0, 4.9995);
+    const auto destination31 = toPoint31(52.0, 5.0505);
+
+    // Destination needs two rides, without transfers only stops of west route are reached
+    Journey journey;
+    QVERIFY(!TransportJourneyPlanner::findEarliestArrival(_network, origin31, destination31, DepartureTime, journey, getSettings(0)));
+
+    // Single ride is still allowed
+    const auto westRouteDestination31 = toPoint31(52.0, 5.0205);
+    QVERIFY(TransportJourneyPlanner::findEarliestArrival(_network, origin31, westRouteDestination31, DepartureTime, journey, getSettings(0)));
+    QCOMPARE(journey.ridesCount, 1);
+    QCOMPARE(journey.legs.size(), 3);
+}
+
+QTEST_MAIN(TestTransportJourneyPlanner)
+#include "TestTransportJourneyPlanner.moc"
@@ -0,0 +1,102 @@
+#include <OsmAndCore/Concurrent/WorkerPool.h>
+#include <OsmAndCore/QRunnableFunctor.h>
+
+#include <QtTest/QtTest>
+#include <QCoreApplication>
+#include <QAtomicInt>
+#include <QElapsedTimer>
+#include <QThread>
+
+using namespace OsmAnd;
+using WorkerPool = Concurrent::WorkerPool;
+
+class TestWorkerPool : public QObject
+{
+    Q_OBJECT
+
+private:
+    struct ConcurrencyProbe
+    {
+        ConcurrencyProbe(const int expectedConcurrency_)
+            : expectedConcurrency(expectedConcurrency_)
+            , running(0)
+            , maxRunning(0)
+        {
+        }
+
+        const int expectedConcurrency;
+        QAtomicInt running;
+        QAtomicInt maxRunning;
+
+        // Holds job until expected number of jobs run at once (or timeout expires), so that
+        // jobs run sequentially by a single worker can't reach expected concurrency
+        void job()
+        {
+            const auto nowRunning = running.fetchAndAddOrdered(1) + 1;
+            auto maxRunningSoFar = maxRunning.loadAcquire();
+            while (nowRunning > maxRunningSoFar && !maxRunning.testAndSetOrdered(maxRunningSoFar, nowRunning))
+                maxRunningSoFar = maxRunning.loadAcquire();
+
+            QElapsedTimer timer;
+            timer.start();
+            while (maxRunning.loadAcquire() < expectedConcurrency && timer.elapsed() < 5000)
+                QThread::msleep(1);
+
+            running.fetchAndSubOrdered(1);
+        }
+    };
+private slots:
+    void executeAndWaitRunsJobsConcurrently();
+    void enqueueWakesThreadPerRunnable();
+};
+
+void TestWorkerPool::executeAndWaitRunsJobsConcurrently()
+{
+    const int jobsCount = 4;
+    WorkerPool pool(WorkerPool::Order::FIFO, jobsCount);
+    ConcurrencyProbe probe(jobsCount);
+
+    QVector<WorkerPool::Job> jobs;
+    for (auto jobIndex = 0; jobIndex < jobsCount; jobIndex++)
+        jobs.push_back([&probe]() { probe.job(); });
+    pool.executeAndWait(jobs);
+
+    // Calling thread runs one job, workers woken by single batch enqueue run the rest
+    QVERIFY(probe.maxRunning.loadAcquire() > 2);
+    QCOMPARE(probe.maxRunning.loadAcquire(), jobsCount);
+}
+
+void TestWorkerPool::enqueueWakesThreadPerRunnable()
+{
+    const int jobsCount = 3;
+    WorkerPool pool(WorkerPool::Order::FIFO, jobsCount);
+
+    // Warm pool up, so that next batch is served by free threads that have to be woken
+    {
+        ConcurrencyProbe warmUpProbe(jobsCount);
+        QVector<WorkerPool::Job> jobs;
+        for (auto jobIndex = 0; jobIndex < jobsCount; jobIndex++)
+            jobs.push_back([&warmUpProbe]() { warmUpProbe.job(); });
+        pool.executeAndWait(jobs);
+    }
+    QVERIFY(pool.waitForDone(5000));
+
+    ConcurrencyProbe probe(jobsCount);
+    QVector<QRunnable*> runnables;
+    for (auto jobIndex = 0; jobIndex < jobsCount; jobIndex++)
+    {
+        runnables.push_back(new QRunnableFunctor(
+            [&probe]
+            (const QRunnableFunctor* const runnable)
+            {
+                probe.job();
+            }));
+    }
+    pool.enqueue(runnables);
+    QVERIFY(pool.waitForDone(10000));
+
+    QCOMPARE(probe.maxRunning.loadAcquire(), jobsCount);
+}
+
+QTEST_MAIN(TestWorkerPool)
+#include "TestWorkerPool.moc"
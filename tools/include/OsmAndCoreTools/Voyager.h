@@ -6,37 +6,36 @@
 #include <OsmAndCore/QtExtensions.h>
 #include <QString>
 #include <QStringList>
+#include <QList>
 #include <QDir>
 #include <QFile>
 
 #include <OsmAndCoreTools.h>
-//#include <OsmAndCore/Routing/RoutingConfiguration.h>
 
 namespace OsmAndTools
 {
     namespace Voyager
     {
+        // Batch routing benchmark: every route is calculated in own planner context, routes are
+        // spread over worker threads, and latencies and route statistics are reported as JSON
         struct OSMAND_CORE_TOOLS_API Configuration
         {
             Configuration();
-            
-            /* bool verbose;
-             bool generateXml;
-             bool doRecalculate;
-             QFileInfoList obfs;
-             QString vehicle;
-             int memoryLimit;
-             double startLatitude;
-             double startLongitude;
-             QList< std::pair<double, double> > waypoints;
-             double endLatitude;
-             double endLongitude;
-             bool leftSide;
-             QString gpxPath;
 
-             std::shared_ptr<RoutingConfiguration> routingConfig;*/
+            QFileInfoList obfs;
+            QString routingConfigPath;
+            QString vehicle;
+            int memoryLimit;
+            int threadsCount;
+            bool leftSide;
+            bool verbose;
+
+            // Each route is start point, optional waypoints and end point
+            QList< QList< std::pair<double, double> > > routes;
         };
         OSMAND_CORE_TOOLS_API bool OSMAND_CORE_TOOLS_CALL parseCommandLineArguments(const QStringList& cmdLineArgs, Configuration& cfg, QString& error);
+        // Routes file has one route per line as "lat,lon;lat,lon[;lat,lon...]", lines starting with '#' are skipped
+        OSMAND_CORE_TOOLS_API bool OSMAND_CORE_TOOLS_CALL parseRoutesFile(const QString& filePath, Configuration& cfg, QString& error);
         OSMAND_CORE_TOOLS_API void OSMAND_CORE_TOOLS_CALL logJourneyToStdOut(const Configuration& cfg);
         OSMAND_CORE_TOOLS_API QString OSMAND_CORE_TOOLS_CALL logJourneyToString(const Configuration& cfg);
     }
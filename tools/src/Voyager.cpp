@@ -3,132 +3,218 @@
 #include <iostream>
 #include <sstream>
 #include <ctime>
+#include <cmath>
 #include <chrono>
+#include <atomic>
+#include <algorithm>
+#include <vector>
 
 #include <OsmAndCore/QtExtensions.h>
 #include <QDateTime>
 #include <QTextStream>
+#include <QThread>
 
 #include <OsmAndCore/Common.h>
 #include <OsmAndCore/Data/ObfReader.h>
+#include <OsmAndCore/Data/ObfFile.h>
 #include <OsmAndCore/Utilities.h>
-//#include <OsmAndCore/Routing/RoutePlanner.h>
-//#include <OsmAndCore/Routing/RoutePlannerContext.h>
+#include <OsmAndCore/Concurrent/Thread.h>
+#include <OsmAndCore/Routing/RoutingConfiguration.h>
+#include <OsmAndCore/Routing/RoutePlanner.h>
+#include <OsmAndCore/Routing/RoutePlannerContext.h>
 
 OsmAndTools::Voyager::Configuration::Configuration()
-    //: verbose(false)
-    //, generateXml(false)
-    //, doRecalculate(false)
-    //, vehicle("car")
-    //, memoryLimit(0)
-    //, startLatitude(0)
-    //, startLongitude(0)
-    //, endLatitude(0)
-    //, endLongitude(0)
-    //, leftSide(false)
-    //, routingConfig(new RoutingConfiguration())
+    : vehicle("car")
+    , memoryLimit(0)
+    , threadsCount(1)
+    , leftSide(false)
+    , verbose(false)
 {
 }
 
+namespace
+{
+    bool parseRoutePoint(const QString& value, std::pair<double, double>& outPoint)
+    {
+        const auto coords = value.trimmed().split(QChar(','));
+        if (coords.size() != 2)
+            return false;
+
+        bool latitudeOk;
+        bool longitudeOk;
+        outPoint.first = coords[0].toDouble(&latitudeOk);
+        outPoint.second = coords[1].toDouble(&longitudeOk);
+        return latitudeOk && longitudeOk;
+    }
+}
+
 OSMAND_CORE_TOOLS_API bool OSMAND_CORE_TOOLS_CALL OsmAndTools::Voyager::parseCommandLineArguments( const QStringList& cmdLineArgs, Configuration& cfg, QString& error )
 {
-//    bool wasObfRootSpecified = false;
-//    bool wasRouterConfigSpecified = false;
-//    for (const auto& arg : constOf(cmdLineArgs))
-//    {
-//        if (arg.startsWith("-config="))
-//        {
-//            QFile configFile(arg.mid(strlen("-config=")));
-//            if(!configFile.exists())
-//            {
-//                error = "Router configuration file does not exist";
-//                return false;
-//            }
-//            configFile.open(QIODevice::ReadOnly | QIODevice::Text);
-//            if(!RoutingConfiguration::parseConfiguration(&configFile, *cfg.routingConfig.get()))
-//            {
-//                error = "Bad router configuration";
-//                return false;
-//            }
-//            configFile.close();
-//            wasRouterConfigSpecified = true;
-//        }
-//        else if (arg == "-verbose")
-//        {
-//            cfg.verbose = true;
-//        }
-//        else if (arg == "-xml")
-//        {
-//            cfg.generateXml = true;
-//        }
-//        else if (arg == "-recalc")
-//        {
-//            cfg.doRecalculate = true;
-//        }
-//        else if (arg.startsWith("-obfsDir="))
-//        {
-//            QDir obfRoot(arg.mid(strlen("-obfsDir=")));
-//            if(!obfRoot.exists())
-//            {
-//                error = "OBF directory does not exist";
-//                return false;
-//            }
-//            Utilities::findFiles(obfRoot, QStringList() << "*.obf", cfg.obfs);
-//            wasObfRootSpecified = true;
-//        }
-//        else if (arg.startsWith("-vehicle="))
-//        {
-//            cfg.vehicle = arg.mid(strlen("-vehicle="));
-//        }
-//        else if (arg.startsWith("-memlimit="))
-//        {
-//            bool ok;
-//            cfg.memoryLimit = arg.mid(strlen("-memlimit=")).toInt(&ok);
-//            if(!ok || cfg.memoryLimit < 0)
-//            {
-//                error = "Bad memory limit";
-//                return false;
-//            }
-//        }
-//        else if (arg.startsWith("-start="))
-//        {
-//            auto coords = arg.mid(strlen("-start=")).split(QChar(';'));
-//            cfg.startLatitude = coords[0].toDouble();
-//            cfg.startLongitude = coords[1].toDouble();
-//        }
-//        else if (arg.startsWith("-waypoint="))
-//        {
-//            auto coords = arg.mid(strlen("-waypoint=")).split(QChar(';'));
-//            auto latitude = coords[0].toDouble();
-//            auto longitude = coords[1].toDouble();
-//            cfg.waypoints.push_back(std::pair<double, double>(latitude, longitude));
-//        }
-//        else if (arg.startsWith("-end="))
-//        {
-//            auto coords = arg.mid(strlen("-end=")).split(QChar(';'));
-//            cfg.endLatitude = coords[0].toDouble();
-//            cfg.endLongitude = coords[1].toDouble();
-//        }
-//        else if (arg == "-left")
-//        {
-//            cfg.leftSide = true;
-//        }
-//        else if (arg.startsWith("-gpx="))
-//        {
-//            cfg.gpxPath = arg.mid(strlen("-gpx="));
-//        }
-//    }
-//
-//    if(!wasObfRootSpecified)
-//        Utilities::findFiles(QDir::current(), QStringList() << "*.obf", cfg.obfs);
-//    if(cfg.obfs.isEmpty())
-//    {
-//        error = "No OBF files loaded";
-//        return false;
-//    }
-//    if(!wasRouterConfigSpecified)
-//        RoutingConfiguration::loadDefault(*cfg.routingConfig);
-    
+    bool wasObfRootSpecified = false;
+    std::pair<double, double> startPoint;
+    std::pair<double, double> endPoint;
+    QList< std::pair<double, double> > waypoints;
+    bool wasStartSpecified = false;
+    bool wasEndSpecified = false;
+    for (const auto& arg : OsmAnd::constOf(cmdLineArgs))
+    {
+        if (arg.startsWith("-config="))
+        {
+            cfg.routingConfigPath = arg.mid(strlen("-config="));
+            if (!QFile::exists(cfg.routingConfigPath))
+            {
+                error = "Router configuration file does not exist";
+                return false;
+            }
+        }
+        else if (arg == "-verbose")
+        {
+            cfg.verbose = true;
+        }
+        else if (arg.startsWith("-obfsDir="))
+        {
+            QDir obfRoot(arg.mid(strlen("-obfsDir=")));
+            if (!obfRoot.exists())
+            {
+                error = "OBF directory does not exist";
+                return false;
+            }
+            OsmAnd::Utilities::findFiles(obfRoot, QStringList() << "*.obf", cfg.obfs);
+            wasObfRootSpecified = true;
+        }
+        else if (arg.startsWith("-vehicle="))
+        {
+            cfg.vehicle = arg.mid(strlen("-vehicle="));
+        }
+        else if (arg.startsWith("-memlimit="))
+        {
+            bool ok;
+            cfg.memoryLimit = arg.mid(strlen("-memlimit=")).toInt(&ok);
+            if (!ok || cfg.memoryLimit < 0)
+            {
+                error = "Bad memory limit";
+                return false;
+            }
+        }
+        else if (arg.startsWith("-threads="))
+        {
+            bool ok;
+            cfg.threadsCount = arg.mid(strlen("-threads=")).toInt(&ok);
+            if (!ok || cfg.threadsCount <= 0)
+            {
+                error = "Bad threads count";
+                return false;
+            }
+        }
+        else if (arg.startsWith("-routes="))
+        {
+            if (!parseRoutesFile(arg.mid(strlen("-routes=")), cfg, error))
+                return false;
+        }
+        else if (arg.startsWith("-start="))
+        {
+            wasStartSpecified = parseRoutePoint(arg.mid(strlen("-start=")), startPoint);
+            if (!wasStartSpecified)
+            {
+                error = "Bad start point";
+                return false;
+            }
+        }
+        else if (arg.startsWith("-waypoint="))
+        {
+            std::pair<double, double> waypoint;
+            if (!parseRoutePoint(arg.mid(strlen("-waypoint=")), waypoint))
+            {
+                error = "Bad waypoint";
+                return false;
+            }
+            waypoints.push_back(waypoint);
+        }
+        else if (arg.startsWith("-end="))
+        {
+            wasEndSpecified = parseRoutePoint(arg.mid(strlen("-end=")), endPoint);
+            if (!wasEndSpecified)
+            {
+                error = "Bad end point";
+                return false;
+            }
+        }
+        else if (arg == "-left")
+        {
+            cfg.leftSide = true;
+        }
+    }
+
+    // Single route may be given right in command line
+    if (wasStartSpecified && wasEndSpecified)
+    {
+        QList< std::pair<double, double> > route;
+        route.push_back(startPoint);
+        route.append(waypoints);
+        route.push_back(endPoint);
+        cfg.routes.push_back(route);
+    }
+    else if (wasStartSpecified || wasEndSpecified)
+    {
+        error = "Both start and end points have to be specified";
+        return false;
+    }
+
+    if (!wasObfRootSpecified)
+        OsmAnd::Utilities::findFiles(QDir::current(), QStringList() << "*.obf", cfg.obfs);
+    if (cfg.obfs.isEmpty())
+    {
+        error = "No OBF files loaded";
+        return false;
+    }
+    if (cfg.routes.isEmpty())
+    {
+        error = "No routes specified";
+        return false;
+    }
+
+    return true;
+}
+
+OSMAND_CORE_TOOLS_API bool OSMAND_CORE_TOOLS_CALL OsmAndTools::Voyager::parseRoutesFile( const QString& filePath, Configuration& cfg, QString& error )
+{
+    QFile routesFile(filePath);
+    if (!routesFile.open(QIODevice::ReadOnly | QIODevice::Text))
+    {
+        error = "Routes file can not be opened";
+        return false;
+    }
+
+    QTextStream routesStream(&routesFile);
+    auto lineNumber = 0;
+    while (!routesStream.atEnd())
+    {
+        const auto line = routesStream.readLine().trimmed();
+        lineNumber++;
+        if (line.isEmpty() || line.startsWith(QChar('#')))
+            continue;
+
+        QList< std::pair<double, double> > route;
+        const auto values = line.split(QChar(';'), QString::SkipEmptyParts);
+        for (const auto& value : values)
+        {
+            std::pair<double, double> point;
+            if (!parseRoutePoint(value, point))
+            {
+                error = QString("Bad point '%1' at line %2 of routes file").arg(value).arg(lineNumber);
+                return false;
+            }
+            route.push_back(point);
+        }
+        if (route.size() < 2)
+        {
+            error = QString("Route at line %1 of routes file has less than 2 points").arg(lineNumber);
+            return false;
+        }
+
+        cfg.routes.push_back(route);
+    }
+
     return true;
 }
 
@@ -160,291 +246,225 @@ OSMAND_CORE_TOOLS_API QString OSMAND_CORE_TOOLS_CALL OsmAndTools::Voyager::logJo
 #endif
 }
 
+namespace
+{
+    struct RouteMeasurement
+    {
+        RouteMeasurement()
+            : wasFound(false)
+            , latency(0.0)
+            , distance(0.0f)
+            , time(0.0f)
+            , visitedSegments(0)
+            , forwardIterations(0)
+            , backwardIterations(0)
+            , sizeOfDQueue(0)
+            , sizeOfRQueue(0)
+            , timeToLoad(0)
+            , timeToCalculate(0)
+            , loadedTiles(0)
+            , distinctLoadedTiles(0)
+            , unloadedTiles(0)
+        {
+        }
+
+        bool wasFound;
+        QString error;
+        double latency;
+        float distance;
+        float time;
+        uint32_t visitedSegments;
+        uint32_t forwardIterations;
+        uint32_t backwardIterations;
+        uint32_t sizeOfDQueue;
+        uint32_t sizeOfRQueue;
+        uint64_t timeToLoad;
+        uint64_t timeToCalculate;
+        uint32_t loadedTiles;
+        uint32_t distinctLoadedTiles;
+        uint32_t unloadedTiles;
+    };
+
+    QString escapeJsonString(const QString& value)
+    {
+        QString escaped;
+        for (const auto& c : OsmAnd::constOf(value))
+        {
+            if (c == QChar('"') || c == QChar('\\'))
+                escaped += QChar('\\');
+            else if (c.unicode() < 0x20)
+            {
+                escaped += QString("\\u%1").arg(c.unicode(), 4, 16, QChar('0'));
+                continue;
+            }
+            escaped += c;
+        }
+        return escaped;
+    }
+
+    // Nearest-rank percentile of sorted values
+    double percentile(const std::vector<double>& sortedValues, const double percent)
+    {
+        if (sortedValues.empty())
+            return 0.0;
+
+        auto rank = static_cast<size_t>(std::ceil(percent / 100.0 * sortedValues.size()));
+        rank = std::max<size_t>(rank, 1);
+        return sortedValues[rank - 1];
+    }
+}
+
 #if defined(_UNICODE) || defined(UNICODE)
 void performJourney(std::wostream &output, const OsmAndTools::Voyager::Configuration& cfg)
 #else
 void performJourney(std::ostream &output, const OsmAndTools::Voyager::Configuration& cfg)
 #endif
 {
-//    if(cfg.generateXml)
-//    {
-//#if defined(_UNICODE) || defined(UNICODE)
-//        output << xT("<?xml version=\"1.0\" encoding=\"UTF-16\"?>") << std::endl;
-//#else
-//        output << xT("<?xml version=\"1.0\" encoding=\"UTF-8\"?>") << std::endl;
-//#endif
-//    }
-//
-//    QList< std::shared_ptr<OsmAnd::ObfReader> > obfData;
-//    for(auto itObf = cfg.obfs.cbegin(); itObf != cfg.obfs.cend(); ++itObf)
-//    {
-//        const auto& obf = *itObf;
-//        std::shared_ptr<OsmAnd::ObfReader> obfReader(new OsmAnd::ObfReader(std::shared_ptr<QIODevice>(new QFile(obf.absoluteFilePath()))));
-//        obfData.push_back(obfReader);
-//    }
-//
-//    OsmAnd::RoutePlannerContext plannerContext(obfData, cfg.routingConfig, cfg.vehicle, false);
-//    std::shared_ptr<const OsmAnd::Model::Road> startRoad;
-//    if(!OsmAnd::RoutePlanner::findClosestRoadPoint(&plannerContext, cfg.startLatitude, cfg.startLongitude, &startRoad))
-//    {
-//        if(cfg.generateXml)
-//            output << xT("<!--");
-//        output << xT("Failed to find road near start point");
-//        if(cfg.generateXml)
-//            output << xT("-->");
-//        output << std::endl;
-//        return;
-//    }
-//    std::shared_ptr<const OsmAnd::Model::Road> endRoad;
-//    if(!OsmAnd::RoutePlanner::findClosestRoadPoint(&plannerContext, cfg.endLatitude, cfg.endLongitude, &endRoad))
-//    {
-//        if(cfg.generateXml)
-//            output << xT("<!--");
-//        output << xT("Failed to find road near end point");
-//        if(cfg.generateXml)
-//            output << xT("-->");
-//        output << std::endl;
-//        return;
-//    }
-//
-//    if(cfg.verbose)
-//    {
-//        if(cfg.generateXml)
-//            output << xT("<!--");
-//        output << xT("Start point (LAT ") << cfg.startLatitude << xT("; LON ") << cfg.startLongitude << xT("):");
-//        if(cfg.generateXml)
-//            output << xT("-->");
-//        output << std::endl;
-//        if(cfg.generateXml)
-//            output << xT("<!--");
-//        output << xT("\tRoad name(s): ");
-//        if(startRoad->names.size() == 0)
-//        {
-//            output << xT("\t[none] (") << startRoad->id << xT(")");
-//            if(cfg.generateXml)
-//                output << xT("-->");
-//            output << std::endl;
-//        }
-//        else
-//        {
-//            for(auto itName = startRoad->names.cbegin(); itName != startRoad->names.cend(); ++itName)
-//                output << QStringToStlString(itName.value()) << xT("; ");
-//            output << xT(" (") << startRoad->id << xT(")");
-//            if(cfg.generateXml)
-//                output << xT("-->");
-//            output << std::endl;
-//        }
-//        output << std::endl;
-//    
-//        if(cfg.generateXml)
-//            output << xT("<!--");
-//        output << xT("End point (LAT ") << cfg.endLatitude << xT("; LON ") << cfg.endLongitude << xT("):");
-//        if(cfg.generateXml)
-//            output << xT("-->");
-//        output << std::endl;
-//        if(cfg.generateXml)
-//            output << xT("<!--");
-//        output << xT("\tRoad name(s): ");
-//        if(endRoad->names.size() == 0)
-//        {
-//            output << xT("\t[none] (") << endRoad->id << xT(")");
-//            if(cfg.generateXml)
-//                output << xT("-->");
-//            output << std::endl;
-//        }
-//        else
-//        {
-//            for(auto itName = endRoad->names.cbegin(); itName != endRoad->names.cend(); ++itName)
-//                output << QStringToStlString(itName.value()) << xT("; ");
-//            output << xT(" (") << endRoad->id << xT(")");
-//            if(cfg.generateXml)
-//                output << xT("-->");
-//            output << std::endl;
-//        }
-//        output << std::endl;
-//    }
-//
-//    QList< std::pair<double, double> > points;
-//    points.push_back(std::pair<double, double>(cfg.startLatitude, cfg.startLongitude));
-//    for(auto itIntermediatePoint = cfg.waypoints.cbegin(); itIntermediatePoint != cfg.waypoints.cend(); ++itIntermediatePoint)
-//        points.push_back(*itIntermediatePoint);
-//    points.push_back(std::pair<double, double>(cfg.endLatitude, cfg.endLongitude));
-//
-//    QList< std::shared_ptr<OsmAnd::RouteSegment> > route;
-//    auto routeCalculationStart = std::chrono::steady_clock::now();
-//    if(cfg.verbose)
-//    {
-//        if(cfg.generateXml)
-//            output << xT("<!--");
-//        output << xT("Started route calculation ") << QStringToStlString(QTime::currentTime().toString());
-//        if(cfg.generateXml)
-//            output << xT("-->");
-//        output << std::endl;
-//    }
-//    OsmAnd::RouteCalculationResult routeFound =
-//            OsmAnd::RoutePlanner::calculateRoute(&plannerContext, points, cfg.leftSide, nullptr);
-//    route = routeFound.list;
-//    auto routeCalculationFinish = std::chrono::steady_clock::now();
-//    if(cfg.verbose)
-//    {
-//        if(cfg.generateXml)
-//            output << xT("<!--");
-//        output << xT("Finished route calculation ") << QStringToStlString(QTime::currentTime().toString()) << xT(", took ") << std::chrono::duration<double, std::milli> (routeCalculationFinish - routeCalculationStart).count() << xT(" ms");
-//        if(cfg.generateXml)
-//            output << xT("-->");
-//        output << std::endl;
-//    }
-//    if(cfg.doRecalculate)
-//    {
-//        auto routeRecalculationStart = std::chrono::steady_clock::now();
-//        if(cfg.verbose)
-//        {
-//            if(cfg.generateXml)
-//                output << xT("<!--");
-//            output << xT("Started route recalculation ") << QStringToStlString(QTime::currentTime().toString());
-//            if(cfg.generateXml)
-//                output << xT("-->");
-//            output << std::endl;
-//        }
-//        routeFound = OsmAnd::RoutePlanner::calculateRoute(&plannerContext, points, cfg.leftSide, nullptr);
-//        route = routeFound.list;
-//        auto routeRecalculationFinish = std::chrono::steady_clock::now();
-//        if(cfg.verbose)
-//        {
-//            if(cfg.generateXml)
-//                output << xT("<!--");
-//            output << xT("Finished route recalculation ") << QStringToStlString(QTime::currentTime().toString()) << xT(", took ") << std::chrono::duration<double, std::milli> (routeRecalculationFinish - routeRecalculationStart).count() << xT(" ms");
-//            if(cfg.generateXml)
-//                output << xT("-->");
-//            output << std::endl;
-//        }
-//    }
-//    if(routeFound.warnMessage == "")
-//    {
-//        if(cfg.generateXml)
-//            output << xT("<!--");
-//        output << xT("FAILED TO FIND ROUTE!") << QStringToStlString(routeFound.warnMessage);
-//        if(cfg.generateXml)
-//            output << xT("-->");
-//        output << std::endl;
-//    }
-//
-//    float totalTime = 0.0f;
-//    float totalDistance = 0.0f;
-//    for(auto itSegment = route.cbegin(); itSegment != route.cend(); ++itSegment)
-//    {
-//        auto segment = *itSegment;
-//
-//        totalTime += segment->time;
-//        totalDistance += segment->distance;
-//    }
-//
-//    if(cfg.generateXml)
-//        output << xT("<test") << std::endl;
-//    else
-//        output << xT("ROUTE:") << std::endl;
-//
-//    output << xT("\tregions=\"\"") << std::endl;
-//    output << xT("\tdescription=\"\"") << std::endl;
-//    output << xT("\tbest_percent=\"\"") << std::endl;
-//    output << xT("\tvehicle=\"") << QStringToStlString(cfg.vehicle) << xT("\"") << std::endl;
-//    output << xT("\tstart_lat=\"") << cfg.startLatitude << xT("\"") << std::endl;
-//    output << xT("\tstart_lon=\"") << cfg.startLongitude << xT("\"") << std::endl;
-//    output << xT("\ttarget_lat=\"") << cfg.endLatitude << xT("\"") << std::endl;
-//    output << xT("\ttarget_lon=\"") << cfg.endLongitude << xT("\"") << std::endl;
-//    output << xT("\tloadedTiles=\"") << 0 << xT("\"") << std::endl;
-//    output << xT("\tvisitedSegments=\"") << 0 << xT("\"") << std::endl;
-//    output << xT("\tcomplete_distance=\"") << totalDistance << xT("\"") << std::endl;
-//    output << xT("\tcomplete_time=\"") << totalTime << xT("\"") << std::endl;
-//    output << xT("\trouting_time=\"") << 0 << xT("\"") << std::endl;
-//
-//    if(cfg.generateXml)
-//        output << xT(">") << std::endl;
-//    else
-//        output << std::endl;
-//
-//    std::unique_ptr<QFile> gpxFile;
-//    std::unique_ptr<QTextStream> gpxStream;
-//    if(!cfg.gpxPath.isEmpty())
-//    {
-//        gpxFile.reset(new QFile(cfg.gpxPath));
-//        gpxFile->open(QIODevice::WriteOnly | QIODevice::Truncate | QIODevice::Text);
-//        gpxStream.reset(new QTextStream(gpxFile.get()));
-//    }
-//    if(gpxFile && gpxFile->isOpen())
-//    {
-//        *(gpxStream.get()) << "<?xml version='1.0' encoding='UTF-8' standalone='yes' ?>\n";
-//        *(gpxStream.get()) << "<gpx version=\"1.0\" creator=\"OsmAnd Voyager tool\" xmlns=\"http://www.topografix.com/GPX/1/1\" xmlns:xsi=\"http://www.w3.org/2001/XMLSchema-instance\" xsi:schemaLocation=\"http://www.topografix.com/GPX/1/1 http://www.topografix.com/GPX/1/1/gpx.xsd\">\n";
-//        *(gpxStream.get()) << "\t<trk>\n";
-//        *(gpxStream.get()) << "\t\t<trkseg>\n";
-//    }
-//    for(auto itSegment = route.cbegin(); itSegment != route.cend(); ++itSegment)
-//    {
-//        auto segment = *itSegment;
-//
-//        if(cfg.generateXml)
-//            output << xT("\t<segment") << std::endl;
-//        else
-//            output << xT("\tSEGMENT:") << std::endl;
-//
-//        output << xT("\t\tid=\"") << segment->road->id << xT("\"") << std::endl;
-//        output << xT("\t\tstart=\"") << segment->startPointIndex << xT("\"") << std::endl;
-//        output << xT("\t\tend=\"") << segment->endPointIndex << xT("\"") << std::endl;
-//
-//        QString name;
-//        if(!segment->road->names.isEmpty())
-//            name += segment->road->names.cbegin().value();
-//        /*String ref = res.getObject().getRef();
-//        if (ref != null) {
-//            name += " (" + ref + ") ";
-//        }*/
-//        output << xT("\t\tname=\"") << QStringToStlString(name) << xT("\"") << std::endl;
-//
-//        output << xT("\t\ttime=\"") << segment->time << xT("\"") << std::endl;
-//        output << xT("\t\tdistance=\"") << segment->distance << xT("\"") << std::endl;
-//        /*float ms = res.getObject().getMaximumSpeed();
-//        if(ms > 0) {
-//            additional.append("maxspeed = \"").append(ms * 3.6f).append("\" ").append(res.getObject().getHighway()).append(" ");
-//        }*/
-//        /*
-//        if (res.getTurnType() != null) {
-//            additional.append("turn = \"").append(res.getTurnType()).append("\" ");
-//            additional.append("turn_angle = \"").append(res.getTurnType().getTurnAngle()).append("\" ");
-//            if (res.getTurnType().getLanes() != null) {
-//                additional.append("lanes = \"").append(Arrays.toString(res.getTurnType().getLanes())).append("\" ");
-//            }
-//        }*/
-//        output << xT("\t\tstart_bearing=\"") << segment->getBearingBegin() << xT("\"") << std::endl;
-//        output << xT("\t\tend_bearing=\"") << segment->getBearingEnd() << xT("\"") << std::endl;
-//        //additional.append("description = \"").append(res.getDescription()).append("\" ");
-//        
-//        if(cfg.generateXml)
-//            output << xT("\t/>") << std::endl;
-//        else
-//            output << std::endl;
-//
-//        if(gpxFile && gpxFile->isOpen())
-//        {
-//            output << xT("\t\tstart=\"") << segment->startPointIndex << xT("\"") << std::endl;
-//            output << xT("\t\tend=\"") << segment->endPointIndex << xT("\"") << std::endl;
-//            for(auto pointIdx = segment->startPointIndex; pointIdx < segment->endPointIndex; pointIdx++)
-//            {
-//                const auto& point = segment->road->points[pointIdx];
-//
-//                *(gpxStream.get()) << "\t\t\t<trkpt lon=\"" << OsmAnd::Utilities::get31LongitudeX(point.x) << "\" lat=\"" << OsmAnd::Utilities::get31LatitudeY(point.y) << "\"/>\n";
-//            }
-//        }
-//    }
-//
-//    if(gpxFile && gpxFile->isOpen())
-//    {
-//        *(gpxStream.get()) << "\t\t</trkseg>\n";
-//        *(gpxStream.get()) << "\t</trk>\n";
-//        *(gpxStream.get()) << "</gpx>\n";
-//        gpxStream->flush();
-//        gpxFile->close();
-//    }
-//
-//    if(cfg.generateXml)
-//        output << xT("</test>") << std::endl;
+    const std::shared_ptr<OsmAnd::RoutingConfiguration> routingConfig(new OsmAnd::RoutingConfiguration());
+    if (!cfg.routingConfigPath.isEmpty())
+    {
+        QFile configFile(cfg.routingConfigPath);
+        configFile.open(QIODevice::ReadOnly | QIODevice::Text);
+        if (!OsmAnd::RoutingConfiguration::parseConfiguration(&configFile, *routingConfig))
+        {
+            output << xT("{ \"error\": \"Bad router configuration\" }") << std::endl;
+            return;
+        }
+        configFile.close();
+    }
+    else
+        OsmAnd::RoutingConfiguration::loadDefault(*routingConfig);
+
+    QList< std::shared_ptr<OsmAnd::ObfReader> > obfReaders;
+    for (const auto& obf : OsmAnd::constOf(cfg.obfs))
+    {
+        const std::shared_ptr<const OsmAnd::ObfFile> obfFile(new OsmAnd::ObfFile(obf.absoluteFilePath()));
+        obfReaders.push_back(std::shared_ptr<OsmAnd::ObfReader>(new OsmAnd::ObfReader(obfFile)));
+    }
+
+    // Routes are taken by workers one by one, each route gets own planner context so that
+    // its statistics are not mixed with other routes, while decoded tiles are still shared
+    std::vector<RouteMeasurement> measurements(cfg.routes.size());
+    std::atomic<int> nextRouteIndex(0);
+    const auto worker =
+        [&cfg, &obfReaders, &routingConfig, &measurements, &nextRouteIndex]
+        ()
+        {
+            for (;;)
+            {
+                const auto routeIndex = nextRouteIndex.fetch_add(1);
+                if (routeIndex >= cfg.routes.size())
+                    return;
+                auto& measurement = measurements[routeIndex];
+
+                OsmAnd::RoutePlannerContext plannerContext(
+                    obfReaders,
+                    routingConfig,
+                    cfg.vehicle,
+                    false,
+                    std::numeric_limits<float>::quiet_NaN(),
+                    nullptr,
+                    cfg.memoryLimit > 0 ? static_cast<size_t>(cfg.memoryLimit) : 1000000);
+
+                const auto routeCalculationStart = std::chrono::steady_clock::now();
+                const auto result = OsmAnd::RoutePlanner::calculateRoute(&plannerContext, cfg.routes[routeIndex], cfg.leftSide, nullptr);
+                const auto routeCalculationFinish = std::chrono::steady_clock::now();
+                measurement.latency = std::chrono::duration<double, std::milli>(routeCalculationFinish - routeCalculationStart).count();
+
+                measurement.wasFound = !result.list.isEmpty();
+                measurement.error = result.warnMessage;
+                for (const auto& segment : OsmAnd::constOf(result.list))
+                {
+                    measurement.distance += segment->distance;
+                    measurement.time += segment->time;
+                }
+
+                if (const auto statistics = plannerContext.getRouteStatistics())
+                {
+                    measurement.visitedSegments = statistics->visitedSegments;
+                    measurement.forwardIterations = statistics->forwardIterations;
+                    measurement.backwardIterations = statistics->backwardIterations;
+                    measurement.sizeOfDQueue = statistics->sizeOfDQueue;
+                    measurement.sizeOfRQueue = statistics->sizeOfRQueue;
+                    measurement.timeToLoad = statistics->timeToLoad;
+                    measurement.timeToCalculate = statistics->timeToCalculate;
+                    measurement.loadedTiles = statistics->loadedTiles;
+                    measurement.distinctLoadedTiles = statistics->distinctLoadedTiles;
+                    measurement.unloadedTiles = statistics->unloadedTiles;
+                }
+            }
+        };
+
+    const auto benchmarkStart = std::chrono::steady_clock::now();
+    QList< std::shared_ptr<OsmAnd::Concurrent::Thread> > threads;
+    for (auto threadIdx = 1; threadIdx < cfg.threadsCount; threadIdx++)
+    {
+        const std::shared_ptr<OsmAnd::Concurrent::Thread> thread(new OsmAnd::Concurrent::Thread(worker));
+        thread->start();
+        threads.push_back(thread);
+    }
+    worker();
+    for (const auto& thread : OsmAnd::constOf(threads))
+        thread->wait();
+    const auto benchmarkFinish = std::chrono::steady_clock::now();
+
+    std::vector<double> latencies;
+    auto failedRoutesCount = 0;
+    auto latenciesSum = 0.0;
+    for (const auto& measurement : measurements)
+    {
+        if (!measurement.wasFound)
+        {
+            failedRoutesCount++;
+            continue;
+        }
+        latencies.push_back(measurement.latency);
+        latenciesSum += measurement.latency;
+    }
+    std::sort(latencies.begin(), latencies.end());
+
+    output << xT("{") << std::endl;
+    output << xT("  \"vehicle\": \"") << QStringToStlString(escapeJsonString(cfg.vehicle)) << xT("\",") << std::endl;
+    output << xT("  \"threads\": ") << cfg.threadsCount << xT(",") << std::endl;
+    output << xT("  \"routes\": ") << measurements.size() << xT(",") << std::endl;
+    output << xT("  \"failedRoutes\": ") << failedRoutesCount << xT(",") << std::endl;
+    output << xT("  \"wallTimeMs\": ") << std::chrono::duration<double, std::milli>(benchmarkFinish - benchmarkStart).count() << xT(",") << std::endl;
+    output << xT("  \"latencyMs\": {");
+    output << xT(" \"mean\": ") << (latencies.empty() ? 0.0 : latenciesSum / latencies.size());
+    output << xT(", \"p50\": ") << percentile(latencies, 50.0);
+    output << xT(", \"p90\": ") << percentile(latencies, 90.0);
+    output << xT(", \"p95\": ") << percentile(latencies, 95.0);
+    output << xT(", \"p99\": ") << percentile(latencies, 99.0);
+    output << xT(", \"max\": ") << (latencies.empty() ? 0.0 : latencies.back());
+    output << xT(" },") << std::endl;
+    output << xT("  \"results\": [") << std::endl;
+    for (auto routeIndex = 0u; routeIndex < measurements.size(); routeIndex++)
+    {
+        const auto& measurement = measurements[routeIndex];
+
+        output << xT("    {");
+        output << xT(" \"index\": ") << routeIndex;
+        output << xT(", \"found\": ") << (measurement.wasFound ? xT("true") : xT("false"));
+        if (!measurement.error.isEmpty())
+            output << xT(", \"error\": \"") << QStringToStlString(escapeJsonString(measurement.error)) << xT("\"");
+        output << xT(", \"latencyMs\": ") << measurement.latency;
+        output << xT(", \"distance\": ") << measurement.distance;
+        output << xT(", \"time\": ") << measurement.time;
+        output << xT(", \"visitedSegments\": ") << measurement.visitedSegments;
+        output << xT(", \"forwardIterations\": ") << measurement.forwardIterations;
+        output << xT(", \"backwardIterations\": ") << measurement.backwardIterations;
+        output << xT(", \"sizeOfDQueue\": ") << measurement.sizeOfDQueue;
+        output << xT(", \"sizeOfRQueue\": ") << measurement.sizeOfRQueue;
+        output << xT(", \"timeToLoadMs\": ") << measurement.timeToLoad;
+        output << xT(", \"timeToCalculateMs\": ") << measurement.timeToCalculate;
+        output << xT(", \"loadedTiles\": ") << measurement.loadedTiles;
+        output << xT(", \"distinctLoadedTiles\": ") << measurement.distinctLoadedTiles;
+        output << xT(", \"unloadedTiles\": ") << measurement.unloadedTiles;
+        output << xT(" }") << (routeIndex + 1 < measurements.size() ? xT(",") : xT("")) << std::endl;
+
+        if (cfg.verbose && !measurement.wasFound)
+            std::cerr << "Route " << routeIndex << " failed: " << qPrintable(measurement.error) << std::endl;
+    }
+    output << xT("  ]") << std::endl;
+    output << xT("}") << std::endl;
 }